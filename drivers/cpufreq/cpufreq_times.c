@@ -13,26 +13,59 @@
  *
  */
 
+#include <linux/cpu.h>
 #include <linux/cpufreq.h>
 #include <linux/cpufreq_times.h>
 #include <linux/cputime.h>
 #include <linux/hashtable.h>
 #include <linux/init.h>
+#include <linux/irq_work.h>
+#include <linux/llist.h>
+#include <linux/percpu.h>
 #include <linux/proc_fs.h>
 #include <linux/sched.h>
 #include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/threads.h>
+#include <linux/workqueue.h>
 
 #define UID_HASH_BITS 10
+#define UID_SHARD_HASH_BITS 8
+#define UID_SHARD_PENDING 16
 
 DECLARE_HASHTABLE(uid_hash_table, UID_HASH_BITS);
 
 static DEFINE_SPINLOCK(task_time_in_state_lock); /* task->time_in_state */
 static DEFINE_SPINLOCK(uid_lock); /* uid_hash_table */
 
+/**
+ * struct uid_entry - registry of uids with time_in_state stats
+ * @uid: the uid
+ * @hash: node in uid_hash_table
+ * @rcu: used to free the entry after a grace period
+ *
+ * The stats themselves live in the per-cpu uid shards and are folded
+ * together by readers.
+ */
 struct uid_entry {
+	uid_t uid;
+	struct hlist_node hash;
+	struct rcu_head rcu;
+};
+
+/**
+ * struct uid_shard_entry - one cpu's share of a uid's time_in_state
+ * @uid: the uid
+ * @max_state: number of entries in time_in_state
+ * @hash: node in the owning uid_shard's table
+ * @rcu: used to free the entry after a grace period
+ * @time_in_state: cputime spent by the uid at each frequency on this cpu
+ *
+ * Entries are never resized in place: a larger one replaces the old one,
+ * so max_state is fixed for the life of an entry.
+ */
+struct uid_shard_entry {
 	uid_t uid;
 	unsigned int max_state;
 	struct hlist_node hash;
@@ -40,6 +73,94 @@ struct uid_entry {
 	u64 time_in_state[0];
 };
 
+/**
+ * struct uid_shard - per-cpu uid time_in_state table
+ * @lock: serializes table changes between the fill work and uid removal
+ * @table: uid_shard_entry hash table, readable under rcu_read_lock()
+ * @nr_pending: number of used entries in @pending
+ * @pending: uids the table has no (large enough) entry for
+ *
+ * The cputime accounting path only looks entries up under RCU and adds
+ * to the owning cpu's counters. It never allocates or takes a lock: on
+ * a miss the task keeps the time in its uid_time_owed, and the uid is
+ * left in @pending for uid_shards_fill_work to add an entry for. The
+ * work touches the counters and @pending only from the owning cpu with
+ * IRQs off.
+ */
+struct uid_shard {
+	spinlock_t lock;
+	DECLARE_HASHTABLE(table, UID_SHARD_HASH_BITS);
+	unsigned int nr_pending;
+	uid_t pending[UID_SHARD_PENDING];
+};
+
+static DEFINE_PER_CPU(struct uid_shard, uid_shards);
+
+/**
+ * struct uid_shard_fill - state of uid_shards_fill_work for one shard
+ * @shard: the shard being filled
+ * @nr: number of used entries in @pending
+ * @pending: uids taken from the shard
+ * @entry: preallocated entries for @pending
+ */
+struct uid_shard_fill {
+	struct uid_shard *shard;
+	unsigned int nr;
+	uid_t pending[UID_SHARD_PENDING];
+	struct uid_shard_entry *entry[UID_SHARD_PENDING];
+};
+
+/**
+ * struct uid_time_owed - uid time a task could not charge to a shard yet
+ * @node: entry in uid_owed_orphans once the task is freed
+ * @uid: the uid the time belongs to
+ * @owed: whether time_in_state holds any time
+ * @max_state: number of entries in time_in_state
+ * @time_in_state: owed cputime at each frequency
+ *
+ * Allocated at fork next to the task's own time_in_state, so the time is
+ * never dropped for lack of a shard entry. It is repaid on the task's
+ * first tick on a cpu with a large enough entry, or settled by
+ * uid_shards_fill_work if the task is freed first. Time is only owed to
+ * one uid at a time: if a task that changed uid misses for both, the new
+ * uid's time is charged to the old one until the debt is repaid.
+ */
+struct uid_time_owed {
+	struct llist_node node;
+	uid_t uid;
+	bool owed;
+	unsigned int max_state;
+	u64 time_in_state[0];
+};
+
+static LLIST_HEAD(uid_owed_orphans);
+
+static void uid_shards_fill_work(struct work_struct *work);
+static DECLARE_WORK(uid_shards_fill, uid_shards_fill_work);
+
+/*
+ * The accounting hook can run under rq->lock, where queueing work could
+ * deadlock on the worker wakeup, so it only raises this irq_work.
+ */
+static void uid_shards_kick_func(struct irq_work *work)
+{
+	schedule_work(&uid_shards_fill);
+}
+
+static DEFINE_PER_CPU(struct irq_work, uid_shards_kick) = {
+	.func = uid_shards_kick_func,
+};
+
+/**
+ * struct uid_fold - scratch buffer for folding uid shards together
+ * @max_state: number of entries in time_in_state
+ * @time_in_state: summed cputime at each frequency across all cpus
+ */
+struct uid_fold {
+	unsigned int max_state;
+	u64 time_in_state[0];
+};
+
 /**
  * struct cpu_freqs - per-cpu frequency information
  * @offset: start of these freqs' stats in task time_in_state array
@@ -83,45 +204,254 @@ static struct uid_entry *find_uid_entry_locked(uid_t uid)
 	return NULL;
 }
 
-/* Caller must hold uid lock */
-static struct uid_entry *find_or_register_uid_locked(uid_t uid)
+static void register_uid(uid_t uid)
+{
+	struct uid_entry *uid_entry;
+	unsigned long flags;
+
+	uid_entry = kzalloc(sizeof(*uid_entry), GFP_KERNEL);
+	if (!uid_entry)
+		return;
+	uid_entry->uid = uid;
+
+	spin_lock_irqsave(&uid_lock, flags);
+	if (!find_uid_entry_locked(uid)) {
+		hash_add_rcu(uid_hash_table, &uid_entry->hash, uid);
+		uid_entry = NULL;
+	}
+	spin_unlock_irqrestore(&uid_lock, flags);
+
+	kfree(uid_entry);
+}
+
+/* Caller must hold rcu_read_lock() or shard lock */
+static struct uid_shard_entry *find_shard_entry_rcu(struct uid_shard *shard,
+						    uid_t uid)
+{
+	struct uid_shard_entry *entry;
+
+	hash_for_each_possible_rcu(shard->table, entry, hash, uid) {
+		if (entry->uid == uid)
+			return entry;
+	}
+	return NULL;
+}
+
+/* Called on the shard's cpu with IRQs off */
+static void uid_shard_request(struct uid_shard *shard, uid_t uid)
+{
+	unsigned int i;
+
+	for (i = 0; i < shard->nr_pending; i++)
+		if (shard->pending[i] == uid)
+			return;
+
+	/* When full, the uid is requested again on its next tick */
+	if (shard->nr_pending < UID_SHARD_PENDING)
+		shard->pending[shard->nr_pending++] = uid;
+
+	irq_work_queue(this_cpu_ptr(&uid_shards_kick));
+}
+
+/* Called on the shard's cpu with IRQs off and rcu_read_lock() held */
+static void uid_time_repay(struct uid_shard *shard, struct uid_time_owed *owed)
+{
+	struct uid_shard_entry *entry = find_shard_entry_rcu(shard, owed->uid);
+	unsigned int i;
+
+	/* A smaller entry is replaced once the fill work gets to the uid */
+	if (!entry || entry->max_state < owed->max_state) {
+		uid_shard_request(shard, owed->uid);
+		return;
+	}
+
+	for (i = 0; i < owed->max_state; i++)
+		entry->time_in_state[i] += owed->time_in_state[i];
+	memset(owed->time_in_state, 0,
+	       owed->max_state * sizeof(owed->time_in_state[0]));
+	owed->owed = false;
+}
+
+static struct uid_shard_entry *uid_shard_entry_alloc(uid_t uid,
+						     unsigned int max_state)
+{
+	struct uid_shard_entry *entry;
+
+	entry = kzalloc(sizeof(*entry) + max_state *
+			sizeof(entry->time_in_state[0]), GFP_KERNEL);
+	if (entry) {
+		entry->uid = uid;
+		entry->max_state = max_state;
+	}
+	return entry;
+}
+
+/* Runs on fill->shard's cpu with IRQs off, so the tick cannot interleave */
+static void uid_shard_take_pending(void *info)
+{
+	struct uid_shard_fill *fill = info;
+	struct uid_shard *shard = fill->shard;
+
+	fill->nr = shard->nr_pending;
+	memcpy(fill->pending, shard->pending,
+	       fill->nr * sizeof(fill->pending[0]));
+	shard->nr_pending = 0;
+}
+
+/*
+ * Publishes *@new as @uid's entry unless the shard has one at least as
+ * large, and returns the entry in use. Caller must hold the shard lock on
+ * the shard's cpu with IRQs off.
+ */
+static struct uid_shard_entry *uid_shard_install_locked(
+	struct uid_shard *shard, uid_t uid, struct uid_shard_entry **new)
 {
-	struct uid_entry *uid_entry, *temp;
+	struct uid_shard_entry *entry = find_shard_entry_rcu(shard, uid);
+
+	if (!*new || (entry && entry->max_state >= (*new)->max_state))
+		return entry;
+
+	if (entry) {
+		memcpy((*new)->time_in_state, entry->time_in_state,
+		       entry->max_state * sizeof(entry->time_in_state[0]));
+		hlist_replace_rcu(&entry->hash, &(*new)->hash);
+		kfree_rcu(entry, rcu);
+	} else {
+		hash_add_rcu(shard->table, &(*new)->hash, uid);
+	}
+
+	entry = *new;
+	*new = NULL;
+	return entry;
+}
+
+/* Runs on fill->shard's cpu with IRQs off, so the tick cannot interleave */
+static void uid_shard_install(void *info)
+{
+	struct uid_shard_fill *fill = info;
+	struct uid_shard *shard = fill->shard;
+	unsigned int i;
+
+	spin_lock(&shard->lock);
+	for (i = 0; i < fill->nr; i++)
+		uid_shard_install_locked(shard, fill->pending[i],
+					 &fill->entry[i]);
+	spin_unlock(&shard->lock);
+}
+
+/* Charges the time a freed task still owed to the current cpu's shard */
+static void uid_time_owed_settle(struct uid_time_owed *owed,
+				 unsigned int max_state)
+{
+	struct uid_shard_entry *entry, *new;
+	struct uid_shard *shard;
+	unsigned int i;
+
+	register_uid(owed->uid);
+	new = uid_shard_entry_alloc(owed->uid, max(max_state,
+						   owed->max_state));
+
+	local_irq_disable();
+	shard = this_cpu_ptr(&uid_shards);
+	spin_lock(&shard->lock);
+	entry = uid_shard_install_locked(shard, owed->uid, &new);
+	for (i = 0; entry && i < min(entry->max_state, owed->max_state); i++)
+		entry->time_in_state[i] += owed->time_in_state[i];
+	spin_unlock(&shard->lock);
+	local_irq_enable();
+
+	kfree(new);
+}
+
+/* Caller must hold get_online_cpus() */
+static void uid_shard_call(unsigned int cpu, smp_call_func_t func,
+			   struct uid_shard_fill *fill)
+{
+	/* An offline cpu does not account, and cannot come back meanwhile */
+	if (cpu_online(cpu)) {
+		smp_call_function_single(cpu, func, fill, 1);
+		return;
+	}
+
+	local_irq_disable();
+	func(fill);
+	local_irq_enable();
+}
+
+/*
+ * Adds the shard entries the accounting path missed and settles the time
+ * freed tasks still owed. Allocations and the uid_hash_table update happen
+ * here in process context, only publishing the entries runs on the owning
+ * cpu.
+ */
+static void uid_shards_fill_work(struct work_struct *work)
+{
+	/* Work items do not run concurrently with themselves */
+	static struct uid_shard_fill fill;
 	unsigned int max_state = READ_ONCE(next_offset);
-	size_t alloc_size = sizeof(*uid_entry) + max_state *
-		sizeof(uid_entry->time_in_state[0]);
+	struct uid_time_owed *owed, *tmp;
+	struct llist_node *orphans;
+	unsigned int cpu, i;
 
-	uid_entry = find_uid_entry_locked(uid);
-	if (uid_entry) {
-		if (uid_entry->max_state == max_state)
-			return uid_entry;
-		/* uid_entry->time_in_state is too small to track all freqs, so
-		 * expand it.
-		 */
-		temp = __krealloc(uid_entry, alloc_size, GFP_ATOMIC);
-		if (!temp)
-			return uid_entry;
-		temp->max_state = max_state;
-		memset(temp->time_in_state + uid_entry->max_state, 0,
-		       (max_state - uid_entry->max_state) *
-		       sizeof(uid_entry->time_in_state[0]));
-		if (temp != uid_entry) {
-			hlist_replace_rcu(&uid_entry->hash, &temp->hash);
-			kfree_rcu(uid_entry, rcu);
+	get_online_cpus();
+	for_each_possible_cpu(cpu) {
+		fill.shard = per_cpu_ptr(&uid_shards, cpu);
+		if (!READ_ONCE(fill.shard->nr_pending))
+			continue;
+
+		uid_shard_call(cpu, uid_shard_take_pending, &fill);
+
+		for (i = 0; i < fill.nr; i++) {
+			/* Make the uid visible to readers before its time */
+			register_uid(fill.pending[i]);
+			fill.entry[i] = uid_shard_entry_alloc(fill.pending[i],
+							      max_state);
 		}
-		return temp;
+
+		uid_shard_call(cpu, uid_shard_install, &fill);
+
+		for (i = 0; i < fill.nr; i++)
+			kfree(fill.entry[i]);
 	}
+	put_online_cpus();
 
-	uid_entry = kzalloc(alloc_size, GFP_ATOMIC);
-	if (!uid_entry)
-		return NULL;
+	orphans = llist_del_all(&uid_owed_orphans);
+	llist_for_each_entry_safe(owed, tmp, orphans, node) {
+		uid_time_owed_settle(owed, max_state);
+		kfree(owed);
+	}
+}
 
-	uid_entry->uid = uid;
-	uid_entry->max_state = max_state;
+/* Caller must hold rcu_read_lock() */
+static void uid_fold_rcu(struct uid_fold *fold, uid_t uid)
+{
+	struct uid_shard_entry *entry;
+	unsigned int cpu, i, max_state;
+
+	memset(fold->time_in_state, 0,
+	       fold->max_state * sizeof(fold->time_in_state[0]));
+
+	for_each_possible_cpu(cpu) {
+		entry = find_shard_entry_rcu(per_cpu_ptr(&uid_shards, cpu), uid);
+		if (!entry)
+			continue;
+		max_state = min(entry->max_state, fold->max_state);
+		for (i = 0; i < max_state; i++)
+			fold->time_in_state[i] +=
+				READ_ONCE(entry->time_in_state[i]);
+	}
+}
 
-	hash_add_rcu(uid_hash_table, &uid_entry->hash, uid);
+static struct uid_fold *uid_fold_alloc(void)
+{
+	unsigned int max_state = READ_ONCE(next_offset);
+	struct uid_fold *fold;
 
-	return uid_entry;
+	fold = kmalloc(sizeof(*fold) + max_state *
+		       sizeof(fold->time_in_state[0]), GFP_KERNEL);
+	if (fold)
+		fold->max_state = max_state;
+	return fold;
 }
 
 static bool freq_index_invalid(unsigned int index)
@@ -142,7 +472,7 @@ static bool freq_index_invalid(unsigned int index)
 
 static int single_uid_time_in_state_show(struct seq_file *m, void *ptr)
 {
-	struct uid_entry *uid_entry;
+	struct uid_fold *fold;
 	unsigned int i;
 	u64 time;
 	uid_t uid = from_kuid_munged(current_user_ns(), *(kuid_t *)m->private);
@@ -150,22 +480,28 @@ static int single_uid_time_in_state_show(struct seq_file *m, void *ptr)
 	if (uid == overflowuid)
 		return -EINVAL;
 
+	fold = uid_fold_alloc();
+	if (!fold)
+		return -ENOMEM;
+
 	rcu_read_lock();
 
-	uid_entry = find_uid_entry_rcu(uid);
-	if (!uid_entry) {
+	if (!find_uid_entry_rcu(uid)) {
 		rcu_read_unlock();
+		kfree(fold);
 		return 0;
 	}
 
-	for (i = 0; i < uid_entry->max_state; ++i) {
+	uid_fold_rcu(fold, uid);
+	for (i = 0; i < fold->max_state; ++i) {
 		if (freq_index_invalid(i))
 			continue;
-		time = cputime_to_clock_t(uid_entry->time_in_state[i]);
+		time = cputime_to_clock_t(fold->time_in_state[i]);
 		seq_write(m, &time, sizeof(time));
 	}
 
 	rcu_read_unlock();
+	kfree(fold);
 
 	return 0;
 }
@@ -192,6 +528,7 @@ static void uid_seq_stop(struct seq_file *seq, void *v) { }
 
 static int uid_time_in_state_seq_show(struct seq_file *m, void *v)
 {
+	struct uid_fold *fold = m->private;
 	struct uid_entry *uid_entry;
 	struct cpu_freqs *freqs, *last_freqs = NULL;
 	int i, cpu;
@@ -216,16 +553,17 @@ static int uid_time_in_state_seq_show(struct seq_file *m, void *v)
 	rcu_read_lock();
 
 	hlist_for_each_entry_rcu(uid_entry, (struct hlist_head *)v, hash) {
-		if (uid_entry->max_state)
-			seq_printf(m, "%d:", uid_entry->uid);
-		for (i = 0; i < uid_entry->max_state; ++i) {
+		if (!fold->max_state)
+			continue;
+		uid_fold_rcu(fold, uid_entry->uid);
+		seq_printf(m, "%d:", uid_entry->uid);
+		for (i = 0; i < fold->max_state; ++i) {
 			if (freq_index_invalid(i))
 				continue;
 			seq_printf(m, " %lu", (unsigned long)cputime_to_clock_t(
-					   uid_entry->time_in_state[i]));
+					   fold->time_in_state[i]));
 		}
-		if (uid_entry->max_state)
-			seq_putc(m, '\n');
+		seq_putc(m, '\n');
 	}
 
 	rcu_read_unlock();
@@ -240,10 +578,12 @@ void cpufreq_task_times_init(struct task_struct *p)
 	p->time_in_state = NULL;
 	spin_unlock_irqrestore(&task_time_in_state_lock, flags);
 	p->max_state = 0;
+	p->uid_time_owed = NULL;
 }
 
 void cpufreq_task_times_alloc(struct task_struct *p)
 {
+	struct uid_time_owed *owed;
 	void *temp;
 	unsigned long flags;
 	unsigned int max_state = READ_ONCE(next_offset);
@@ -253,10 +593,19 @@ void cpufreq_task_times_alloc(struct task_struct *p)
 	if (!temp)
 		return;
 
+	owed = kzalloc(sizeof(*owed) + max_state * sizeof(owed->time_in_state[0]),
+		       GFP_ATOMIC);
+	if (!owed) {
+		kfree(temp);
+		return;
+	}
+	owed->max_state = max_state;
+
 	spin_lock_irqsave(&task_time_in_state_lock, flags);
 	p->time_in_state = temp;
 	spin_unlock_irqrestore(&task_time_in_state_lock, flags);
 	p->max_state = max_state;
+	p->uid_time_owed = owed;
 }
 
 /* Caller must hold task_time_in_state_lock */
@@ -264,6 +613,23 @@ static int cpufreq_task_times_realloc_locked(struct task_struct *p)
 {
 	void *temp;
 	unsigned int max_state = READ_ONCE(next_offset);
+	struct uid_time_owed *owed = p->uid_time_owed;
+
+	/* Grown first so it always covers every state the task can see */
+	if (!owed || owed->max_state < max_state) {
+		owed = krealloc(owed, sizeof(*owed) +
+				max_state * sizeof(owed->time_in_state[0]),
+				GFP_ATOMIC);
+		if (!owed)
+			return -ENOMEM;
+		if (!p->uid_time_owed)
+			memset(owed, 0, sizeof(*owed));
+		memset(owed->time_in_state + owed->max_state, 0,
+		       (max_state - owed->max_state) *
+		       sizeof(owed->time_in_state[0]));
+		owed->max_state = max_state;
+		p->uid_time_owed = owed;
+	}
 
 	temp = krealloc(p->time_in_state, max_state * sizeof(u64), GFP_ATOMIC);
 	if (!temp)
@@ -277,9 +643,19 @@ static int cpufreq_task_times_realloc_locked(struct task_struct *p)
 
 void cpufreq_task_times_exit(struct task_struct *p)
 {
+	struct uid_time_owed *owed = p->uid_time_owed;
 	unsigned long flags;
 	void *temp;
 
+	/* p no longer runs, so nothing adds to owed behind our back */
+	p->uid_time_owed = NULL;
+	if (owed && owed->owed) {
+		llist_add(&owed->node, &uid_owed_orphans);
+		irq_work_queue(raw_cpu_ptr(&uid_shards_kick));
+	} else {
+		kfree(owed);
+	}
+
 	if (!p->time_in_state)
 		return;
 
@@ -326,7 +702,9 @@ void cpufreq_acct_update_power(struct task_struct *p, cputime_t cputime)
 {
 	unsigned long flags;
 	unsigned int state;
-	struct uid_entry *uid_entry;
+	struct uid_shard *shard;
+	struct uid_shard_entry *entry;
+	struct uid_time_owed *owed;
 	struct cpu_freqs *freqs = all_freqs[task_cpu(p)];
 	uid_t uid = from_kuid_munged(current_user_ns(), task_uid(p));
 
@@ -335,17 +713,43 @@ void cpufreq_acct_update_power(struct task_struct *p, cputime_t cputime)
 
 	state = freqs->offset + READ_ONCE(freqs->last_index);
 
-	spin_lock_irqsave(&task_time_in_state_lock, flags);
-	if ((state < p->max_state || !cpufreq_task_times_realloc_locked(p)) &&
-	    p->time_in_state)
+	/*
+	 * p->time_in_state is only resized here, and p is only accounted on
+	 * the cpu it runs on, so the common case needs no lock. Readers may
+	 * see a stale count but never a freed array: the lock is only needed
+	 * to keep proc_time_in_state_show() off the old array while resizing.
+	 */
+	if (state < p->max_state && p->time_in_state) {
 		p->time_in_state[state] += cputime;
-	spin_unlock_irqrestore(&task_time_in_state_lock, flags);
+	} else {
+		spin_lock_irqsave(&task_time_in_state_lock, flags);
+		if (!cpufreq_task_times_realloc_locked(p) && p->time_in_state)
+			p->time_in_state[state] += cputime;
+		spin_unlock_irqrestore(&task_time_in_state_lock, flags);
+	}
 
-	spin_lock_irqsave(&uid_lock, flags);
-	uid_entry = find_or_register_uid_locked(uid);
-	if (uid_entry && state < uid_entry->max_state)
-		uid_entry->time_in_state[state] += cputime;
-	spin_unlock_irqrestore(&uid_lock, flags);
+	/* Only keeps IRQ-context accounting on this cpu from interleaving */
+	local_irq_save(flags);
+	rcu_read_lock();
+	shard = this_cpu_ptr(&uid_shards);
+	entry = find_shard_entry_rcu(shard, uid);
+	owed = p->uid_time_owed;
+	if (entry && state < entry->max_state) {
+		entry->time_in_state[state] += cputime;
+	} else {
+		if (owed && state < owed->max_state) {
+			if (!owed->owed) {
+				owed->uid = uid;
+				owed->owed = true;
+			}
+			owed->time_in_state[state] += cputime;
+		}
+		uid_shard_request(shard, uid);
+	}
+	if (owed && owed->owed)
+		uid_time_repay(shard, owed);
+	rcu_read_unlock();
+	local_irq_restore(flags);
 }
 
 void cpufreq_times_create_policy(struct cpufreq_policy *policy)
@@ -390,15 +794,19 @@ void cpufreq_times_create_policy(struct cpufreq_policy *policy)
 void cpufreq_task_times_remove_uids(uid_t uid_start, uid_t uid_end)
 {
 	struct uid_entry *uid_entry;
+	struct uid_shard_entry *entry;
+	struct uid_shard *shard;
 	struct hlist_node *tmp;
 	unsigned long flags;
+	unsigned int cpu;
+	uid_t uid;
 
 	spin_lock_irqsave(&uid_lock, flags);
 
-	for (; uid_start <= uid_end; uid_start++) {
+	for (uid = uid_start; uid <= uid_end; uid++) {
 		hash_for_each_possible_safe(uid_hash_table, uid_entry, tmp,
-			hash, uid_start) {
-			if (uid_start == uid_entry->uid) {
+			hash, uid) {
+			if (uid == uid_entry->uid) {
 				hash_del_rcu(&uid_entry->hash);
 				kfree_rcu(uid_entry, rcu);
 			}
@@ -406,6 +814,21 @@ void cpufreq_task_times_remove_uids(uid_t uid_start, uid_t uid_end)
 	}
 
 	spin_unlock_irqrestore(&uid_lock, flags);
+
+	for_each_possible_cpu(cpu) {
+		shard = per_cpu_ptr(&uid_shards, cpu);
+		spin_lock_irqsave(&shard->lock, flags);
+		for (uid = uid_start; uid <= uid_end; uid++) {
+			hash_for_each_possible_safe(shard->table, entry, tmp,
+				hash, uid) {
+				if (uid == entry->uid) {
+					hash_del_rcu(&entry->hash);
+					kfree_rcu(entry, rcu);
+				}
+			}
+		}
+		spin_unlock_irqrestore(&shard->lock, flags);
+	}
 }
 
 void cpufreq_times_record_transition(struct cpufreq_freqs *freq)
@@ -437,7 +860,17 @@ static const struct seq_operations uid_time_in_state_seq_ops = {
 
 static int uid_time_in_state_open(struct inode *inode, struct file *file)
 {
-	return seq_open(file, &uid_time_in_state_seq_ops);
+	unsigned int max_state = READ_ONCE(next_offset);
+	struct uid_fold *fold;
+
+	fold = __seq_open_private(file, &uid_time_in_state_seq_ops,
+				  sizeof(*fold) + max_state *
+				  sizeof(fold->time_in_state[0]));
+	if (!fold)
+		return -ENOMEM;
+
+	fold->max_state = max_state;
+	return 0;
 }
 
 int single_uid_time_in_state_open(struct inode *inode, struct file *file)
@@ -450,11 +883,20 @@ static const struct file_operations uid_time_in_state_fops = {
 	.open		= uid_time_in_state_open,
 	.read		= seq_read,
 	.llseek		= seq_lseek,
-	.release	= seq_release,
+	.release	= seq_release_private,
 };
 
 static int __init cpufreq_times_init(void)
 {
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct uid_shard *shard = per_cpu_ptr(&uid_shards, cpu);
+
+		spin_lock_init(&shard->lock);
+		hash_init(shard->table);
+	}
+
 	proc_create_data("uid_time_in_state", 0444, NULL,
 			 &uid_time_in_state_fops, NULL);
 
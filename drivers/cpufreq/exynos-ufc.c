@@ -17,6 +17,12 @@
 #include <linux/cpumask.h>
 #include <linux/cpufreq.h>
 #include <linux/pm_opp.h>
+#include <linux/ktime.h>
+#include <linux/sched.h>
+#include <linux/miscdevice.h>
+#include <linux/fs.h>
+#include <linux/uaccess.h>
+#include <linux/workqueue.h>
 
 #include <soc/samsung/exynos-cpu_hotplug.h>
 
@@ -141,13 +147,11 @@ static void control_hmp_boost(bool enable)
 static inline void control_hmp_boost(bool enable) {}
 #endif
 
-static ssize_t store_cpufreq_min_limit(struct kobject *kobj,
-				struct kobj_attribute *attr, const char *buf,
-				size_t count)
+static void cpufreq_min_limit_update(int input)
 {
 	struct list_head *domains = get_domain_list();
 	struct exynos_cpufreq_domain *domain;
-	int input, scale = -1;
+	int scale = -1;
 	unsigned int freq;
 	unsigned int req_limit_freq;
 	bool set_max = false;
@@ -156,17 +160,9 @@ static ssize_t store_cpufreq_min_limit(struct kobject *kobj,
 	int ret = 0;
 	struct cpumask mask;
 
-	if (sscanf(buf, "%8d", &input) < 1)
-		return -EINVAL;
-
 	if (ap_fuse == 2)
 		scale++;
 
-	if (!domains) {
-		pr_err("failed to get domains!\n");
-		return -ENXIO;
-	}
-
 	list_for_each_entry_reverse(domain, domains, list) {
 		struct exynos_ufc *ufc, *r_ufc = NULL, *r_ufc_32 = NULL;
 		struct cpufreq_policy *policy = NULL;
@@ -259,17 +255,13 @@ static ssize_t store_cpufreq_min_limit(struct kobject *kobj,
 
 		set_max = true;
 	}
-
-	return count;
 }
 
-static ssize_t store_cpufreq_min_limit_wo_boost(struct kobject *kobj,
-				struct kobj_attribute *attr, const char *buf,
-				size_t count)
+static void cpufreq_min_limit_wo_boost_update(int input)
 {
 	struct list_head *domains = get_domain_list();
 	struct exynos_cpufreq_domain *domain;
-	int input, scale = -1;
+	int scale = -1;
 	unsigned int freq;
 	unsigned int req_limit_freq;
 	bool set_max = false;
@@ -278,17 +270,9 @@ static ssize_t store_cpufreq_min_limit_wo_boost(struct kobject *kobj,
 	int ret = 0;
 	struct cpumask mask;
 
-	if (sscanf(buf, "%8d", &input) < 1)
-		return -EINVAL;
-
 	if (ap_fuse == 2)
 		scale++;
 
-	if (!domains) {
-		pr_err("failed to get domains!\n");
-		return -ENXIO;
-	}
-
 	list_for_each_entry_reverse(domain, domains, list) {
 		struct exynos_ufc *ufc, *r_ufc = NULL, *r_ufc_32 = NULL;
 		struct cpufreq_policy *policy = NULL;
@@ -371,9 +355,6 @@ static ssize_t store_cpufreq_min_limit_wo_boost(struct kobject *kobj,
 
 		set_max = true;
 	}
-
-	return count;
-
 }
 
 static ssize_t show_cpufreq_max_limit(struct kobject *kobj,
@@ -544,6 +525,379 @@ static void cpufreq_max_limit_update(int input_freq)
 	}
 }
 
+/*********************************************************************
+ *                       LIMIT REQUEST CLIENTS                       *
+ *********************************************************************/
+/*
+ * Every requester of the frequency limits is a client: the sysfs nodes
+ * are one, and each open file of /dev/cpufreq_limit is another. For
+ * min and max limit separately, the request of the highest priority
+ * client wins, and among clients of the same priority the strictest
+ * request wins. A request can expire, and all requests of a file are
+ * dropped when it is closed.
+ */
+enum {
+	UFC_REQ_MIN,
+	UFC_REQ_MAX,
+	UFC_REQ_MIN_WO_BOOST,
+	UFC_REQ_TYPE_NUM,
+};
+
+#define UFC_PRIO_MAX		10
+#define UFC_MAX_RETIRED		16
+
+struct ufc_req {
+	int input;		/* scaled down frequency, -1 if not requested */
+	u64 expires_ms;		/* 0 if it does not expire */
+	u64 requests;
+	u64 held_ms;		/* time this request was the applied limit */
+};
+
+struct ufc_client {
+	struct list_head list;
+	char name[TASK_COMM_LEN];
+	pid_t pid;
+	int prio;
+	bool closed;
+	struct ufc_req req[UFC_REQ_TYPE_NUM];
+};
+
+static DEFINE_MUTEX(ufc_lock);
+static LIST_HEAD(ufc_clients);
+static LIST_HEAD(ufc_retired);
+static int ufc_nr_retired;
+static struct ufc_client *ufc_winner[UFC_REQ_TYPE_NUM];
+static u64 ufc_winner_since[UFC_REQ_TYPE_NUM];
+static int ufc_applied[UFC_REQ_TYPE_NUM] = { -1, -1, -1 };
+
+static struct ufc_client ufc_sysfs_client = {
+	.name = "sysfs",
+	.req = { { .input = -1 }, { .input = -1 }, { .input = -1 } },
+};
+
+static void ufc_expire_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(ufc_expire_work, ufc_expire_work_fn);
+
+static bool ufc_stricter(int type, int input, int than)
+{
+	return type == UFC_REQ_MAX ? input < than : input > than;
+}
+
+static struct ufc_client *ufc_pick(int type)
+{
+	struct ufc_client *client, *winner = NULL;
+
+	list_for_each_entry(client, &ufc_clients, list) {
+		int input = client->req[type].input;
+
+		if (input < 0)
+			continue;
+
+		if (!winner || client->prio > winner->prio ||
+			(client->prio == winner->prio &&
+			 ufc_stricter(type, input, winner->req[type].input)))
+			winner = client;
+	}
+
+	return winner;
+}
+
+/*
+ * Must be called with ufc_lock held. @force applies the limits even if the
+ * winners did not change: cpu hotplug and execution mode changes alter the
+ * policy limits behind our back, so explicit requests always apply them.
+ */
+static void ufc_update(bool force)
+{
+	struct ufc_client *client;
+	u64 now = ktime_to_ms(ktime_get());
+	u64 next_expire = 0;
+	int type;
+
+	list_for_each_entry(client, &ufc_clients, list) {
+		for (type = 0; type < UFC_REQ_TYPE_NUM; type++) {
+			struct ufc_req *req = &client->req[type];
+
+			if (req->input < 0 || !req->expires_ms)
+				continue;
+
+			if (req->expires_ms <= now) {
+				req->input = -1;
+				req->expires_ms = 0;
+			} else if (!next_expire || req->expires_ms < next_expire) {
+				next_expire = req->expires_ms;
+			}
+		}
+	}
+
+	for (type = 0; type < UFC_REQ_TYPE_NUM; type++) {
+		struct ufc_client *winner = ufc_pick(type);
+		int input = winner ? winner->req[type].input : -1;
+
+		if (ufc_winner[type])
+			ufc_winner[type]->req[type].held_ms +=
+					now - ufc_winner_since[type];
+		ufc_winner[type] = winner;
+		ufc_winner_since[type] = now;
+
+		if (!force && input == ufc_applied[type])
+			continue;
+
+		ufc_applied[type] = input;
+		if (type == UFC_REQ_MIN) {
+			cpufreq_min_limit_update(input);
+		} else if (type == UFC_REQ_MIN_WO_BOOST) {
+			cpufreq_min_limit_wo_boost_update(input);
+		} else {
+			last_max_limit = input;
+			cpufreq_max_limit_update(input);
+		}
+	}
+
+	if (next_expire)
+		mod_delayed_work(system_wq, &ufc_expire_work,
+				msecs_to_jiffies(next_expire - now));
+	else
+		cancel_delayed_work(&ufc_expire_work);
+}
+
+static void ufc_expire_work_fn(struct work_struct *work)
+{
+	mutex_lock(&ufc_lock);
+	ufc_update(false);
+	mutex_unlock(&ufc_lock);
+}
+
+/* Must be called with ufc_lock held. */
+static void ufc_request(struct ufc_client *client, int type, int input,
+			unsigned int timeout_ms)
+{
+	struct ufc_req *req = &client->req[type];
+
+	req->input = input < 0 ? -1 : input;
+	req->expires_ms = (input >= 0 && timeout_ms) ?
+			ktime_to_ms(ktime_get()) + timeout_ms : 0;
+	req->requests++;
+
+	ufc_update(true);
+}
+
+static int ufc_open(struct inode *inode, struct file *file)
+{
+	struct ufc_client *client;
+	int type;
+
+	client = kzalloc(sizeof(*client), GFP_KERNEL);
+	if (!client)
+		return -ENOMEM;
+
+	get_task_comm(client->name, current);
+	client->pid = task_tgid_nr(current);
+	for (type = 0; type < UFC_REQ_TYPE_NUM; type++)
+		client->req[type].input = -1;
+
+	mutex_lock(&ufc_lock);
+	list_add_tail(&client->list, &ufc_clients);
+	mutex_unlock(&ufc_lock);
+
+	file->private_data = client;
+
+	return 0;
+}
+
+static int ufc_release(struct inode *inode, struct file *file)
+{
+	struct ufc_client *client = file->private_data;
+	struct ufc_client *old = NULL;
+	int type;
+
+	mutex_lock(&ufc_lock);
+
+	for (type = 0; type < UFC_REQ_TYPE_NUM; type++)
+		client->req[type].input = -1;
+	ufc_update(true);
+
+	/* keep the statistics of the last closed clients */
+	client->closed = true;
+	list_move_tail(&client->list, &ufc_retired);
+	if (++ufc_nr_retired > UFC_MAX_RETIRED) {
+		old = list_first_entry(&ufc_retired, struct ufc_client, list);
+		list_del(&old->list);
+		ufc_nr_retired--;
+	}
+
+	mutex_unlock(&ufc_lock);
+
+	kfree(old);
+
+	return 0;
+}
+
+/*
+ * Commands, one per line:
+ *   min <freq> [<timeout ms>]	request minimum limit, -1 to release
+ *   max <freq> [<timeout ms>]	request maximum limit, -1 to release
+ *   min_wo_boost <freq> [<timeout ms>]
+ *				minimum limit without HMP boost, -1 to release
+ *   prio <0..UFC_PRIO_MAX>	priority of all requests of this file
+ * <freq> is scaled down as the cpufreq_min/max_limit nodes.
+ */
+static ssize_t ufc_write(struct file *file, const char __user *ubuf,
+			size_t count, loff_t *ppos)
+{
+	struct ufc_client *client = file->private_data;
+	char buf[64], *line, *cur, *end;
+	size_t len = min(count, sizeof(buf) - 1);
+	unsigned int timeout;
+	int input, ret = 0;
+
+	if (copy_from_user(buf, ubuf, len))
+		return -EFAULT;
+	buf[len] = '\0';
+
+	/*
+	 * Only whole lines are parsed. A longer write is consumed up to its
+	 * last line that fits, and the writer passes the rest again. A single
+	 * line longer than the buffer is invalid.
+	 */
+	if (len < count) {
+		end = strrchr(buf, '\n');
+		if (!end)
+			return -EINVAL;
+		len = end - buf + 1;
+		buf[len] = '\0';
+	}
+
+	mutex_lock(&ufc_lock);
+
+	cur = buf;
+	while ((line = strsep(&cur, "\n")) != NULL) {
+		if (!*line)
+			continue;
+
+		timeout = 0;
+		if (sscanf(line, "min_wo_boost %d %u", &input, &timeout) >= 1) {
+			ufc_request(client, UFC_REQ_MIN_WO_BOOST, input, timeout);
+		} else if (sscanf(line, "min %d %u", &input, &timeout) >= 1) {
+			ufc_request(client, UFC_REQ_MIN, input, timeout);
+		} else if (sscanf(line, "max %d %u", &input, &timeout) >= 1) {
+			ufc_request(client, UFC_REQ_MAX, input, timeout);
+		} else if (sscanf(line, "prio %d", &input) == 1 &&
+				input >= 0 && input <= UFC_PRIO_MAX) {
+			client->prio = input;
+			ufc_update(true);
+		} else {
+			ret = -EINVAL;
+			break;
+		}
+	}
+
+	mutex_unlock(&ufc_lock);
+
+	return ret ? ret : len;
+}
+
+static const struct file_operations ufc_fops = {
+	.owner		= THIS_MODULE,
+	.open		= ufc_open,
+	.release	= ufc_release,
+	.write		= ufc_write,
+	.llseek		= noop_llseek,
+};
+
+static struct miscdevice ufc_misc = {
+	.minor	= MISC_DYNAMIC_MINOR,
+	.name	= "cpufreq_limit",
+	.fops	= &ufc_fops,
+};
+
+static ssize_t ufc_show_client(struct ufc_client *client, u64 now,
+				char *buf, ssize_t count)
+{
+	u64 held[UFC_REQ_TYPE_NUM];
+	int type;
+
+	for (type = 0; type < UFC_REQ_TYPE_NUM; type++) {
+		held[type] = client->req[type].held_ms;
+		if (ufc_winner[type] == client)
+			held[type] += now - ufc_winner_since[type];
+	}
+
+	return scnprintf(buf + count, PAGE_SIZE - count,
+			"%-16s %6d %4d %8d %8d %8d %10llu %10llu %8llu %8llu%s\n",
+			client->name, client->pid, client->prio,
+			client->req[UFC_REQ_MIN].input,
+			client->req[UFC_REQ_MAX].input,
+			client->req[UFC_REQ_MIN_WO_BOOST].input,
+			held[UFC_REQ_MIN], held[UFC_REQ_MAX],
+			client->req[UFC_REQ_MIN].requests,
+			client->req[UFC_REQ_MAX].requests,
+			client->closed ? " closed" : "");
+}
+
+static ssize_t show_cpufreq_limit_clients(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	struct ufc_client *client;
+	u64 now = ktime_to_ms(ktime_get());
+	ssize_t count;
+
+	count = scnprintf(buf, PAGE_SIZE,
+			"%-16s %6s %4s %8s %8s %8s %10s %10s %8s %8s\n",
+			"client", "pid", "prio", "min", "max", "wo_boost",
+			"min_held", "max_held", "min_reqs", "max_reqs");
+
+	mutex_lock(&ufc_lock);
+	list_for_each_entry(client, &ufc_clients, list)
+		count += ufc_show_client(client, now, buf, count);
+	list_for_each_entry(client, &ufc_retired, list)
+		count += ufc_show_client(client, now, buf, count);
+	mutex_unlock(&ufc_lock);
+
+	return count;
+}
+
+static ssize_t store_cpufreq_min_limit(struct kobject *kobj,
+				struct kobj_attribute *attr, const char *buf,
+				size_t count)
+{
+	int input;
+
+	if (sscanf(buf, "%8d", &input) < 1)
+		return -EINVAL;
+
+	if (!get_domain_list()) {
+		pr_err("failed to get domains!\n");
+		return -ENXIO;
+	}
+
+	mutex_lock(&ufc_lock);
+	ufc_request(&ufc_sysfs_client, UFC_REQ_MIN, input, 0);
+	mutex_unlock(&ufc_lock);
+
+	return count;
+}
+
+static ssize_t store_cpufreq_min_limit_wo_boost(struct kobject *kobj,
+				struct kobj_attribute *attr, const char *buf,
+				size_t count)
+{
+	int input;
+
+	if (sscanf(buf, "%8d", &input) < 1)
+		return -EINVAL;
+
+	if (!get_domain_list()) {
+		pr_err("failed to get domains!\n");
+		return -ENXIO;
+	}
+
+	mutex_lock(&ufc_lock);
+	ufc_request(&ufc_sysfs_client, UFC_REQ_MIN_WO_BOOST, input, 0);
+	mutex_unlock(&ufc_lock);
+
+	return count;
+}
 
 static ssize_t store_cpufreq_max_limit(struct kobject *kobj, struct kobj_attribute *attr,
 					const char *buf, size_t count)
@@ -553,8 +907,9 @@ static ssize_t store_cpufreq_max_limit(struct kobject *kobj, struct kobj_attribu
 	if (sscanf(buf, "%8d", &input) < 1)
 		return -EINVAL;
 
-	last_max_limit = input;
-	cpufreq_max_limit_update(input);
+	mutex_lock(&ufc_lock);
+	ufc_request(&ufc_sysfs_client, UFC_REQ_MAX, input, 0);
+	mutex_unlock(&ufc_lock);
 
 	return count;
 }
@@ -574,6 +929,7 @@ static ssize_t store_execution_mode_change(struct kobject *kobj, struct kobj_att
 	if (sscanf(buf, "%8d", &input) < 1)
 		return -EINVAL;
 
+	mutex_lock(&ufc_lock);
 	prev_mode = sse_mode;
 	sse_mode = !!input;
 
@@ -581,6 +937,7 @@ static ssize_t store_execution_mode_change(struct kobject *kobj, struct kobj_att
 		if (last_max_limit != -1)
 			cpufreq_max_limit_update(last_max_limit);
 	}
+	mutex_unlock(&ufc_lock);
 
 	return count;
 }
@@ -599,6 +956,8 @@ __ATTR(cpufreq_max_limit, 0644,
 static struct kobj_attribute execution_mode_change =
 __ATTR(execution_mode_change, 0644,
 		show_execution_mode_change, store_execution_mode_change);
+static struct kobj_attribute cpufreq_limit_clients =
+__ATTR(cpufreq_limit_clients, 0444, show_cpufreq_limit_clients, NULL);
 
 static __init void init_sysfs(void)
 {
@@ -617,6 +976,13 @@ static __init void init_sysfs(void)
 	if (sysfs_create_file(power_kobj, &execution_mode_change.attr))
 		pr_err("failed to create cpufreq_max_limit node\n");
 
+	if (sysfs_create_file(power_kobj, &cpufreq_limit_clients.attr))
+		pr_err("failed to create cpufreq_limit_clients node\n");
+
+	list_add(&ufc_sysfs_client.list, &ufc_clients);
+	if (misc_register(&ufc_misc))
+		pr_err("failed to register cpufreq_limit device\n");
+
 }
 
 static int parse_ufc_ctrl_info(struct exynos_cpufreq_domain *domain,
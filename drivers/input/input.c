@@ -27,6 +27,7 @@
 #include <linux/device.h>
 #include <linux/mutex.h>
 #include <linux/rcupdate.h>
+#include <linux/uaccess.h>
 #include "input-compat.h"
 
 #if !defined(CONFIG_INPUT_BOOSTER) // Input Booster +
@@ -450,6 +451,304 @@ DECLARE_RESET_BOOSTER_FUNC(pen);
 DECLARE_RESET_BOOSTER_FUNC(hover);
 DECLARE_RESET_BOOSTER_FUNC(key_two);
 
+// ********** Adaptive Hold Policy ********** //
+/*
+ * The hold time of a boost is scaled from the device tree value by the
+ * speed of the touch motion and by the frames the display missed recently.
+ * A tap holds the boost for half of the time, a fling up to twice and every
+ * missed frame extends it further. The policy only depends on the samples
+ * given to it, so a recorded trace replays with the same result.
+ */
+#define IB_SPEED_PCT_DIV	20	/* px/s per percent of hold time */
+#define IB_MISS_PCT		25	/* percent of hold time per missed frame */
+#define IB_MISS_DECAY_MS	250	/* missed frames are halved every period */
+#define IB_MOTION_GAP_MS	100	/* a longer gap starts a new motion */
+#define IB_HOLD_PCT_MIN		50
+#define IB_HOLD_PCT_MAX		300
+
+static bool booster_adaptive = true;
+module_param(booster_adaptive, bool, 0644);
+
+struct input_booster_policy {
+	s64 last_ms;
+	int last_x;
+	int last_y;
+	bool has_pos;
+	unsigned int speed;	/* px/s, moving average */
+	unsigned int misses;
+	s64 miss_ms;
+};
+
+struct input_booster_stat {
+	const char *name;
+	struct t_input_booster *booster;
+	bool motion;
+	unsigned long holds;
+	unsigned long base_ms;
+	unsigned long hold_ms;
+	unsigned long misses;
+	unsigned long until;
+};
+
+#define IB_STAT(_name, _motion) \
+	{ .name = #_name, .booster = &_name##_booster, .motion = _motion }
+
+static struct input_booster_stat input_booster_stats[] = {
+	IB_STAT(touch, true),
+	IB_STAT(multitouch, true),
+	IB_STAT(key, false),
+	IB_STAT(touchkey, false),
+	IB_STAT(keyboard, false),
+	IB_STAT(mouse, false),
+	IB_STAT(mouse_wheel, false),
+	IB_STAT(pen, true),
+	IB_STAT(hover, false),
+	IB_STAT(key_two, false),
+};
+
+static DEFINE_SPINLOCK(input_booster_policy_lock);
+static struct input_booster_policy input_booster_live;
+
+static void input_booster_policy_decay(struct input_booster_policy *p,
+				       s64 now_ms)
+{
+	s64 periods = (now_ms - p->miss_ms) / IB_MISS_DECAY_MS;
+
+	if (periods <= 0)
+		return;
+
+	p->misses = (periods >= 32) ? 0 : p->misses >> periods;
+	p->miss_ms += periods * IB_MISS_DECAY_MS;
+}
+
+static void input_booster_policy_motion(struct input_booster_policy *p,
+					s64 now_ms, int x, int y)
+{
+	s64 dt = now_ms - p->last_ms;
+
+	if (p->has_pos && dt > 0 && dt < IB_MOTION_GAP_MS) {
+		unsigned int dist = abs(x - p->last_x) + abs(y - p->last_y);
+		unsigned int speed = (unsigned int)div64_s64(dist * 1000LL, dt);
+
+		p->speed = (p->speed * 3 + speed) / 4;
+	} else if (!p->has_pos || dt >= IB_MOTION_GAP_MS) {
+		p->speed = 0;
+	}
+
+	p->last_ms = now_ms;
+	p->last_x = x;
+	p->last_y = y;
+	p->has_pos = true;
+}
+
+static void input_booster_policy_miss(struct input_booster_policy *p,
+				      s64 now_ms, unsigned int frames)
+{
+	input_booster_policy_decay(p, now_ms);
+	if (!p->misses)
+		p->miss_ms = now_ms;
+	p->misses += frames;
+}
+
+static unsigned int input_booster_policy_hold(struct input_booster_policy *p,
+					      s64 now_ms, unsigned int base_ms,
+					      bool motion)
+{
+	unsigned int pct = 100;
+
+	input_booster_policy_decay(p, now_ms);
+
+	if (motion) {
+		if (p->has_pos && now_ms - p->last_ms >= IB_MOTION_GAP_MS)
+			p->speed = 0;
+		pct = IB_HOLD_PCT_MIN + p->speed / IB_SPEED_PCT_DIV;
+	}
+	pct += p->misses * IB_MISS_PCT;
+	pct = clamp_t(unsigned int, pct, IB_HOLD_PCT_MIN, IB_HOLD_PCT_MAX);
+
+	return base_ms * pct / 100;
+}
+
+static struct input_booster_stat *input_booster_find_stat(
+					struct t_input_booster *_this)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(input_booster_stats); i++)
+		if (input_booster_stats[i].booster == _this)
+			return &input_booster_stats[i];
+
+	return NULL;
+}
+
+static unsigned long input_booster_hold(struct t_input_booster *_this, int idx)
+{
+	struct input_booster_stat *stat = input_booster_find_stat(_this);
+	unsigned int base_ms = _this->param[idx].time;
+	unsigned int hold_ms = base_ms;
+	unsigned long flags;
+
+	spin_lock_irqsave(&input_booster_policy_lock, flags);
+	if (booster_adaptive && stat)
+		hold_ms = input_booster_policy_hold(&input_booster_live,
+				ktime_to_ms(ktime_get()), base_ms, stat->motion);
+	if (stat) {
+		stat->holds++;
+		stat->base_ms += base_ms;
+		stat->hold_ms += hold_ms;
+		stat->until = jiffies + msecs_to_jiffies(hold_ms);
+	}
+	spin_unlock_irqrestore(&input_booster_policy_lock, flags);
+
+	return msecs_to_jiffies(hold_ms);
+}
+
+static void input_booster_track_motion(int x, int y)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&input_booster_policy_lock, flags);
+	input_booster_policy_motion(&input_booster_live,
+				    ktime_to_ms(ktime_get()), x, y);
+	spin_unlock_irqrestore(&input_booster_policy_lock, flags);
+}
+
+/*
+ * Called by the display driver when queued frames could not be shown at
+ * their vsync. The misses are charged to the boosters holding at the time.
+ */
+void input_booster_frame_miss(unsigned int frames)
+{
+	unsigned long flags;
+	int i;
+
+	if (!frames)
+		return;
+
+	spin_lock_irqsave(&input_booster_policy_lock, flags);
+	input_booster_policy_miss(&input_booster_live,
+				  ktime_to_ms(ktime_get()), frames);
+	for (i = 0; i < ARRAY_SIZE(input_booster_stats); i++)
+		if (time_before(jiffies, input_booster_stats[i].until))
+			input_booster_stats[i].misses += frames;
+	spin_unlock_irqrestore(&input_booster_policy_lock, flags);
+}
+EXPORT_SYMBOL(input_booster_frame_miss);
+
+#ifdef CONFIG_PROC_FS
+/*
+ * /proc/bus/input/booster shows the counters of each booster. Writing a
+ * trace to it replays the trace through the policy without boosting:
+ *   m <ms> <x> <y>		touch position
+ *   v <ms> <frames>		missed frames
+ *   b <ms> <base_ms> <motion>	boost with the device tree hold time
+ *   reset			start a new replay
+ */
+static DEFINE_MUTEX(input_booster_replay_lock);
+static struct input_booster_policy input_booster_replay_policy;
+static unsigned long input_booster_replay_holds;
+static unsigned long input_booster_replay_base_ms;
+static unsigned long input_booster_replay_hold_ms;
+
+static void input_booster_replay_line(const char *line)
+{
+	struct input_booster_policy *p = &input_booster_replay_policy;
+	long long ms;
+	int a, b, c;
+
+	if (!strncmp(line, "reset", 5)) {
+		memset(p, 0, sizeof(*p));
+		input_booster_replay_holds = 0;
+		input_booster_replay_base_ms = 0;
+		input_booster_replay_hold_ms = 0;
+	} else if (sscanf(line, "m %lld %d %d", &ms, &a, &b) == 3) {
+		input_booster_policy_motion(p, ms, a, b);
+	} else if (sscanf(line, "v %lld %d", &ms, &a) == 2 && a > 0) {
+		input_booster_policy_miss(p, ms, a);
+	} else if (sscanf(line, "b %lld %d %d", &ms, &a, &c) == 3 && a >= 0) {
+		input_booster_replay_holds++;
+		input_booster_replay_base_ms += a;
+		input_booster_replay_hold_ms +=
+			input_booster_policy_hold(p, ms, a, !!c);
+	}
+}
+
+static ssize_t input_booster_proc_write(struct file *file,
+					const char __user *ubuf,
+					size_t count, loff_t *ppos)
+{
+	char *buf, *line, *end;
+	size_t len = min_t(size_t, count, PAGE_SIZE - 1);
+
+	buf = kmalloc(len + 1, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	if (copy_from_user(buf, ubuf, len)) {
+		kfree(buf);
+		return -EFAULT;
+	}
+	buf[len] = '\0';
+
+	/* a line cut by the page limit is consumed by the next write */
+	end = strrchr(buf, '\n');
+	if (len < count && end) {
+		len = end - buf + 1;
+		buf[len] = '\0';
+	}
+
+	mutex_lock(&input_booster_replay_lock);
+	for (line = buf; (end = strsep(&line, "\n")) != NULL; )
+		if (*end)
+			input_booster_replay_line(end);
+	mutex_unlock(&input_booster_replay_lock);
+
+	kfree(buf);
+
+	return len;
+}
+
+static int input_booster_proc_show(struct seq_file *seq, void *v)
+{
+	struct input_booster_stat stats[ARRAY_SIZE(input_booster_stats)];
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&input_booster_policy_lock, flags);
+	memcpy(stats, input_booster_stats, sizeof(stats));
+	spin_unlock_irqrestore(&input_booster_policy_lock, flags);
+
+	seq_printf(seq, "%-12s %10s %12s %12s %10s\n",
+		   "booster", "holds", "base_ms", "hold_ms", "misses");
+	for (i = 0; i < ARRAY_SIZE(stats); i++)
+		seq_printf(seq, "%-12s %10lu %12lu %12lu %10lu\n",
+			   stats[i].name, stats[i].holds, stats[i].base_ms,
+			   stats[i].hold_ms, stats[i].misses);
+
+	mutex_lock(&input_booster_replay_lock);
+	seq_printf(seq, "%-12s %10lu %12lu %12lu %10s\n", "replay",
+		   input_booster_replay_holds, input_booster_replay_base_ms,
+		   input_booster_replay_hold_ms, "-");
+	mutex_unlock(&input_booster_replay_lock);
+
+	return 0;
+}
+
+static int input_booster_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, input_booster_proc_show, NULL);
+}
+
+static const struct file_operations input_booster_fileops = {
+	.owner		= THIS_MODULE,
+	.open		= input_booster_proc_open,
+	.read		= seq_read,
+	.write		= input_booster_proc_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
 // ********** Define State Functions ********** //
 DECLARE_STATE_FUNC(idle)
 {
@@ -466,7 +765,7 @@ DECLARE_STATE_FUNC(idle)
 			}
 		}
 		SET_BOOSTER;
-		schedule_delayed_work(&_this->input_booster_timeout_work[_this->index], msecs_to_jiffies(_this->param[_this->index].time));
+		schedule_delayed_work(&_this->input_booster_timeout_work[_this->index], input_booster_hold(_this, _this->index));
 		_this->index++;
 		CHANGE_STATE_TO(press);
 	} else if(input_booster_event == BOOSTER_OFF) {
@@ -489,16 +788,16 @@ DECLARE_STATE_FUNC(press)
 					cancel_delayed_work(&_this->input_booster_timeout_work[(_this->index) ? _this->index-1 : 0]);
 					SET_BOOSTER;
 				}
-				schedule_delayed_work(&_this->input_booster_timeout_work[_this->index], msecs_to_jiffies(_this->param[_this->index].time));
+				schedule_delayed_work(&_this->input_booster_timeout_work[_this->index], input_booster_hold(_this, _this->index));
 				pr_debug("[Input Booster] %s           schedule_delayed_work again  time : %d\n", glGage, _this->param[_this->index].time);
 				if(!delayed_work_pending(&_this->input_booster_timeout_work[_this->index]) && _this->param[_this->index].time > 0) {
 					pr_debug("[Input Booster] %s           schedule_delayed_work Re-again time : %d\n", glGage, _this->param[(_this->index > 0) ? _this->index-1 : _this->index].time);
-					schedule_delayed_work(&_this->input_booster_timeout_work[(_this->index > 0) ? _this->index-1 : _this->index], msecs_to_jiffies(_this->param[(_this->index > 0) ? _this->index-1 : _this->index].time));
+					schedule_delayed_work(&_this->input_booster_timeout_work[(_this->index > 0) ? _this->index-1 : _this->index], input_booster_hold(_this, (_this->index > 0) ? _this->index-1 : _this->index));
 				}
 			} else if(_this->param[_this->index].time > 0) {
-				schedule_delayed_work(&_this->input_booster_timeout_work[_this->index], msecs_to_jiffies(_this->param[_this->index].time));
+				schedule_delayed_work(&_this->input_booster_timeout_work[_this->index], input_booster_hold(_this, _this->index));
 			} else {
-				schedule_delayed_work(&_this->input_booster_timeout_work[(_this->index) ? _this->index-1 : 0], msecs_to_jiffies(_this->param[(_this->index > 0) ? _this->index-1 : _this->index].time));
+				schedule_delayed_work(&_this->input_booster_timeout_work[(_this->index) ? _this->index-1 : 0], input_booster_hold(_this, (_this->index > 0) ? _this->index-1 : _this->index));
 			}
 			_this->index++;
 			_this->multi_events = (_this->multi_events > 0) ? 0 : _this->multi_events;
@@ -508,7 +807,7 @@ DECLARE_STATE_FUNC(press)
 		if(delayed_work_pending(&_this->input_booster_timeout_work[_this->index])) {
 			pr_debug("[Input Booster] %s           cancel the pending workqueue for multi events\n", glGage);
 			cancel_delayed_work(&_this->input_booster_timeout_work[_this->index]);
-			schedule_delayed_work(&_this->input_booster_timeout_work[(_this->index) ? _this->index-1 : 0], msecs_to_jiffies(_this->param[(_this->index > 0) ? _this->index-1 : _this->index].time));
+			schedule_delayed_work(&_this->input_booster_timeout_work[(_this->index) ? _this->index-1 : 0], input_booster_hold(_this, (_this->index > 0) ? _this->index-1 : _this->index));
 		} else {
 			pr_debug("[Input Booster] %s      State : Press  index : %d, time : %d\n", glGage, _this->index, _this->param[_this->index].time);
 		}
@@ -524,9 +823,21 @@ void input_booster_disable(struct t_input_booster *_this)
 void input_booster(struct input_dev *dev)
 {
 	int i, j, DetectedCategory = false, iTouchID = -1, iTouchSlot = -1;
+	int pos_x = -1, pos_y = -1;
 #if defined(CONFIG_SOC_EXYNOS7420) // This code should be working properly in Exynos7420(Noble & Zero2) only.
 	int lcdoffcounter = 0;
 #endif
+	for (i = 0; i < input_count && i < MAX_EVENTS; i++) {
+		if (input_events[i].type != EV_ABS)
+			continue;
+		if (input_events[i].code == ABS_MT_POSITION_X && pos_x < 0)
+			pos_x = input_events[i].value;
+		else if (input_events[i].code == ABS_MT_POSITION_Y && pos_y < 0)
+			pos_y = input_events[i].value;
+	}
+	if (pos_x >= 0 && pos_y >= 0)
+		input_booster_track_motion(pos_x, pos_y);
+
 	for (i = 0; i < input_count && i < MAX_EVENTS; i++) {
 		if (DetectedCategory) {
 			break;
@@ -1774,6 +2085,12 @@ static int __init input_proc_init(void)
 	if (!entry)
 		goto fail2;
 
+#if !defined(CONFIG_INPUT_BOOSTER) // Input Booster +
+	if (!proc_create("booster", 0644, proc_bus_input_dir,
+			 &input_booster_fileops))
+		pr_warn("failed to create booster proc entry\n");
+#endif  // Input Booster -
+
 	return 0;
 
  fail2:	remove_proc_entry("devices", proc_bus_input_dir);
@@ -1783,6 +2100,9 @@ static int __init input_proc_init(void)
 
 static void input_proc_exit(void)
 {
+#if !defined(CONFIG_INPUT_BOOSTER) // Input Booster +
+	remove_proc_entry("booster", proc_bus_input_dir);
+#endif  // Input Booster -
 	remove_proc_entry("devices", proc_bus_input_dir);
 	remove_proc_entry("handlers", proc_bus_input_dir);
 	remove_proc_entry("bus/input", NULL);
@@ -213,6 +213,60 @@ void exynos_sysmmu_tlb_invalidate(struct iommu_domain *iommu_domain,
 	spin_unlock_irqrestore(&domain->lock, flags);
 }
 
+void exynos_sysmmu_tlb_invalidate_all(struct iommu_domain *iommu_domain)
+{
+	struct exynos_iommu_domain *domain = to_exynos_domain(iommu_domain);
+	struct exynos_iommu_owner *owner;
+	struct sysmmu_list_data *list;
+	unsigned long flags;
+
+	spin_lock_irqsave(&domain->lock, flags);
+	list_for_each_entry(owner, &domain->clients_list, client) {
+		list_for_each_entry(list, &owner->sysmmu_list, node) {
+			struct sysmmu_drvdata *drvdata = dev_get_drvdata(list->sysmmu);
+
+			spin_lock(&drvdata->lock);
+			if (is_runtime_active_or_enabled(drvdata) &&
+					is_sysmmu_active(drvdata)) {
+				exynos_ss_printk("TLB invalidation %s: all\n",
+						dev_name(drvdata->sysmmu));
+				__sysmmu_tlb_invalidate_all(drvdata->sfrbase,
+							    drvdata->is_abox);
+			}
+			spin_unlock(&drvdata->lock);
+		}
+	}
+	spin_unlock_irqrestore(&domain->lock, flags);
+}
+
+/*
+ * Secure and ABOX System MMUs must see every unmap invalidated before the
+ * IOVA is given back, so the domains they belong to never defer flushes.
+ */
+bool exynos_iommu_domain_needs_strict_flush(struct iommu_domain *iommu_domain)
+{
+	struct exynos_iommu_domain *domain = to_exynos_domain(iommu_domain);
+	struct exynos_iommu_owner *owner;
+	struct sysmmu_list_data *list;
+	unsigned long flags;
+	bool strict = false;
+
+	spin_lock_irqsave(&domain->lock, flags);
+	list_for_each_entry(owner, &domain->clients_list, client) {
+		list_for_each_entry(list, &owner->sysmmu_list, node) {
+			struct sysmmu_drvdata *drvdata = dev_get_drvdata(list->sysmmu);
+
+			if (drvdata->is_abox || drvdata->securebase) {
+				strict = true;
+				goto out;
+			}
+		}
+	}
+out:
+	spin_unlock_irqrestore(&domain->lock, flags);
+
+	return strict;
+}
 
 static unsigned int dump_tlb_entry_way_type(void __iomem *sfrbase,
 						int idx_way, int idx_set)
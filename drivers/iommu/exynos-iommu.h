@@ -14,6 +14,11 @@
 #include <linux/kernel.h>
 #include <linux/spinlock.h>
 #include <linux/list.h>
+#include <linux/rbtree.h>
+#include <linux/percpu.h>
+#include <linux/workqueue.h>
+#include <linux/mutex.h>
+#include <linux/shrinker.h>
 #include <linux/device.h>
 #include <linux/platform_device.h>
 #include <linux/genalloc.h>
@@ -351,21 +356,97 @@ struct sysmmu_drvdata {
 };
 
 struct exynos_vm_region {
-	struct list_head node;
+	struct rb_node node;
+	struct list_head flush_node;	/* entry of exynos_iovmm.flush_list */
 	u32 start;
 	u32 size;
 	u32 section_off;
 	u32 dummy_size;
 };
 
+/*
+ * Freed IOVM ranges are kept reserved in the bitmap and cached per cpu by
+ * size class so that the next map of the same size skips the bitmap scan.
+ * Class n holds ranges of [2^n, 2^(n+1)) times the smallest region.
+ */
+#define IOVM_CACHE_CLASSES	8
+#define IOVM_MAG_SIZE		8
+
+struct iovm_magazine {
+	u32 index[IOVM_MAG_SIZE];	/* first page of the cached range */
+	u32 vsize[IOVM_MAG_SIZE];	/* pages in the cached range */
+	unsigned int count;
+};
+
+struct iovm_cpu_cache {
+	spinlock_t lock;
+	struct iovm_magazine mag[IOVM_CACHE_CLASSES];
+};
+
+struct iovm_stats {
+	u64 alloc_ns_total;
+	u64 alloc_ns_max;
+	unsigned int nr_alloc;
+	unsigned int nr_cache_hit;
+	unsigned int nr_cache_drain;
+	unsigned int nr_alloc_fail;
+};
+
+struct iovm_flush_stats {
+	u64 strict_ns_total;		/* invalidation + PTW wait per unmap */
+	u64 flush_ns_total;		/* time spent in batched flushes */
+	u64 deferred_bytes;
+	unsigned int nr_strict;
+	unsigned int nr_deferred;
+	unsigned int nr_flush;
+	unsigned int nr_flush_all;
+};
+
+/* an IOVM mapping of a dma-buf kept alive for the next iovmm_map_dmabuf() */
+struct exynos_iovmm_dmabuf {
+	struct list_head node;		/* entry of exynos_iovmm.dmabuf_list */
+	struct dma_buf *dmabuf;		/* referenced while the entry lives */
+	struct device *dev;		/* device that created the mapping */
+	phys_addr_t phys;		/* first chunk of the mapped buffer */
+	off_t offset;
+	size_t size;
+	enum dma_data_direction dir;
+	int prot;
+	dma_addr_t iova;
+	unsigned int refcnt;		/* users that have not unmapped yet */
+	unsigned long idle_since;	/* jiffies of the last unmap */
+};
+
+struct iovm_dmabuf_stats {
+	unsigned int nr_hit;
+	unsigned int nr_miss;
+	unsigned int nr_evict;
+	unsigned int nr_expire;
+};
+
 struct exynos_iovmm {
 	struct iommu_domain *domain;	/* iommu domain for this iovmm */
 	size_t iovm_size;		/* iovm bitmap size per plane */
 	u32 iova_start;			/* iovm start address per plane */
 	unsigned long *vm_map;		/* iovm biatmap per plane */
-	struct list_head regions_list;	/* list of exynos_vm_region */
-	spinlock_t vmlist_lock;		/* lock for updating regions_list */
+	struct rb_root regions_root;	/* exynos_vm_region sorted by start */
+	spinlock_t vmlist_lock;		/* lock for updating regions_root */
 	spinlock_t bitmap_lock;		/* lock for manipulating bitmaps */
+	struct iovm_cpu_cache __percpu *cpu_cache;
+	struct iovm_stats stats;	/* protected by vmlist_lock */
+	struct list_head flush_list;	/* unmapped regions awaiting TLB flush */
+	unsigned int flush_count;
+	u32 flush_start;		/* lowest iova in flush_list */
+	u32 flush_end;			/* highest iova + 1 in flush_list */
+	spinlock_t flush_lock;		/* lock for flush_list and fstats */
+	struct delayed_work flush_work;
+	struct iovm_flush_stats fstats;
+	struct list_head dmabuf_list;	/* exynos_iovmm_dmabuf, MRU first */
+	unsigned int dmabuf_idle;	/* entries with no user */
+	struct mutex dmabuf_lock;	/* lock for dmabuf_list and dstats */
+	struct shrinker dmabuf_shrinker;
+	struct iovm_dmabuf_stats dstats;
+	struct delayed_work dmabuf_expire_work;
 	struct device *dev;	/* peripheral device that has this iovmm */
 	size_t allocated_size;
 	int num_areas;
@@ -377,6 +458,8 @@ struct exynos_iovmm {
 
 void exynos_sysmmu_tlb_invalidate(struct iommu_domain *domain, dma_addr_t start,
 				  size_t size);
+void exynos_sysmmu_tlb_invalidate_all(struct iommu_domain *domain);
+bool exynos_iommu_domain_needs_strict_flush(struct iommu_domain *domain);
 int exynos_iommu_map_userptr(struct iommu_domain *dom, unsigned long addr,
 			      dma_addr_t iova, size_t size, int prot);
 void exynos_iommu_unmap_userptr(struct iommu_domain *dom,
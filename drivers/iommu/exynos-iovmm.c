@@ -19,6 +19,8 @@
 #include <linux/err.h>
 #include <linux/debugfs.h>
 #include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/dma-buf.h>
 
 #include <linux/exynos_iovmm.h>
 
@@ -26,6 +28,227 @@
 
 #define sg_physically_continuous(sg) (sg_next(sg) == NULL)
 
+/*
+ * Number of unmapped regions queued before their TLB entries are invalidated
+ * at once and the longest time they may wait. 0 batch means strict unmap.
+ */
+static unsigned int iovmm_flush_batch =
+			IS_ENABLED(CONFIG_EXYNOS_IOVMM_FLUSH_QUEUE) ? 32 : 0;
+static unsigned int iovmm_flush_timeout_ms = 10;
+
+/* batches spanning more than this invalidate the whole TLB */
+#define IOVM_FLUSH_RANGE_MAX	SZ_64M
+/* 60us is required to guarantee that PTW ends itself */
+#define IOVM_PTW_WAIT_US	60
+
+static void iovm_flush_queue(struct exynos_iovmm *vmm);
+
+/* smallest region alloc_iovm_region() hands out: 4KB + 128KB padding */
+#define IOVM_CACHE_MIN_ORDER	ilog2(SZ_256K >> PAGE_SHIFT)
+
+static int iovm_cache_class(u32 vsize)
+{
+	int class = ilog2(vsize) - IOVM_CACHE_MIN_ORDER;
+
+	if (class < 0 || class >= IOVM_CACHE_CLASSES)
+		return -1;
+
+	return class;
+}
+
+/*
+ * Takes a cached range of exactly @vsize pages from the magazine of the
+ * local cpu. The range is still marked in the bitmap.
+ */
+static bool iovm_cache_get(struct exynos_iovmm *vmm, u32 vsize, u32 *index)
+{
+	int class = iovm_cache_class(vsize);
+	struct iovm_cpu_cache *cache;
+	struct iovm_magazine *mag;
+	unsigned long flags;
+	bool hit = false;
+	int i;
+
+	if (class < 0)
+		return false;
+
+	cache = get_cpu_ptr(vmm->cpu_cache);
+	spin_lock_irqsave(&cache->lock, flags);
+	mag = &cache->mag[class];
+	for (i = mag->count - 1; i >= 0; i--) {
+		if (mag->vsize[i] != vsize)
+			continue;
+
+		*index = mag->index[i];
+		mag->count--;
+		mag->index[i] = mag->index[mag->count];
+		mag->vsize[i] = mag->vsize[mag->count];
+		hit = true;
+		break;
+	}
+	spin_unlock_irqrestore(&cache->lock, flags);
+	put_cpu_ptr(vmm->cpu_cache);
+
+	return hit;
+}
+
+static bool iovm_cache_put(struct exynos_iovmm *vmm, u32 vsize, u32 index)
+{
+	int class = iovm_cache_class(vsize);
+	struct iovm_cpu_cache *cache;
+	struct iovm_magazine *mag;
+	unsigned long flags;
+	bool cached = false;
+
+	if (class < 0)
+		return false;
+
+	cache = get_cpu_ptr(vmm->cpu_cache);
+	spin_lock_irqsave(&cache->lock, flags);
+	mag = &cache->mag[class];
+	if (mag->count < IOVM_MAG_SIZE) {
+		mag->index[mag->count] = index;
+		mag->vsize[mag->count] = vsize;
+		mag->count++;
+		cached = true;
+	}
+	spin_unlock_irqrestore(&cache->lock, flags);
+	put_cpu_ptr(vmm->cpu_cache);
+
+	return cached;
+}
+
+/* Returns all cached ranges of every cpu to the bitmap */
+static void iovm_cache_drain(struct exynos_iovmm *vmm)
+{
+	unsigned long flags;
+	int cpu, class;
+	unsigned int i;
+
+	for_each_possible_cpu(cpu) {
+		struct iovm_cpu_cache *cache = per_cpu_ptr(vmm->cpu_cache, cpu);
+
+		spin_lock_irqsave(&cache->lock, flags);
+		spin_lock(&vmm->bitmap_lock);
+		for (class = 0; class < IOVM_CACHE_CLASSES; class++) {
+			struct iovm_magazine *mag = &cache->mag[class];
+
+			for (i = 0; i < mag->count; i++)
+				bitmap_clear(vmm->vm_map,
+					     mag->index[i], mag->vsize[i]);
+			mag->count = 0;
+		}
+		spin_unlock(&vmm->bitmap_lock);
+		spin_unlock_irqrestore(&cache->lock, flags);
+	}
+}
+
+static size_t iovm_cache_size(struct exynos_iovmm *vmm)
+{
+	unsigned long flags;
+	size_t pages = 0;
+	int cpu, class;
+	unsigned int i;
+
+	for_each_possible_cpu(cpu) {
+		struct iovm_cpu_cache *cache = per_cpu_ptr(vmm->cpu_cache, cpu);
+
+		spin_lock_irqsave(&cache->lock, flags);
+		for (class = 0; class < IOVM_CACHE_CLASSES; class++)
+			for (i = 0; i < cache->mag[class].count; i++)
+				pages += cache->mag[class].vsize[i];
+		spin_unlock_irqrestore(&cache->lock, flags);
+	}
+
+	return pages << PAGE_SHIFT;
+}
+
+/* first-fit search of @vsize free pages aligned by @align pages */
+static bool iovm_bitmap_alloc(struct exynos_iovmm *vmm, u32 vsize,
+			      u32 align, u32 *pindex)
+{
+	u32 index = 0;
+	unsigned long end, i;
+
+	spin_lock(&vmm->bitmap_lock);
+again:
+	index = find_next_zero_bit(vmm->vm_map,
+			IOVM_NUM_PAGES(vmm->iovm_size), index);
+
+	if (align) {
+		index = ALIGN(index, align);
+		if (index >= IOVM_NUM_PAGES(vmm->iovm_size)) {
+			spin_unlock(&vmm->bitmap_lock);
+			return false;
+		}
+
+		if (test_bit(index, vmm->vm_map))
+			goto again;
+	}
+
+	end = index + vsize;
+
+	if (end >= IOVM_NUM_PAGES(vmm->iovm_size)) {
+		spin_unlock(&vmm->bitmap_lock);
+		return false;
+	}
+
+	i = find_next_bit(vmm->vm_map, end, index);
+	if (i < end) {
+		index = i + 1;
+		goto again;
+	}
+
+	bitmap_set(vmm->vm_map, index, vsize);
+
+	spin_unlock(&vmm->bitmap_lock);
+
+	*pindex = index;
+
+	return true;
+}
+
+static void insert_iovm_region_locked(struct exynos_iovmm *vmm,
+				      struct exynos_vm_region *region)
+{
+	struct rb_node **p = &vmm->regions_root.rb_node;
+	struct rb_node *parent = NULL;
+
+	while (*p) {
+		struct exynos_vm_region *pos;
+
+		parent = *p;
+		pos = rb_entry(parent, struct exynos_vm_region, node);
+		if (region->start < pos->start)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+
+	rb_link_node(&region->node, parent, p);
+	rb_insert_color(&region->node, &vmm->regions_root);
+}
+
+static struct exynos_vm_region *find_iovm_region_locked(
+				struct exynos_iovmm *vmm, dma_addr_t iova)
+{
+	struct rb_node *n = vmm->regions_root.rb_node;
+
+	while (n) {
+		struct exynos_vm_region *region;
+
+		region = rb_entry(n, struct exynos_vm_region, node);
+		if (iova < region->start)
+			n = n->rb_left;
+		else if (iova >= region->start + region->size)
+			n = n->rb_right;
+		else
+			return region;
+	}
+
+	return NULL;
+}
+
 /* alloc_iovm_region - Allocate IO virtual memory region
  * vmm: virtual memory allocator
  * size: total size to allocate vm region from @vmm.
@@ -52,71 +275,62 @@ static dma_addr_t alloc_iovm_region(struct exynos_iovmm *vmm, size_t size,
 	u32 index = 0;
 	u32 vstart;
 	u32 vsize;
-	unsigned long end, i;
 	struct exynos_vm_region *region;
 	size_t align = SZ_1M;
+	bool hit, drained = false;
+	u64 begin, elapsed;
 
 	BUG_ON(page_offset >= PAGE_SIZE);
 
+	begin = ktime_get_ns();
+
 	/* To avoid allocating prefetched iovm region */
 	vsize = (ALIGN(size + SZ_128K, SZ_128K) + section_offset) >> PAGE_SHIFT;
 	align >>= PAGE_SHIFT;
 	section_offset >>= PAGE_SHIFT;
 
-	spin_lock(&vmm->bitmap_lock);
-again:
-	index = find_next_zero_bit(vmm->vm_map,
-			IOVM_NUM_PAGES(vmm->iovm_size), index);
+	region = kmalloc(sizeof(*region), GFP_KERNEL);
+	if (unlikely(!region))
+		return 0;
 
-	if (align) {
-		index = ALIGN(index, align);
-		if (index >= IOVM_NUM_PAGES(vmm->iovm_size)) {
-			spin_unlock(&vmm->bitmap_lock);
+	hit = iovm_cache_get(vmm, vsize, &index);
+	while (!hit && !iovm_bitmap_alloc(vmm, vsize, align, &index)) {
+		/* cached ranges may be what blocks this allocation */
+		if (drained) {
+			kfree(region);
+			spin_lock(&vmm->vmlist_lock);
+			vmm->stats.nr_alloc_fail++;
+			spin_unlock(&vmm->vmlist_lock);
 			return 0;
 		}
 
-		if (test_bit(index, vmm->vm_map))
-			goto again;
+		iovm_flush_queue(vmm);
+		iovm_cache_drain(vmm);
+		drained = true;
 	}
 
-	end = index + vsize;
-
-	if (end >= IOVM_NUM_PAGES(vmm->iovm_size)) {
-		spin_unlock(&vmm->bitmap_lock);
-		return 0;
-	}
-
-	i = find_next_bit(vmm->vm_map, end, index);
-	if (i < end) {
-		index = i + 1;
-		goto again;
-	}
-
-	bitmap_set(vmm->vm_map, index, vsize);
-
-	spin_unlock(&vmm->bitmap_lock);
-
 	vstart = (index << PAGE_SHIFT) + vmm->iova_start + page_offset;
 
-	region = kmalloc(sizeof(*region), GFP_KERNEL);
-	if (unlikely(!region)) {
-		spin_lock(&vmm->bitmap_lock);
-		bitmap_clear(vmm->vm_map, index, vsize);
-		spin_unlock(&vmm->bitmap_lock);
-		return 0;
-	}
-
-	INIT_LIST_HEAD(&region->node);
 	region->start = vstart;
 	region->size = vsize << PAGE_SHIFT;
 	region->dummy_size = region->size - size;
 	region->section_off = section_offset << PAGE_SHIFT;
 
+	elapsed = ktime_get_ns() - begin;
+
 	spin_lock(&vmm->vmlist_lock);
-	list_add_tail(&region->node, &vmm->regions_list);
+	insert_iovm_region_locked(vmm, region);
 	vmm->allocated_size += region->size;
 	vmm->num_areas++;
 	vmm->num_map++;
+	vmm->stats.nr_alloc++;
+	vmm->stats.alloc_ns_total += elapsed;
+	if (elapsed > vmm->stats.alloc_ns_max)
+		vmm->stats.alloc_ns_max = elapsed;
+	if (hit)
+		vmm->stats.nr_cache_hit++;
+	if (drained)
+		vmm->stats.nr_cache_drain++;
 	spin_unlock(&vmm->vmlist_lock);
 
 	return region->start + region->section_off;
@@ -128,18 +342,10 @@ struct exynos_vm_region *find_iovm_region(struct exynos_iovmm *vmm,
 	struct exynos_vm_region *region;
 
 	spin_lock(&vmm->vmlist_lock);
-
-	list_for_each_entry(region, &vmm->regions_list, node) {
-		if (region->start <= iova &&
-			(region->start + region->size) > iova) {
-			spin_unlock(&vmm->vmlist_lock);
-			return region;
-		}
-	}
-
+	region = find_iovm_region_locked(vmm, iova);
 	spin_unlock(&vmm->vmlist_lock);
 
-	return NULL;
+	return region;
 }
 
 static struct exynos_vm_region *remove_iovm_region(struct exynos_iovmm *vmm,
@@ -149,15 +355,14 @@ static struct exynos_vm_region *remove_iovm_region(struct exynos_iovmm *vmm,
 
 	spin_lock(&vmm->vmlist_lock);
 
-	list_for_each_entry(region, &vmm->regions_list, node) {
-		if (region->start + region->section_off == iova) {
-			list_del(&region->node);
-			vmm->allocated_size -= region->size;
-			vmm->num_areas--;
-			vmm->num_unmap++;
-			spin_unlock(&vmm->vmlist_lock);
-			return region;
-		}
+	region = find_iovm_region_locked(vmm, iova);
+	if (region && (region->start + region->section_off == iova)) {
+		rb_erase(&region->node, &vmm->regions_root);
+		vmm->allocated_size -= region->size;
+		vmm->num_areas--;
+		vmm->num_unmap++;
+		spin_unlock(&vmm->vmlist_lock);
+		return region;
 	}
 
 	spin_unlock(&vmm->vmlist_lock);
@@ -180,31 +385,149 @@ static void free_iovm_region(struct exynos_iovmm *vmm,
 	kfree(region);
 }
 
+/*
+ * Same as free_iovm_region() but keeps the range of an unmapped region
+ * in the size class cache for the next allocation of the same size.
+ */
+static void release_iovm_region(struct exynos_iovmm *vmm,
+				struct exynos_vm_region *region)
+{
+	u32 index = (region->start - vmm->iova_start) >> PAGE_SHIFT;
+
+	if (iovm_cache_put(vmm, region->size >> PAGE_SHIFT, index))
+		kfree(region);
+	else
+		free_iovm_region(vmm, region);
+}
+
+/*
+ * Invalidates the TLB entries of all queued regions with a single range or
+ * whole TLB invalidation and gives their IOVM ranges back.
+ */
+static void iovm_flush_queue(struct exynos_iovmm *vmm)
+{
+	struct exynos_vm_region *region, *tmp;
+	LIST_HEAD(list);
+	u32 start, end;
+	u64 begin, elapsed;
+	bool all;
+
+	spin_lock(&vmm->flush_lock);
+	if (!vmm->flush_count) {
+		spin_unlock(&vmm->flush_lock);
+		return;
+	}
+	list_splice_init(&vmm->flush_list, &list);
+	start = vmm->flush_start;
+	end = vmm->flush_end;
+	vmm->flush_count = 0;
+	spin_unlock(&vmm->flush_lock);
+
+	begin = ktime_get_ns();
+
+	all = (end - start) > IOVM_FLUSH_RANGE_MAX;
+	if (all)
+		exynos_sysmmu_tlb_invalidate_all(vmm->domain);
+	else
+		exynos_sysmmu_tlb_invalidate(vmm->domain, start, end - start);
+
+	udelay(IOVM_PTW_WAIT_US);
+
+	elapsed = ktime_get_ns() - begin;
+
+	list_for_each_entry_safe(region, tmp, &list, flush_node) {
+		list_del(&region->flush_node);
+		release_iovm_region(vmm, region);
+	}
+
+	spin_lock(&vmm->flush_lock);
+	vmm->fstats.nr_flush++;
+	if (all)
+		vmm->fstats.nr_flush_all++;
+	vmm->fstats.flush_ns_total += elapsed;
+	spin_unlock(&vmm->flush_lock);
+}
+
+static void iovm_flush_work(struct work_struct *work)
+{
+	struct exynos_iovmm *vmm = container_of(to_delayed_work(work),
+					struct exynos_iovmm, flush_work);
+
+	iovm_flush_queue(vmm);
+}
+
+/*
+ * Queues an unmapped region instead of invalidating its TLB entries now.
+ * Returns false if the region must be invalidated synchronously.
+ */
+static bool iovm_flush_queue_add(struct exynos_iovmm *vmm,
+				 struct exynos_vm_region *region)
+{
+	unsigned int batch = READ_ONCE(iovmm_flush_batch);
+	bool flush;
+
+	if (!batch || exynos_iommu_domain_needs_strict_flush(vmm->domain))
+		return false;
+
+	spin_lock(&vmm->flush_lock);
+	if (!vmm->flush_count) {
+		vmm->flush_start = region->start;
+		vmm->flush_end = region->start + region->size;
+	} else {
+		vmm->flush_start = min(vmm->flush_start, region->start);
+		vmm->flush_end = max(vmm->flush_end,
+				     region->start + region->size);
+	}
+	list_add_tail(&region->flush_node, &vmm->flush_list);
+	vmm->flush_count++;
+	vmm->fstats.nr_deferred++;
+	vmm->fstats.deferred_bytes += region->size - region->dummy_size;
+	flush = vmm->flush_count >= batch;
+	spin_unlock(&vmm->flush_lock);
+
+	if (flush)
+		iovm_flush_queue(vmm);
+	else
+		schedule_delayed_work(&vmm->flush_work,
+			msecs_to_jiffies(READ_ONCE(iovmm_flush_timeout_ms)));
+
+	return true;
+}
+
 static dma_addr_t add_iovm_region(struct exynos_iovmm *vmm,
 					dma_addr_t start, size_t size)
 {
 	struct exynos_vm_region *region, *pos;
+	struct rb_node **p, *parent = NULL;
 
 	region = kzalloc(sizeof(*region), GFP_KERNEL);
 	if (!region)
 		return 0;
 
-	INIT_LIST_HEAD(&region->node);
 	region->start = start;
 	region->size = size;
 
 	spin_lock(&vmm->vmlist_lock);
 
-	list_for_each_entry(pos, &vmm->regions_list, node) {
+	p = &vmm->regions_root.rb_node;
+	while (*p) {
+		parent = *p;
+		pos = rb_entry(parent, struct exynos_vm_region, node);
 		if ((start < (pos->start + pos->size)) &&
 					((start + size) > pos->start)) {
 			spin_unlock(&vmm->vmlist_lock);
 			kfree(region);
 			return 0;
 		}
+
+		if (start < pos->start)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
 	}
 
-	list_add(&region->node, &vmm->regions_list);
+	rb_link_node(&region->node, parent, p);
+	rb_insert_color(&region->node, &vmm->regions_root);
 
 	spin_unlock(&vmm->vmlist_lock);
 
@@ -214,10 +537,12 @@ static dma_addr_t add_iovm_region(struct exynos_iovmm *vmm,
 static void show_iovm_regions(struct exynos_iovmm *vmm)
 {
 	struct exynos_vm_region *pos;
+	struct rb_node *n;
 
 	pr_err("LISTING IOVMM REGIONS...\n");
 	spin_lock(&vmm->vmlist_lock);
-	list_for_each_entry(pos, &vmm->regions_list, node) {
+	for (n = rb_first(&vmm->regions_root); n; n = rb_next(n)) {
+		pos = rb_entry(n, struct exynos_vm_region, node);
 		pr_err("REGION: %#x (SIZE: %#x, +[%#x, %#x])\n",
 				pos->start, pos->size,
 				pos->section_off, pos->dummy_size);
@@ -247,6 +572,8 @@ void iovmm_deactivate(struct device *dev)
 		return;
 	}
 
+	iovm_flush_queue(vmm);
+
 	iommu_detach_device(vmm->domain, dev);
 }
 
@@ -482,13 +809,22 @@ void iovmm_unmap(struct device *dev, dma_addr_t iova)
 			return;
 		}
 
-		exynos_sysmmu_tlb_invalidate(vmm->domain, region->start, region->size);
+		if (!iovm_flush_queue_add(vmm, region)) {
+			u64 begin = ktime_get_ns();
 
-		/* TODO: for sysmmu v6, remove it later */
-		/* 60us is required to guarantee that PTW ends itself */
-		udelay(60);
+			exynos_sysmmu_tlb_invalidate(vmm->domain,
+						region->start, region->size);
 
-		free_iovm_region(vmm, region);
+			/* TODO: for sysmmu v6, remove it later */
+			udelay(IOVM_PTW_WAIT_US);
+
+			spin_lock(&vmm->flush_lock);
+			vmm->fstats.nr_strict++;
+			vmm->fstats.strict_ns_total += ktime_get_ns() - begin;
+			spin_unlock(&vmm->flush_lock);
+
+			release_iovm_region(vmm, region);
+		}
 
 		dev_dbg(dev, "IOVMM: Unmapped %#x bytes from %#x.\n",
 				(unsigned int)unmap_size, (unsigned int)iova);
@@ -497,6 +833,242 @@ void iovmm_unmap(struct device *dev, dma_addr_t iova)
 	}
 }
 
+/* idle dma-buf mappings kept per IO address space */
+static unsigned int iovmm_dmabuf_cache_max = 32;
+/* idle dma-buf mappings older than this are unmapped and unpinned */
+static unsigned int iovmm_dmabuf_idle_ms = 1000;
+
+/* moves up to @nr idle mappings, least recently used first, to @victims */
+static unsigned long iovm_dmabuf_evict_locked(struct exynos_iovmm *vmm,
+				unsigned long nr, struct list_head *victims)
+{
+	struct exynos_iovmm_dmabuf *map, *tmp;
+	unsigned long evicted = 0;
+
+	list_for_each_entry_safe_reverse(map, tmp, &vmm->dmabuf_list, node) {
+		if (evicted == nr)
+			break;
+
+		if (map->refcnt)
+			continue;
+
+		list_move(&map->node, victims);
+		vmm->dmabuf_idle--;
+		vmm->dstats.nr_evict++;
+		evicted++;
+	}
+
+	return evicted;
+}
+
+static void iovm_dmabuf_release(struct list_head *victims)
+{
+	struct exynos_iovmm_dmabuf *map, *tmp;
+
+	list_for_each_entry_safe(map, tmp, victims, node) {
+		list_del(&map->node);
+		iovmm_unmap(map->dev, map->iova);
+		dma_buf_put(map->dmabuf);
+		kfree(map);
+	}
+}
+
+/*
+ * Unmaps the mappings that have been idle for longer than dmabuf_idle_ms so
+ * that a cached mapping does not keep its buffer allocated indefinitely.
+ */
+static void iovm_dmabuf_expire_work(struct work_struct *work)
+{
+	struct exynos_iovmm *vmm = container_of(to_delayed_work(work),
+					struct exynos_iovmm, dmabuf_expire_work);
+	struct exynos_iovmm_dmabuf *map, *tmp;
+	unsigned long timeout, next = 0;
+	LIST_HEAD(victims);
+
+	timeout = msecs_to_jiffies(READ_ONCE(iovmm_dmabuf_idle_ms));
+
+	mutex_lock(&vmm->dmabuf_lock);
+	list_for_each_entry_safe(map, tmp, &vmm->dmabuf_list, node) {
+		if (map->refcnt)
+			continue;
+
+		if (time_before(jiffies, map->idle_since + timeout)) {
+			if (!next || time_before(map->idle_since + timeout, next))
+				next = map->idle_since + timeout;
+			continue;
+		}
+
+		list_move(&map->node, &victims);
+		vmm->dmabuf_idle--;
+		vmm->dstats.nr_expire++;
+	}
+	if (next)
+		schedule_delayed_work(&vmm->dmabuf_expire_work,
+				      max_t(long, next - jiffies, 1));
+	mutex_unlock(&vmm->dmabuf_lock);
+
+	iovm_dmabuf_release(&victims);
+}
+
+/* takes a user of the mapping of the given part of @dmabuf, if any */
+static struct exynos_iovmm_dmabuf *iovm_dmabuf_get_locked(
+		struct exynos_iovmm *vmm, struct dma_buf *dmabuf,
+		phys_addr_t phys, off_t offset, size_t size,
+		enum dma_data_direction direction, int prot)
+{
+	struct exynos_iovmm_dmabuf *map;
+
+	list_for_each_entry(map, &vmm->dmabuf_list, node) {
+		if (map->dmabuf != dmabuf || map->phys != phys ||
+				map->offset != offset || map->size != size ||
+				map->dir != direction || map->prot != prot)
+			continue;
+
+		if (!map->refcnt++)
+			vmm->dmabuf_idle--;
+		list_move(&map->node, &vmm->dmabuf_list);
+
+		return map;
+	}
+
+	return NULL;
+}
+
+dma_addr_t iovmm_map_dmabuf(struct device *dev, struct dma_buf *dmabuf,
+		struct scatterlist *sg, off_t offset, size_t size,
+		enum dma_data_direction direction, int prot)
+{
+	struct exynos_iovmm *vmm = exynos_get_iovmm(dev);
+	struct exynos_iovmm_dmabuf *map, *new;
+	phys_addr_t phys = sg_phys(sg);
+	dma_addr_t iova;
+
+	if (vmm == NULL) {
+		dev_err(dev, "%s: IOVMM not found\n", __func__);
+		return -EINVAL;
+	}
+
+	mutex_lock(&vmm->dmabuf_lock);
+	map = iovm_dmabuf_get_locked(vmm, dmabuf, phys, offset, size,
+				     direction, prot);
+	if (map) {
+		vmm->dstats.nr_hit++;
+		iova = map->iova;
+	} else {
+		vmm->dstats.nr_miss++;
+	}
+	mutex_unlock(&vmm->dmabuf_lock);
+
+	if (map)
+		return iova;
+
+	new = kzalloc(sizeof(*new), GFP_KERNEL);
+	if (!new)
+		return -ENOMEM;
+
+	iova = iovmm_map(dev, sg, offset, size, direction, prot);
+	if (IS_ERR_VALUE(iova)) {
+		kfree(new);
+		return iova;
+	}
+
+	/* the buffer cannot be freed and reused while the mapping lives */
+	get_dma_buf(dmabuf);
+
+	new->dmabuf = dmabuf;
+	new->dev = dev;
+	new->phys = phys;
+	new->offset = offset;
+	new->size = size;
+	new->dir = direction;
+	new->prot = prot;
+	new->iova = iova;
+	new->refcnt = 1;
+
+	/* another user may have mapped the same buffer in the meantime */
+	mutex_lock(&vmm->dmabuf_lock);
+	map = iovm_dmabuf_get_locked(vmm, dmabuf, phys, offset, size,
+				     direction, prot);
+	if (map)
+		iova = map->iova;
+	else
+		list_add(&new->node, &vmm->dmabuf_list);
+	mutex_unlock(&vmm->dmabuf_lock);
+
+	if (map) {
+		iovmm_unmap(dev, new->iova);
+		dma_buf_put(dmabuf);
+		kfree(new);
+	}
+
+	return iova;
+}
+
+void iovmm_unmap_dmabuf(struct device *dev, struct dma_buf *dmabuf,
+			dma_addr_t iova)
+{
+	struct exynos_iovmm *vmm = exynos_get_iovmm(dev);
+	struct exynos_iovmm_dmabuf *map;
+	unsigned int max = READ_ONCE(iovmm_dmabuf_cache_max);
+	LIST_HEAD(victims);
+
+	if (vmm == NULL) {
+		dev_err(dev, "%s: IOVMM not found\n", __func__);
+		return;
+	}
+
+	mutex_lock(&vmm->dmabuf_lock);
+	list_for_each_entry(map, &vmm->dmabuf_list, node) {
+		if (map->dmabuf == dmabuf && map->iova == iova && map->refcnt)
+			goto found;
+	}
+	mutex_unlock(&vmm->dmabuf_lock);
+
+	dev_err(dev, "IOVMM: No dma-buf mapping %pa to free.\n", &iova);
+	return;
+found:
+	if (!--map->refcnt) {
+		map->idle_since = jiffies;
+		vmm->dmabuf_idle++;
+		if (!delayed_work_pending(&vmm->dmabuf_expire_work))
+			schedule_delayed_work(&vmm->dmabuf_expire_work,
+				msecs_to_jiffies(READ_ONCE(iovmm_dmabuf_idle_ms)));
+	}
+
+	if (vmm->dmabuf_idle > max)
+		iovm_dmabuf_evict_locked(vmm, vmm->dmabuf_idle - max, &victims);
+	mutex_unlock(&vmm->dmabuf_lock);
+
+	iovm_dmabuf_release(&victims);
+}
+
+static unsigned long iovm_dmabuf_shrink_count(struct shrinker *shrinker,
+					      struct shrink_control *sc)
+{
+	struct exynos_iovmm *vmm = container_of(shrinker,
+					struct exynos_iovmm, dmabuf_shrinker);
+
+	return READ_ONCE(vmm->dmabuf_idle);
+}
+
+static unsigned long iovm_dmabuf_shrink_scan(struct shrinker *shrinker,
+					     struct shrink_control *sc)
+{
+	struct exynos_iovmm *vmm = container_of(shrinker,
+					struct exynos_iovmm, dmabuf_shrinker);
+	unsigned long freed;
+	LIST_HEAD(victims);
+
+	if (!mutex_trylock(&vmm->dmabuf_lock))
+		return SHRINK_STOP;
+	freed = iovm_dmabuf_evict_locked(vmm, sc->nr_to_scan, &victims);
+	mutex_unlock(&vmm->dmabuf_lock);
+
+	iovm_dmabuf_release(&victims);
+
+	return freed;
+}
+
 /*
  * NOTE:
  * exynos_iovmm_map_userptr() should be called under current->mm.mmap_sem held.
@@ -592,7 +1164,7 @@ void exynos_iovmm_unmap_userptr(struct device *dev, dma_addr_t iova)
 		exynos_iommu_unmap_userptr(vmm->domain,
 					   start & SPAGE_MASK, size);
 
-		free_iovm_region(vmm, region);
+		release_iovm_region(vmm, region);
 	} else {
 		dev_err(dev, "IOVMM: No IOVM region %pa to free.\n", &iova);
 	}
@@ -672,6 +1244,20 @@ static int exynos_iovmm_create_debugfs(void)
 	else
 		pr_info("IOVMM: Created debugfs entry at debugfs/iovmm\n");
 
+	if (exynos_iovmm_debugfs_root) {
+		debugfs_create_u32("flush_batch", 0644,
+				exynos_iovmm_debugfs_root, &iovmm_flush_batch);
+		debugfs_create_u32("flush_timeout_ms", 0644,
+				exynos_iovmm_debugfs_root,
+				&iovmm_flush_timeout_ms);
+		debugfs_create_u32("dmabuf_cache_max", 0644,
+				exynos_iovmm_debugfs_root,
+				&iovmm_dmabuf_cache_max);
+		debugfs_create_u32("dmabuf_idle_ms", 0644,
+				exynos_iovmm_debugfs_root,
+				&iovmm_dmabuf_idle_ms);
+	}
+
 	exynos_iommu_debugfs_root = debugfs_create_dir("iommu", NULL);
 	if (!exynos_iommu_debugfs_root)
 		pr_err("IOMMU: Failed to create debugfs entry\n");
@@ -682,9 +1268,72 @@ static int exynos_iovmm_create_debugfs(void)
 }
 arch_initcall(exynos_iovmm_create_debugfs);
 
+/*
+ * Estimates the time saved per MB of deferred unmaps: what the deferred
+ * unmaps would have cost with the measured strict invalidation time, minus
+ * the time actually spent in batched flushes.
+ */
+static u64 iovm_flush_saved_ns_per_mb(struct iovm_flush_stats *st)
+{
+	u64 strict_ns = IOVM_PTW_WAIT_US * NSEC_PER_USEC;
+	u64 cost, mb;
+
+	if (st->nr_strict)
+		strict_ns = div_u64(st->strict_ns_total, st->nr_strict);
+
+	cost = strict_ns * st->nr_deferred;
+	if (cost <= st->flush_ns_total)
+		return 0;
+
+	mb = max_t(u64, st->deferred_bytes >> 20, 1);
+
+	return div64_u64(cost - st->flush_ns_total, mb);
+}
+
+/* counts the free extents in the bitmap and the size of the largest one */
+static void iovm_bitmap_frag(struct exynos_iovmm *vmm,
+			     unsigned long *nr_free, unsigned long *max_free)
+{
+	unsigned long nbits = IOVM_NUM_PAGES(vmm->iovm_size);
+	unsigned long start = 0, end;
+
+	*nr_free = 0;
+	*max_free = 0;
+
+	spin_lock(&vmm->bitmap_lock);
+	while ((start = find_next_zero_bit(vmm->vm_map, nbits, start)) < nbits) {
+		end = find_next_bit(vmm->vm_map, nbits, start);
+		(*nr_free)++;
+		*max_free = max(*max_free, end - start);
+		start = end;
+	}
+	spin_unlock(&vmm->bitmap_lock);
+}
+
 static int iovmm_debug_show(struct seq_file *s, void *unused)
 {
 	struct exynos_iovmm *vmm = s->private;
+	unsigned long nr_free, max_free;
+	struct iovm_flush_stats fstats;
+	struct iovm_dmabuf_stats dstats;
+	unsigned int pending, nr_dmabuf = 0, idle;
+	struct exynos_iovmm_dmabuf *map;
+	size_t cached;
+
+	iovm_bitmap_frag(vmm, &nr_free, &max_free);
+	cached = iovm_cache_size(vmm);
+
+	spin_lock(&vmm->flush_lock);
+	fstats = vmm->fstats;
+	pending = vmm->flush_count;
+	spin_unlock(&vmm->flush_lock);
+
+	mutex_lock(&vmm->dmabuf_lock);
+	dstats = vmm->dstats;
+	idle = vmm->dmabuf_idle;
+	list_for_each_entry(map, &vmm->dmabuf_list, node)
+		nr_dmabuf++;
+	mutex_unlock(&vmm->dmabuf_lock);
 
 	seq_printf(s, "%10.s  %10.s  %10.s  %6.s\n",
 			"VASTART", "SIZE", "FREE", "CHUNKS");
@@ -698,7 +1347,33 @@ static int iovmm_debug_show(struct seq_file *s, void *unused)
 	seq_puts(s, "---------------------------------------------\n");
 	seq_printf(s, "Total number of mappings  : %d\n", vmm->num_map);
 	seq_printf(s, "Total number of unmappings: %d\n", vmm->num_unmap);
+	seq_printf(s, "Free extents              : %lu (largest %#lx)\n",
+			nr_free, max_free << PAGE_SHIFT);
+	seq_printf(s, "Cached IOVM               : %#zx\n", cached);
+	seq_printf(s, "Allocations               : %u (cached %u, failed %u)\n",
+			vmm->stats.nr_alloc, vmm->stats.nr_cache_hit,
+			vmm->stats.nr_alloc_fail);
+	seq_printf(s, "Cache drains              : %u\n",
+			vmm->stats.nr_cache_drain);
+	seq_printf(s, "Allocation latency (ns)   : avg %llu max %llu\n",
+			vmm->stats.nr_alloc ?
+			div_u64(vmm->stats.alloc_ns_total, vmm->stats.nr_alloc) : 0,
+			vmm->stats.alloc_ns_max);
 	spin_unlock(&vmm->vmlist_lock);
+	seq_printf(s, "Strict TLB invalidations  : %u\n", fstats.nr_strict);
+	seq_printf(s, "Deferred unmaps           : %u (%#llx bytes, %u pending)\n",
+			fstats.nr_deferred, fstats.deferred_bytes, pending);
+	seq_printf(s, "Batched TLB flushes       : %u (whole TLB %u)\n",
+			fstats.nr_flush, fstats.nr_flush_all);
+	seq_printf(s, "TLB flush time saved      : %llu ns/MB\n",
+			iovm_flush_saved_ns_per_mb(&fstats));
+	seq_printf(s, "Dma-buf mappings          : %u (idle %u)\n",
+			nr_dmabuf, idle);
+	seq_printf(s, "Dma-buf map hit/miss      : %u/%u (%u%%, evicted %u, expired %u)\n",
+			dstats.nr_hit, dstats.nr_miss,
+			(dstats.nr_hit + dstats.nr_miss) ?
+			dstats.nr_hit * 100 / (dstats.nr_hit + dstats.nr_miss) : 0,
+			dstats.nr_evict, dstats.nr_expire);
 
 	return 0;
 }
@@ -717,7 +1392,14 @@ static ssize_t iovmm_debug_write(struct file *filp, const char __user *p,
 	spin_lock(&vmm->vmlist_lock);
 	vmm->num_map = 0;
 	vmm->num_unmap = 0;
+	memset(&vmm->stats, 0, sizeof(vmm->stats));
 	spin_unlock(&vmm->vmlist_lock);
+	spin_lock(&vmm->flush_lock);
+	memset(&vmm->fstats, 0, sizeof(vmm->fstats));
+	spin_unlock(&vmm->flush_lock);
+	mutex_lock(&vmm->dmabuf_lock);
+	memset(&vmm->dstats, 0, sizeof(vmm->dstats));
+	mutex_unlock(&vmm->dmabuf_lock);
 	return len;
 }
 
@@ -743,6 +1425,7 @@ struct exynos_iovmm *exynos_create_single_iovmm(const char *name,
 {
 	struct exynos_iovmm *vmm;
 	int ret = 0;
+	int cpu;
 
 	vmm = kzalloc(sizeof(*vmm), GFP_KERNEL);
 	if (!vmm) {
@@ -758,6 +1441,15 @@ struct exynos_iovmm *exynos_create_single_iovmm(const char *name,
 		goto err_setup_domain;
 	}
 
+	vmm->cpu_cache = alloc_percpu(struct iovm_cpu_cache);
+	if (!vmm->cpu_cache) {
+		ret = -ENOMEM;
+		goto err_setup_domain;
+	}
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(vmm->cpu_cache, cpu)->lock);
+
 	vmm->domain = iommu_domain_alloc(&platform_bus_type);
 	if (!vmm->domain) {
 		ret = -ENOMEM;
@@ -767,7 +1459,21 @@ struct exynos_iovmm *exynos_create_single_iovmm(const char *name,
 	spin_lock_init(&vmm->vmlist_lock);
 	spin_lock_init(&vmm->bitmap_lock);
 
-	INIT_LIST_HEAD(&vmm->regions_list);
+	vmm->regions_root = RB_ROOT;
+
+	INIT_LIST_HEAD(&vmm->flush_list);
+	spin_lock_init(&vmm->flush_lock);
+	INIT_DELAYED_WORK(&vmm->flush_work, iovm_flush_work);
+
+	INIT_LIST_HEAD(&vmm->dmabuf_list);
+	mutex_init(&vmm->dmabuf_lock);
+	INIT_DELAYED_WORK(&vmm->dmabuf_expire_work, iovm_dmabuf_expire_work);
+	vmm->dmabuf_shrinker.count_objects = iovm_dmabuf_shrink_count;
+	vmm->dmabuf_shrinker.scan_objects = iovm_dmabuf_shrink_scan;
+	vmm->dmabuf_shrinker.seeks = DEFAULT_SEEKS;
+	if (register_shrinker(&vmm->dmabuf_shrinker))
+		pr_warn("%s IOVMM: Failed to register dma-buf shrinker\n",
+			name);
 
 	vmm->domain_name = name;
 
@@ -778,6 +1484,8 @@ struct exynos_iovmm *exynos_create_single_iovmm(const char *name,
 	return vmm;
 
 err_setup_domain:
+	free_percpu(vmm->cpu_cache);
+	kfree(vmm->vm_map);
 	kfree(vmm);
 err_alloc_vmm:
 	pr_err("%s IOVMM: Failed to create IOVMM (%d)\n", name, ret);
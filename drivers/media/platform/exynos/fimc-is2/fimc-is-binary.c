@@ -12,8 +12,17 @@
 #include <linux/vmalloc.h>
 #include <linux/fs.h>
 #include <linux/file.h>
+#include <linux/namei.h>
 #include <linux/slab.h>
 #include <linux/firmware.h>
+#include <linux/crc32.h>
+#include <linux/lz4.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/shrinker.h>
+#include <linux/workqueue.h>
+#include <linux/completion.h>
 
 #include "fimc-is-binary.h"
 #include "exynos-fimc-is-sensor.h"
@@ -27,6 +36,38 @@ static struct set_ver set_ver_s[SENSOR_POSITION_MAX];
 
 static const char * const bin_names[] = { "DDK", "RTA", "SETFILE" };
 
+/*
+ * binary cache
+ *
+ * Loaded images are kept after the camera is closed so that the next
+ * launch can skip the file system read (and the unpacking of compressed
+ * images). Entries are verified by CRC before each reuse and
+ * are dropped by the shrinker when they are not in use.
+ */
+struct fimc_is_bin_cache {
+	struct list_head	list;
+	char			*key;
+	void			*data;
+	size_t			size;
+	u32			crc;
+	const struct firmware	*fw;
+	void			(*free)(const void *buf);
+	int			by_fw;
+	int			users;
+	int			err;
+	struct completion	done;
+
+	/* asynchronous prefetch */
+	struct work_struct	work;
+	int			(*load)(struct fimc_is_binary *bin, void *priv);
+	void			*priv;
+};
+
+static LIST_HEAD(bin_cache_list);
+static DEFINE_MUTEX(bin_cache_lock);
+static unsigned long bin_cache_pages;
+static atomic_t bin_cache_shrinker_on = ATOMIC_INIT(0);
+
 static char *library_get_buf(const struct is_bin_ver_info *info, unsigned int hint)
 {
 	struct lib_ver *s = (struct lib_ver *)info->s;
@@ -242,6 +283,7 @@ int request_binary(struct fimc_is_binary *bin, const char *path,
 	bin->data = NULL;
 	bin->size = 0;
 	bin->fw = NULL;
+	bin->cache = NULL;
 
 	/* whether the loader is customized or not */
 	if (bin->customized != (unsigned long)bin) {
@@ -288,13 +330,482 @@ int request_binary(struct fimc_is_binary *bin, const char *path,
 	return ret;
 }
 
+static inline u64 bin_elapsed_us(u64 start)
+{
+	return div_u64(ktime_get_ns() - start, NSEC_PER_USEC);
+}
+
+/*
+ * bin_unpack: replace a LZ4 compressed image by its uncompressed form
+ */
+static int bin_unpack(struct fimc_is_binary *bin)
+{
+	struct is_bin_lz4_header *hdr = bin->data;
+	size_t size;
+	void *buf;
+	int ret;
+
+	if (bin->size < sizeof(*hdr) || hdr->magic != IS_BIN_LZ4_MAGIC)
+		return 0;
+
+	size = hdr->size;
+	buf = vmalloc(size);
+	if (!buf)
+		return -ENOMEM;
+
+	ret = lz4_decompress_unknownoutputsize((unsigned char *)(hdr + 1),
+				bin->size - sizeof(*hdr), buf, &size);
+	if (ret || size != hdr->size) {
+		pr_err("%s: failed to unpack (%d, %zu != %u)\n", __func__,
+				ret, size, hdr->size);
+		vfree(buf);
+		return -EINVAL;
+	}
+
+	release_binary(bin);
+	bin->fw = NULL;
+	bin->data = buf;
+	bin->size = size;
+	bin->free = &vfree;
+
+	return 0;
+}
+
+static void bin_cache_free(struct fimc_is_bin_cache *bc)
+{
+	if (bc->fw)
+		release_firmware(bc->fw);
+	else if (bc->data)
+		bc->free(bc->data);
+
+	kfree(bc->key);
+	kfree(bc);
+}
+
+static void bin_cache_unlink(struct fimc_is_bin_cache *bc)
+{
+	if (list_empty(&bc->list))
+		return;
+
+	list_del_init(&bc->list);
+	bin_cache_pages -= PAGE_ALIGN(bc->size) >> PAGE_SHIFT;
+}
+
+static void bin_cache_put(struct fimc_is_bin_cache *bc, bool drop)
+{
+	bool release;
+
+	mutex_lock(&bin_cache_lock);
+	if (drop)
+		bin_cache_unlink(bc);
+	release = !--bc->users && list_empty(&bc->list);
+	mutex_unlock(&bin_cache_lock);
+
+	if (release)
+		bin_cache_free(bc);
+}
+
+static unsigned long bin_cache_count(struct shrinker *s, struct shrink_control *sc)
+{
+	return bin_cache_pages;
+}
+
+static unsigned long bin_cache_scan(struct shrinker *s, struct shrink_control *sc)
+{
+	struct fimc_is_bin_cache *bc, *temp;
+	unsigned long freed = 0;
+	LIST_HEAD(victims);
+
+	if (!mutex_trylock(&bin_cache_lock))
+		return SHRINK_STOP;
+
+	list_for_each_entry_safe(bc, temp, &bin_cache_list, list) {
+		if (bc->users)
+			continue;
+
+		freed += PAGE_ALIGN(bc->size) >> PAGE_SHIFT;
+		bin_cache_unlink(bc);
+		list_add(&bc->list, &victims);
+
+		if (freed >= sc->nr_to_scan)
+			break;
+	}
+	mutex_unlock(&bin_cache_lock);
+
+	list_for_each_entry_safe(bc, temp, &victims, list) {
+		info("binary cache: drop %s (%zu bytes)\n", bc->key, bc->size);
+		bin_cache_free(bc);
+	}
+
+	return freed;
+}
+
+static struct shrinker bin_cache_shrinker = {
+	.count_objects	= bin_cache_count,
+	.scan_objects	= bin_cache_scan,
+	.seeks		= DEFAULT_SEEKS,
+};
+
+static struct fimc_is_bin_cache *bin_cache_alloc(const char *key)
+{
+	struct fimc_is_bin_cache *bc;
+
+	bc = kzalloc(sizeof(*bc), GFP_KERNEL);
+	if (!bc)
+		return NULL;
+
+	bc->key = kstrdup(key, GFP_KERNEL);
+	if (!bc->key) {
+		kfree(bc);
+		return NULL;
+	}
+
+	INIT_LIST_HEAD(&bc->list);
+	init_completion(&bc->done);
+	bc->users = 1;
+
+	return bc;
+}
+
+static struct fimc_is_bin_cache *bin_cache_find(const char *key)
+{
+	struct fimc_is_bin_cache *bc;
+
+	list_for_each_entry(bc, &bin_cache_list, list)
+		if (!strcmp(bc->key, key))
+			return bc;
+
+	return NULL;
+}
+
+/*
+ * bin_cache_fill: hand a freshly loaded image over to a cache entry
+ * the image is unpacked first if it is compressed
+ */
+static int bin_cache_fill(struct fimc_is_bin_cache *bc, struct fimc_is_binary *bin)
+{
+	u64 start;
+	int ret;
+
+	bc->by_fw = was_loaded_by(bin);
+
+	start = ktime_get_ns();
+	ret = bin_unpack(bin);
+	if (ret)
+		return ret;
+
+	bc->fw = bin->fw;
+	bc->data = bin->data;
+	bc->size = bin->size;
+	bc->free = bin->free;
+	bc->crc = crc32_le(~0, bc->data, bc->size);
+
+	bin->fw = NULL;
+	bin->cache = bc;
+
+	info("binary cache: %s %zu bytes, unpack %llu us\n",
+			bc->key, bc->size, bin_elapsed_us(start));
+
+	return 0;
+}
+
+/*
+ * bin_cache_get: borrow a cached image, waiting for its prefetch if needed
+ */
+static int bin_cache_get(struct fimc_is_bin_cache *bc, struct fimc_is_binary *bin)
+{
+	u64 start;
+
+	wait_for_completion(&bc->done);
+	if (bc->err)
+		return bc->err;
+
+	start = ktime_get_ns();
+	if (crc32_le(~0, bc->data, bc->size) != bc->crc) {
+		pr_err("%s: %s is corrupted\n", __func__, bc->key);
+		return -EBADMSG;
+	}
+
+	bin->data = bc->data;
+	bin->size = bc->size;
+	bin->cache = bc;
+
+	info("binary cache: %s hit, verify %llu us\n", bc->key, bin_elapsed_us(start));
+
+	return 0;
+}
+
+static void bin_cache_publish(struct fimc_is_bin_cache *bc, int err)
+{
+	mutex_lock(&bin_cache_lock);
+	bc->err = err;
+	if (!err)
+		bin_cache_pages += PAGE_ALIGN(bc->size) >> PAGE_SHIFT;
+	mutex_unlock(&bin_cache_lock);
+
+	complete_all(&bc->done);
+
+	if (!atomic_cmpxchg(&bin_cache_shrinker_on, 0, 1))
+		register_shrinker(&bin_cache_shrinker);
+}
+
+static int bin_load(struct fimc_is_binary *bin, const char *key,
+			int (*load)(struct fimc_is_binary *bin, void *priv), void *priv)
+{
+	u64 start;
+	int ret;
+
+	start = ktime_get_ns();
+	ret = load(bin, priv);
+	if (!ret)
+		info("binary cache: %s read %llu us\n", key, bin_elapsed_us(start));
+
+	return ret;
+}
+
+ /**
+  * request_binary_by: load a binary through the binary cache
+  * @bin: pointer to fimc_is_binary structure
+  * @key: name of the binary in the cache
+  * @load: loader to call on a cache miss, fills @bin like request_binary
+  * @priv: argument of @load
+  **/
+int request_binary_by(struct fimc_is_binary *bin, const char *key,
+			int (*load)(struct fimc_is_binary *bin, void *priv), void *priv)
+{
+	struct fimc_is_bin_cache *bc;
+	int ret;
+
+	bin->data = NULL;
+	bin->size = 0;
+	bin->fw = NULL;
+	bin->cache = NULL;
+
+	mutex_lock(&bin_cache_lock);
+	bc = bin_cache_find(key);
+	if (bc) {
+		bc->users++;
+		mutex_unlock(&bin_cache_lock);
+
+		ret = bin_cache_get(bc, bin);
+		if (!ret)
+			return 0;
+
+		/* a stale entry is never handed out again */
+		bin_cache_put(bc, true);
+		goto p_uncached;
+	}
+
+	bc = bin_cache_alloc(key);
+	if (!bc) {
+		mutex_unlock(&bin_cache_lock);
+		goto p_uncached;
+	}
+	list_add(&bc->list, &bin_cache_list);
+	mutex_unlock(&bin_cache_lock);
+
+	ret = bin_load(bin, key, load, priv);
+	if (!ret) {
+		ret = bin_cache_fill(bc, bin);
+		if (ret)
+			release_binary(bin);
+	}
+
+	bin_cache_publish(bc, ret);
+	if (ret)
+		bin_cache_put(bc, true);
+
+	return ret;
+
+p_uncached:
+	ret = bin_load(bin, key, load, priv);
+	if (ret)
+		return ret;
+
+	ret = bin_unpack(bin);
+	if (ret)
+		release_binary(bin);
+
+	return ret;
+}
+
+struct bin_request {
+	const char *path;
+	const char *name;
+	struct device *device;
+};
+
+static int bin_request_load(struct fimc_is_binary *bin, void *priv)
+{
+	struct bin_request *req = priv;
+
+	return request_binary(bin, req->path, req->name, req->device);
+}
+
+static int bin_file_stat(const char *filename, struct kstat *st)
+{
+	struct path path;
+	int ret;
+
+	ret = kern_path(filename, LOOKUP_FOLLOW, &path);
+	if (ret)
+		return ret;
+
+	ret = vfs_getattr(&path, st);
+	path_put(&path);
+	if (!ret && !S_ISREG(st->mode))
+		ret = -EINVAL;
+
+	return ret;
+}
+
+/*
+ * bin_cache_drop_stale: drop idle entries of older versions of a file
+ * @filename: full path of the file
+ * @key: cache key of the current version
+ */
+static void bin_cache_drop_stale(const char *filename, const char *key)
+{
+	struct fimc_is_bin_cache *bc, *temp;
+	size_t len = strlen(filename);
+	LIST_HEAD(victims);
+
+	mutex_lock(&bin_cache_lock);
+	list_for_each_entry_safe(bc, temp, &bin_cache_list, list) {
+		if (bc->users || strncmp(bc->key, filename, len) ||
+				bc->key[len] != '@' || !strcmp(bc->key, key))
+			continue;
+
+		bin_cache_unlink(bc);
+		list_add(&bc->list, &victims);
+	}
+	mutex_unlock(&bin_cache_lock);
+
+	list_for_each_entry_safe(bc, temp, &victims, list) {
+		info("binary cache: drop %s, replaced\n", bc->key);
+		bin_cache_free(bc);
+	}
+}
+
+ /**
+  * request_cached_binary: request_binary through the binary cache
+  * @bin: pointer to fimc_is_binary structure
+  * @path: path of binary file
+  * @name: name of binary file, also used as the cache key
+  * @device: device for which binary is being loaded
+  *
+  * A file at @path takes precedence over the firmware, as in request_binary.
+  * Such a file is replaced by hand for tuning, so it is cached by its path,
+  * size and mtime instead, and a new version is read on the next request.
+  **/
+int request_cached_binary(struct fimc_is_binary *bin, const char *path,
+				const char *name, struct device *device)
+{
+	struct bin_request req = {
+		.path	= path,
+		.name	= name,
+		.device	= device,
+	};
+	struct kstat st;
+	char *filename, *key;
+	int ret;
+
+	if (!path)
+		return request_binary_by(bin, name, bin_request_load, &req);
+
+	filename = __getname();
+	if (unlikely(!filename))
+		return -ENOMEM;
+
+	snprintf(filename, PATH_MAX, "%s%s", path, name);
+	if (bin_file_stat(filename, &st)) {
+		ret = request_binary_by(bin, name, bin_request_load, &req);
+		goto p_putname;
+	}
+
+	key = kasprintf(GFP_KERNEL, "%s@%lld.%ld.%ld", filename,
+			(long long)st.size, st.mtime.tv_sec, st.mtime.tv_nsec);
+	if (!key) {
+		ret = -ENOMEM;
+		goto p_putname;
+	}
+
+	bin_cache_drop_stale(filename, key);
+	ret = request_binary_by(bin, key, bin_request_load, &req);
+	kfree(key);
+
+p_putname:
+	__putname(filename);
+
+	return ret;
+}
+
+static void bin_prefetch_work(struct work_struct *work)
+{
+	struct fimc_is_bin_cache *bc = container_of(work, struct fimc_is_bin_cache, work);
+	struct fimc_is_binary bin;
+	int ret;
+
+	setup_binary_loader(&bin, 0, 0, NULL, NULL);
+	bin.cache = NULL;
+
+	ret = bin_load(&bin, bc->key, bc->load, bc->priv);
+	if (!ret) {
+		ret = bin_cache_fill(bc, &bin);
+		if (ret)
+			release_binary(&bin);
+	}
+
+	bin_cache_publish(bc, ret);
+	bin_cache_put(bc, !!ret);
+}
+
+ /**
+  * prefetch_binary_by: start loading a binary into the binary cache
+  * @key: name of the binary in the cache
+  * @load: loader to run asynchronously, fills a binary like request_binary
+  * @priv: argument of @load, must stay valid until the binary is requested
+  *
+  * A following request_binary_by() with the same key waits for the prefetch
+  * instead of loading the binary again.
+  **/
+int prefetch_binary_by(const char *key,
+			int (*load)(struct fimc_is_binary *bin, void *priv), void *priv)
+{
+	struct fimc_is_bin_cache *bc;
+
+	mutex_lock(&bin_cache_lock);
+	if (bin_cache_find(key)) {
+		mutex_unlock(&bin_cache_lock);
+		return 0;
+	}
+
+	bc = bin_cache_alloc(key);
+	if (!bc) {
+		mutex_unlock(&bin_cache_lock);
+		return -ENOMEM;
+	}
+
+	bc->load = load;
+	bc->priv = priv;
+	INIT_WORK(&bc->work, bin_prefetch_work);
+	list_add(&bc->list, &bin_cache_list);
+	mutex_unlock(&bin_cache_lock);
+
+	queue_work(system_unbound_wq, &bc->work);
+
+	return 0;
+}
+
 /**
  * release_firmware: release the resource related to a binary
  * @bin: binary resource to release
 **/
 void release_binary(struct fimc_is_binary *bin)
 {
-	if (bin->fw)
+	if (bin->cache)
+		bin_cache_put(bin->cache, false);
+	else if (bin->fw)
 		release_firmware(bin->fw);
 	else if (bin->data)
 		bin->free(bin->data);
@@ -306,7 +817,9 @@ void release_binary(struct fimc_is_binary *bin)
 **/
 int was_loaded_by(struct fimc_is_binary *bin)
 {
-	if (bin->fw)
+	if (bin->cache)
+		return bin->cache->by_fw;
+	else if (bin->fw)
 		return 1;	/* by request_firmware */
 	else if (bin->data)
 		return 0;	/* from file system */
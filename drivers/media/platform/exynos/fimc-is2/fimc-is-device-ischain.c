@@ -1044,45 +1044,44 @@ err:
 #endif
 
 #if !defined(DISABLE_SETFILE)
-static int fimc_is_ischain_loadsetf(struct fimc_is_device_ischain *device,
-	struct fimc_is_vender *vender,
-	ulong load_addr)
+static int fimc_is_ischain_readsetf(struct fimc_is_binary *bin, void *priv)
 {
 	int ret = 0;
-	void *address;
+	struct fimc_is_device_ischain *device = priv;
+	struct fimc_is_core *core;
+	struct fimc_is_vender *vender;
 	const struct firmware *fw_blob = NULL;
 	u8 *buf = NULL;
 	struct file *fp = NULL;
 	mm_segment_t old_fs;
 	long fsize, nread;
-	int fw_requested = 1;
 	u32 retry;
 	int fw_load_ret = 0;
 	int position;
 
-	mdbgd_ischain("%s\n", device, __func__);
+	core = (struct fimc_is_core *)platform_get_drvdata(device->pdev);
+	vender = &core->vender;
+	position = device->sensor->position;
 
-	if (IS_ERR_OR_NULL(device->sensor)) {
-		err("sensor device is NULL");
-		ret = -EINVAL;
-		goto out;
-	}
+	bin->data = NULL;
+	bin->size = 0;
+	bin->fw = NULL;
+	bin->cache = NULL;
 
-	position = device->sensor->position;
 	old_fs = get_fs();
 	set_fs(KERNEL_DS);
 	fp = filp_open(vender->setfile_path[position], O_RDONLY, 0);
 	if (IS_ERR_OR_NULL(fp)) {
 		fw_load_ret = fimc_is_vender_fw_filp_open(vender, &fp, IS_BIN_SETFILE);
 		if (fw_load_ret == FW_SKIP) {
+			set_fs(old_fs);
 			goto request_fw;
 		} else if (fw_load_ret == FW_FAIL) {
-			fw_requested = 0;
-			goto out;
-	}
+			set_fs(old_fs);
+			return -ENOENT;
+		}
 	}
 
-	fw_requested = 0;
 	fsize = fp->f_path.dentry->d_inode->i_size;
 	info("start(%d), file path %s, size %ld Bytes\n",
 		fw_load_ret, vender->setfile_path[position], fsize);
@@ -1092,73 +1091,110 @@ static int fimc_is_ischain_loadsetf(struct fimc_is_device_ischain *device,
 		dev_err(&device->pdev->dev,
 			"failed to allocate memory\n");
 		ret = -ENOMEM;
-		goto out;
+		goto p_close;
 	}
 	nread = vfs_read(fp, (char __user *)buf, fsize, &fp->f_pos);
 	if (nread != fsize) {
 		dev_err(&device->pdev->dev,
 			"failed to read firmware file, %ld Bytes\n", nread);
+		vfree(buf);
 		ret = -EIO;
-		goto out;
+		goto p_close;
 	}
 
-	address = (void *)(device->minfo->kvaddr + load_addr);
-	memcpy((void *)address, (void *)buf, fsize);
-	fimc_is_ischain_cache_flush(device, load_addr, fsize + 1);
-	carve_binary_version(IS_BIN_SETFILE, position, buf, fsize);
+	bin->data = buf;
+	bin->size = fsize;
+	bin->free = &vfree;
 
-request_fw:
-	if (fw_requested) {
-		set_fs(old_fs);
+p_close:
+	filp_close(fp, current->files);
+	set_fs(old_fs);
+	return ret;
 
-		retry = 4;
+request_fw:
+	retry = 4;
+	ret = request_firmware((const struct firmware **)&fw_blob,
+		vender->request_setfile_path[position], &device->pdev->dev);
+	while (--retry && ret) {
+		mwarn("request_firmware is fail(%d)", device, ret);
 		ret = request_firmware((const struct firmware **)&fw_blob,
 			vender->request_setfile_path[position], &device->pdev->dev);
-		while (--retry && ret) {
-			mwarn("request_firmware is fail(%d)", device, ret);
-			ret = request_firmware((const struct firmware **)&fw_blob,
-				vender->request_setfile_path[position], &device->pdev->dev);
-		}
+	}
 
-		if (!retry) {
-			merr("request_firmware is fail(%d)", device, ret);
-			ret = -EINVAL;
-			goto out;
-		}
+	if (ret) {
+		merr("request_firmware is fail(%d)", device, ret);
+		return -EINVAL;
+	}
 
-		if (!fw_blob) {
-			merr("fw_blob is NULL", device);
-			ret = -EINVAL;
-			goto out;
-		}
+	if (!fw_blob || !fw_blob->data) {
+		merr("fw_blob is NULL", device);
+		release_firmware(fw_blob);
+		return -EINVAL;
+	}
 
-		if (!fw_blob->data) {
-			merr("fw_blob->data is NULL", device);
-			ret = -EINVAL;
-			goto out;
-		}
+	bin->fw = fw_blob;
+	bin->data = (void *)fw_blob->data;
+	bin->size = fw_blob->size;
+
+	return 0;
+}
+
+/* a setfile pushed for tuning is read again on every launch */
+static bool fimc_is_ischain_setf_pushed(struct fimc_is_vender *vender, int position)
+{
+	struct file *fp;
+
+	fp = filp_open(vender->setfile_path[position], O_RDONLY, 0);
+	if (IS_ERR_OR_NULL(fp))
+		return false;
+
+	filp_close(fp, current->files);
+
+	return true;
+}
+
+static int fimc_is_ischain_loadsetf(struct fimc_is_device_ischain *device,
+	struct fimc_is_vender *vender,
+	ulong load_addr)
+{
+	int ret = 0;
+	void *address;
+	struct fimc_is_binary bin;
+	int position;
+
+	mdbgd_ischain("%s\n", device, __func__);
 
-		address = (void *)(device->minfo->kvaddr + load_addr);
-		memcpy(address, fw_blob->data, fw_blob->size);
-		fimc_is_ischain_cache_flush(device, load_addr, fw_blob->size + 1);
-		carve_binary_version(IS_BIN_SETFILE, position,
-				(void *)fw_blob->data, fw_blob->size);
+	if (IS_ERR_OR_NULL(device->sensor)) {
+		err("sensor device is NULL");
+		ret = -EINVAL;
+		goto out;
 	}
 
-out:
-	if (!fw_requested) {
-		if (buf) {
-			vfree(buf);
-		}
-		if (!IS_ERR_OR_NULL(fp)) {
-			filp_close(fp, current->files);
-		}
-		set_fs(old_fs);
-	} else {
-		if (!IS_ERR_OR_NULL(fw_blob))
-			release_firmware(fw_blob);
+	position = device->sensor->position;
+
+	TIME_LAUNCH_STR(LAUNCH_SETFILE_LOAD);
+	setup_binary_loader(&bin, 0, 0, NULL, NULL);
+	if (fimc_is_ischain_setf_pushed(vender, position))
+		ret = fimc_is_ischain_readsetf(&bin, device);
+	else
+		ret = request_binary_by(&bin, vender->request_setfile_path[position],
+					fimc_is_ischain_readsetf, device);
+	if (ret == -ENOENT) {
+		/* no dumped setfile to load */
+		ret = 0;
+		goto out;
+	} else if (ret) {
+		goto out;
 	}
 
+	address = (void *)(device->minfo->kvaddr + load_addr);
+	memcpy(address, bin.data, bin.size);
+	fimc_is_ischain_cache_flush(device, load_addr, bin.size + 1);
+	carve_binary_version(IS_BIN_SETFILE, position, bin.data, bin.size);
+	release_binary(&bin);
+	TIME_LAUNCH_END(LAUNCH_SETFILE_LOAD);
+
+out:
 	if (ret)
 		err("setfile loading is fail");
 	else
@@ -3587,6 +3623,13 @@ static int fimc_is_ischain_init(struct fimc_is_device_ischain *device,
 		goto p_err;
 	}
 
+#if !defined(DISABLE_SETFILE)
+	/* read the setfile in parallel with the library opening the stream */
+	if (!fimc_is_ischain_setf_pushed(vender, module->position))
+		prefetch_binary_by(vender->request_setfile_path[module->position],
+					fimc_is_ischain_readsetf, device);
+#endif
+
 	ret = fimc_is_itf_enum(device);
 	if (ret) {
 		merr("fimc_is_itf_enum is fail(%d)", device, ret);
@@ -68,6 +68,7 @@ enum fimc_is_time_launch {
 	LAUNCH_SENSOR_INIT,
 	LAUNCH_SENSOR_START,
 	LAUNCH_FAST_AE,
+	LAUNCH_SETFILE_LOAD,
 	LAUNCH_TOTAL,
 };
 
@@ -187,11 +187,27 @@ struct is_bin_ver_info {
 #define IS_BIN_LIB_HINT_DDK	0
 #define IS_BIN_LIB_HINT_RTA	1
 
+/*
+ * a binary image may be shipped LZ4 compressed with this header in front,
+ * it is unpacked once when it is loaded into the binary cache
+ */
+#define IS_BIN_LZ4_MAGIC	0x345A4C46	/* "FLZ4" */
+
+struct is_bin_lz4_header {
+	u32 magic;
+	u32 size;	/* size of the uncompressed image */
+	u32 reserved[2];
+};
+
+struct fimc_is_bin_cache;
+
 struct fimc_is_binary {
 	void *data;
 	size_t size;
 
 	const struct firmware *fw;
+	/* set if data is borrowed from the binary cache */
+	struct fimc_is_bin_cache *cache;
 
 	unsigned long customized;
 
@@ -213,6 +229,12 @@ void setup_binary_loader(struct fimc_is_binary *bin,
 				void (*free)(const void *buf));
 int request_binary(struct fimc_is_binary *bin, const char *path,
 				const char *name, struct device *device);
+int request_binary_by(struct fimc_is_binary *bin, const char *key,
+			int (*load)(struct fimc_is_binary *bin, void *priv), void *priv);
+int request_cached_binary(struct fimc_is_binary *bin, const char *path,
+				const char *name, struct device *device);
+int prefetch_binary_by(const char *key,
+			int (*load)(struct fimc_is_binary *bin, void *priv), void *priv);
 void release_binary(struct fimc_is_binary *bin);
 int was_loaded_by(struct fimc_is_binary *bin);
 
@@ -2158,7 +2158,7 @@ int fimc_is_load_ddk_bin(int loadType)
 	ret = fimc_is_vender_request_binary(&bin, FIMC_IS_ISP_LIB_SDCARD_PATH, FIMC_IS_FW_DUMP_PATH,
 						gPtr_lib_support.fw_name, device);
 #else
-	ret = request_binary(&bin, FIMC_IS_ISP_LIB_SDCARD_PATH,
+	ret = request_cached_binary(&bin, FIMC_IS_ISP_LIB_SDCARD_PATH,
 						FIMC_IS_ISP_LIB, device);
 #endif
 	if (ret) {
@@ -2304,7 +2304,7 @@ int fimc_is_load_vra_bin(int loadType)
 	}
 
 	setup_binary_loader(&bin, 3, -EAGAIN, NULL, NULL);
-	ret = request_binary(&bin, FIMC_IS_ISP_LIB_SDCARD_PATH,
+	ret = request_cached_binary(&bin, FIMC_IS_ISP_LIB_SDCARD_PATH,
 						FIMC_IS_VRA_LIB, device);
 	if (ret) {
 		err_lib("failed to load VRA library (%d)", ret);
@@ -2350,7 +2350,7 @@ int fimc_is_load_rta_bin(int loadType)
 	ret = fimc_is_vender_request_binary(&bin, FIMC_IS_ISP_LIB_SDCARD_PATH, FIMC_IS_FW_DUMP_PATH,
 						gPtr_lib_support.rta_fw_name, device);
 #else
-	ret = request_binary(&bin, FIMC_IS_ISP_LIB_SDCARD_PATH,
+	ret = request_cached_binary(&bin, FIMC_IS_ISP_LIB_SDCARD_PATH,
 						FIMC_IS_RTA_LIB, device);
 #endif
 	if (ret) {
@@ -50,6 +50,15 @@ module_param_named(sc_set_blur, sc_set_blur, uint, 0644);
 int __measure_hw_latency;
 module_param_named(measure_hw_latency, __measure_hw_latency, int, 0644);
 
+/*
+ * If true, the source crop that is not aligned to the pre-scaler is trimmed
+ * by the remainder instead of falling back to two-pass scaling. The trimmed
+ * area is always smaller than a destination pixel, but the output is no
+ * longer bit-exact with the two-pass result, so it is off by default.
+ */
+int sc_prescale_trim;
+module_param_named(prescale_trim, sc_prescale_trim, int, 0644);
+
 struct vb2_sc_buffer {
 	struct v4l2_m2m_buffer mb;
 	struct sc_ctx *ctx;
@@ -815,6 +824,141 @@ static int sc_v4l2_dqbuf(struct file *file, void *fh,
 	return v4l2_m2m_dqbuf(file, ctx->m2m_ctx, buf);
 }
 
+/* deadline of the jobs of the contexts that do not specify it */
+static const u32 sc_prio_deadline_us[SC_PRIO_NUM] = {
+	[SC_PRIO_NORMAL]	= 33000,
+	[SC_PRIO_REALTIME]	= 8000,
+	[SC_PRIO_BACKGROUND]	= 200000,
+};
+
+static u32 sc_ctx_deadline_us(struct sc_ctx *ctx)
+{
+	return ctx->deadline_us ?: sc_prio_deadline_us[ctx->priority];
+}
+
+/*
+ * v4l2-m2m runs the jobs of the V4L2 contexts in the order they are ready,
+ * so only one of them is handed to it at a time. The others wait in
+ * sc->m2m_waiting and the one with the earliest deadline goes next.
+ * Called by v4l2_m2m_try_schedule() with the job spinlock of m2m held.
+ */
+static int sc_m2m_job_ready(void *priv)
+{
+	struct sc_ctx *ctx = priv;
+	struct sc_dev *sc = ctx->sc_dev;
+	unsigned long flags;
+	int ready = 0;
+
+	spin_lock_irqsave(&sc->ctxlist_lock, flags);
+	/* sc_m2m_ctx_release() must not find ctx in the list again */
+	if (test_bit(CTX_RELEASE, &ctx->flags))
+		goto out;
+
+	if (!sc->m2m_owner) {
+		list_del_init(&ctx->m2m_node);
+		sc->m2m_owner = ctx;
+		ready = 1;
+	} else if (list_empty(&ctx->m2m_node)) {
+		ctx->m2m_deadline = ktime_add_us(ktime_get(),
+						 sc_ctx_deadline_us(ctx));
+		list_add_tail(&ctx->m2m_node, &sc->m2m_waiting);
+	}
+out:
+	spin_unlock_irqrestore(&sc->ctxlist_lock, flags);
+
+	return ready;
+}
+
+/*
+ * Hands the waiting V4L2 context with the earliest deadline to v4l2-m2m
+ * if none is given yet. A context that is no longer ready just drops off
+ * the list and it is added again on its next v4l2_m2m_try_schedule().
+ */
+static void sc_m2m_kick(struct sc_dev *sc)
+{
+	struct sc_ctx *ctx, *next;
+	unsigned long flags;
+
+	for (;;) {
+		spin_lock_irqsave(&sc->ctxlist_lock, flags);
+		next = NULL;
+		if (!sc->m2m_owner) {
+			list_for_each_entry(ctx, &sc->m2m_waiting, m2m_node) {
+				if (!next || ktime_before(ctx->m2m_deadline,
+							  next->m2m_deadline))
+					next = ctx;
+			}
+		}
+		if (next) {
+			list_del_init(&next->m2m_node);
+			sc->m2m_kicking++;
+		}
+		spin_unlock_irqrestore(&sc->ctxlist_lock, flags);
+
+		if (!next)
+			break;
+
+		v4l2_m2m_try_schedule(next->m2m_ctx);
+
+		spin_lock_irqsave(&sc->ctxlist_lock, flags);
+		sc->m2m_kicking--;
+		spin_unlock_irqrestore(&sc->ctxlist_lock, flags);
+		wake_up(&sc->wait);
+	}
+}
+
+static void sc_m2m_job_finish(struct sc_dev *sc, struct sc_ctx *ctx)
+{
+	unsigned long flags;
+
+	/* ctx is still the owner, so its next job waits for its turn */
+	v4l2_m2m_job_finish(sc->m2m.m2m_dev, ctx->m2m_ctx);
+
+	spin_lock_irqsave(&sc->ctxlist_lock, flags);
+	if (sc->m2m_owner == ctx)
+		sc->m2m_owner = NULL;
+	spin_unlock_irqrestore(&sc->ctxlist_lock, flags);
+
+	sc_m2m_kick(sc);
+}
+
+/*
+ * Called after v4l2-m2m cancelled the jobs of ctx. A job cancelled before
+ * it ran never reaches sc_m2m_job_finish(), so the ownership is released
+ * here.
+ */
+static void sc_m2m_ctx_leave(struct sc_ctx *ctx)
+{
+	struct sc_dev *sc = ctx->sc_dev;
+	unsigned long flags;
+
+	spin_lock_irqsave(&sc->ctxlist_lock, flags);
+	list_del_init(&ctx->m2m_node);
+	if (sc->m2m_owner == ctx)
+		sc->m2m_owner = NULL;
+	spin_unlock_irqrestore(&sc->ctxlist_lock, flags);
+
+	sc_m2m_kick(sc);
+}
+
+static void sc_m2m_ctx_release(struct sc_ctx *ctx)
+{
+	struct sc_dev *sc = ctx->sc_dev;
+	unsigned long flags;
+
+	set_bit(CTX_RELEASE, &ctx->flags);
+
+	spin_lock_irqsave(&sc->ctxlist_lock, flags);
+	list_del_init(&ctx->m2m_node);
+	spin_unlock_irqrestore(&sc->ctxlist_lock, flags);
+
+	/* sc_m2m_kick() may still be scheduling ctx that it took off the list */
+	wait_event(sc->wait, !READ_ONCE(sc->m2m_kicking));
+
+	v4l2_m2m_ctx_release(ctx->m2m_ctx);
+	sc_m2m_ctx_leave(ctx);
+}
+
 static int sc_v4l2_streamon(struct file *file, void *fh,
 			     enum v4l2_buf_type type)
 {
@@ -826,7 +970,11 @@ static int sc_v4l2_streamoff(struct file *file, void *fh,
 			      enum v4l2_buf_type type)
 {
 	struct sc_ctx *ctx = fh_to_sc_ctx(fh);
-	return v4l2_m2m_streamoff(file, ctx->m2m_ctx, type);
+	int ret;
+
+	ret = v4l2_m2m_streamoff(file, ctx->m2m_ctx, type);
+	sc_m2m_ctx_leave(ctx);
+	return ret;
 }
 
 static int sc_v4l2_cropcap(struct file *file, void *fh,
@@ -1094,6 +1242,269 @@ static void sc_calc_intbufsize(struct sc_dev *sc, struct sc_int_frame *int_frame
 	memcpy(&int_frame->dst_addr, &frame->addr, sizeof(int_frame->dst_addr));
 }
 
+/*
+ * Intermediate buffers are kept in a device-wide pool after the context that
+ * used them is done with them. Short-lived contexts that scale beyond the
+ * one-pass range then reuse the buffers with their IOVAs instead of
+ * allocating and mapping new ones. Sizes are rounded up to a quarter of their
+ * power of two so that similar frame sizes share buffers.
+ */
+#define SC_INTBUF_POOL_MAX	12
+
+static size_t sc_intbuf_bucket(size_t size)
+{
+	size_t step;
+
+	size = PAGE_ALIGN(size);
+	step = max_t(size_t, roundup_pow_of_two(size) >> 2, PAGE_SIZE);
+
+	return ALIGN(size, step);
+}
+
+static void sc_intbuf_destroy(struct sc_intbuf_pool *pool,
+			      struct sc_intbuf *buf)
+{
+	if (buf->src_addr)
+		ion_iovmm_unmap(buf->attachment, buf->src_addr);
+	if (buf->dst_addr)
+		ion_iovmm_unmap(buf->attachment, buf->dst_addr);
+	if (buf->sgt)
+		dma_buf_unmap_attachment(buf->attachment, buf->sgt,
+					 DMA_BIDIRECTIONAL);
+	if (buf->attachment)
+		dma_buf_detach(buf->dma_buf, buf->attachment);
+	if (buf->dma_buf)
+		dma_buf_put(buf->dma_buf);
+	if (buf->handle)
+		ion_free(pool->client, buf->handle);
+
+	kfree(buf);
+}
+
+static struct sc_intbuf *sc_intbuf_create(struct sc_dev *sc, size_t size,
+					  bool protected)
+{
+	struct sc_intbuf_pool *pool = &sc->intbuf_pool;
+	struct sc_intbuf *buf;
+	unsigned int ion_mask, flag;
+	dma_addr_t addr;
+
+	if (protected) {
+		ion_mask = EXYNOS_ION_HEAP_VIDEO_SCALER_MASK;
+		flag = ION_FLAG_PROTECTED;
+	} else {
+		ion_mask = ION_HEAP_SYSTEM_MASK;
+		flag = 0;
+	}
+
+	buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+	if (!buf)
+		return NULL;
+
+	INIT_LIST_HEAD(&buf->node);
+	buf->size = size;
+	buf->protected = protected;
+
+	buf->handle = ion_alloc(pool->client, size, 0, ion_mask, flag);
+	if (IS_ERR(buf->handle)) {
+		dev_err(sc->dev,
+			"Failed to allocate intermediate buffer (err %ld)",
+			PTR_ERR(buf->handle));
+		buf->handle = NULL;
+		goto err;
+	}
+
+	buf->dma_buf = ion_share_dma_buf(pool->client, buf->handle);
+	if (IS_ERR(buf->dma_buf)) {
+		dev_err(sc->dev,
+			"Failed to get dma_buf from ion_handle (err %ld)",
+			PTR_ERR(buf->dma_buf));
+		buf->dma_buf = NULL;
+		goto err;
+	}
+
+	buf->attachment = dma_buf_attach(buf->dma_buf, sc->dev);
+	if (IS_ERR(buf->attachment)) {
+		dev_err(sc->dev,
+			"Failed to get dma_buf_attach from dma_buf (err %ld)",
+			PTR_ERR(buf->attachment));
+		buf->attachment = NULL;
+		goto err;
+	}
+
+	buf->sgt = dma_buf_map_attachment(buf->attachment, DMA_BIDIRECTIONAL);
+	if (IS_ERR(buf->sgt)) {
+		dev_err(sc->dev,
+			"Failed to get sgt from dma_buf_attach (err %ld)",
+			PTR_ERR(buf->sgt));
+		buf->sgt = NULL;
+		goto err;
+	}
+
+	addr = ion_iovmm_map(buf->attachment, 0, size, DMA_TO_DEVICE, 0);
+	if (IS_ERR_VALUE(addr)) {
+		dev_err(sc->dev, "Failed to allocate iova (err %pa)", &addr);
+		goto err;
+	}
+	buf->src_addr = addr;
+
+	addr = ion_iovmm_map(buf->attachment, 0, size, DMA_FROM_DEVICE, 0);
+	if (IS_ERR_VALUE(addr)) {
+		dev_err(sc->dev, "Failed to allocate iova (err %pa)", &addr);
+		goto err;
+	}
+	buf->dst_addr = addr;
+
+	return buf;
+err:
+	sc_intbuf_destroy(pool, buf);
+	return NULL;
+}
+
+static struct sc_intbuf *sc_intbuf_get(struct sc_dev *sc, size_t size,
+				       bool protected)
+{
+	struct sc_intbuf_pool *pool = &sc->intbuf_pool;
+	struct sc_intbuf *buf;
+
+	size = sc_intbuf_bucket(size);
+
+	mutex_lock(&pool->lock);
+
+	if (!pool->client) {
+		struct ion_client *client;
+
+		client = exynos_ion_client_create("scaler-int");
+		if (IS_ERR(client)) {
+			mutex_unlock(&pool->lock);
+			dev_err(sc->dev,
+			"Failed to create ION client for int.buf.(err %ld)\n",
+				PTR_ERR(client));
+			return NULL;
+		}
+		pool->client = client;
+	}
+
+	list_for_each_entry(buf, &pool->free, node) {
+		if ((buf->size == size) && (buf->protected == protected)) {
+			list_del_init(&buf->node);
+			pool->free_bytes -= buf->size;
+			pool->nr_free--;
+			mutex_unlock(&pool->lock);
+			return buf;
+		}
+	}
+
+	mutex_unlock(&pool->lock);
+
+	return sc_intbuf_create(sc, size, protected);
+}
+
+static void sc_intbuf_put(struct sc_dev *sc, struct sc_intbuf *buf)
+{
+	struct sc_intbuf_pool *pool = &sc->intbuf_pool;
+	LIST_HEAD(reap);
+
+	/* protected buffers are carved out of a small heap: never hold them */
+	if (buf->protected) {
+		sc_intbuf_destroy(pool, buf);
+		return;
+	}
+
+	mutex_lock(&pool->lock);
+
+	list_add(&buf->node, &pool->free);
+	pool->free_bytes += buf->size;
+	pool->nr_free++;
+
+	while (pool->nr_free > SC_INTBUF_POOL_MAX) {
+		buf = list_last_entry(&pool->free, struct sc_intbuf, node);
+		list_move(&buf->node, &reap);
+		pool->free_bytes -= buf->size;
+		pool->nr_free--;
+	}
+
+	mutex_unlock(&pool->lock);
+
+	while (!list_empty(&reap)) {
+		buf = list_first_entry(&reap, struct sc_intbuf, node);
+		list_del(&buf->node);
+		sc_intbuf_destroy(pool, buf);
+	}
+}
+
+static unsigned long sc_intbuf_shrink_count(struct shrinker *shrinker,
+					    struct shrink_control *sc)
+{
+	struct sc_intbuf_pool *pool =
+		container_of(shrinker, struct sc_intbuf_pool, shrinker);
+
+	return pool->free_bytes >> PAGE_SHIFT;
+}
+
+static unsigned long sc_intbuf_shrink_scan(struct shrinker *shrinker,
+					   struct shrink_control *sc)
+{
+	struct sc_intbuf_pool *pool =
+		container_of(shrinker, struct sc_intbuf_pool, shrinker);
+	struct sc_intbuf *buf;
+	unsigned long freed = 0;
+	LIST_HEAD(reap);
+
+	if (!mutex_trylock(&pool->lock))
+		return SHRINK_STOP;
+
+	while ((freed < sc->nr_to_scan) && !list_empty(&pool->free)) {
+		buf = list_last_entry(&pool->free, struct sc_intbuf, node);
+		list_move(&buf->node, &reap);
+		pool->free_bytes -= buf->size;
+		pool->nr_free--;
+		freed += buf->size >> PAGE_SHIFT;
+	}
+
+	mutex_unlock(&pool->lock);
+
+	while (!list_empty(&reap)) {
+		buf = list_first_entry(&reap, struct sc_intbuf, node);
+		list_del(&buf->node);
+		sc_intbuf_destroy(pool, buf);
+	}
+
+	return freed;
+}
+
+static int sc_intbuf_pool_init(struct sc_dev *sc)
+{
+	struct sc_intbuf_pool *pool = &sc->intbuf_pool;
+
+	mutex_init(&pool->lock);
+	INIT_LIST_HEAD(&pool->free);
+	pool->shrinker.count_objects = sc_intbuf_shrink_count;
+	pool->shrinker.scan_objects = sc_intbuf_shrink_scan;
+	pool->shrinker.seeks = DEFAULT_SEEKS;
+
+	return register_shrinker(&pool->shrinker);
+}
+
+static void sc_intbuf_pool_destroy(struct sc_dev *sc)
+{
+	struct sc_intbuf_pool *pool = &sc->intbuf_pool;
+	struct sc_intbuf *buf, *tmp;
+
+	unregister_shrinker(&pool->shrinker);
+
+	list_for_each_entry_safe(buf, tmp, &pool->free, node) {
+		list_del(&buf->node);
+		sc_intbuf_destroy(pool, buf);
+	}
+	pool->free_bytes = 0;
+	pool->nr_free = 0;
+
+	if (pool->client)
+		ion_client_destroy(pool->client);
+	pool->client = NULL;
+}
+
 static void free_intermediate_frame(struct sc_ctx *ctx)
 {
 	int i;
@@ -1101,39 +1512,13 @@ static void free_intermediate_frame(struct sc_ctx *ctx)
 	if (ctx->i_frame == NULL)
 		return;
 
-	if (!ctx->i_frame->handle[0])
-		return;
-
-	if (ctx->i_frame->src_addr.y)
-		ion_iovmm_unmap(ctx->i_frame->attachment[0],
-				ctx->i_frame->src_addr.y);
-	if (ctx->i_frame->src_addr.cb)
-		ion_iovmm_unmap(ctx->i_frame->attachment[1],
-				ctx->i_frame->src_addr.cb);
-	if (ctx->i_frame->src_addr.cr)
-		ion_iovmm_unmap(ctx->i_frame->attachment[2],
-				ctx->i_frame->src_addr.cr);
-	if (ctx->i_frame->dst_addr.y)
-		ion_iovmm_unmap(ctx->i_frame->attachment[0],
-				ctx->i_frame->dst_addr.y);
-	if (ctx->i_frame->dst_addr.cb)
-		ion_iovmm_unmap(ctx->i_frame->attachment[1],
-				ctx->i_frame->dst_addr.cb);
-	if (ctx->i_frame->dst_addr.cr)
-		ion_iovmm_unmap(ctx->i_frame->attachment[2],
-				ctx->i_frame->dst_addr.cr);
-
-	for(i = 0; i < 3; i++) {
-		if (ctx->i_frame->handle[i]) {
-			dma_buf_unmap_attachment(ctx->i_frame->attachment[i],
-					ctx->i_frame->sgt[i], DMA_BIDIRECTIONAL);
-			dma_buf_detach(ctx->i_frame->dma_buf[i], ctx->i_frame->attachment[i]);
-			dma_buf_put(ctx->i_frame->dma_buf[i]);
-			ion_free(ctx->i_frame->client, ctx->i_frame->handle[i]);
+	for (i = 0; i < 3; i++) {
+		if (ctx->i_frame->buf[i]) {
+			sc_intbuf_put(ctx->sc_dev, ctx->i_frame->buf[i]);
+			ctx->i_frame->buf[i] = NULL;
 		}
 	}
 
-	memset(&ctx->i_frame->handle, 0, sizeof(struct ion_handle *) * 3);
 	memset(&ctx->i_frame->src_addr, 0, sizeof(ctx->i_frame->src_addr));
 	memset(&ctx->i_frame->dst_addr, 0, sizeof(ctx->i_frame->dst_addr));
 }
@@ -1142,7 +1527,6 @@ static void destroy_intermediate_frame(struct sc_ctx *ctx)
 {
 	if (ctx->i_frame) {
 		free_intermediate_frame(ctx);
-		ion_client_destroy(ctx->i_frame->client);
 		kfree(ctx->i_frame);
 		ctx->i_frame = NULL;
 		clear_bit(CTX_INT_FRAME, &ctx->flags);
@@ -1151,11 +1535,15 @@ static void destroy_intermediate_frame(struct sc_ctx *ctx)
 
 static bool initialize_initermediate_frame(struct sc_ctx *ctx)
 {
+	static const char * const plane_name[3] = { "y", "cb", "cr" };
 	struct sc_frame *frame;
 	struct sc_dev *sc = ctx->sc_dev;
-	int ion_mask, flag;
+	struct sc_int_frame *i_frame = ctx->i_frame;
+	unsigned int size[3];
+	bool protected;
+	int i;
 
-	frame = &ctx->i_frame->frame;
+	frame = &i_frame->frame;
 
 	frame->crop.top = 0;
 	frame->crop.left = 0;
@@ -1168,214 +1556,50 @@ static bool initialize_initermediate_frame(struct sc_ctx *ctx)
 	 * needed to be initialized because image setting is never changed
 	 * while streaming continues.
 	 */
-	if (ctx->i_frame->handle[0])
+	if (i_frame->buf[0])
 		return true;
 
-	sc_calc_intbufsize(sc, ctx->i_frame);
+	sc_calc_intbufsize(sc, i_frame);
 
-	if(test_bit(CTX_INT_FRAME_CP, &sc->state)) {
-		ion_mask = EXYNOS_ION_HEAP_VIDEO_SCALER_MASK;
-		flag = ION_FLAG_PROTECTED;
-	} else {
-		ion_mask = ION_HEAP_SYSTEM_MASK;
-		flag = 0;
-	}
+	protected = test_bit(CTX_INT_FRAME_CP, &sc->state);
+	size[0] = frame->addr.ysize;
+	size[1] = frame->addr.cbsize;
+	size[2] = frame->addr.crsize;
 
-	if (frame->addr.ysize) {
-		ctx->i_frame->handle[0] = ion_alloc(ctx->i_frame->client,
-				frame->addr.ysize, 0, ion_mask, flag);
-		if (IS_ERR(ctx->i_frame->handle[0])) {
-			dev_err(sc->dev,
-			"Failed to allocate intermediate y buffer (err %ld)",
-				PTR_ERR(ctx->i_frame->handle[0]));
-			ctx->i_frame->handle[0] = NULL;
-			goto err_ion_alloc;
-		}
+	for (i = 0; i < 3; i++) {
+		if (!size[i])
+			continue;
 
-		ctx->i_frame->dma_buf[0] = ion_share_dma_buf(ctx->i_frame->client,
-				ctx->i_frame->handle[0]);
-		if (IS_ERR(ctx->i_frame->dma_buf[0])) {
+		i_frame->buf[i] = sc_intbuf_get(sc, size[i], protected);
+		if (!i_frame->buf[i]) {
 			dev_err(sc->dev,
-			"Failed to get dma_buf from ion_handle of y (err %ld)",
-			PTR_ERR(ctx->i_frame->dma_buf[0]));
-			ctx->i_frame->dma_buf[0] = NULL;
-			goto err_ion_alloc;
+				"Failed to get intermediate %s buffer\n",
+				plane_name[i]);
+			goto err_intbuf;
 		}
-
-		ctx->i_frame->attachment[0] = dma_buf_attach(ctx->i_frame->dma_buf[0],
-				sc->dev);
-		if (IS_ERR(ctx->i_frame->attachment[0])) {
-			dev_err(sc->dev,
-			"Failed to get dma_buf_attach from dma_buf of y (err %ld)",
-			PTR_ERR(ctx->i_frame->attachment[0]));
-			ctx->i_frame->attachment[0] = NULL;
-			goto err_ion_alloc;
-		}
-
-		ctx->i_frame->sgt[0] = dma_buf_map_attachment(ctx->i_frame->attachment[0],
-				DMA_BIDIRECTIONAL);
-		if (IS_ERR(ctx->i_frame->sgt[0])) {
-			dev_err(sc->dev,
-			"Failed to get sgt from dma_buf_attach of y (err %ld)",
-			PTR_ERR(ctx->i_frame->sgt[0]));
-			ctx->i_frame->sgt[0] = NULL;
-			goto err_ion_alloc;
-		}
-
-		ctx->i_frame->src_addr.y = ion_iovmm_map(ctx->i_frame->attachment[0], 0,
-					frame->addr.ysize, DMA_TO_DEVICE, 0);
-		if (IS_ERR_VALUE(ctx->i_frame->src_addr.y)) {
-			dev_err(sc->dev,
-				"Failed to allocate iova of y (err %pa)",
-				&ctx->i_frame->src_addr.y);
-			ctx->i_frame->src_addr.y = 0;
-			goto err_ion_alloc;
-		}
-
-		ctx->i_frame->dst_addr.y = ion_iovmm_map(ctx->i_frame->attachment[0], 0,
-					frame->addr.ysize, DMA_FROM_DEVICE, 0);
-		if (IS_ERR_VALUE(ctx->i_frame->dst_addr.y)) {
-			dev_err(sc->dev,
-				"Failed to allocate iova of y (err %pa)",
-				&ctx->i_frame->dst_addr.y);
-			ctx->i_frame->dst_addr.y = 0;
-			goto err_ion_alloc;
-		}
-
-		frame->addr.y = ctx->i_frame->dst_addr.y;
 	}
 
-	if (frame->addr.cbsize) {
-		ctx->i_frame->handle[1] = ion_alloc(ctx->i_frame->client,
-				frame->addr.cbsize, 0, ion_mask, flag);
-		if (IS_ERR(ctx->i_frame->handle[1])) {
-			dev_err(sc->dev,
-			"Failed to allocate intermediate cb buffer (err %ld)",
-				PTR_ERR(ctx->i_frame->handle[1]));
-			ctx->i_frame->handle[1] = NULL;
-			goto err_ion_alloc;
-		}
-
-		ctx->i_frame->dma_buf[1] = ion_share_dma_buf(ctx->i_frame->client,
-				ctx->i_frame->handle[1]);
-		if (IS_ERR(ctx->i_frame->dma_buf[1])) {
-			dev_err(sc->dev,
-			"Failed to get dma_buf from ion_handle of cb (err %ld)",
-			PTR_ERR(ctx->i_frame->dma_buf[1]));
-			ctx->i_frame->dma_buf[1] = NULL;
-			goto err_ion_alloc;
-		}
-
-		ctx->i_frame->attachment[1] = dma_buf_attach(ctx->i_frame->dma_buf[1],
-				sc->dev);
-		if (IS_ERR(ctx->i_frame->attachment[1])) {
-			dev_err(sc->dev,
-			"Failed to get dma_buf_attach from dma_buf of cb (err %ld)",
-			PTR_ERR(ctx->i_frame->attachment[1]));
-			ctx->i_frame->attachment[1] = NULL;
-			goto err_ion_alloc;
-		}
-
-		ctx->i_frame->sgt[1] = dma_buf_map_attachment(ctx->i_frame->attachment[1],
-				DMA_BIDIRECTIONAL);
-		if (IS_ERR(ctx->i_frame->sgt[1])) {
-			dev_err(sc->dev,
-			"Failed to get sgt from dma_buf_attach of cb (err %ld)",
-			PTR_ERR(ctx->i_frame->sgt[1]));
-			ctx->i_frame->sgt[1] = NULL;
-			goto err_ion_alloc;
-		}
-
-		ctx->i_frame->src_addr.cb = ion_iovmm_map(ctx->i_frame->attachment[1], 0,
-					frame->addr.cbsize, DMA_TO_DEVICE, 0);
-		if (IS_ERR_VALUE(ctx->i_frame->src_addr.cb)) {
-			dev_err(sc->dev,
-				"Failed to allocate iova of cb (err %pa)",
-				&ctx->i_frame->src_addr.cb);
-			ctx->i_frame->src_addr.cb = 0;
-			goto err_ion_alloc;
-		}
-
-		ctx->i_frame->dst_addr.cb = ion_iovmm_map(ctx->i_frame->attachment[1], 0,
-					frame->addr.cbsize, DMA_FROM_DEVICE, 0);
-		if (IS_ERR_VALUE(ctx->i_frame->dst_addr.cb)) {
-			dev_err(sc->dev,
-				"Failed to allocate iova of cb (err %pa)",
-				&ctx->i_frame->dst_addr.cb);
-			ctx->i_frame->dst_addr.cb = 0;
-			goto err_ion_alloc;
-		}
-
-		frame->addr.cb = ctx->i_frame->dst_addr.cb;
+	if (i_frame->buf[0]) {
+		i_frame->src_addr.y = i_frame->buf[0]->src_addr;
+		i_frame->dst_addr.y = i_frame->buf[0]->dst_addr;
+		frame->addr.y = i_frame->dst_addr.y;
 	}
 
-	if (frame->addr.crsize) {
-		ctx->i_frame->handle[2] = ion_alloc(ctx->i_frame->client,
-				frame->addr.crsize, 0, ion_mask, flag);
-		if (IS_ERR(ctx->i_frame->handle[2])) {
-			dev_err(sc->dev,
-			"Failed to allocate intermediate cr buffer (err %ld)",
-				PTR_ERR(ctx->i_frame->handle[2]));
-			ctx->i_frame->handle[2] = NULL;
-			goto err_ion_alloc;
-		}
-
-		ctx->i_frame->dma_buf[2] = ion_share_dma_buf(ctx->i_frame->client,
-				ctx->i_frame->handle[2]);
-		if (IS_ERR(ctx->i_frame->dma_buf[2])) {
-			dev_err(sc->dev,
-			"Failed to get dma_buf from ion_handle of cr (err %ld)",
-			PTR_ERR(ctx->i_frame->dma_buf[2]));
-			ctx->i_frame->dma_buf[2] = NULL;
-			goto err_ion_alloc;
-		}
-
-		ctx->i_frame->attachment[2] = dma_buf_attach(ctx->i_frame->dma_buf[2],
-				sc->dev);
-		if (IS_ERR(ctx->i_frame->attachment[2])) {
-			dev_err(sc->dev,
-			"Failed to get dma_buf_attach from dma_buf of cr (err %ld)",
-			PTR_ERR(ctx->i_frame->attachment[2]));
-			ctx->i_frame->attachment[2] = NULL;
-			goto err_ion_alloc;
-		}
-
-		ctx->i_frame->sgt[2] = dma_buf_map_attachment(ctx->i_frame->attachment[2],
-				DMA_BIDIRECTIONAL);
-		if (IS_ERR(ctx->i_frame->sgt[2])) {
-			dev_err(sc->dev,
-			"Failed to get sgt from dma_buf_attach of cr (err %ld)",
-			PTR_ERR(ctx->i_frame->sgt[2]));
-			ctx->i_frame->sgt[2] = NULL;
-			goto err_ion_alloc;
-		}
-
-		ctx->i_frame->src_addr.cr = ion_iovmm_map(ctx->i_frame->attachment[2], 0,
-					frame->addr.crsize, DMA_TO_DEVICE, 0);
-		if (IS_ERR_VALUE(ctx->i_frame->src_addr.cr)) {
-			dev_err(sc->dev,
-				"Failed to allocate iova of cr (err %pa)",
-				&ctx->i_frame->src_addr.cr);
-			ctx->i_frame->src_addr.cr = 0;
-			goto err_ion_alloc;
-		}
-
-		ctx->i_frame->dst_addr.cr = ion_iovmm_map(ctx->i_frame->attachment[2], 0,
-					frame->addr.crsize, DMA_FROM_DEVICE, 0);
-		if (IS_ERR_VALUE(ctx->i_frame->dst_addr.cr)) {
-			dev_err(sc->dev,
-				"Failed to allocate iova of cr (err %pa)",
-				&ctx->i_frame->dst_addr.cr);
-			ctx->i_frame->dst_addr.cr = 0;
-			goto err_ion_alloc;
-		}
+	if (i_frame->buf[1]) {
+		i_frame->src_addr.cb = i_frame->buf[1]->src_addr;
+		i_frame->dst_addr.cb = i_frame->buf[1]->dst_addr;
+		frame->addr.cb = i_frame->dst_addr.cb;
+	}
 
-		frame->addr.cr = ctx->i_frame->dst_addr.cr;
+	if (i_frame->buf[2]) {
+		i_frame->src_addr.cr = i_frame->buf[2]->src_addr;
+		i_frame->dst_addr.cr = i_frame->buf[2]->dst_addr;
+		frame->addr.cr = i_frame->dst_addr.cr;
 	}
 
 	return true;
 
-err_ion_alloc:
+err_intbuf:
 	free_intermediate_frame(ctx);
 	return false;
 }
@@ -1389,17 +1613,6 @@ static bool allocate_intermediate_frame(struct sc_ctx *ctx)
 				"Failed to allocate intermediate frame\n");
 			return false;
 		}
-
-		ctx->i_frame->client = exynos_ion_client_create("scaler-int");
-		if (IS_ERR(ctx->i_frame->client)) {
-			dev_err(ctx->sc_dev->dev,
-			"Failed to create ION client for int.buf.(err %ld)\n",
-				PTR_ERR(ctx->i_frame->client));
-			ctx->i_frame->client = NULL;
-			kfree(ctx->i_frame);
-			ctx->i_frame = NULL;
-			return false;
-		}
 	}
 
 	return true;
@@ -1608,6 +1821,68 @@ err_ft:
 	return -EINVAL;
 }
 
+static unsigned int sc_prescale_level(unsigned int ratio)
+{
+	if (ratio > SCALE_RATIO_CONST(8, 1))
+		return 2;
+	else if (ratio > SCALE_RATIO_CONST(4, 1))
+		return 1;
+
+	return 0;
+}
+
+/*
+ * The pre-scaler needs the source size aligned to its ratio. Dropping the
+ * remainder at the right and the bottom edges loses less than a destination
+ * pixel while it saves the intermediate frame and the second H/W pass.
+ * Fractional crop and the denoise filter depend on the exact source size.
+ */
+static bool sc_trim_prescale_source(struct sc_ctx *ctx,
+			__s32 *src_width, __s32 *src_height,
+			unsigned int *h_ratio, unsigned int *v_ratio)
+{
+	unsigned int walign, halign;
+	__s32 width, height;
+
+	if (!sc_prescale_trim)
+		return false;
+
+	if (ctx->init_phase.w || ctx->init_phase.h ||
+			(ctx->dnoise_ft.strength > SC_FT_BLUR))
+		return false;
+
+	/* the same constraint as sc_find_scaling_ratio() checks */
+	walign = 1 << (ctx->pre_h_ratio + ctx->s_frame.sc_fmt->h_shift);
+	halign = 1 << (ctx->pre_v_ratio + ctx->s_frame.sc_fmt->v_shift);
+
+	width = round_down(*src_width, walign);
+	height = round_down(*src_height, halign);
+	if (!width || !height)
+		return false;
+
+	if (!!(ctx->flip_rot_cfg & SCALER_ROT_90)) {
+		ctx->src_trim_w = *src_height - height;
+		ctx->src_trim_h = *src_width - width;
+	} else {
+		ctx->src_trim_w = *src_width - width;
+		ctx->src_trim_h = *src_height - height;
+	}
+
+	*src_width = width;
+	*src_height = height;
+	*h_ratio = SCALE_RATIO(width, ctx->d_frame.crop.width);
+	*v_ratio = SCALE_RATIO(height, ctx->d_frame.crop.height);
+
+	/* a smaller source never needs a stronger pre-scaler */
+	ctx->pre_h_ratio = sc_prescale_level(*h_ratio);
+	ctx->pre_v_ratio = sc_prescale_level(*v_ratio);
+
+	sc_dbg("trimmed source by %ux%u for the pre-scaler\n",
+			ctx->src_trim_w, ctx->src_trim_h);
+
+	return true;
+}
+
 static int sc_find_scaling_ratio(struct sc_ctx *ctx)
 {
 	__s32 src_width, src_height;
@@ -1620,6 +1895,9 @@ static int sc_find_scaling_ratio(struct sc_ctx *ctx)
 			(ctx->d_frame.crop.width == 0))
 		return 0; /* s_fmt is not complete */
 
+	ctx->src_trim_w = 0;
+	ctx->src_trim_h = 0;
+
 	src_width = ctx->s_frame.crop.width;
 	src_height = ctx->s_frame.crop.height;
 	if (!!(ctx->flip_rot_cfg & SCALER_ROT_90))
@@ -1658,31 +1936,22 @@ static int sc_find_scaling_ratio(struct sc_ctx *ctx)
 	if (sc->variant->prescale) {
 		BUG_ON(sc_down_min != SCALE_RATIO_CONST(16, 1));
 
-		if (h_ratio > SCALE_RATIO_CONST(8, 1)) {
-			ctx->pre_h_ratio = 2;
-		} else if (h_ratio > SCALE_RATIO_CONST(4, 1)) {
-			ctx->pre_h_ratio = 1;
-		} else {
-			ctx->pre_h_ratio = 0;
-		}
-
-		if (v_ratio > SCALE_RATIO_CONST(8, 1)) {
-			ctx->pre_v_ratio = 2;
-		} else if (v_ratio > SCALE_RATIO_CONST(4, 1)) {
-			ctx->pre_v_ratio = 1;
-		} else {
-			ctx->pre_v_ratio = 0;
-		}
+		ctx->pre_h_ratio = sc_prescale_level(h_ratio);
+		ctx->pre_v_ratio = sc_prescale_level(v_ratio);
 
 		/*
 		 * If the source image resolution violates the constraints of
-		 * pre-scaler, then performs poly-phase scaling twice
+		 * pre-scaler, trim the remainder if possible. Otherwise
+		 * performs poly-phase scaling twice
 		 */
 		if (ctx->pre_h_ratio || ctx->pre_v_ratio) {
-			if (!IS_ALIGNED(src_width, 1 << (ctx->pre_h_ratio +
+			if ((!IS_ALIGNED(src_width, 1 << (ctx->pre_h_ratio +
 					ctx->s_frame.sc_fmt->h_shift)) ||
 				!IS_ALIGNED(src_height, 1 << (ctx->pre_v_ratio +
-					ctx->s_frame.sc_fmt->v_shift))) {
+					ctx->s_frame.sc_fmt->v_shift))) &&
+				!sc_trim_prescale_source(ctx,
+					&src_width, &src_height,
+					&h_ratio, &v_ratio)) {
 				sc_down_min = SCALE_RATIO_CONST(4, 1);
 				ctx->pre_h_ratio = 0;
 				ctx->pre_v_ratio = 0;
@@ -1956,6 +2225,12 @@ static int sc_s_ctrl(struct v4l2_ctrl *ctrl)
 	case SC_CID_DNOISE_FT:
 		ctx->dnoise_ft.strength = ctrl->val;
 		break;
+	case SC_CID_PRIORITY:
+		ctx->priority = ctrl->val;
+		break;
+	case SC_CID_DEADLINE:
+		ctx->deadline_us = ctrl->val;
+		break;
 	}
 
 	return ret;
@@ -2045,6 +2320,24 @@ static const struct v4l2_ctrl_config sc_custom_ctrl[] = {
 		.min = 0,
 		.max = SC_FT_MAX,
 		.def = 0,
+	}, {
+		.ops = &sc_ctrl_ops,
+		.id = SC_CID_PRIORITY,
+		.name = "Set job priority class",
+		.type = V4L2_CTRL_TYPE_INTEGER,
+		.step = 1,
+		.min = SC_PRIO_NORMAL,
+		.max = SC_PRIO_NUM - 1,
+		.def = SC_PRIO_NORMAL,
+	}, {
+		.ops = &sc_ctrl_ops,
+		.id = SC_CID_DEADLINE,
+		.name = "Set job deadline in usec",
+		.type = V4L2_CTRL_TYPE_INTEGER,
+		.step = 1,
+		.min = 0,
+		.max = SC_DEADLINE_MAX_US,
+		.def = 0,
 	}
 };
 
@@ -2163,6 +2456,7 @@ static int sc_open(struct file *file)
 
 	ctx->context_type = SC_CTX_V4L2_TYPE;
 	INIT_LIST_HEAD(&ctx->node);
+	INIT_LIST_HEAD(&ctx->m2m_node);
 	ctx->sc_dev = sc;
 
 	v4l2_fh_init(&ctx->fh, sc->m2m.vfd);
@@ -2231,7 +2525,7 @@ static int sc_release(struct file *file)
 
 	atomic_dec(&sc->m2m.in_use);
 
-	v4l2_m2m_ctx_release(ctx->m2m_ctx);
+	sc_m2m_ctx_release(ctx);
 
 	destroy_intermediate_frame(ctx);
 
@@ -2302,7 +2596,7 @@ static void sc_job_finish(struct sc_dev *sc, struct sc_ctx *ctx)
 		v4l2_m2m_buf_done(src_vb, VB2_BUF_STATE_ERROR);
 		v4l2_m2m_buf_done(dst_vb, VB2_BUF_STATE_ERROR);
 
-		v4l2_m2m_job_finish(sc->m2m.m2m_dev, ctx->m2m_ctx);
+		sc_m2m_job_finish(sc, ctx);
 	} else {
 		struct m2m1shot_task *task =
 			m2m1shot_get_current_task(sc->m21dev);
@@ -2526,6 +2820,87 @@ static void sc_set_initial_phase(struct sc_ctx *ctx)
 	sc_hwset_src_init_phase(sc, &ctx->init_phase);
 }
 
+static const char * const sc_prio_name[SC_PRIO_NUM] = {
+	[SC_PRIO_NORMAL]	= "normal",
+	[SC_PRIO_REALTIME]	= "realtime",
+	[SC_PRIO_BACKGROUND]	= "background",
+};
+
+/*
+ * Earliest deadline first. Every job has a finite deadline from its queueing
+ * time, so a background job is chosen at the latest when its deadline
+ * passes the deadline of the newly queued jobs. No job starves. Jobs with
+ * the same deadline run in the queued order.
+ * Must be called with sc->ctxlist_lock held.
+ */
+static struct sc_ctx *sc_pick_next_ctx(struct sc_dev *sc)
+{
+	struct sc_ctx *ctx, *next = NULL;
+
+	list_for_each_entry(ctx, &sc->context_list, node) {
+		if (!next || ktime_before(ctx->ktime_deadline,
+					  next->ktime_deadline))
+			next = ctx;
+	}
+
+	return next;
+}
+
+/* Must be called with sc->ctxlist_lock held. */
+static void sc_sched_account(struct sc_dev *sc, struct sc_ctx *ctx)
+{
+	struct sc_sched_stat *stat = &sc->sched_stat;
+	ktime_t now = ktime_get();
+	s64 delay_us = ktime_us_delta(now, ctx->ktime_queued);
+	unsigned int bucket = 0;
+
+	if (delay_us >= USEC_PER_MSEC)
+		bucket = min_t(unsigned int,
+				ilog2(div_s64(delay_us, USEC_PER_MSEC)) + 1,
+				SC_QDELAY_BUCKETS - 1);
+
+	stat->qdelay[ctx->priority][bucket]++;
+	if (delay_us > stat->qdelay_max_us[ctx->priority])
+		stat->qdelay_max_us[ctx->priority] = (u32)delay_us;
+	if (ktime_after(now, ctx->ktime_deadline))
+		stat->missed[ctx->priority]++;
+}
+
+static ssize_t sched_stat_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct sc_dev *sc = dev_get_drvdata(dev);
+	struct sc_sched_stat stat;
+	unsigned long flags;
+	ssize_t len;
+	int prio, i;
+
+	spin_lock_irqsave(&sc->ctxlist_lock, flags);
+	stat = sc->sched_stat;
+	spin_unlock_irqrestore(&sc->ctxlist_lock, flags);
+
+	len = scnprintf(buf, PAGE_SIZE, "%-10s", "class");
+	for (i = 0; i < SC_QDELAY_BUCKETS - 1; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				" %7s<%-2d", "", 1 << i);
+	len += scnprintf(buf + len, PAGE_SIZE - len, " %6s>=%-2d %8s %10s\n",
+			"", 1 << (SC_QDELAY_BUCKETS - 2), "missed", "max(us)");
+
+	for (prio = 0; prio < SC_PRIO_NUM; prio++) {
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%-10s",
+				sc_prio_name[prio]);
+		for (i = 0; i < SC_QDELAY_BUCKETS; i++)
+			len += scnprintf(buf + len, PAGE_SIZE - len, " %10u",
+					stat.qdelay[prio][i]);
+		len += scnprintf(buf + len, PAGE_SIZE - len, " %8u %10u\n",
+				stat.missed[prio], stat.qdelay_max_us[prio]);
+	}
+
+	return len;
+}
+
+static DEVICE_ATTR_RO(sched_stat);
+
 static int sc_run_next_job(struct sc_dev *sc)
 {
 	unsigned long flags;
@@ -2562,7 +2937,8 @@ static int sc_run_next_job(struct sc_dev *sc)
 		return 0;
 	}
 
-	ctx = list_first_entry(&sc->context_list, struct sc_ctx, node);
+	ctx = sc_pick_next_ctx(sc);
+	sc_sched_account(sc, ctx);
 
 	set_bit(CTX_RUN, &ctx->flags);
 	list_del_init(&ctx->node);
@@ -2670,7 +3046,8 @@ static int sc_run_next_job(struct sc_dev *sc)
 
 	sc_hwset_src_pos(sc, s_frame->crop.left, s_frame->crop.top,
 			s_frame->sc_fmt->h_shift, s_frame->sc_fmt->v_shift);
-	sc_hwset_src_wh(sc, s_frame->crop.width, s_frame->crop.height,
+	sc_hwset_src_wh(sc, s_frame->crop.width - ctx->src_trim_w,
+			s_frame->crop.height - ctx->src_trim_h,
 			pre_h_ratio, pre_v_ratio,
 			s_frame->sc_fmt->h_shift, s_frame->sc_fmt->v_shift);
 
@@ -2736,6 +3113,10 @@ static int sc_add_context_and_run(struct sc_dev *sc, struct sc_ctx *ctx)
 		return -EAGAIN;
 	}
 
+	ctx->ktime_queued = ktime_get();
+	ctx->ktime_deadline = ktime_add_us(ctx->ktime_queued,
+					   sc_ctx_deadline_us(ctx));
+
 	spin_lock_irqsave(&sc->ctxlist_lock, flags);
 	list_add_tail(&ctx->node, &sc->context_list);
 	spin_unlock_irqrestore(&sc->ctxlist_lock, flags);
@@ -2806,7 +3187,7 @@ static irqreturn_t sc_irq_handler(int irq, void *priv)
 			SCALER_INT_OK(irq_status) ?
 				VB2_BUF_STATE_DONE : VB2_BUF_STATE_ERROR);
 
-		v4l2_m2m_job_finish(sc->m2m.m2m_dev, ctx->m2m_ctx);
+		sc_m2m_job_finish(sc, ctx);
 
 		/* Wake up from CTX_ABORT state */
 		clear_bit(CTX_ABORT, &ctx->flags);
@@ -2998,6 +3379,7 @@ static void sc_m2m_job_abort(void *priv)
 
 static struct v4l2_m2m_ops sc_m2m_ops = {
 	.device_run	= sc_m2m_device_run,
+	.job_ready	= sc_m2m_job_ready,
 	.job_abort	= sc_m2m_job_abort,
 };
 
@@ -3267,8 +3649,14 @@ static int sc_m2m1shot_prepare_operation(struct m2m1shot_context *m21ctx,
 {
 	struct sc_ctx *ctx = m21ctx->priv;
 	struct m2m1shot *shot = &task->task;
+	unsigned int prio;
 	int ret;
 
+	prio = (shot->op.op & SC_M2M1SHOT_OP_PRIO_MASK) >>
+					SC_M2M1SHOT_OP_PRIO_SHIFT;
+	if (prio >= SC_PRIO_NUM)
+		return -EINVAL;
+
 	if (!sc_configure_rotation_degree(ctx, shot->op.rotate))
 		return -EINVAL;
 
@@ -3289,6 +3677,8 @@ static int sc_m2m1shot_prepare_operation(struct m2m1shot_context *m21ctx,
 	ctx->dnoise_ft.strength = (shot->op.op & SC_M2M1SHOT_OP_FILTER_MASK) >>
 					SC_M2M1SHOT_OP_FILTER_SHIFT;
 
+	ctx->priority = prio;
+
 	ret = sc_find_scaling_ratio(m21ctx->priv);
 	if (ret)
 		return ret;
@@ -3668,6 +4058,7 @@ static int sc_probe(struct platform_device *pdev)
 
 	spin_lock_init(&sc->ctxlist_lock);
 	INIT_LIST_HEAD(&sc->context_list);
+	INIT_LIST_HEAD(&sc->m2m_waiting);
 	spin_lock_init(&sc->slock);
 	mutex_init(&sc->lock);
 	init_waitqueue_head(&sc->wait);
@@ -3729,6 +4120,12 @@ static int sc_probe(struct platform_device *pdev)
 		goto err_wq;
 	}
 
+	ret = sc_intbuf_pool_init(sc);
+	if (ret) {
+		dev_err(&pdev->dev, "Failed to init intermediate buffer pool\n");
+		goto err_pool;
+	}
+
 	ret = sc_register_m2m_device(sc, sc->dev_id);
 	if (ret) {
 		dev_err(&pdev->dev, "failed to register m2m device\n");
@@ -3812,6 +4209,9 @@ static int sc_probe(struct platform_device *pdev)
 	sc->reboot_notifier.notifier_call = sc_reboot_notifier;
 	register_reboot_notifier(&sc->reboot_notifier);
 
+	if (device_create_file(&pdev->dev, &dev_attr_sched_stat))
+		dev_warn(&pdev->dev, "failed to create sched_stat\n");
+
 	dev_info(&pdev->dev,
 		"Driver probed successfully(version: %08x(%x))\n",
 		hwver, sc->version);
@@ -3829,6 +4229,8 @@ err_iommu:
 		pm_qos_remove_request(&sc->qosreq_int);
 	sc_unregister_m2m_device(sc);
 err_m2m:
+	sc_intbuf_pool_destroy(sc);
+err_pool:
 	destroy_workqueue(sc->fence_wq);
 err_wq:
 	vb2_ion_destroy_context(sc->alloc_ctx);
@@ -3842,8 +4244,12 @@ static int sc_remove(struct platform_device *pdev)
 {
 	struct sc_dev *sc = platform_get_drvdata(pdev);
 
+	device_remove_file(&pdev->dev, &dev_attr_sched_stat);
+
 	destroy_workqueue(sc->fence_wq);
 
+	sc_intbuf_pool_destroy(sc);
+
 	vb2_ion_destroy_context(sc->alloc_ctx);
 
 	sc_clk_put(sc);
@@ -21,6 +21,7 @@
 #include <linux/io.h>
 #include <linux/pm_qos.h>
 #include <linux/dma-buf.h>
+#include <linux/shrinker.h>
 #include <media/videobuf2-core.h>
 #include <media/v4l2-device.h>
 #include <media/v4l2-mem2mem.h>
@@ -43,7 +44,7 @@ extern int sc_log_level;
 #define SC_MAX_DEVS		1
 #define SC_TIMEOUT		(2 * HZ)	/* 2 seconds */
 #define SC_WDT_CNT		3
-#define SC_MAX_CTRL_NUM		11
+#define SC_MAX_CTRL_NUM		13
 
 #define SC_MAX_PLANES		3
 /* Address index */
@@ -67,6 +68,7 @@ extern int sc_log_level;
 #define CTX_DST_FMT	6
 #define CTX_INT_FRAME	7 /* intermediate frame available */
 #define CTX_INT_FRAME_CP 8 /* intermediate frame available */
+#define CTX_RELEASE	9 /* no more V4L2 jobs are to be scheduled */
 
 
 /* CSC equation */
@@ -114,6 +116,13 @@ extern int sc_log_level;
 #define SC_M2M1SHOT_OP_FILTER_SHIFT	(28)
 #define SC_M2M1SHOT_OP_FILTER_MASK	(0xf << 28)
 
+/* for job scheduling */
+#define SC_CID_PRIORITY			(V4L2_CID_EXYNOS_BASE + 151)
+#define SC_CID_DEADLINE			(V4L2_CID_EXYNOS_BASE + 152)
+#define SC_M2M1SHOT_OP_PRIO_SHIFT	(24)
+#define SC_M2M1SHOT_OP_PRIO_MASK	(0x3 << 24)
+#define SC_DEADLINE_MAX_US		1000000
+
 #ifdef CONFIG_VIDEOBUF2_ION
 #define sc_buf_sync_prepare vb2_ion_buf_prepare
 #define sc_buf_sync_finish vb2_ion_buf_finish
@@ -307,15 +316,49 @@ struct sc_frame {
 	bool			pre_multi;
 };
 
+/*
+ * struct sc_intbuf - a plane buffer of the intermediate frame
+ * @node:	entry of sc_intbuf_pool.free while the buffer is idle
+ * @size:	buffer size rounded up to the pool bucket
+ * @protected:	allocated from the protected heap
+ * @src_addr:	device address when the buffer is read by the scaler
+ * @dst_addr:	device address when the buffer is written by the scaler
+ */
+struct sc_intbuf {
+	struct list_head		node;
+	size_t				size;
+	bool				protected;
+	struct ion_handle		*handle;
+	struct dma_buf			*dma_buf;
+	struct dma_buf_attachment	*attachment;
+	struct sg_table			*sgt;
+	dma_addr_t			src_addr;
+	dma_addr_t			dst_addr;
+};
+
+/*
+ * struct sc_intbuf_pool - idle intermediate buffers shared by all contexts
+ * @lock:	protects @free, @free_bytes and @nr_free
+ * @client:	ION client owning every buffer of the pool
+ * @free:	idle buffers, most recently released first
+ * @free_bytes:	total size of the buffers in @free
+ * @nr_free:	number of the buffers in @free
+ * @shrinker:	releases idle buffers under memory pressure
+ */
+struct sc_intbuf_pool {
+	struct mutex			lock;
+	struct ion_client		*client;
+	struct list_head		free;
+	size_t				free_bytes;
+	unsigned int			nr_free;
+	struct shrinker			shrinker;
+};
+
 struct sc_int_frame {
 	struct sc_frame			frame;
-	struct ion_client		*client;
-	struct ion_handle		*handle[3];
+	struct sc_intbuf		*buf[3];
 	struct sc_addr			src_addr;
 	struct sc_addr			dst_addr;
-	struct sg_table			*sgt[3];
-	struct dma_buf			*dma_buf[3];
-	struct dma_buf_attachment	*attachment[3];
 };
 
 /*
@@ -361,6 +404,26 @@ enum sc_ft {
 	SC_FT_MAX,
 };
 
+/*
+ * Priority class of a context. A job is scheduled by its deadline and the
+ * class gives the deadline of the contexts that do not specify one.
+ */
+enum sc_prio {
+	SC_PRIO_NORMAL = 0,
+	SC_PRIO_REALTIME,
+	SC_PRIO_BACKGROUND,
+	SC_PRIO_NUM,
+};
+
+/* queueing delay buckets: < 1ms, < 2ms, < 4ms, ... < 64ms, >= 64ms */
+#define SC_QDELAY_BUCKETS	8
+
+struct sc_sched_stat {
+	u32			qdelay[SC_PRIO_NUM][SC_QDELAY_BUCKETS];
+	u32			missed[SC_PRIO_NUM];
+	u32			qdelay_max_us[SC_PRIO_NUM];
+};
+
 struct sc_dnoise_filter {
 	u32			strength;
 	u32			w;
@@ -390,6 +453,11 @@ struct sc_ctx;
  * @version:	IP version number
  * @cfw:	cfw flag
  * @pb_disable:       prefetch-buffer disable flag
+ * @intbuf_pool:	idle buffers for two-pass scaling
+ * @sched_stat:	queueing delay of the jobs per priority class
+ * @m2m_owner:	V4L2 context whose job is given to v4l2-m2m
+ * @m2m_waiting:	V4L2 contexts ready to run while @m2m_owner is set
+ * @m2m_kicking:	number of contexts in @m2m_waiting being scheduled
  */
 struct sc_dev {
 	struct device			*dev;
@@ -420,6 +488,11 @@ struct sc_dev {
 	bool				pb_disable;
 	u32				cfw;
 	struct notifier_block		reboot_notifier;
+	struct sc_intbuf_pool		intbuf_pool;
+	struct sc_sched_stat		sched_stat;
+	struct sc_ctx			*m2m_owner;
+	struct list_head		m2m_waiting; /* for sc_ctx.m2m_node */
+	unsigned int			m2m_kicking;
 };
 
 enum SC_CONTEXT_TYPE {
@@ -446,6 +519,14 @@ enum SC_CONTEXT_TYPE {
  * @flags:		context state flags
  * @pre_multi:		pre-multiplied format
  * @csc:		csc equation value
+ * @src_trim_w:		source columns dropped to keep the pre-scaler usable
+ * @src_trim_h:		source rows dropped to keep the pre-scaler usable
+ * @priority:		priority class of the context
+ * @deadline_us:	relative deadline of a job, 0 for the class default
+ * @ktime_queued:	time when the current job is queued to sc_dev
+ * @ktime_deadline:	absolute deadline of the current job
+ * @m2m_node:		list to be added to sc_dev.m2m_waiting
+ * @m2m_deadline:	absolute deadline of the job waiting in @m2m_node
  */
 struct sc_ctx {
 	struct list_head		node;
@@ -478,6 +559,14 @@ struct sc_ctx {
 	struct sc_csc			csc;
 	struct sc_init_phase		init_phase;
 	struct sc_dnoise_filter		dnoise_ft;
+	unsigned int			src_trim_w;
+	unsigned int			src_trim_h;
+	enum sc_prio			priority;
+	u32				deadline_us;
+	ktime_t				ktime_queued;
+	ktime_t				ktime_deadline;
+	struct list_head		m2m_node;
+	ktime_t				m2m_deadline;
 };
 
 static inline struct sc_frame *ctx_get_frame(struct sc_ctx *ctx,
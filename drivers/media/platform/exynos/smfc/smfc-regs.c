@@ -152,8 +152,17 @@ void smfc_hwconfigure_tables(struct smfc_ctx *ctx,
 {
 	size_t i;
 	void __iomem *base = ctx->smfc->reg;
+	struct smfc_dev *smfc = ctx->smfc;
+
+	/* the same quality factor as the last job: nothing to rewrite */
+	if ((qfactor > 0) && ((smfc->hwtables & SMFC_HWTABLES_MAIN_MASK) ==
+						SMFC_HWTABLES_MAIN(qfactor)))
+		goto out;
+
+	smfc->hwtables &= ~SMFC_HWTABLES_MAIN_MASK;
 
 	if (qfactor > 0) {
+		smfc->hwtables |= SMFC_HWTABLES_MAIN(qfactor);
 		qfactor = (qfactor < 50) ? 5000 / qfactor : 200 - qfactor * 2;
 		smfc_hwconfigure_qtable(base + REG_QTBL_BASE,
 					qfactor, default_luma_qtbl);
@@ -189,7 +198,7 @@ void smfc_hwconfigure_tables(struct smfc_ctx *ctx,
 	for (i = 0; i < ARRAY_SIZE(ITU_H_TBL_VAL_AC_CHROMINANCE); i++)
 		__raw_writel(ITU_H_TBL_VAL_AC_CHROMINANCE[i],
 				base + REG_HTBL_CHROMA_ACVAL + i * sizeof(u32));
-
+out:
 	__raw_writel(VAL_MAIN_TABLE_SELECT, base + REG_MAIN_TABLE_SELECT);
 	__raw_writel(SMFC_DHT_LEN, base + REG_MAIN_DHT_LEN);
 }
@@ -199,11 +208,18 @@ void smfc_hwconfigure_2nd_tables(struct smfc_ctx *ctx, unsigned int qfactor)
 	/* Qunatiazation table 2 and 3 will be used by the secondary image */
 	void __iomem *base = ctx->smfc->reg;
 	void __iomem *qtblbase = base + REG_QTBL_BASE + SMFC_MCU_SIZE * 2;
-	qfactor = (qfactor < 50) ? 5000 / qfactor : 200 - qfactor * 2;
+	struct smfc_dev *smfc = ctx->smfc;
+
+	if ((smfc->hwtables & SMFC_HWTABLES_SEC_MASK) !=
+					SMFC_HWTABLES_SEC(qfactor)) {
+		smfc->hwtables &= ~SMFC_HWTABLES_SEC_MASK;
+		smfc->hwtables |= SMFC_HWTABLES_SEC(qfactor);
 
-	smfc_hwconfigure_qtable(qtblbase, qfactor, default_luma_qtbl);
-	smfc_hwconfigure_qtable(qtblbase + SMFC_MCU_SIZE,
-				qfactor, default_chroma_qtbl);
+		qfactor = (qfactor < 50) ? 5000 / qfactor : 200 - qfactor * 2;
+		smfc_hwconfigure_qtable(qtblbase, qfactor, default_luma_qtbl);
+		smfc_hwconfigure_qtable(qtblbase + SMFC_MCU_SIZE,
+					qfactor, default_chroma_qtbl);
+	}
 	/* Huffman table for the secondary image is the same as the main image */
 	__raw_writel(VAL_SEC_TABLE_SELECT, base + REG_SEC_TABLE_SELECT);
 	__raw_writel(SMFC_DHT_LEN, base + REG_SEC_DHT_LEN);
@@ -216,6 +232,9 @@ void smfc_hwconfigure_tables_for_decompression(struct smfc_ctx *ctx)
 	u32 tblsel = ctx->num_components << 16;
 	int i;
 
+	/* tables of the stream overwrite those of compression */
+	smfc_invalidate_hwtables(ctx->smfc);
+
 	/* Huffman table selector configuration */
 	for (i = 0; i < ctx->num_components; i++) {
 		u32 val = (ctx->huffman_tables->compsel[i].idx_dc |
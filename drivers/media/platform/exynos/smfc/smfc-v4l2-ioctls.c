@@ -20,6 +20,7 @@
 #define V4L2_CID_JPEG_QTABLES2		(V4L2_CID_JPEG_CLASS_BASE + 22)
 #define V4L2_CID_JPEG_HWFC_ENABLE	(V4L2_CID_JPEG_CLASS_BASE + 25)
 #define V4L2_CID_JPEG_MAX_PERF		(V4L2_CID_JPEG_CLASS_BASE + 26)
+#define V4L2_CID_JPEG_STAGE_TIME	(V4L2_CID_JPEG_CLASS_BASE + 27)
 
 #define SMFC_FMT_MAIN_SIZE(val) ((val) & 0xFFFF)
 #define SMFC_FMT_SEC_SIZE(val) (((val) >> 16) & 0xFFFF)
@@ -342,8 +343,26 @@ static int smfc_s_ctrl(struct v4l2_ctrl *ctrl)
 	return 0;
 }
 
+static int smfc_g_volatile_ctrl(struct v4l2_ctrl *ctrl)
+{
+	struct smfc_ctx *ctx = container_of(ctrl->handler,
+					    struct smfc_ctx, v4l2_ctrlhdlr);
+	switch (ctrl->id) {
+	case V4L2_CID_JPEG_STAGE_TIME:
+		memcpy(ctrl->p_new.p_u32, ctx->stage_us,
+		       sizeof(ctx->stage_us));
+		break;
+	default:
+		dev_err(ctx->smfc->dev, "Unsupported CID %#x\n", ctrl->id);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 static const struct v4l2_ctrl_ops smfc_ctrl_ops = {
 	.s_ctrl = smfc_s_ctrl,
+	.g_volatile_ctrl = smfc_g_volatile_ctrl,
 };
 
 int smfc_init_controls(struct smfc_dev *smfc,
@@ -437,6 +456,23 @@ int smfc_init_controls(struct smfc_dev *smfc,
 		goto err;
 	}
 
+	/* power, config and H/W time of the last job in usec. */
+	memset(&ctrlcfg, 0, sizeof(ctrlcfg));
+	ctrlcfg.ops = &smfc_ctrl_ops;
+	ctrlcfg.id = V4L2_CID_JPEG_STAGE_TIME;
+	ctrlcfg.name = "JPEG stage time of the last job";
+	ctrlcfg.type = V4L2_CTRL_TYPE_U32;
+	ctrlcfg.flags = V4L2_CTRL_FLAG_READ_ONLY | V4L2_CTRL_FLAG_VOLATILE;
+	ctrlcfg.min = 0;
+	ctrlcfg.max = U32_MAX;
+	ctrlcfg.step = 1;
+	ctrlcfg.def = 0;
+	ctrlcfg.dims[0] = SMFC_STAGE_NUM;
+	if (!v4l2_ctrl_new_custom(hdlr, &ctrlcfg, NULL)) {
+		msg = "stage time";
+		goto err;
+	}
+
 	return 0;
 err:
 	v4l2_ctrl_handler_free(hdlr);
@@ -38,6 +38,19 @@ enum {
 	SMFC_HWFC_WAIT,
 };
 
+/* drops the power and the clocks held by a job since smfc_m2m_device_run() */
+static void smfc_release_hw(struct smfc_dev *smfc)
+{
+	if (!IS_ERR(smfc->clk_gate)) {
+		clk_disable(smfc->clk_gate);
+		if (!IS_ERR(smfc->clk_gate2))
+			clk_disable(smfc->clk_gate2);
+	}
+
+	pm_runtime_mark_last_busy(smfc->dev);
+	pm_runtime_put_autosuspend(smfc->dev);
+}
+
 static irqreturn_t exynos_smfc_irq_handler(int irq, void *priv)
 {
 	struct smfc_dev *smfc = priv;
@@ -73,32 +86,27 @@ static irqreturn_t exynos_smfc_irq_handler(int irq, void *priv)
 		smfc_dump_registers(smfc);
 		state = VB2_BUF_STATE_ERROR;
 		smfc_hwconfigure_reset(smfc);
+		smfc_invalidate_hwtables(smfc);
 	}
 
-	if (!IS_ERR(smfc->clk_gate)) {
-		clk_disable(smfc->clk_gate);
-		if (!IS_ERR(smfc->clk_gate2))
-			clk_disable(smfc->clk_gate2);
-	}
-
-	pm_runtime_put(smfc->dev);
-
 	/* ctx is NULL if streamoff is called before (de)compression finishes */
 	if (ctx) {
-		struct vb2_v4l2_buffer *vb;
+		struct vb2_v4l2_buffer *vb_dst, *vb_src;
 
-		vb = v4l2_m2m_dst_buf_remove(ctx->fh.m2m_ctx);
-		if (vb) {
+		ctx->stage_us[SMFC_STAGE_HW] =
+				(u32)ktime_us_delta(ktime, ctx->ktime_beg);
+
+		vb_dst = v4l2_m2m_dst_buf_remove(ctx->fh.m2m_ctx);
+		if (vb_dst) {
 			if (!!(ctx->flags & SMFC_CTX_COMPRESS)) {
-				vb2_set_plane_payload(&vb->vb2_buf, 0, streamsize);
+				vb2_set_plane_payload(&vb_dst->vb2_buf, 0,
+						      streamsize);
 				if (!!(ctx->flags & SMFC_CTX_B2B_COMPRESS))
-					vb2_set_plane_payload(&vb->vb2_buf, 1,
-							thumb_streamsize);
+					vb2_set_plane_payload(&vb_dst->vb2_buf,
+							1, thumb_streamsize);
 			}
 
-			vb->timestamp.tv_usec =
-				(__u32)ktime_us_delta(ktime, ctx->ktime_beg);
-			v4l2_m2m_buf_done(vb, state);
+			vb_dst->timestamp.tv_usec = ctx->stage_us[SMFC_STAGE_HW];
 
 			if ((!!(ctx->flags & SMFC_CTX_COMPRESS)) && ctx->enable_hwfc) {
 				atomic_set(&smfc_hwfc_state, SMFC_HWFC_STANDBY);
@@ -106,13 +114,29 @@ static irqreturn_t exynos_smfc_irq_handler(int irq, void *priv)
 			}
 		}
 
-		vb = v4l2_m2m_src_buf_remove(ctx->fh.m2m_ctx);
-		if (vb)
-			v4l2_m2m_buf_done(vb, state);
+		vb_src = v4l2_m2m_src_buf_remove(ctx->fh.m2m_ctx);
+
+		/*
+		 * The buffers must be returned before v4l2_m2m_job_finish().
+		 * Once the job is finished, a concurrent close may release the
+		 * queues and free ctx.
+		 */
+		if (vb_dst)
+			v4l2_m2m_buf_done(vb_dst, state);
+		if (vb_src)
+			v4l2_m2m_buf_done(vb_src, state);
 
 		if (!suspending) {
+			/*
+			 * v4l2_m2m_job_finish() configures and starts the job of
+			 * the next ready context, if any. The power and the
+			 * clocks of this job are held until then to keep the
+			 * H/W warm for it.
+			 */
 			v4l2_m2m_job_finish(smfc->m2mdev, ctx->fh.m2m_ctx);
+			smfc_release_hw(smfc);
 		} else {
+			smfc_release_hw(smfc);
 			/*
 			 * smfc_resume() is in charge of calling
 			 * v4l2_m2m_job_finish() on resuming
@@ -125,6 +149,7 @@ static irqreturn_t exynos_smfc_irq_handler(int irq, void *priv)
 			wake_up(&smfc_suspend_wq);
 		}
 	} else {
+		smfc_release_hw(smfc);
 		dev_err(smfc->dev, "Spurious interrupt on H/W JPEG occurred\n");
 	}
 
@@ -155,14 +180,9 @@ static void smfc_timedout_handler(unsigned long arg)
 	dev_err(smfc->dev, "=== TIMED-OUT! (1 sec.) =========================");
 	smfc_dump_registers(smfc);
 	smfc_hwconfigure_reset(smfc);
+	smfc_invalidate_hwtables(smfc);
 
-	if (!IS_ERR(smfc->clk_gate)) {
-		clk_disable(smfc->clk_gate);
-		if (!IS_ERR(smfc->clk_gate2))
-			clk_disable(smfc->clk_gate2);
-	}
-
-	pm_runtime_put(smfc->dev);
+	smfc_release_hw(smfc);
 
 	ctx = v4l2_m2m_get_curr_priv(smfc->m2mdev);
 	if (ctx) {
@@ -570,7 +590,14 @@ static void smfc_m2m_device_run(void *priv)
 	unsigned char quality_factor = ctx->quality_factor;
 	unsigned char thumb_quality_factor = ctx->thumb_quality_factor;
 	unsigned char enable_hwfc = ctx->enable_hwfc;
+	ktime_t ktime;
+
+	ctx->ktime_run = ktime_get();
 
+	/*
+	 * This is called from the interrupt handler of the previous job while
+	 * it still holds the power. Then the H/W is always active here.
+	 */
 	ret = in_irq() ? pm_runtime_get(ctx->smfc->dev) :
 			 pm_runtime_get_sync(ctx->smfc->dev);
 	if (ret < 0) {
@@ -592,6 +619,10 @@ static void smfc_m2m_device_run(void *priv)
 		goto err_clk;
 	}
 
+	ktime = ktime_get();
+	ctx->stage_us[SMFC_STAGE_POWER] =
+			(u32)ktime_us_delta(ktime, ctx->ktime_run);
+
 	if (!smfc_check_hwfc_configuration(ctx, !!enable_hwfc))
 		goto err_hwfc;
 
@@ -635,6 +666,8 @@ static void smfc_m2m_device_run(void *priv)
 	}
 
 	ctx->ktime_beg = ktime_get();
+	ctx->stage_us[SMFC_STAGE_CONFIG] =
+			(u32)ktime_us_delta(ctx->ktime_beg, ktime);
 
 	smfc_hwconfigure_start(ctx, restart_interval, !!enable_hwfc);
 
@@ -647,7 +680,7 @@ err_hwfc:
 			clk_disable(ctx->smfc->clk_gate2);
 	}
 err_clk:
-	pm_runtime_put(ctx->smfc->dev);
+	pm_runtime_put_autosuspend(ctx->smfc->dev);
 err_pm:
 	v4l2_m2m_buf_done(
 		v4l2_m2m_src_buf_remove(ctx->fh.m2m_ctx), VB2_BUF_STATE_ERROR);
@@ -885,6 +918,8 @@ static int exynos_smfc_reboot_notifier(struct notifier_block *nb,
 
 	wait_event(smfc_suspend_wq, !(smfc_dev->flags & SMFC_DEV_SUSPENDING));
 
+	/* no more warm window: suspend now if no job holds the H/W */
+	pm_runtime_dont_use_autosuspend(smfc_dev->dev);
 	pm_runtime_barrier(smfc_dev->dev);
 	if (pm_runtime_active(smfc_dev->dev)) {
 		pm_runtime_put_sync(smfc_dev->dev);
@@ -950,6 +985,12 @@ static int exynos_smfc_probe(struct platform_device *pdev)
 		smfc->device_id = -1;
 	}
 
+	/*
+	 * Keep the H/W powered for a while after a job so that burst shots
+	 * and thumbnails do not pay for the power sequence of every image.
+	 */
+	pm_runtime_set_autosuspend_delay(&pdev->dev, SMFC_AUTOSUSPEND_DELAY_MS);
+	pm_runtime_use_autosuspend(&pdev->dev);
 	pm_runtime_enable(&pdev->dev);
 
 	if (!of_property_read_u32(pdev->dev.of_node, "smfc,int_qos_minlock",
@@ -1048,9 +1089,11 @@ static int smfc_suspend(struct device *dev)
 	wait_event(smfc_suspend_wq, !(smfc->flags & SMFC_DEV_SUSPENDING));
 
 	/*
-	 * It is guaranteed that the Runtime PM is suspended
-	 * and all relavent clocks are disabled.
+	 * It is guaranteed that all relavent clocks are disabled. The Runtime
+	 * PM may still be active in the autosuspend delay but the H/W loses
+	 * its tables during Suspend To RAM.
 	 */
+	smfc_invalidate_hwtables(smfc);
 
 	return 0;
 }
@@ -1082,6 +1125,8 @@ static int smfc_runtime_suspend(struct device *dev)
 {
 	struct smfc_dev *smfc = dev_get_drvdata(dev);
 
+	smfc_invalidate_hwtables(smfc);
+
 	if (smfc->qosreq_int_level > 0)
 		pm_qos_update_request(&smfc->qosreq_int, 0);
 
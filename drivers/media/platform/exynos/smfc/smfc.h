@@ -90,6 +90,19 @@ struct smfc_device_data {
 /* Set if HWFC is enabled in device_run, cleared in irq/timeout handler */
 #define SMFC_DEV_OTF_EMUMODE	(1 << 4)
 
+/* Delay before the runtime PM suspends the H/W after the last job */
+#define SMFC_AUTOSUSPEND_DELAY_MS	100
+
+/*
+ * Tables for compression left in the table SFRs by the last job.
+ * The soft reset before each job does not touch them but they are lost
+ * when the H/W is power gated.
+ */
+#define SMFC_HWTABLES_MAIN(qf)		((1 << 31) | (qf))
+#define SMFC_HWTABLES_MAIN_MASK		((1 << 31) | 0xFF)
+#define SMFC_HWTABLES_SEC(qf)		((1 << 30) | ((qf) << 8))
+#define SMFC_HWTABLES_SEC_MASK		((1 << 30) | 0xFF00)
+
 struct smfc_dev {
 	struct v4l2_device v4l2_dev;
 	struct video_device *videodev;
@@ -111,8 +124,14 @@ struct smfc_dev {
 	struct pm_qos_request qosreq_int;
 	s32 qosreq_int_level;
 	struct notifier_block reboot_notifier;
+	u32 hwtables; /* SMFC_HWTABLES_MAIN() | SMFC_HWTABLES_SEC() */
 };
 
+static inline void smfc_invalidate_hwtables(struct smfc_dev *smfc)
+{
+	smfc->hwtables = 0;
+}
+
 #define SMFC_CTX_COMPRESS	(1 << 0)
 #define SMFC_CTX_B2B_COMPRESS	(1 << 1) /* valid if SMFC_CTX_COMPRESS is set */
 
@@ -163,11 +182,21 @@ struct smfc_crop {
 	u32 so[SMFC_MAX_NUM_COMP];
 };
 
+/* stages of the last job of a context reported by V4L2_CID_JPEG_STAGE_TIME */
+enum smfc_stage {
+	SMFC_STAGE_POWER,	/* runtime PM and gate clocks */
+	SMFC_STAGE_CONFIG,	/* reset, tables and buffer addresses */
+	SMFC_STAGE_HW,		/* start to the completion interrupt */
+	SMFC_STAGE_NUM,
+};
+
 struct smfc_ctx {
 	struct v4l2_fh fh;
 	struct v4l2_ctrl_handler v4l2_ctrlhdlr;
 	struct smfc_dev *smfc;
+	ktime_t ktime_run;
 	ktime_t ktime_beg;
+	u32 stage_us[SMFC_STAGE_NUM];
 	u32 flags;
 	/* uncomressed image description */
 	const struct smfc_image_format *img_fmt;
@@ -11,6 +11,7 @@
 #include <asm/uaccess.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
+#include <linux/mutex.h>
 
 #include <scsc/scsc_logring.h>
 #include <scsc/scsc_mx.h>
@@ -118,6 +119,19 @@ static bool use_new_fw_structure = true;
 module_param(use_new_fw_structure, bool, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(use_new_fw_structure, "deprecated");
 
+/* Keep the last firmware image in memory across WLBT restarts */
+static bool fw_image_cache = true;
+module_param(fw_image_cache, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(fw_image_cache, "Retain firmware image between restarts, default Y");
+
+/* Firmware image last read from the filesystem. It is reused while the
+ * file on disk keeps the same path, size and mtime.
+ */
+static DEFINE_MUTEX(fw_cache_lock);
+static const struct firmware *fw_cache;
+static char fw_cache_path[MX140_FW_PATH_MAX_LENGTH];
+static struct kstat fw_cache_stat;
+
 static char *cfg_platform = "default";
 module_param(cfg_platform, charp, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(cfg_platform, "HCF config subdirectory");
@@ -265,11 +279,51 @@ void mx140_file_release_conf(struct scsc_mx *mx, const struct firmware *conf)
 }
 EXPORT_SYMBOL(mx140_file_release_conf);
 
+static int mx140_file_stat(const char *path, struct kstat *stat)
+{
+	mm_segment_t fs;
+	int r;
+
+	fs = get_fs();
+	set_fs(get_ds());
+	r = vfs_stat(path, stat);
+	set_fs(fs);
+
+	return r;
+}
+
+static bool mx140_file_fw_cache_match(const char *path, const struct kstat *stat)
+{
+	return fw_cache && !strcmp(fw_cache_path, path) &&
+	       fw_cache_stat.size == stat->size &&
+	       timespec_equal(&fw_cache_stat.mtime, &stat->mtime);
+}
+
+/* Drop the retained firmware image. Caller holds fw_cache_lock. */
+static void __mx140_file_release_fw_cache(struct scsc_mx *mx)
+{
+	if (!fw_cache)
+		return;
+
+	mx140_release_file(mx, fw_cache);
+	fw_cache = NULL;
+	fw_cache_path[0] = '\0';
+}
+
+void mx140_file_release_fw_cache(struct scsc_mx *mx)
+{
+	mutex_lock(&fw_cache_lock);
+	__mx140_file_release_fw_cache(mx);
+	mutex_unlock(&fw_cache_lock);
+}
+
 static int __mx140_file_download_fw(struct scsc_mx *mx, void *dest, size_t dest_size, u32 *fw_image_size, const char *fw_suffix)
 {
 	const struct firmware *firm;
 	int                   r = 0;
 	char                  img_path_name[MX140_FW_PATH_MAX_LENGTH];
+	struct kstat          stat;
+	bool                  stat_ok;
 
 	if (mx140_basedir_file(mx))
 		return -ENOENT;
@@ -283,10 +337,21 @@ static int __mx140_file_download_fw(struct scsc_mx *mx, void *dest, size_t dest_
 		fw_suffix);
 
 	SCSC_TAG_INFO(MX_FILE, "Load WLBT fw %s in shared address %p\n", img_path_name, dest);
-	r = mx140_request_file(mx, img_path_name, &firm);
-	if (r) {
-		SCSC_TAG_ERR(MX_FILE, "Error Loading FW, error %d\n", r);
-		return r;
+
+	mutex_lock(&fw_cache_lock);
+	if (!fw_image_cache)
+		__mx140_file_release_fw_cache(mx);
+	stat_ok = !mx140_file_stat(img_path_name, &stat);
+	if (fw_image_cache && stat_ok && mx140_file_fw_cache_match(img_path_name, &stat)) {
+		SCSC_TAG_INFO(MX_FILE, "Using retained image of %s\n", img_path_name);
+		firm = fw_cache;
+	} else {
+		r = mx140_request_file(mx, img_path_name, &firm);
+		if (r) {
+			mutex_unlock(&fw_cache_lock);
+			SCSC_TAG_ERR(MX_FILE, "Error Loading FW, error %d\n", r);
+			return r;
+		}
 	}
 	SCSC_TAG_DEBUG(MX_FILE, "FW Download, size %zu\n", firm->size);
 
@@ -297,7 +362,18 @@ static int __mx140_file_download_fw(struct scsc_mx *mx, void *dest, size_t dest_
 		memcpy(dest, firm->data, firm->size);
 		*fw_image_size = firm->size;
 	}
-	mx140_release_file(mx, firm);
+
+	if (firm == fw_cache) {
+		/* Already retained */
+	} else if (!r && fw_image_cache && stat_ok) {
+		__mx140_file_release_fw_cache(mx);
+		fw_cache = firm;
+		fw_cache_stat = stat;
+		strlcpy(fw_cache_path, img_path_name, sizeof(fw_cache_path));
+	} else {
+		mx140_release_file(mx, firm);
+	}
+	mutex_unlock(&fw_cache_lock);
 	return r;
 }
 
@@ -12,6 +12,7 @@
 #include <linux/version.h>
 #include <linux/kmod.h>
 #include <linux/notifier.h>
+#include <linux/ktime.h>
 #include "scsc_mx_impl.h"
 #include "miframman.h"
 #include "mifmboxman.h"
@@ -652,10 +653,50 @@ static void fw_crc_work_func(struct work_struct *work)
 }
 
 
+/*
+ * CRC over the whole image as loaded. This only depends on the image in
+ * shared DRAM, so it runs while the MIF and transports are being set up
+ * and is joined by fw_verify_join() before Maxwell is released from reset.
+ */
+static void fw_verify_work_func(struct work_struct *work)
+{
+	struct mxman *mxman = container_of(work, struct mxman, fw_verify_work);
+	u64          t = ktime_get_ns();
+
+	mxman->fw_verify_status = do_fw_crc32_checks(mxman->fw, mxman->fw_image_size, &mxman->fwhdr, true);
+	mxman->boot_ns[MXMAN_BOOT_FW_VERIFY] = ktime_get_ns() - t;
+}
+
+static void fw_verify_start(struct mxman *mxman)
+{
+	mxman->fw_verify_status = 0;
+	if (mxman->check_crc)
+		queue_work(mxman->fw_crc_wq, &mxman->fw_verify_work);
+}
+
+static int fw_verify_join(struct mxman *mxman)
+{
+	u64 t = ktime_get_ns();
+
+	if (!mxman->check_crc)
+		return 0;
+
+	flush_work(&mxman->fw_verify_work);
+	mxman->boot_ns[MXMAN_BOOT_VERIFY_WAIT] = ktime_get_ns() - t;
+	if (mxman->fw_verify_status) {
+		SCSC_TAG_ERR(MXMAN, "do_fw_crc32_checks() failed\n");
+		return mxman->fw_verify_status;
+	}
+	fw_crc_wq_start(mxman);
+
+	return 0;
+}
+
 static void fw_crc_wq_init(struct mxman *mxman)
 {
 	mxman->fw_crc_wq = create_singlethread_workqueue("fw_crc_wq");
 	INIT_DELAYED_WORK(&mxman->fw_crc_work, fw_crc_work_func);
+	INIT_WORK(&mxman->fw_verify_work, fw_verify_work_func);
 }
 
 static void fw_crc_wq_stop(struct mxman *mxman)
@@ -863,12 +904,14 @@ static int fw_init(struct mxman *mxman, void *start_dram, size_t size_dram, bool
 	u32                 fw_image_size;
 	struct fwhdr        *fwhdr = &mxman->fwhdr;
 	char                *fw = start_dram;
+	u64                 t = ktime_get_ns();
 
 	r = mx140_file_download_fw(mxman->mx, start_dram, size_dram, &fw_image_size);
 	if (r) {
 		SCSC_TAG_ERR(MXMAN, "mx140_file_download_fw() failed (%d)\n", r);
 		return r;
 	}
+	mxman->boot_ns[MXMAN_BOOT_FW_LOAD] = ktime_get_ns() - t;
 
 	r = fwhdr_init(fw, fwhdr, fwhdr_parsed_ok, &mxman->check_crc);
 	if (r) {
@@ -877,15 +920,8 @@ static int fw_init(struct mxman *mxman, void *start_dram, size_t size_dram, bool
 	}
 	mxman->fw = fw;
 	mxman->fw_image_size = fw_image_size;
-	if (mxman->check_crc) {
-		/* do CRC on the entire image */
-		r = do_fw_crc32_checks(fw, fw_image_size, &mxman->fwhdr, true);
-		if (r) {
-			SCSC_TAG_ERR(MXMAN, "do_fw_crc32_checks() failed\n");
-			return r;
-		}
-		fw_crc_wq_start(mxman);
-	}
+	/* do CRC on the entire image, joined in mxman_start() */
+	fw_verify_start(mxman);
 
 	if (*fwhdr_parsed_ok) {
 		build_id = fwhdr_get_build_id(fw, fwhdr);
@@ -927,8 +963,11 @@ static int mxman_start(struct mxman *mxman)
 	void                *start_mifram_heap;
 	u32                 length_mifram_heap;
 	int                 r;
+	u64                 t_boot = ktime_get_ns();
+	u64                 t;
 
 	(void)snprintf(mxman->fw_build_id, sizeof(mxman->fw_build_id), "unknown");
+	memset(mxman->boot_ns, 0, sizeof(mxman->boot_ns));
 
 	/* If the option is set to skip header, we must allow unidentified f/w */
 	if (skip_header) {
@@ -968,14 +1007,26 @@ static int mxman_start(struct mxman *mxman)
 	start_mifram_heap = (char *)start_dram + fwhdr->fw_runtime_length;
 	length_mifram_heap = size_dram - fwhdr->fw_runtime_length;
 
+	t = ktime_get_ns();
 	miframman_init(scsc_mx_get_ramman(mxman->mx), start_mifram_heap, length_mifram_heap, start_dram);
 	mifmboxman_init(scsc_mx_get_mboxman(mxman->mx));
 	mifintrbit_init(scsc_mx_get_intrbit(mxman->mx), mif);
+	mxman->boot_ns[MXMAN_BOOT_MIF_SETUP] = ktime_get_ns() - t;
 
 	/* Initialise transports */
+	t = ktime_get_ns();
 	r = transports_init(mxman);
-	if (r) {
+	mxman->boot_ns[MXMAN_BOOT_TRANSPORTS] = ktime_get_ns() - t;
+	if (r)
 		SCSC_TAG_ERR(MXMAN, "transports_init() failed\n");
+
+	/* The image must be verified before it is run */
+	if (!r) {
+		r = fw_verify_join(mxman);
+		if (r)
+			transports_release(mxman);
+	}
+	if (r) {
 		fw_crc_wq_stop(mxman);
 		mifintrbit_deinit(scsc_mx_get_intrbit(mxman->mx));
 		miframman_deinit(scsc_mx_get_ramman(mxman->mx));
@@ -1027,6 +1078,7 @@ static int mxman_start(struct mxman *mxman)
 	mxman->mxman_state = MXMAN_STATE_STARTING;
 
 	/* release Maxwell from reset */
+	t = ktime_get_ns();
 	r = mif->reset(mif, 0);
 	if (r) {
 #ifdef CONFIG_SCSC_LOG_COLLECTION
@@ -1047,12 +1099,15 @@ static int mxman_start(struct mxman *mxman)
 			mxman_stop(mxman);
 			return r;
 		}
+		mxman->boot_ns[MXMAN_BOOT_FW_START] = ktime_get_ns() - t;
 #ifdef CONFIG_SCSC_MXLOGGER
 		mxlogger_start(scsc_mx_get_mxlogger(mxman->mx));
 #endif
 	} else {
 		msleep(WAIT_FOR_FW_TO_START_DELAY_MS);
+		mxman->boot_ns[MXMAN_BOOT_FW_START] = ktime_get_ns() - t;
 	}
+	mxman->boot_ns[MXMAN_BOOT_TOTAL] = ktime_get_ns() - t_boot;
 
 	return 0;
 }
@@ -1855,6 +1910,7 @@ void mxman_deinit(struct mxman *mxman)
 	active_mxman = NULL;
 	mxproc_remove_info_proc_dir(&mxman->mxproc);
 	fw_crc_wq_deinit(mxman);
+	mx140_file_release_fw_cache(mxman->mx);
 	failure_wq_deinit(mxman);
 #ifdef CONFIG_SCSC_WLBTD
 	wlbtd_wq_deinit(mxman);
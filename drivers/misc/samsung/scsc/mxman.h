@@ -36,12 +36,27 @@ enum mxman_state {
 
 #define SCSC_FAILURE_REASON_LEN 256
 
+/* Phases of the last WLBT start, as reported by mx_boot_time */
+enum mxman_boot_phase {
+	MXMAN_BOOT_FW_LOAD,	/* image into shared DRAM */
+	MXMAN_BOOT_FW_VERIFY,	/* full image CRC, overlaps MIF setup */
+	MXMAN_BOOT_MIF_SETUP,	/* ramman, mboxman, intrbit */
+	MXMAN_BOOT_TRANSPORTS,
+	MXMAN_BOOT_VERIFY_WAIT,	/* time spent waiting for the CRC to finish */
+	MXMAN_BOOT_FW_START,	/* reset release to MM_START_IND */
+	MXMAN_BOOT_TOTAL,
+	MXMAN_BOOT_PHASES,
+};
+
 struct mxman {
 	struct scsc_mx          *mx;
 	int                     users;
 	void                    *start_dram;
 	struct workqueue_struct *fw_crc_wq;
 	struct delayed_work     fw_crc_work;
+	struct work_struct      fw_verify_work;
+	int                     fw_verify_status;
+	u64                     boot_ns[MXMAN_BOOT_PHASES];
 	struct workqueue_struct *failure_wq;
 	struct work_struct      failure_work;
 	char                    *fw;
@@ -7,6 +7,7 @@
 #include <linux/proc_fs.h>
 #include <linux/version.h>
 #include <linux/seq_file.h>
+#include <linux/math64.h>
 #include <scsc/scsc_release.h>
 #include <scsc/scsc_logring.h>
 #include "mxman.h"
@@ -277,6 +278,33 @@ static ssize_t mx_procfs_mx_boot_count_read(struct file *file, char __user *user
 	return simple_read_from_buffer(user_buf, count, ppos, buf, pos);
 }
 
+static ssize_t mx_procfs_mx_boot_time_read(struct file *file, char __user *user_buf, size_t count, loff_t *ppos)
+{
+	static const char * const phase[MXMAN_BOOT_PHASES] = {
+		[MXMAN_BOOT_FW_LOAD]     = "fw_load",
+		[MXMAN_BOOT_FW_VERIFY]   = "fw_verify",
+		[MXMAN_BOOT_MIF_SETUP]   = "mif_setup",
+		[MXMAN_BOOT_TRANSPORTS]  = "transports",
+		[MXMAN_BOOT_VERIFY_WAIT] = "verify_wait",
+		[MXMAN_BOOT_FW_START]    = "fw_start",
+		[MXMAN_BOOT_TOTAL]       = "total",
+	};
+	struct mxproc *mxproc = file->private_data;
+	char         buf[256];
+	int          pos = 0;
+	const size_t bufsz = sizeof(buf);
+	int          i;
+
+	if (!mxproc || !mxproc->mxman)
+		return 0;
+
+	for (i = 0; i < MXMAN_BOOT_PHASES; i++)
+		pos += scnprintf(buf + pos, bufsz - pos, "%-12s %llu us\n", phase[i],
+				 div_u64(mxproc->mxman->boot_ns[i], NSEC_PER_USEC));
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, pos);
+}
+
 static ssize_t mx_procfs_mx_suspend_write(struct file *file, const char __user *user_buf, size_t count, loff_t *ppos)
 {
 	struct mxproc *mxproc = file->private_data;
@@ -364,6 +392,7 @@ MX_PROCFS_RW_FILE_OPS(mx_suspend);
 MX_PROCFS_RO_FILE_OPS(mx_suspend_count);
 MX_PROCFS_RO_FILE_OPS(mx_recovery_count);
 MX_PROCFS_RO_FILE_OPS(mx_boot_count);
+MX_PROCFS_RO_FILE_OPS(mx_boot_time);
 MX_PROCFS_RO_FILE_OPS(mx_status);
 MX_PROCFS_RO_FILE_OPS(mx_services);
 MX_PROCFS_RO_FILE_OPS(mx_lastpanic);
@@ -506,6 +535,7 @@ int mxproc_create_info_proc_dir(struct mxproc *mxproc, struct mxman *mxman)
 	MX_PROCFS_ADD_FILE(mxproc, mx_rf_hw_ver, parent, S_IRUSR | S_IRGRP | S_IROTH);
 	MX_PROCFS_ADD_FILE(mxproc, mx_rf_hw_name, parent, S_IRUSR | S_IRGRP | S_IROTH);
 	MX_PROCFS_ADD_FILE(mxproc, mx_boot_count, parent, S_IRUSR | S_IRGRP | S_IROTH);
+	MX_PROCFS_ADD_FILE(mxproc, mx_boot_time, parent, S_IRUSR | S_IRGRP | S_IROTH);
 	SCSC_TAG_DEBUG(MX_PROC, "created %s proc dir\n", dir);
 
 	return 0;
@@ -517,6 +547,7 @@ void mxproc_remove_info_proc_dir(struct mxproc *mxproc)
 		char dir[MX_DIRLEN];
 
 		MX_PROCFS_REMOVE_FILE(mx_boot_count, mxproc->procfs_ctrl_dir);
+		MX_PROCFS_REMOVE_FILE(mx_boot_time, mxproc->procfs_info_dir);
 		MX_PROCFS_REMOVE_FILE(mx_release, mxproc->procfs_info_dir);
 		MX_PROCFS_REMOVE_FILE(mx_rf_hw_ver, mxproc->procfs_info_dir);
 		MX_PROCFS_REMOVE_FILE(mx_rf_hw_name, mxproc->procfs_info_dir);
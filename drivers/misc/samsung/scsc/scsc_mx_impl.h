@@ -40,6 +40,7 @@ struct mxlogger         *scsc_mx_get_mxlogger(struct scsc_mx *mx);
 struct panicmon         *scsc_mx_get_panicmon(struct scsc_mx *mx);
 struct suspendmon	*scsc_mx_get_suspendmon(struct scsc_mx *mx);
 int mx140_file_download_fw(struct scsc_mx *mx, void *dest, size_t dest_size, u32 *fw_image_size);
+void mx140_file_release_fw_cache(struct scsc_mx *mx);
 int mx140_request_file(struct scsc_mx *mx, char *path, const struct firmware **firmp);
 int mx140_release_file(struct scsc_mx *mx, const struct firmware *firmp);
 int mx140_basedir_file(struct scsc_mx *mx);
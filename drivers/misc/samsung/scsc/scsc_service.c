@@ -42,6 +42,7 @@ struct scsc_service {
 	struct scsc_service_client *client;
 	struct completion          sm_msg_start_completion;
 	struct completion          sm_msg_stop_completion;
+	struct mutex               start_mutex; /* held until the START_CFM wait ends */
 };
 
 void srvman_init(struct srvman *srvman, struct scsc_mx *mx)
@@ -53,6 +54,8 @@ void srvman_init(struct srvman *srvman, struct scsc_mx *mx)
 	mutex_init(&srvman->api_access_mutex);
 
 	wake_lock_init(&srvman->sm_wake_lock, WAKE_LOCK_SUSPEND, "srvman_wakelock");
+	spin_lock_init(&srvman->sm_wake_lock_spinlock);
+	srvman->sm_wake_lock_count = 0;
 }
 
 void srvman_deinit(struct srvman *srvman)
@@ -144,11 +147,32 @@ static int wait_for_sm_msg_stop_cfm(struct scsc_service *service)
 	return 0;
 }
 
-static int send_sm_msg_start_blocking(struct scsc_service *service, scsc_mifram_ref ref)
+/*
+ * sm_wake_lock is shared by every service management request, and a start
+ * may now be waiting for its CFM while another request runs, so it is
+ * only released when the last holder drops it.
+ */
+static void srvman_wake_lock(struct srvman *srvman)
+{
+	spin_lock(&srvman->sm_wake_lock_spinlock);
+	if (srvman->sm_wake_lock_count++ == 0)
+		wake_lock(&srvman->sm_wake_lock);
+	spin_unlock(&srvman->sm_wake_lock_spinlock);
+}
+
+static void srvman_wake_unlock(struct srvman *srvman)
+{
+	spin_lock(&srvman->sm_wake_lock_spinlock);
+	if (--srvman->sm_wake_lock_count == 0)
+		wake_unlock(&srvman->sm_wake_lock);
+	spin_unlock(&srvman->sm_wake_lock_spinlock);
+}
+
+/* Must be called with api_access_mutex held, the MM stream writer is not locked */
+static void send_sm_msg_start(struct scsc_service *service, scsc_mifram_ref ref)
 {
 	struct scsc_mx          *mx = service->mx;
 	struct mxmgmt_transport *mxmgmt_transport = scsc_mx_get_mxmgmt_transport(mx);
-	int                     r;
 	struct sm_msg_packet    message = { .service_id = service->id,
 					    .msg = SM_MSG_START_REQ,
 					    .optional_data = ref };
@@ -157,6 +181,12 @@ static int send_sm_msg_start_blocking(struct scsc_service *service, scsc_mifram_
 
 	/* Send to FW in MM stream */
 	mxmgmt_transport_send(mxmgmt_transport, MMTRANS_CHAN_ID_SERVICE_MANAGEMENT, &message, sizeof(message));
+}
+
+static int wait_sm_msg_start(struct scsc_service *service)
+{
+	int r;
+
 	r = wait_for_sm_msg_start_cfm(service);
 	if (r) {
 		SCSC_TAG_ERR(MXMAN, "wait_for_sm_msg_start_cfm() failed: r=%d\n", r);
@@ -247,8 +277,9 @@ int scsc_mx_service_start(struct scsc_service *service, scsc_mifram_ref ref)
 	if (chv_run)
 		return 0;
 #endif
+	mutex_lock(&service->start_mutex);
 	mutex_lock(&srvman->api_access_mutex);
-	wake_lock(&srvman->sm_wake_lock);
+	srvman_wake_lock(srvman);
 	if (srvman->error) {
 		tval = ns_to_timeval(mxman->last_panic_time);
 		SCSC_TAG_ERR(MXMAN, "error: refused due to previous f/w failure scsc_panic_code=0x%x happened at [%6lu.%06ld]\n",
@@ -257,21 +288,27 @@ int scsc_mx_service_start(struct scsc_service *service, scsc_mifram_ref ref)
 		/* Print the last panic record to help track ancient failures */
 		mxman_show_last_panic(mxman);
 
-		wake_unlock(&srvman->sm_wake_lock);
+		srvman_wake_unlock(srvman);
 		mutex_unlock(&srvman->api_access_mutex);
+		mutex_unlock(&service->start_mutex);
 		return -EILSEQ;
 	}
 
-	r = send_sm_msg_start_blocking(service, ref);
-	if (r) {
-		SCSC_TAG_ERR(MXMAN, "send_sm_msg_start_blocking() failed: r=%d\n", r);
-		wake_unlock(&srvman->sm_wake_lock);
-		mutex_unlock(&srvman->api_access_mutex);
-		return r;
-	}
-	wake_unlock(&srvman->sm_wake_lock);
+	send_sm_msg_start(service, ref);
+	/*
+	 * The CFM is completed per service, so wait for it without holding
+	 * api_access_mutex and let WLAN and BT start alongside each other.
+	 * start_mutex keeps scsc_mx_service_close() from freeing the service
+	 * until the wait is over.
+	 */
 	mutex_unlock(&srvman->api_access_mutex);
-	return 0;
+
+	r = wait_sm_msg_start(service);
+	if (r)
+		SCSC_TAG_ERR(MXMAN, "wait_sm_msg_start() failed: r=%d\n", r);
+	srvman_wake_unlock(srvman);
+	mutex_unlock(&service->start_mutex);
+	return r;
 }
 EXPORT_SYMBOL(scsc_mx_service_start);
 
@@ -330,7 +367,7 @@ int scsc_mx_service_stop(struct scsc_service *service)
 		return 0;
 #endif
 	mutex_lock(&srvman->api_access_mutex);
-	wake_lock(&srvman->sm_wake_lock);
+	srvman_wake_lock(srvman);
 	if (srvman->error) {
 		tval = ns_to_timeval(mxman->last_panic_time);
 		SCSC_TAG_ERR(MXMAN, "error: refused due to previous f/w failure scsc_panic_code=0x%x happened at [%6lu.%06ld]\n",
@@ -339,7 +376,7 @@ int scsc_mx_service_stop(struct scsc_service *service)
 		/* Print the last panic record to help track ancient failures */
 		mxman_show_last_panic(mxman);
 
-		wake_unlock(&srvman->sm_wake_lock);
+		srvman_wake_unlock(srvman);
 		mutex_unlock(&srvman->api_access_mutex);
 
 		/* Return a special status to allow caller recovery logic to know
@@ -356,12 +393,12 @@ int scsc_mx_service_stop(struct scsc_service *service)
 	r = send_sm_msg_stop_blocking(service);
 	if (r) {
 		SCSC_TAG_ERR(MXMAN, "send_sm_msg_stop_blocking() failed: r=%d\n", r);
-		wake_unlock(&srvman->sm_wake_lock);
+		srvman_wake_unlock(srvman);
 		mutex_unlock(&srvman->api_access_mutex);
 		return -EIO; /* operation failed */
 	}
 
-	wake_unlock(&srvman->sm_wake_lock);
+	srvman_wake_unlock(srvman);
 	mutex_unlock(&srvman->api_access_mutex);
 	return 0;
 }
@@ -490,8 +527,13 @@ int scsc_mx_service_close(struct scsc_service *service)
 	struct timeval tval = {};
 
 	SCSC_TAG_INFO(MXMAN, "\n");
+
+	/* Wait for a start of this service that is still waiting for its CFM */
+	mutex_lock(&service->start_mutex);
+	mutex_unlock(&service->start_mutex);
+
 	mutex_lock(&srvman->api_access_mutex);
-	wake_lock(&srvman->sm_wake_lock);
+	srvman_wake_lock(srvman);
 
 	if (srvman->error) {
 		tval = ns_to_timeval(mxman->last_panic_time);
@@ -502,7 +544,7 @@ int scsc_mx_service_close(struct scsc_service *service)
 		mxman_show_last_panic(mxman);
 
 		mutex_unlock(&srvman->api_access_mutex);
-		wake_unlock(&srvman->sm_wake_lock);
+		srvman_wake_unlock(srvman);
 
 		/* Return a special status when recovery is disabled, to allow
 		 * calling recovery logic to be aware that recovery is disabled,
@@ -527,9 +569,10 @@ int scsc_mx_service_close(struct scsc_service *service)
 							  NULL, NULL);
 	}
 
+	mutex_destroy(&service->start_mutex);
 	kfree(service);
 	mxman_close(mxman);
-	wake_unlock(&srvman->sm_wake_lock);
+	srvman_wake_unlock(srvman);
 	mutex_unlock(&srvman->api_access_mutex);
 	return 0;
 }
@@ -548,14 +591,14 @@ struct scsc_service *scsc_mx_service_open(struct scsc_mx *mx, enum scsc_service_
 	SCSC_TAG_INFO(MXMAN, "\n");
 
 	mutex_lock(&srvman->api_access_mutex);
-	wake_lock(&srvman->sm_wake_lock);
+	srvman_wake_lock(srvman);
 	if (srvman->error) {
 		tval = ns_to_timeval(mxman->last_panic_time);
 		SCSC_TAG_ERR(MXMAN, "error: refused due to previous f/w failure scsc_panic_code=0x%x happened at [%6lu.%06ld]\n",
 				mxman->scsc_panic_code, tval.tv_sec, tval.tv_usec);
 		/* Print the last panic record to help track ancient failures */
 		mxman_show_last_panic(mxman);
-		wake_unlock(&srvman->sm_wake_lock);
+		srvman_wake_unlock(srvman);
 		mutex_unlock(&srvman->api_access_mutex);
 		*status = -EILSEQ;
 		return NULL;
@@ -569,7 +612,7 @@ struct scsc_service *scsc_mx_service_open(struct scsc_mx *mx, enum scsc_service_
 						msecs_to_jiffies(SCSC_MX_SERVICE_RECOVERY_TIMEOUT));
 		if (r == 0) {
 			SCSC_TAG_ERR(MXMAN, "Recovery timeout\n");
-			wake_unlock(&srvman->sm_wake_lock);
+			srvman_wake_unlock(srvman);
 			*status = -EIO;
 			return NULL;
 		}
@@ -583,7 +626,7 @@ struct scsc_service *scsc_mx_service_open(struct scsc_mx *mx, enum scsc_service_
 		ret = mxman_open(mxman);
 		if (ret) {
 			kfree(service);
-			wake_unlock(&srvman->sm_wake_lock);
+			srvman_wake_unlock(srvman);
 			mutex_unlock(&srvman->api_access_mutex);
 			*status = ret;
 			return NULL;
@@ -594,6 +637,7 @@ struct scsc_service *scsc_mx_service_open(struct scsc_mx *mx, enum scsc_service_
 		service->client = client;
 		init_completion(&service->sm_msg_start_completion);
 		init_completion(&service->sm_msg_stop_completion);
+		mutex_init(&service->start_mutex);
 		mutex_lock(&srvman->service_list_mutex);
 		empty = list_empty(&srvman->service_list);
 		mutex_unlock(&srvman->service_list_mutex);
@@ -606,7 +650,7 @@ struct scsc_service *scsc_mx_service_open(struct scsc_mx *mx, enum scsc_service_
 	} else
 		*status = -ENOMEM;
 
-	wake_unlock(&srvman->sm_wake_lock);
+	srvman_wake_unlock(srvman);
 	mutex_unlock(&srvman->api_access_mutex);
 
 	return service;
@@ -8,6 +8,7 @@
 #define _SRVMAN_H
 
 #include <linux/wakelock.h>
+#include <linux/spinlock.h>
 
 struct srvman;
 
@@ -27,6 +28,9 @@ struct srvman {
 	struct mutex     api_access_mutex;
 	bool             error;
 	struct wake_lock sm_wake_lock;
+	/* Requests in flight holding sm_wake_lock */
+	spinlock_t       sm_wake_lock_spinlock;
+	int              sm_wake_lock_count;
 };
 
 
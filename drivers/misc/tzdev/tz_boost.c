@@ -11,54 +11,372 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/atomic.h>
+#include <linux/cpufreq.h>
+#include <linux/cpumask.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/moduleparam.h>
 #include <linux/mutex.h>
 #include <linux/pm_qos.h>
+#include <linux/workqueue.h>
 
 #include "tz_boost.h"
 #include "tz_hotplug.h"
 
-static unsigned int tz_boost_is_active;
+/*
+ * The boost follows secure world demand. The time spent in SMC calls is
+ * sampled every period_ms; the boost level jumps up to the sampled
+ * utilization and decays towards it with time constant decay_ms. The
+ * level scales the minimum frequency request of the big cluster, and
+ * from mask_util on the normal world is also moved to the big cores.
+ *
+ * TZIO_BOOST starts a session in which the policy runs and TZIO_RELAX
+ * ends it; with auto_boost set the policy also runs outside sessions.
+ */
+#define TZ_BOOST_UTIL_SCALE	1024
+
+static unsigned int period_ms = 10;
+module_param(period_ms, uint, 0644);
+
+static unsigned int decay_ms = 40;
+module_param(decay_ms, uint, 0644);
+
+/* Levels below min_util make no frequency request */
+static unsigned int min_util = 64;
+module_param(min_util, uint, 0644);
+
+static unsigned int mask_util = 512;
+module_param(mask_util, uint, 0644);
+
+/* Frequency of a full boost in kHz, 0 for the big cluster's maximum */
+static unsigned int max_freq;
+module_param(max_freq, uint, 0644);
+
+static bool auto_boost;
+module_param(auto_boost, bool, 0644);
+
+/* Level a session starts at, before the first sample */
+static unsigned int start_util = TZ_BOOST_UTIL_SCALE;
+module_param(start_util, uint, 0644);
+
+static DEFINE_MUTEX(tz_boost_lock);
 static struct pm_qos_request tz_boost_qos;
 static unsigned int cpu_boost_mask;
-static DEFINE_MUTEX(tz_boost_lock);
+static unsigned int tz_boost_is_active;
+static unsigned int tz_boost_level;
+static unsigned int tz_boost_freq;
+static unsigned int tz_boost_mask_set;
+
+static atomic64_t tz_boost_swd_ns = ATOMIC64_INIT(0);
+static atomic_t tz_boost_sampling = ATOMIC_INIT(0);
+static u64 tz_boost_swd_last;
+static u64 tz_boost_sample_last;
+
+static u64 tz_boost_session_start;
+static struct tz_boost_stats tz_boost_stats;
+
+/* Simulated secure world load, see tz_boost_sim_set() */
+static unsigned int tz_boost_sim_util;
+static u64 tz_boost_sim_end;
+
+static void tz_boost_sample(struct work_struct *work);
+static DECLARE_DELAYED_WORK(tz_boost_work, tz_boost_sample);
+
+static bool tz_boost_policy_active(void)
+{
+	return tz_boost_is_active || READ_ONCE(auto_boost);
+}
+
+static void tz_boost_kick(void)
+{
+	if (!atomic_xchg(&tz_boost_sampling, 1)) {
+		tz_boost_sample_last = ktime_get_ns();
+		tz_boost_swd_last = atomic64_read(&tz_boost_swd_ns);
+		queue_delayed_work(system_power_efficient_wq, &tz_boost_work,
+				msecs_to_jiffies(period_ms));
+	}
+}
 
 void tz_boost_set_boost_mask(unsigned int big_cpus_mask)
 {
 	cpu_boost_mask = big_cpus_mask;
 }
 
-void tz_boost_enable(void)
+u64 tz_boost_swd_enter(void)
+{
+	return ktime_get_ns();
+}
+
+void tz_boost_swd_exit(u64 start)
+{
+	atomic64_add(ktime_get_ns() - start, &tz_boost_swd_ns);
+	smp_mb__after_atomic();
+
+	if (!atomic_read(&tz_boost_sampling) && tz_boost_policy_active())
+		tz_boost_kick();
+}
+
+static unsigned int tz_boost_full_freq(void)
+{
+	unsigned long mask = cpu_boost_mask;
+	unsigned int freq = READ_ONCE(max_freq);
+	int cpu;
+
+	if (freq)
+		return freq;
+
+	cpu = find_first_bit(&mask, BITS_PER_LONG);
+	if (cpu < nr_cpu_ids) {
+		freq = cpufreq_quick_get_max(cpu);
+		if (freq)
+			return freq;
+	}
+
+	/* Unknown cluster maximum: every request is a full boost */
+	return TZ_BOOST_CPU_FREQ_MAX_DEFAULT_VALUE;
+}
+
+/* Called with tz_boost_lock held */
+static void tz_boost_apply(unsigned int level)
+{
+	unsigned int freq = 0;
+	unsigned int mask_set;
+
+	if (level >= min_util) {
+		freq = tz_boost_full_freq();
+		if (freq != TZ_BOOST_CPU_FREQ_MAX_DEFAULT_VALUE)
+			freq = (u64)freq * level / TZ_BOOST_UTIL_SCALE;
+	}
+
+	if (freq != tz_boost_freq) {
+		if (!tz_boost_freq)
+			pm_qos_add_request(&tz_boost_qos, TZ_BOOST_CPU_FREQ_MIN, freq);
+		else if (!freq)
+			pm_qos_remove_request(&tz_boost_qos);
+		else
+			pm_qos_update_request(&tz_boost_qos, freq);
+		tz_boost_freq = freq;
+	}
+
+	mask_set = freq && level >= mask_util;
+	if (mask_set != tz_boost_mask_set) {
+		tzdev_update_nwd_cpu_mask(mask_set ? cpu_boost_mask : 0);
+		tz_boost_mask_set = mask_set;
+	}
+
+	tz_boost_level = level;
+}
+
+/* Called with tz_boost_lock held, accounts the last @elapsed ns */
+static void tz_boost_account(u64 elapsed, u64 swd)
+{
+	struct tz_boost_session *cur = &tz_boost_stats.cur;
+	unsigned int bucket;
+
+	if (!tz_boost_is_active)
+		return;
+
+	cur->swd_ns += swd;
+	if (tz_boost_freq)
+		cur->boost_ns += elapsed;
+
+	bucket = tz_boost_level * TZ_BOOST_LEVELS / (TZ_BOOST_UTIL_SCALE + 1);
+	if (bucket)
+		cur->level_ns[bucket] += elapsed;
+}
+
+/* Time constant decay of @level towards @util over @elapsed ns */
+static unsigned int tz_boost_decay(unsigned int level, unsigned int util,
+				u64 elapsed)
 {
-	tzdev_update_nwd_cpu_mask(cpu_boost_mask);
+	u64 tau = (u64)max(decay_ms, 1U) * NSEC_PER_MSEC;
+	unsigned int step;
+
+	if (util >= level)
+		return util;
+
+	step = div64_u64((u64)(level - util) * min(elapsed, tau), tau);
+
+	return step ? level - step : util;
+}
+
+static void tz_boost_sample(struct work_struct *work)
+{
+	u64 now, swd, busy, elapsed;
+	unsigned int util, level;
 
 	mutex_lock(&tz_boost_lock);
 
+	now = ktime_get_ns();
+	swd = atomic64_read(&tz_boost_swd_ns);
+	elapsed = now - tz_boost_sample_last;
+	busy = swd - tz_boost_swd_last;
+	tz_boost_sample_last = now;
+	tz_boost_swd_last = swd;
+
+	if (tz_boost_sim_util && now < tz_boost_sim_end)
+		busy += div_u64(elapsed * tz_boost_sim_util, 100);
+	else
+		tz_boost_sim_util = 0;
+
+	tz_boost_account(elapsed, busy);
+
+	util = 0;
+	if (elapsed)
+		util = min_t(u64, div64_u64(busy * TZ_BOOST_UTIL_SCALE, elapsed),
+				TZ_BOOST_UTIL_SCALE);
+
+	level = tz_boost_policy_active() ?
+		tz_boost_decay(tz_boost_level, util, elapsed) : 0;
+	tz_boost_apply(level);
+
+	if (tz_boost_policy_active() && (level || busy)) {
+		queue_delayed_work(system_power_efficient_wq, &tz_boost_work,
+				msecs_to_jiffies(period_ms));
+	} else {
+		/* Idle: stop sampling until the next SMC, unless one raced in */
+		atomic_set(&tz_boost_sampling, 0);
+		smp_mb__after_atomic();
+		if (atomic64_read(&tz_boost_swd_ns) != swd &&
+				tz_boost_policy_active())
+			tz_boost_kick();
+	}
+
+	mutex_unlock(&tz_boost_lock);
+}
+
+void tz_boost_enable(void)
+{
+	mutex_lock(&tz_boost_lock);
+
 	if (tz_boost_is_active) {
 		mutex_unlock(&tz_boost_lock);
 		return;
 	}
 
-	pm_qos_add_request(&tz_boost_qos, TZ_BOOST_CPU_FREQ_MIN,
-				TZ_BOOST_CPU_FREQ_MAX_DEFAULT_VALUE);
-
+	memset(&tz_boost_stats.cur, 0, sizeof(tz_boost_stats.cur));
+	tz_boost_session_start = ktime_get_ns();
 	tz_boost_is_active = 1;
+	tz_boost_stats.sessions++;
+	tz_boost_apply(max(tz_boost_level,
+			min(start_util, (unsigned int)TZ_BOOST_UTIL_SCALE)));
+
 	mutex_unlock(&tz_boost_lock);
+
+	tz_boost_kick();
+}
+
+/* Called with tz_boost_lock held */
+static void tz_boost_session_close(struct tz_boost_session *s, u64 now)
+{
+	unsigned int i;
+
+	s->duration_ns = now - tz_boost_session_start;
+	s->level_ns[0] = s->duration_ns;
+	for (i = 1; i < TZ_BOOST_LEVELS; i++)
+		s->level_ns[0] -= min(s->level_ns[0], s->level_ns[i]);
 }
 
 void tz_boost_disable(void)
 {
-	tzdev_update_nwd_cpu_mask(0);
+	struct tz_boost_session *cur = &tz_boost_stats.cur;
+	struct tz_boost_session *total = &tz_boost_stats.total;
+	unsigned int i;
+	u64 now;
+
+	cancel_delayed_work_sync(&tz_boost_work);
 
 	mutex_lock(&tz_boost_lock);
 
 	if (!tz_boost_is_active) {
+		atomic_set(&tz_boost_sampling, 0);
+		if (auto_boost)
+			tz_boost_kick();
+		else
+			tz_boost_apply(0);
 		mutex_unlock(&tz_boost_lock);
 		return;
 	}
 
+	now = ktime_get_ns();
+	tz_boost_account(now - tz_boost_sample_last,
+			atomic64_read(&tz_boost_swd_ns) - tz_boost_swd_last);
+	tz_boost_session_close(cur, now);
+
+	total->duration_ns += cur->duration_ns;
+	total->swd_ns += cur->swd_ns;
+	total->boost_ns += cur->boost_ns;
+	for (i = 0; i < TZ_BOOST_LEVELS; i++)
+		total->level_ns[i] += cur->level_ns[i];
+	tz_boost_stats.last = *cur;
+	memset(cur, 0, sizeof(*cur));
+
 	tz_boost_is_active = 0;
+	atomic_set(&tz_boost_sampling, 0);
 
-	pm_qos_remove_request(&tz_boost_qos);
+	if (auto_boost) {
+		tz_boost_kick();
+	} else {
+		tz_boost_sim_util = 0;
+		tz_boost_apply(0);
+	}
 
 	mutex_unlock(&tz_boost_lock);
 }
+
+int tz_boost_get_stats(struct tz_boost_stats *stats)
+{
+	mutex_lock(&tz_boost_lock);
+
+	*stats = tz_boost_stats;
+	stats->level = tz_boost_level;
+	stats->freq = tz_boost_freq;
+	if (tz_boost_is_active)
+		tz_boost_session_close(&stats->cur, ktime_get_ns());
+
+	mutex_unlock(&tz_boost_lock);
+
+	return 0;
+}
+
+/*
+ * Simulated secure world load, to exercise the policy without a secure
+ * world: writing "<util %> <duration ms>" adds that utilization to the
+ * samples for that long.
+ */
+static int tz_boost_sim_set(const char *val, const struct kernel_param *kp)
+{
+	unsigned int util, duration;
+
+	if (sscanf(val, "%u %u", &util, &duration) != 2 || util > 100)
+		return -EINVAL;
+
+	mutex_lock(&tz_boost_lock);
+	tz_boost_sim_util = util;
+	tz_boost_sim_end = ktime_get_ns() + (u64)duration * NSEC_PER_MSEC;
+	mutex_unlock(&tz_boost_lock);
+
+	if (util && tz_boost_policy_active())
+		tz_boost_kick();
+
+	return 0;
+}
+
+static int tz_boost_sim_get(char *buffer, const struct kernel_param *kp)
+{
+	int ret;
+
+	mutex_lock(&tz_boost_lock);
+	ret = sprintf(buffer, "util %u level %u freq %u\n", tz_boost_sim_util,
+			tz_boost_level, tz_boost_freq);
+	mutex_unlock(&tz_boost_lock);
+
+	return ret;
+}
+
+static const struct kernel_param_ops tz_boost_sim_ops = {
+	.set = tz_boost_sim_set,
+	.get = tz_boost_sim_get,
+};
+module_param_cb(sim_load, &tz_boost_sim_ops, NULL, 0644);
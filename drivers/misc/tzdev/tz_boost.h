@@ -16,11 +16,34 @@
 
 #include <linux/errno.h>
 #include <linux/pm_qos.h>
+#include <linux/types.h>
+
+#define TZ_BOOST_LEVELS		4
+
+/* Boost session: from TZIO_BOOST to TZIO_RELAX */
+struct tz_boost_session {
+	uint64_t duration_ns;
+	uint64_t swd_ns;			/* time spent in the secure world */
+	uint64_t boost_ns;			/* time with a frequency request */
+	uint64_t level_ns[TZ_BOOST_LEVELS];	/* time per quarter of boost level */
+};
+
+struct tz_boost_stats {
+	uint32_t level;				/* current level, out of 1024 */
+	uint32_t freq;				/* current frequency request, kHz */
+	uint64_t sessions;
+	struct tz_boost_session cur;
+	struct tz_boost_session last;
+	struct tz_boost_session total;
+};
 
 #ifdef CONFIG_TZDEV_BOOST
 void tz_boost_enable(void);
 void tz_boost_disable(void);
 void tz_boost_set_boost_mask(unsigned int big_cpus_mask);
+u64 tz_boost_swd_enter(void);
+void tz_boost_swd_exit(u64 start);
+int tz_boost_get_stats(struct tz_boost_stats *stats);
 #else
 static inline void tz_boost_enable(void)
 {
@@ -34,6 +57,20 @@ static void tz_boost_set_boost_mask(unsigned int big_cpus_mask)
 {
 	(void) big_cpus_mask;
 }
+
+static inline u64 tz_boost_swd_enter(void)
+{
+	return 0;
+}
+
+static inline void tz_boost_swd_exit(u64 start)
+{
+}
+
+static inline int tz_boost_get_stats(struct tz_boost_stats *stats)
+{
+	return -ENOSYS;
+}
 #endif /* CONFIG_TZDEV_BOOST */
 
 /* cluster 1 is a high performance cluster for all current exynos platforms */
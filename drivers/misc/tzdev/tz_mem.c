@@ -11,13 +11,20 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/debugfs.h>
 #include <linux/delay.h>
+#include <linux/kref.h>
 #include <linux/list.h>
 #include <linux/migrate.h>
+#include <linux/mmu_notifier.h>
 #include <linux/mmzone.h>
+#include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
 #include <linux/spinlock.h>
+#include <linux/workqueue.h>
 
 #include "sysdep.h"
 #include "tzdev.h"
@@ -33,9 +40,54 @@
 #define TZDEV_IWSHMEM_REG_FLAG_WRITE	(1 << 0)
 #define TZDEV_IWSHMEM_REG_FLAG_KERNEL	(1 << 1)
 
+/*
+ * User memory registrations are cached per address space. Releasing a
+ * registration only drops a reference to it: the SWd keeps the memory
+ * registered, and registering the same range again hands out the same id
+ * without pinning pages or an SMC. Idle registrations are released from
+ * the SWd lazily, by tzdev_mem_release_work, once they are evicted from
+ * the cache or the range they map is invalidated by the mm.
+ */
+struct tzdev_mem_ctx {
+	struct list_head link;		/* tzdev_mem_ctx_list */
+	struct mm_struct *mm;
+	struct mmu_notifier mn;
+	struct kref kref;		/* the list and every registration */
+	struct rcu_head rcu;
+
+	spinlock_t lock;		/* protects everything below */
+	struct list_head cache;		/* valid registrations, LRU first */
+	struct list_head stale;		/* idle, waiting for SWd release */
+	unsigned long nr_idle_pages;
+	unsigned int nr_regs;
+	unsigned long seq;		/* bumped on every invalidation */
+	bool dead;
+	pid_t tgid;
+
+	u64 hits;
+	u64 misses;
+	u64 invalidated;
+	u64 evicted;
+};
+
+/* Idle pages each address space keeps registered, 0 disables the cache */
+static unsigned int cache_max_pages = 256;
+module_param(cache_max_pages, uint, 0644);
+
 static void *tzdev_mem_release_buf;
 static DEFINE_IDR(tzdev_mem_map);
-static DEFINE_MUTEX(tzdev_mem_mutex);
+/* Protects tzdev_mem_map only */
+static DEFINE_MUTEX(tzdev_mem_map_mutex);
+/* Serializes SWd releases and the release buffer */
+static DEFINE_MUTEX(tzdev_mem_release_mutex);
+
+static LIST_HEAD(tzdev_mem_ctx_list);
+static DEFINE_SPINLOCK(tzdev_mem_ctx_lock);
+
+static struct dentry *tzdev_mem_debugfs;
+
+static void tzdev_mem_release_work_fn(struct work_struct *work);
+static DECLARE_WORK(tzdev_mem_release_work, tzdev_mem_release_work_fn);
 
 int isolate_lru_page(struct page *page);
 
@@ -138,22 +190,200 @@ static void tzdev_decrease_pinned_vm(struct mm_struct *mm, unsigned long nr_page
 	up_write(&mm->mmap_sem);
 }
 
-static void tzdev_mem_free(int id, struct tzdev_mem_reg *mem, unsigned int is_user)
+static void tzdev_mem_ctx_free(struct rcu_head *rcu)
+{
+	kfree(container_of(rcu, struct tzdev_mem_ctx, rcu));
+}
+
+static void tzdev_mem_ctx_destroy(struct kref *kref)
+{
+	struct tzdev_mem_ctx *ctx = container_of(kref, struct tzdev_mem_ctx, kref);
+
+	/* Notifier methods may still run until the SRCU grace period ends */
+	mmu_notifier_unregister_no_release(&ctx->mn, ctx->mm);
+	mmu_notifier_call_srcu(&ctx->rcu, tzdev_mem_ctx_free);
+}
+
+/* Called with ctx->lock held, moves idle registrations out of the cache
+ * until at most @limit idle pages are left. Returns true if it did. */
+static bool tzdev_mem_ctx_trim(struct tzdev_mem_ctx *ctx, unsigned long limit)
+{
+	struct tzdev_mem_reg *mem, *tmp;
+	bool evicted = false;
+
+	list_for_each_entry_safe(mem, tmp, &ctx->cache, link) {
+		if (ctx->nr_idle_pages <= limit)
+			break;
+		if (mem->users)
+			continue;
+
+		mem->stale = true;
+		ctx->nr_idle_pages -= mem->nr_pages;
+		list_move_tail(&mem->link, &ctx->stale);
+		ctx->evicted++;
+		evicted = true;
+	}
+
+	return evicted;
+}
+
+/* Called with ctx->lock held */
+static bool tzdev_mem_ctx_invalidate(struct tzdev_mem_ctx *ctx,
+		unsigned long start, unsigned long end)
 {
+	struct tzdev_mem_reg *mem, *tmp;
+	bool queued = false;
+
+	ctx->seq++;
+
+	list_for_each_entry_safe(mem, tmp, &ctx->cache, link) {
+		if (mem->start >= end || mem->start + mem->size <= start)
+			continue;
+
+		/* Registrations in use keep their pages until released */
+		mem->stale = true;
+		ctx->invalidated++;
+		if (mem->users) {
+			list_del_init(&mem->link);
+		} else {
+			ctx->nr_idle_pages -= mem->nr_pages;
+			list_move_tail(&mem->link, &ctx->stale);
+			queued = true;
+		}
+	}
+
+	return queued;
+}
+
+static void tzdev_mem_mn_invalidate_range_start(struct mmu_notifier *mn,
+		struct mm_struct *mm, unsigned long start, unsigned long end)
+{
+	struct tzdev_mem_ctx *ctx = container_of(mn, struct tzdev_mem_ctx, mn);
+	bool queued;
+
+	/* mmap_sem may be held here, the SWd release is left to the work */
+	spin_lock(&ctx->lock);
+	queued = tzdev_mem_ctx_invalidate(ctx, start, end);
+	spin_unlock(&ctx->lock);
+
+	if (queued)
+		schedule_work(&tzdev_mem_release_work);
+}
+
+static void tzdev_mem_mn_invalidate_page(struct mmu_notifier *mn,
+		struct mm_struct *mm, unsigned long address)
+{
+	tzdev_mem_mn_invalidate_range_start(mn, mm, address, address + PAGE_SIZE);
+}
+
+static void tzdev_mem_mn_release(struct mmu_notifier *mn, struct mm_struct *mm)
+{
+	struct tzdev_mem_ctx *ctx = container_of(mn, struct tzdev_mem_ctx, mn);
+
+	spin_lock(&ctx->lock);
+	ctx->dead = true;
+	tzdev_mem_ctx_invalidate(ctx, 0, ULONG_MAX);
+	spin_unlock(&ctx->lock);
+
+	/* The work also drops the list reference of the dead context */
+	schedule_work(&tzdev_mem_release_work);
+}
+
+static const struct mmu_notifier_ops tzdev_mem_mn_ops = {
+	.release		= tzdev_mem_mn_release,
+	.invalidate_page	= tzdev_mem_mn_invalidate_page,
+	.invalidate_range_start	= tzdev_mem_mn_invalidate_range_start,
+};
+
+/* Called with tzdev_mem_ctx_lock held */
+static struct tzdev_mem_ctx *__tzdev_mem_ctx_find(struct mm_struct *mm)
+{
+	struct tzdev_mem_ctx *ctx;
+
+	list_for_each_entry(ctx, &tzdev_mem_ctx_list, link) {
+		if (ctx->mm == mm && !READ_ONCE(ctx->dead)) {
+			kref_get(&ctx->kref);
+			return ctx;
+		}
+	}
+
+	return NULL;
+}
+
+static struct tzdev_mem_ctx *tzdev_mem_ctx_get(struct task_struct *task,
+		struct mm_struct *mm)
+{
+	struct tzdev_mem_ctx *ctx, *new;
+	int ret;
+
+	spin_lock(&tzdev_mem_ctx_lock);
+	ctx = __tzdev_mem_ctx_find(mm);
+	spin_unlock(&tzdev_mem_ctx_lock);
+	if (ctx)
+		return ctx;
+
+	new = kzalloc(sizeof(struct tzdev_mem_ctx), GFP_KERNEL);
+	if (!new)
+		return ERR_PTR(-ENOMEM);
+
+	new->mm = mm;
+	new->mn.ops = &tzdev_mem_mn_ops;
+	new->tgid = task_tgid_nr(task);
+	kref_init(&new->kref);
+	spin_lock_init(&new->lock);
+	INIT_LIST_HEAD(&new->cache);
+	INIT_LIST_HEAD(&new->stale);
+
+	ret = mmu_notifier_register(&new->mn, mm);
+	if (ret) {
+		kfree(new);
+		return ERR_PTR(ret);
+	}
+
+	spin_lock(&tzdev_mem_ctx_lock);
+	ctx = __tzdev_mem_ctx_find(mm);
+	if (!ctx) {
+		list_add_tail(&new->link, &tzdev_mem_ctx_list);
+		kref_get(&new->kref);
+		ctx = new;
+		new = NULL;
+	}
+	spin_unlock(&tzdev_mem_ctx_lock);
+
+	/* Lost the race with another registration */
+	if (new)
+		kref_put(&new->kref, tzdev_mem_ctx_destroy);
+
+	return ctx;
+}
+
+static void tzdev_mem_ctx_put(struct tzdev_mem_ctx *ctx)
+{
+	kref_put(&ctx->kref, tzdev_mem_ctx_destroy);
+}
+
+static void tzdev_mem_free(struct tzdev_mem_reg *mem)
+{
+	struct tzdev_mem_ctx *ctx = mem->ctx;
 	struct task_struct *task;
 	struct mm_struct *mm;
+	bool unlist;
 
 	if (!mem->pid) {
-		if (!is_user) {
-			idr_remove(&tzdev_mem_map, id);
-			kfree(mem);
-		}
-
 		/* Nothing to do for kernel memory */
+		kfree(mem);
 		return;
 	}
 
-	idr_remove(&tzdev_mem_map, id);
+	spin_lock(&ctx->lock);
+	if (!mem->stale && !mem->users)
+		ctx->nr_idle_pages -= mem->nr_pages;
+	list_del_init(&mem->link);
+	unlist = !--ctx->nr_regs && ctx->dead;
+	spin_unlock(&ctx->lock);
+
+	if (unlist)
+		schedule_work(&tzdev_mem_release_work);
 
 	tzdev_put_user_pages(mem->pages, mem->nr_pages);
 
@@ -171,10 +401,25 @@ static void tzdev_mem_free(int id, struct tzdev_mem_reg *mem, unsigned int is_us
 	mmput(mm);
 
 out:
+	tzdev_mem_ctx_put(ctx);
 	kfree(mem->pages);
 	kfree(mem);
 }
 
+/* Removes @id from the map, the caller owns the registration then */
+static struct tzdev_mem_reg *tzdev_mem_claim(int id)
+{
+	struct tzdev_mem_reg *mem;
+
+	mutex_lock(&tzdev_mem_map_mutex);
+	mem = idr_find(&tzdev_mem_map, id);
+	if (mem)
+		idr_remove(&tzdev_mem_map, id);
+	mutex_unlock(&tzdev_mem_map_mutex);
+
+	return mem;
+}
+
 static void tzdev_mem_list_release(unsigned char *buf, unsigned int cnt)
 {
 	uint32_t *ids;
@@ -183,45 +428,43 @@ static void tzdev_mem_list_release(unsigned char *buf, unsigned int cnt)
 
 	ids = (uint32_t *)buf;
 	for (i = 0; i < cnt; i++) {
-		mem = idr_find(&tzdev_mem_map, ids[i]);
+		mem = tzdev_mem_claim(ids[i]);
 		BUG_ON(!mem);
-		tzdev_mem_free(ids[i], mem, 0);
+		tzdev_mem_free(mem);
 	}
 }
 
 static void _tzdev_mem_release_all(unsigned int is_user)
 {
 	struct tzdev_mem_reg *mem;
-	unsigned int id;
+	int id = 0;
+
+	mutex_lock(&tzdev_mem_release_mutex);
+	do {
+		mutex_lock(&tzdev_mem_map_mutex);
+		while ((mem = idr_get_next(&tzdev_mem_map, &id)) != NULL) {
+			if (!is_user || mem->pid) {
+				idr_remove(&tzdev_mem_map, id);
+				break;
+			}
+			id++;
+		}
+		mutex_unlock(&tzdev_mem_map_mutex);
 
-	mutex_lock(&tzdev_mem_mutex);
-	idr_for_each_entry(&tzdev_mem_map, mem, id)
-		tzdev_mem_free(id, mem, is_user);
-	mutex_unlock(&tzdev_mem_mutex);
+		if (mem)
+			tzdev_mem_free(mem);
+	} while (mem);
+	mutex_unlock(&tzdev_mem_release_mutex);
 
 	if (!is_user)
 		idr_destroy(&tzdev_mem_map);
 }
 
-static int _tzdev_mem_release(int id, unsigned int is_user)
+/* Called with tzdev_mem_release_mutex held */
+static int tzdev_mem_release_swd(int id)
 {
-	struct tzdev_mem_reg *mem;
 	struct tz_iwio_aux_channel *ch;
 	long cnt;
-	int ret = 0;
-
-	mutex_lock(&tzdev_mem_mutex);
-
-	mem = idr_find(&tzdev_mem_map, id);
-	if (!mem) {
-		ret = -ENOENT;
-		goto out;
-	}
-
-	if (is_user != !!mem->pid) {
-		ret = -EPERM;
-		goto out;
-	}
 
 	ch = tz_iwio_get_aux_channel();
 	cnt = tzdev_smc_shmem_list_rls(id);
@@ -232,13 +475,106 @@ static int _tzdev_mem_release(int id, unsigned int is_user)
 		tz_iwio_put_aux_channel();
 
 		tzdev_mem_list_release(tzdev_mem_release_buf, cnt);
-	} else {
-		ret = cnt;
-		tz_iwio_put_aux_channel();
+		return 0;
 	}
 
-out:
-	mutex_unlock(&tzdev_mem_mutex);
+	tz_iwio_put_aux_channel();
+
+	return cnt;
+}
+
+static void tzdev_mem_release_work_fn(struct work_struct *work)
+{
+	struct tzdev_mem_ctx *ctx, *ctx_tmp;
+	struct tzdev_mem_reg *mem, *tmp;
+	LIST_HEAD(stale);
+	LIST_HEAD(dead);
+	int id, ret;
+
+	mutex_lock(&tzdev_mem_release_mutex);
+
+	spin_lock(&tzdev_mem_ctx_lock);
+	list_for_each_entry_safe(ctx, ctx_tmp, &tzdev_mem_ctx_list, link) {
+		spin_lock(&ctx->lock);
+		list_splice_tail_init(&ctx->stale, &stale);
+		/* Released registrations of a dead context may still be
+		 * queued, it stays listed until all of them are freed */
+		if (ctx->dead && !ctx->nr_regs)
+			list_move_tail(&ctx->link, &dead);
+		spin_unlock(&ctx->lock);
+	}
+	spin_unlock(&tzdev_mem_ctx_lock);
+
+	list_for_each_entry_safe(mem, tmp, &stale, link) {
+		/* mem may be freed by its own release */
+		list_del_init(&mem->link);
+		id = mem->id;
+
+		ret = tzdev_mem_release_swd(id);
+		if (ret)
+			tzdev_print(0, "Failed to release shmem %d (%d)\n", id, ret);
+	}
+
+	mutex_unlock(&tzdev_mem_release_mutex);
+
+	list_for_each_entry_safe(ctx, ctx_tmp, &dead, link) {
+		list_del(&ctx->link);
+		tzdev_mem_ctx_put(ctx);
+	}
+}
+
+static int _tzdev_mem_release(int id, unsigned int is_user)
+{
+	struct tzdev_mem_reg *mem;
+	struct tzdev_mem_ctx *ctx;
+	bool queued = false;
+	int ret = 0;
+
+	if (is_user) {
+		mutex_lock(&tzdev_mem_map_mutex);
+		mem = idr_find(&tzdev_mem_map, id);
+		if (!mem || !mem->pid) {
+			mutex_unlock(&tzdev_mem_map_mutex);
+			return mem ? -EPERM : -ENOENT;
+		}
+
+		ctx = mem->ctx;
+		spin_lock(&ctx->lock);
+		if (!mem->users) {
+			ret = -ENOENT;
+		} else if (!--mem->users) {
+			if (mem->stale) {
+				list_add_tail(&mem->link, &ctx->stale);
+				queued = true;
+			} else {
+				ctx->nr_idle_pages += mem->nr_pages;
+				queued = tzdev_mem_ctx_trim(ctx,
+						READ_ONCE(cache_max_pages));
+			}
+		}
+		spin_unlock(&ctx->lock);
+		mutex_unlock(&tzdev_mem_map_mutex);
+
+		if (queued)
+			schedule_work(&tzdev_mem_release_work);
+
+		return ret;
+	}
+
+	mutex_lock(&tzdev_mem_release_mutex);
+
+	mutex_lock(&tzdev_mem_map_mutex);
+	mem = idr_find(&tzdev_mem_map, id);
+	if (!mem)
+		ret = -ENOENT;
+	else if (mem->pid)
+		ret = -EPERM;
+	mutex_unlock(&tzdev_mem_map_mutex);
+
+	if (!ret)
+		ret = tzdev_mem_release_swd(id);
+
+	mutex_unlock(&tzdev_mem_release_mutex);
 
 	return ret;
 }
@@ -247,30 +583,37 @@ static int _tzdev_mem_register(struct tzdev_mem_reg *mem, sk_pfn_t *pfns,
 		unsigned long nr_pages, unsigned int flags)
 {
 	struct tz_iwio_aux_channel *ch;
-	int i, id;
+	int i, id, ret = 0;
 
-	mutex_lock(&tzdev_mem_mutex);
-	id = sysdep_idr_alloc(&tzdev_mem_map, mem);
+	/* Reserve the id, it is looked up only once the SWd knows it */
+	mutex_lock(&tzdev_mem_map_mutex);
+	id = sysdep_idr_alloc(&tzdev_mem_map, NULL);
+	mutex_unlock(&tzdev_mem_map_mutex);
 	if (id < 0)
-		goto out;
+		return id;
 
 	ch = tz_iwio_get_aux_channel();
 
 	for (i = 0; i < nr_pages; i += TZDEV_PFNS_PER_PAGE) {
 		memcpy(ch->buffer, &pfns[i], min(nr_pages - i, TZDEV_PFNS_PER_PAGE) * sizeof(sk_pfn_t));
 		if (tzdev_smc_shmem_list_reg(id, nr_pages, flags)) {
-			idr_remove(&tzdev_mem_map, id);
-			id = -EFAULT;
+			ret = -EFAULT;
 			break;
 		}
 	}
 
 	tz_iwio_put_aux_channel();
 
-out:
-	mutex_unlock(&tzdev_mem_mutex);
+	mem->id = id;
 
-	return id;
+	mutex_lock(&tzdev_mem_map_mutex);
+	if (ret)
+		idr_remove(&tzdev_mem_map, id);
+	else
+		idr_replace(&tzdev_mem_map, mem, id);
+	mutex_unlock(&tzdev_mem_map_mutex);
+
+	return ret ? ret : id;
 }
 
 #if defined(CONFIG_TZDEV_PAGE_MIGRATION)
@@ -457,6 +800,43 @@ static int tzdev_migrate_pages(struct task_struct *task, struct mm_struct *mm,
 }
 #endif /* CONFIG_TZDEV_PAGE_MIGRATION */
 
+static int tzdev_mem_cache_show(struct seq_file *m, void *v)
+{
+	struct tzdev_mem_ctx *ctx;
+	struct tzdev_mem_reg *mem;
+
+	spin_lock(&tzdev_mem_ctx_lock);
+	list_for_each_entry(ctx, &tzdev_mem_ctx_list, link) {
+		spin_lock(&ctx->lock);
+		seq_printf(m, "tgid %d%s: hits %llu misses %llu invalidated %llu evicted %llu idle pages %lu\n",
+				ctx->tgid, ctx->dead ? " (dead)" : "",
+				ctx->hits, ctx->misses, ctx->invalidated,
+				ctx->evicted, ctx->nr_idle_pages);
+		list_for_each_entry(mem, &ctx->cache, link)
+			seq_printf(m, "\tid %d start 0x%lx size %lu %s users %u hits %llu\n",
+					mem->id, mem->start, mem->size,
+					mem->write ? "rw" : "ro", mem->users,
+					mem->hits);
+		spin_unlock(&ctx->lock);
+	}
+	spin_unlock(&tzdev_mem_ctx_lock);
+
+	return 0;
+}
+
+static int tzdev_mem_cache_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tzdev_mem_cache_show, NULL);
+}
+
+static const struct file_operations tzdev_mem_cache_fops = {
+	.owner		= THIS_MODULE,
+	.open		= tzdev_mem_cache_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 int tzdev_mem_init(void)
 {
 	struct page *page;
@@ -469,27 +849,75 @@ int tzdev_mem_init(void)
 
 	tzdev_print(0, "AUX channels mem release buffer allocated\n");
 
+	/* Statistics only, not fatal */
+	tzdev_mem_debugfs = debugfs_create_file("tzdev_mem_cache", S_IRUSR,
+			NULL, NULL, &tzdev_mem_cache_fops);
+
 	return 0;
 }
 
 void tzdev_mem_fini(void)
 {
+	struct tzdev_mem_ctx *ctx, *tmp;
+	LIST_HEAD(ctxs);
+
+	debugfs_remove(tzdev_mem_debugfs);
+
 	_tzdev_mem_release_all(0);
+	flush_work(&tzdev_mem_release_work);
+
+	spin_lock(&tzdev_mem_ctx_lock);
+	list_splice_init(&tzdev_mem_ctx_list, &ctxs);
+	spin_unlock(&tzdev_mem_ctx_lock);
+
+	list_for_each_entry_safe(ctx, tmp, &ctxs, link) {
+		list_del(&ctx->link);
+		tzdev_mem_ctx_put(ctx);
+	}
+	mmu_notifier_synchronize();
+
 	__free_page(virt_to_page(tzdev_mem_release_buf));
 }
 
+/* Hands out a cached registration of the range, if there is one */
+static int tzdev_mem_cache_lookup(struct tzdev_mem_ctx *ctx,
+		unsigned long start, unsigned long size, unsigned int write)
+{
+	struct tzdev_mem_reg *mem;
+	int id = -ENOENT;
+
+	spin_lock(&ctx->lock);
+	list_for_each_entry(mem, &ctx->cache, link) {
+		if (mem->start != start || mem->size != size || mem->write != write)
+			continue;
+
+		if (!mem->users++)
+			ctx->nr_idle_pages -= mem->nr_pages;
+		mem->hits++;
+		ctx->hits++;
+		list_move_tail(&mem->link, &ctx->cache);
+		id = mem->id;
+		break;
+	}
+	spin_unlock(&ctx->lock);
+
+	return id;
+}
+
 int tzdev_mem_register_user(struct tzio_mem_register *s)
 {
 	struct pid *pid;
 	struct task_struct *task;
 	struct mm_struct *mm;
+	struct tzdev_mem_ctx *ctx;
 	struct page **pages;
 	struct tzdev_mem_reg *mem;
 	sk_pfn_t *pfns;
-	unsigned long start, end;
+	unsigned long start, end, seq;
 	unsigned long nr_pages = 0;
 	int ret, res, i, id;
 	unsigned int flags = 0;
+	bool retried = false, trimmed;
 
 	if (s->size) {
 		if (!access_ok(s->write ? VERIFY_WRITE : VERIFY_READ, s->ptr, s->size))
@@ -522,10 +950,23 @@ int tzdev_mem_register_user(struct tzio_mem_register *s)
 		goto out_task;
 	}
 
+	ctx = tzdev_mem_ctx_get(task, mm);
+	if (IS_ERR(ctx)) {
+		ret = PTR_ERR(ctx);
+		goto out_mm;
+	}
+
+	id = tzdev_mem_cache_lookup(ctx, (unsigned long)s->ptr, s->size, s->write);
+	if (id >= 0) {
+		s->id = id;
+		ret = 0;
+		goto out_ctx;
+	}
+
 	pages = kcalloc(nr_pages, sizeof(struct page *), GFP_KERNEL);
 	if (!pages) {
 		ret = -ENOMEM;
-		goto out_mm;
+		goto out_ctx;
 	}
 
 	pfns = kmalloc(nr_pages * sizeof(sk_pfn_t), GFP_KERNEL);
@@ -534,7 +975,7 @@ int tzdev_mem_register_user(struct tzio_mem_register *s)
 		goto out_pages;
 	}
 
-	mem = kmalloc(sizeof(struct tzdev_mem_reg), GFP_KERNEL);
+	mem = kzalloc(sizeof(struct tzdev_mem_reg), GFP_KERNEL);
 	if (!mem) {
 		ret = -ENOMEM;
 		goto out_pfns;
@@ -543,9 +984,33 @@ int tzdev_mem_register_user(struct tzio_mem_register *s)
 	mem->pid = pid;
 	mem->nr_pages = nr_pages;
 	mem->pages = pages;
-
+	mem->ctx = ctx;
+	INIT_LIST_HEAD(&mem->link);
+	mem->start = (unsigned long)s->ptr;
+	mem->size = s->size;
+	mem->write = s->write;
+	mem->users = 1;
+
+	/* Invalidations from here on make the pinned pages unfit for caching */
+	spin_lock(&ctx->lock);
+	seq = ctx->seq;
+	spin_unlock(&ctx->lock);
+
+retry:
 	res = tzdev_get_user_pages(task, mm, (unsigned long)s->ptr,
 			nr_pages, 1, !s->write, pages, NULL);
+	if (res == -ENOMEM && !retried) {
+		/* Idle cached registrations count against RLIMIT_MEMLOCK */
+		retried = true;
+		spin_lock(&ctx->lock);
+		trimmed = tzdev_mem_ctx_trim(ctx, 0);
+		spin_unlock(&ctx->lock);
+		if (trimmed) {
+			schedule_work(&tzdev_mem_release_work);
+			flush_work(&tzdev_mem_release_work);
+			goto retry;
+		}
+	}
 	if (res) {
 		tzdev_print(0, "Failed to pin user pages (%d)\n", res);
 		ret = res;
@@ -571,12 +1036,31 @@ int tzdev_mem_register_user(struct tzio_mem_register *s)
 	for (i = 0; i < nr_pages; i++)
 		pfns[i] = page_to_pfn(pages[i]);
 
+	spin_lock(&ctx->lock);
+	ctx->nr_regs++;
+	spin_unlock(&ctx->lock);
+
 	id = _tzdev_mem_register(mem, pfns, nr_pages, flags);
 	if (id < 0) {
+		spin_lock(&ctx->lock);
+		ctx->nr_regs--;
+		spin_unlock(&ctx->lock);
 		ret = id;
 		goto out_pin;
 	}
 
+	/*
+	 * Pinning may itself break COW and invalidate the range, such a
+	 * registration is not cached and is released on its last release.
+	 */
+	spin_lock(&ctx->lock);
+	ctx->misses++;
+	if (ctx->seq != seq || !READ_ONCE(cache_max_pages))
+		mem->stale = true;
+	else
+		list_add_tail(&mem->link, &ctx->cache);
+	spin_unlock(&ctx->lock);
+
 	s->id = id;
 
 	kfree(pfns);
@@ -595,6 +1079,8 @@ out_pfns:
 	kfree(pfns);
 out_pages:
 	kfree(pages);
+out_ctx:
+	tzdev_mem_ctx_put(ctx);
 out_mm:
 	mmput(mm);
 out_task:
@@ -631,7 +1117,7 @@ int tzdev_mem_register(void *ptr, unsigned long size, unsigned int write)
 	if (!pfns)
 		return -ENOMEM;
 
-	mem = kmalloc(sizeof(struct tzdev_mem_reg), GFP_KERNEL);
+	mem = kzalloc(sizeof(struct tzdev_mem_reg), GFP_KERNEL);
 	if (!mem) {
 		ret = -ENOMEM;
 		goto out_pfns;
@@ -682,7 +1168,7 @@ int tzdev_mem_pages_register(struct page **pages, unsigned int nr_pages, unsigne
 	if (!pfns)
 		return -ENOMEM;
 
-	mem = kmalloc(sizeof(struct tzdev_mem_reg), GFP_KERNEL);
+	mem = kzalloc(sizeof(struct tzdev_mem_reg), GFP_KERNEL);
 	if (!mem) {
 		ret = -ENOMEM;
 		goto out_pfns;
@@ -737,15 +1223,15 @@ int tzdev_is_mem_exist(unsigned int id, unsigned int *is_user)
 {
 	struct tzdev_mem_reg *mem;
 
-	mutex_lock(&tzdev_mem_mutex);
+	mutex_lock(&tzdev_mem_map_mutex);
 	mem = idr_find(&tzdev_mem_map, id);
 	if (!mem) {
-		mutex_unlock(&tzdev_mem_mutex);
+		mutex_unlock(&tzdev_mem_map_mutex);
 		return 0;
 	}
 
 	*is_user = !!mem->pid;
-	mutex_unlock(&tzdev_mem_mutex);
+	mutex_unlock(&tzdev_mem_map_mutex);
 
 	return 1;
 }
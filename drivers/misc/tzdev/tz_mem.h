@@ -19,10 +19,23 @@
 
 #include "tz_common.h"
 
+struct tzdev_mem_ctx;
+
 struct tzdev_mem_reg {
 	struct pid *pid;
 	unsigned long nr_pages;
 	struct page **pages;
+	int id;
+
+	/* User memory only, see the registration cache in tz_mem.c */
+	struct tzdev_mem_ctx *ctx;
+	struct list_head link;
+	unsigned long start;
+	unsigned long size;
+	unsigned int write;
+	unsigned int users;
+	bool stale;
+	u64 hits;
 };
 
 int tzdev_mem_init(void);
@@ -102,6 +102,7 @@ int __tzdev_smc_cmd(struct tzio_smc_data *data,
 		unsigned int swd_ctx_present)
 {
 	int ret;
+	u64 swd_start;
 
 #ifdef TZIO_DEBUG
 	printk(KERN_ERR "tzdev_smc_cmd: args[0]=0x%lx, args[1]=0x%lx, args[2]=0x%lx, args[3]=0x%lx\n",
@@ -110,7 +111,9 @@ int __tzdev_smc_cmd(struct tzio_smc_data *data,
 	tzprofiler_enter_sw();
 	tz_iwlog_schedule_delayed_work();
 
+	swd_start = tz_boost_swd_enter();
 	ret = tzdev_platform_smc_call(data);
+	tz_boost_swd_exit(swd_start);
 
 	tz_iwlog_cancel_delayed_work();
 
@@ -407,6 +407,7 @@ static long tzprofiler_unlocked_ioctl(struct file *file, unsigned int cmd, unsig
 	int ret;
 	uint64_t addr;
 	struct tz_uuid uuid;
+	struct tz_boost_stats boost_stats;
 
 	switch (cmd) {
 	case TZPROFILER_INCREASE_POOL:
@@ -442,6 +443,14 @@ static long tzprofiler_unlocked_ioctl(struct file *file, unsigned int cmd, unsig
 	case TZPROFILER_SET_STEPS_NUMBER:
 		ret = tzprofiler_set_steps_number(arg);
 		break;
+	case TZPROFILER_GET_BOOST_STATS:
+		ret = tz_boost_get_stats(&boost_stats);
+		if (ret)
+			break;
+
+		if (copy_to_user((void *)arg, &boost_stats, sizeof(struct tz_boost_stats)))
+			return -EFAULT;
+		break;
 	default:
 		ret = -ENOTTY;
 		tzdev_print(0, "Unexpected command %d\n", cmd);
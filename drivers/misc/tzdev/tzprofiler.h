@@ -15,6 +15,7 @@
 #define _TZPROFILER_H_
 
 #include "tzdev.h"
+#include "tz_boost.h"
 #include "tz_iwcbuf.h"
 
 #define TZPROFILER_NAME			"tzprofiler"
@@ -35,6 +36,7 @@ struct profiler_buf_entry {
 #define TZPROFILER_SET_START_ADDR	_IOW(TZPROFILER_IOC_MAGIC, 5, uint64_t)
 #define TZPROFILER_SET_STOP_ADDR	_IOW(TZPROFILER_IOC_MAGIC, 6, uint64_t)
 #define TZPROFILER_SET_STEPS_NUMBER	_IOW(TZPROFILER_IOC_MAGIC, 7, uint32_t)
+#define TZPROFILER_GET_BOOST_STATS	_IOR(TZPROFILER_IOC_MAGIC, 8, struct tz_boost_stats)
 
 #if defined(CONFIG_TZPROFILER)
 int tzprofiler_initialize(void);
@@ -15,7 +15,9 @@
 
 #include <linux/atomic.h>
 #include <linux/cpufreq_times.h>
+#include <linux/cred.h>
 #include <linux/err.h>
+#include <linux/export.h>
 #include <linux/hashtable.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
@@ -28,6 +30,7 @@
 #include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
+#include <linux/uid_sys_stats.h>
 
 
 #define UID_HASH_BITS	10
@@ -66,10 +69,8 @@ struct task_entry {
 
 struct uid_entry {
 	uid_t uid;
-	cputime_t utime;
-	cputime_t stime;
-	cputime_t active_utime;
-	cputime_t active_stime;
+	struct user_struct *user;
+	struct prev_cputime prev_cputime;
 	int state;
 	struct io_stats io[UID_STATE_SIZE];
 	struct hlist_node hash;
@@ -78,14 +79,6 @@ struct uid_entry {
 #endif
 };
 
-static u64 compute_write_bytes(struct task_struct *task)
-{
-	if (task->ioac.write_bytes <= task->ioac.cancelled_write_bytes)
-		return 0;
-
-	return task->ioac.write_bytes - task->ioac.cancelled_write_bytes;
-}
-
 static void compute_io_bucket_stats(struct io_stats *io_bucket,
 					struct io_stats *io_curr,
 					struct io_stats *io_last,
@@ -120,6 +113,14 @@ static void compute_io_bucket_stats(struct io_stats *io_bucket,
 }
 
 #ifdef CONFIG_UID_SYS_STATS_DEBUG
+static u64 compute_write_bytes(struct task_struct *task)
+{
+	if (task->ioac.write_bytes <= task->ioac.cancelled_write_bytes)
+		return 0;
+
+	return task->ioac.write_bytes - task->ioac.cancelled_write_bytes;
+}
+
 static void get_full_task_comm(struct task_entry *task_entry,
 		struct task_struct *task)
 {
@@ -288,14 +289,51 @@ static void show_io_uid_tasks(struct seq_file *m, struct uid_entry *uid_entry)
 				task_entry->io[UID_STATE_BACKGROUND].fsync);
 	}
 }
+
+static struct uid_entry *find_or_register_uid(uid_t uid);
+
+/*
+ * Per-task stats are only kept for debugging, so unlike the per-uid
+ * totals they are still gathered by walking every thread.
+ */
+static void update_io_stats_tasks_locked(struct uid_entry *only)
+{
+	struct uid_entry *uid_entry = NULL;
+	struct task_struct *task, *temp;
+	struct user_namespace *user_ns = current_user_ns();
+	unsigned long bkt;
+	uid_t uid;
+
+	if (only) {
+		set_io_uid_tasks_zero(only);
+	} else {
+		hash_for_each(hash_table, bkt, uid_entry, hash)
+			set_io_uid_tasks_zero(uid_entry);
+		uid_entry = NULL;
+	}
+
+	rcu_read_lock();
+	do_each_thread(temp, task) {
+		uid = from_kuid_munged(user_ns, task_uid(task));
+		if (only) {
+			if (uid != only->uid)
+				continue;
+			uid_entry = only;
+		} else if (!uid_entry || uid_entry->uid != uid) {
+			uid_entry = find_or_register_uid(uid);
+		}
+		if (!uid_entry)
+			continue;
+		add_uid_tasks_io_stats(uid_entry, task, UID_STATE_TOTAL_CURR);
+	} while_each_thread(temp, task);
+	rcu_read_unlock();
+}
 #else
 static void remove_uid_tasks(struct uid_entry *uid_entry) {};
-static void set_io_uid_tasks_zero(struct uid_entry *uid_entry) {};
-static void add_uid_tasks_io_stats(struct uid_entry *uid_entry,
-		struct task_struct *task, int slot) {};
 static void compute_io_uid_tasks(struct uid_entry *uid_entry) {};
 static void show_io_uid_tasks(struct seq_file *m,
 		struct uid_entry *uid_entry) {}
+static void update_io_stats_tasks_locked(struct uid_entry *only) {};
 #endif
 
 static struct uid_entry *find_uid_entry(uid_t uid)
@@ -321,6 +359,7 @@ static struct uid_entry *find_or_register_uid(uid_t uid)
 		return NULL;
 
 	uid_entry->uid = uid;
+	prev_cputime_init(&uid_entry->prev_cputime);
 #ifdef CONFIG_UID_SYS_STATS_DEBUG
 	hash_init(uid_entry->task_entries);
 #endif
@@ -329,46 +368,125 @@ static struct uid_entry *find_or_register_uid(uid_t uid)
 	return uid_entry;
 }
 
-static int uid_cputime_show(struct seq_file *m, void *v)
+static void compute_uid_stats(struct uid_entry *uid_entry,
+			      struct uid_sys_stats *stats)
 {
-	struct uid_entry *uid_entry = NULL;
-	struct task_struct *task, *temp;
-	struct user_namespace *user_ns = current_user_ns();
-	cputime_t utime;
-	cputime_t stime;
-	unsigned long bkt;
+	struct uid_sys_stats *cpu_stats;
+	int cpu, i;
+
+	memset(stats, 0, sizeof(*stats));
+
+	if (!uid_entry->user || !uid_entry->user->sys_stats)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		cpu_stats = per_cpu_ptr(uid_entry->user->sys_stats, cpu);
+		for (i = 0; i < UID_SYS_STATS_NR; i++)
+			stats->stat[i] += READ_ONCE(cpu_stats->stat[i]);
+	}
+}
+
+static void compute_uid_io_stats(struct uid_entry *uid_entry,
+				 struct io_stats *io)
+{
+	struct uid_sys_stats stats;
+	u64 write_bytes, cancelled_write_bytes;
+
+	compute_uid_stats(uid_entry, &stats);
+
+	write_bytes = stats.stat[UID_SYS_STATS_WRITE_BYTES];
+	cancelled_write_bytes = stats.stat[UID_SYS_STATS_CANCELLED_WRITE_BYTES];
+
+	io->read_bytes = stats.stat[UID_SYS_STATS_READ_BYTES];
+	io->write_bytes = write_bytes > cancelled_write_bytes ?
+		write_bytes - cancelled_write_bytes : 0;
+	io->rchar = stats.stat[UID_SYS_STATS_RCHAR];
+	io->wchar = stats.stat[UID_SYS_STATS_WCHAR];
+	io->fsync = stats.stat[UID_SYS_STATS_FSYNC];
+}
+
+DEFINE_STATIC_KEY_FALSE(uid_sys_stats_enabled);
+/* task_io_account_*() are inlined into modules */
+EXPORT_SYMBOL_GPL(uid_sys_stats_enabled);
+
+void __uid_sys_stats_account(struct task_struct *tsk,
+			     enum uid_sys_stats_item item, u64 amt)
+{
+	struct uid_sys_stats __percpu *stats;
+
+	/* current's cred cannot change under us, so skip RCU for it */
+	if (tsk == current) {
+		stats = current_user()->sys_stats;
+		if (stats)
+			this_cpu_add(stats->stat[item], amt);
+		return;
+	}
+
+	rcu_read_lock();
+	stats = __task_cred(tsk)->user->sys_stats;
+	if (stats)
+		this_cpu_add(stats->stat[item], amt);
+	rcu_read_unlock();
+}
+EXPORT_SYMBOL_GPL(__uid_sys_stats_account);
+
+/*
+ * Called for every alloc_uid(). The uid_entry keeps a reference on the
+ * user_struct so its running totals outlive the uid's last task, until
+ * the uid is dropped through remove_uid_range.
+ *
+ * alloc_uid() runs on each setuid() family call, which zygote makes for
+ * every app it forks. Only the first call for a user_struct needs
+ * uid_lock, so readers of /proc/uid_* holding it do not delay app
+ * launch. sys_stats_registered only changes under uid_lock, so a
+ * lockless read that sees it set is ordered before any remove_uid_range
+ * that clears it.
+ */
+void uid_sys_stats_register_user(struct user_struct *up)
+{
+	struct uid_entry *uid_entry;
 	uid_t uid;
 
-	rt_mutex_lock(&uid_lock);
+	if (atomic_read(&up->sys_stats_registered))
+		return;
 
-	hash_for_each(hash_table, bkt, uid_entry, hash) {
-		uid_entry->active_stime = 0;
-		uid_entry->active_utime = 0;
+	uid = from_kuid_munged(current_user_ns(), up->uid);
+
+	rt_mutex_lock(&uid_lock);
+	if (atomic_cmpxchg(&up->sys_stats_registered, 0, 1) == 0) {
+		uid_entry = find_or_register_uid(uid);
+		if (!uid_entry)
+			atomic_set(&up->sys_stats_registered, 0);
+		else if (!uid_entry->user)
+			uid_entry->user = get_uid(up);
 	}
+	rt_mutex_unlock(&uid_lock);
+}
 
-	read_lock(&tasklist_lock);
-	do_each_thread(temp, task) {
-		uid = from_kuid_munged(user_ns, task_uid(task));
-		if (!uid_entry || uid_entry->uid != uid)
-			uid_entry = find_or_register_uid(uid);
-		if (!uid_entry) {
-			read_unlock(&tasklist_lock);
-			rt_mutex_unlock(&uid_lock);
-			pr_err("%s: failed to find the uid_entry for uid %d\n",
-				__func__, uid);
-			return -ENOMEM;
-		}
-		task_cputime_adjusted(task, &utime, &stime);
-		uid_entry->active_utime += utime;
-		uid_entry->active_stime += stime;
-	} while_each_thread(temp, task);
-	read_unlock(&tasklist_lock);
+/*
+ * The per-uid utime/stime ticks are scaled to the uid's scheduler
+ * runtime, as task_cputime_adjusted() does per task, and kept monotonic
+ * in uid_entry->prev_cputime. Costs O(uids * cpus) however many threads
+ * exist.
+ */
+static int uid_cputime_show(struct seq_file *m, void *v)
+{
+	struct uid_entry *uid_entry;
+	struct uid_sys_stats stats;
+	struct task_cputime cputime;
+	cputime_t total_utime;
+	cputime_t total_stime;
+	unsigned long bkt;
+
+	rt_mutex_lock(&uid_lock);
 
 	hash_for_each(hash_table, bkt, uid_entry, hash) {
-		cputime_t total_utime = uid_entry->utime +
-							uid_entry->active_utime;
-		cputime_t total_stime = uid_entry->stime +
-							uid_entry->active_stime;
+		compute_uid_stats(uid_entry, &stats);
+		cputime.utime = (__force cputime_t)stats.stat[UID_SYS_STATS_UTIME];
+		cputime.stime = (__force cputime_t)stats.stat[UID_SYS_STATS_STIME];
+		cputime.sum_exec_runtime = stats.stat[UID_SYS_STATS_RTIME];
+		cputime_totals_adjusted(&cputime, &uid_entry->prev_cputime,
+					&total_utime, &total_stime);
 		seq_printf(m, "%d: %llu %llu\n", uid_entry->uid,
 			(unsigned long long)jiffies_to_msecs(
 				cputime_to_jiffies(total_utime)) * USEC_PER_MSEC,
@@ -401,6 +519,7 @@ static ssize_t uid_remove_write(struct file *file,
 			const char __user *buffer, size_t count, loff_t *ppos)
 {
 	struct uid_entry *uid_entry;
+	struct user_struct *up;
 	struct hlist_node *tmp;
 	char uids[128];
 	char *start_uid, *end_uid = NULL;
@@ -434,6 +553,11 @@ static ssize_t uid_remove_write(struct file *file,
 							hash, (uid_t)uid_start) {
 			if (uid_start == uid_entry->uid) {
 				remove_uid_tasks(uid_entry);
+				up = uid_entry->user;
+				if (up)
+					atomic_set(&up->sys_stats_registered,
+						   0);
+				free_uid(up);
 				hash_del(&uid_entry->hash);
 				kfree(uid_entry);
 			}
@@ -451,70 +575,9 @@ static const struct file_operations uid_remove_fops = {
 };
 
 
-static void add_uid_io_stats(struct uid_entry *uid_entry,
-			struct task_struct *task, int slot)
-{
-	struct io_stats *io_slot = &uid_entry->io[slot];
-
-	io_slot->read_bytes += task->ioac.read_bytes;
-	io_slot->write_bytes += compute_write_bytes(task);
-	io_slot->rchar += task->ioac.rchar;
-	io_slot->wchar += task->ioac.wchar;
-	io_slot->fsync += task->ioac.syscfs;
-
-	add_uid_tasks_io_stats(uid_entry, task, slot);
-}
-
-static void update_io_stats_all_locked(void)
-{
-	struct uid_entry *uid_entry = NULL;
-	struct task_struct *task, *temp;
-	struct user_namespace *user_ns = current_user_ns();
-	unsigned long bkt;
-	uid_t uid;
-
-	hash_for_each(hash_table, bkt, uid_entry, hash) {
-		memset(&uid_entry->io[UID_STATE_TOTAL_CURR], 0,
-			sizeof(struct io_stats));
-		set_io_uid_tasks_zero(uid_entry);
-	}
-
-	rcu_read_lock();
-	do_each_thread(temp, task) {
-		uid = from_kuid_munged(user_ns, task_uid(task));
-		if (!uid_entry || uid_entry->uid != uid)
-			uid_entry = find_or_register_uid(uid);
-		if (!uid_entry)
-			continue;
-		add_uid_io_stats(uid_entry, task, UID_STATE_TOTAL_CURR);
-	} while_each_thread(temp, task);
-	rcu_read_unlock();
-
-	hash_for_each(hash_table, bkt, uid_entry, hash) {
-		compute_io_bucket_stats(&uid_entry->io[uid_entry->state],
-					&uid_entry->io[UID_STATE_TOTAL_CURR],
-					&uid_entry->io[UID_STATE_TOTAL_LAST],
-					&uid_entry->io[UID_STATE_DEAD_TASKS]);
-		compute_io_uid_tasks(uid_entry);
-	}
-}
-
 static void update_io_stats_uid_locked(struct uid_entry *uid_entry)
 {
-	struct task_struct *task, *temp;
-	struct user_namespace *user_ns = current_user_ns();
-
-	memset(&uid_entry->io[UID_STATE_TOTAL_CURR], 0,
-		sizeof(struct io_stats));
-	set_io_uid_tasks_zero(uid_entry);
-
-	rcu_read_lock();
-	do_each_thread(temp, task) {
-		if (from_kuid_munged(user_ns, task_uid(task)) != uid_entry->uid)
-			continue;
-		add_uid_io_stats(uid_entry, task, UID_STATE_TOTAL_CURR);
-	} while_each_thread(temp, task);
-	rcu_read_unlock();
+	compute_uid_io_stats(uid_entry, &uid_entry->io[UID_STATE_TOTAL_CURR]);
 
 	compute_io_bucket_stats(&uid_entry->io[uid_entry->state],
 				&uid_entry->io[UID_STATE_TOTAL_CURR],
@@ -523,6 +586,16 @@ static void update_io_stats_uid_locked(struct uid_entry *uid_entry)
 	compute_io_uid_tasks(uid_entry);
 }
 
+static void update_io_stats_all_locked(void)
+{
+	struct uid_entry *uid_entry;
+	unsigned long bkt;
+
+	update_io_stats_tasks_locked(NULL);
+
+	hash_for_each(hash_table, bkt, uid_entry, hash)
+		update_io_stats_uid_locked(uid_entry);
+}
 
 static int uid_io_show(struct seq_file *m, void *v)
 {
@@ -607,6 +680,7 @@ static ssize_t uid_procstat_write(struct file *file,
 		return count;
 	}
 
+	update_io_stats_tasks_locked(uid_entry);
 	update_io_stats_uid_locked(uid_entry);
 
 	uid_entry->state = state;
@@ -622,12 +696,12 @@ static const struct file_operations uid_procstat_fops = {
 	.write		= uid_procstat_write,
 };
 
+#ifdef CONFIG_UID_SYS_STATS_DEBUG
 static int process_notifier(struct notifier_block *self,
 			unsigned long cmd, void *v)
 {
 	struct task_struct *task = v;
 	struct uid_entry *uid_entry;
-	cputime_t utime, stime;
 	uid_t uid;
 
 	if (!task)
@@ -641,11 +715,7 @@ static int process_notifier(struct notifier_block *self,
 		goto exit;
 	}
 
-	task_cputime_adjusted(task, &utime, &stime);
-	uid_entry->utime += utime;
-	uid_entry->stime += stime;
-
-	add_uid_io_stats(uid_entry, task, UID_STATE_DEAD_TASKS);
+	add_uid_tasks_io_stats(uid_entry, task, UID_STATE_DEAD_TASKS);
 
 exit:
 	rt_mutex_unlock(&uid_lock);
@@ -655,6 +725,7 @@ exit:
 static struct notifier_block process_notifier_block = {
 	.notifier_call	= process_notifier,
 };
+#endif
 
 static int __init proc_uid_sys_stats_init(void)
 {
@@ -692,7 +763,13 @@ static int __init proc_uid_sys_stats_init(void)
 	proc_create_data("set", 0222, proc_parent,
 		&uid_procstat_fops, NULL);
 
+	/* init and kernel threads run as root without going through alloc_uid */
+	uid_sys_stats_register_user(&root_user);
+	static_branch_enable(&uid_sys_stats_enabled);
+
+#ifdef CONFIG_UID_SYS_STATS_DEBUG
 	profile_event_register(PROFILE_TASK_EXIT, &process_notifier_block);
+#endif
 
 	return 0;
 
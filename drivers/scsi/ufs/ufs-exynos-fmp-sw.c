@@ -0,0 +1,346 @@
+/*
+ * Software model of the Exynos FMP descriptor engine for UFS
+ *
+ * Registers as the FMP backend of UFS hosts that have no FMP instance.
+ * Each segment's crypto setting is turned into the descriptor words the
+ * hardware would be programmed with, in a shadow table, and decoded back
+ * to check it; the real PRDT entry is left in bypass, since nothing would
+ * decrypt the data. This keeps the inline encryption path testable and
+ * measurable without the hardware.
+ *
+ * debugfs, in ufs-fmp-sw/:
+ *	stats	configured segments by mode, and descriptor check failures
+ *	bench	write a segment count to time the file descriptor build
+ *		of the I/O path, with and without a key template; read
+ *		back the result
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <linux/module.h>
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/random.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <crypto/fmp.h>
+
+#include "ufs-exynos-fmp.h"
+
+#define FMP_SW_BENCH_MAX	(1UL << 24)
+
+static atomic64_t fmp_sw_segments;
+static atomic64_t fmp_sw_disk;
+static atomic64_t fmp_sw_file;
+static atomic64_t fmp_sw_errors;
+
+static struct dentry *fmp_sw_dir;
+
+static DEFINE_MUTEX(fmp_sw_bench_lock);
+static struct {
+	unsigned long segments;
+	u64 ns_tmpl;
+	u64 ns_mapping;
+	unsigned long errors;
+} fmp_sw_bench;
+
+/* Program @crypto into @table, as the FMP driver does for the hardware */
+static int fmp_sw_fill(struct fmp_table_setting *table,
+			struct fmp_crypto_setting *crypto)
+{
+	unsigned int size = crypto->key_size;
+
+	if (crypto->algo_mode == EXYNOS_FMP_BYPASS_MODE)
+		return 0;
+
+	if (crypto->enc_mode == EXYNOS_FMP_DISK_ENC) {
+		/* The disk key lives in the FMP itself, only the IV is per entry */
+		SET_DAS(table, crypto->algo_mode);
+		table->disk_iv0 = cpu_to_le32(lower_32_bits(crypto->sector));
+		table->disk_iv1 = cpu_to_le32(upper_32_bits(crypto->sector));
+		return 0;
+	}
+
+	if (size != EXYNOS_FMP_KEY_SIZE_16 && size != EXYNOS_FMP_KEY_SIZE_32)
+		return -EINVAL;
+
+	SET_FAS(table, crypto->algo_mode);
+	if (size == EXYNOS_FMP_KEY_SIZE_32)
+		table->des2 |= FKL;
+	else
+		table->des2 &= ~FKL;
+
+	table->file_iv0 = cpu_to_le32(crypto->index);
+	table->file_iv1 = 0;
+	table->file_iv2 = 0;
+	table->file_iv3 = 0;
+
+	/* Key words are consecutive in the descriptor, in key byte order */
+	memcpy(&table->file_enckey0, crypto->key, size);
+	if (crypto->algo_mode == EXYNOS_FMP_ALGO_MODE_AES_XTS)
+		memcpy(&table->file_twkey0, crypto->key + size, size);
+
+	return 0;
+}
+
+/* Decode @table and compare it with the setting it was built from */
+static int fmp_sw_check(struct fmp_table_setting *table,
+			struct fmp_crypto_setting *crypto)
+{
+	unsigned int size;
+
+	if (crypto->algo_mode == EXYNOS_FMP_BYPASS_MODE)
+		return 0;
+
+	if (crypto->enc_mode == EXYNOS_FMP_DISK_ENC) {
+		if ((GET_DAS(table) >> 30) != crypto->algo_mode ||
+				le32_to_cpu(table->disk_iv0) !=
+				lower_32_bits(crypto->sector))
+			return -EINVAL;
+		return 0;
+	}
+
+	size = (table->des2 & FKL) ? EXYNOS_FMP_KEY_SIZE_32 :
+					EXYNOS_FMP_KEY_SIZE_16;
+	if ((GET_FAS(table) >> 28) != crypto->algo_mode ||
+			size != crypto->key_size ||
+			le32_to_cpu(table->file_iv0) != crypto->index)
+		return -EINVAL;
+
+	if (memcmp(&table->file_enckey0, crypto->key, size))
+		return -EINVAL;
+
+	if (crypto->algo_mode == EXYNOS_FMP_ALGO_MODE_AES_XTS &&
+			memcmp(&table->file_twkey0, crypto->key + size, size))
+		return -EINVAL;
+
+	return 0;
+}
+
+static int fmp_sw_program(struct fmp_table_setting *table,
+			struct fmp_crypto_setting *crypto, atomic64_t *count)
+{
+	int ret;
+
+	if (crypto->algo_mode == EXYNOS_FMP_BYPASS_MODE)
+		return 0;
+
+	atomic64_inc(count);
+	ret = fmp_sw_fill(table, crypto);
+	if (!ret)
+		ret = fmp_sw_check(table, crypto);
+
+	return ret;
+}
+
+static int fmp_sw_config(struct platform_device *pdev,
+			struct fmp_data_setting *data)
+{
+	struct fmp_table_setting shadow;
+	int ret;
+
+	atomic64_inc(&fmp_sw_segments);
+
+	memset(&shadow, 0, sizeof(shadow));
+	ret = fmp_sw_program(&shadow, &data->disk, &fmp_sw_disk);
+	if (!ret)
+		ret = fmp_sw_program(&shadow, &data->file, &fmp_sw_file);
+	memzero_explicit(&shadow, sizeof(shadow));
+
+	if (ret)
+		atomic64_inc(&fmp_sw_errors);
+
+	/* Nothing encrypts the data, so the entry must not claim it does */
+	SET_DAS(data->table, 0);
+	SET_FAS(data->table, 0);
+
+	return 0;
+}
+
+static int fmp_sw_clear(struct platform_device *pdev,
+			struct fmp_data_setting *data)
+{
+	return 0;
+}
+
+static struct exynos_fmp_variant_ops fmp_sw_vops = {
+	.name = "fmp-sw",
+	.config = fmp_sw_config,
+	.clear = fmp_sw_clear,
+};
+
+/* Times the per-segment setting build of exynos_ufs_fmp_file_cfg() */
+static u64 fmp_sw_bench_loop(struct address_space *mapping,
+			struct fmp_table_setting *table,
+			unsigned long segments)
+{
+	struct fmp_crypto_setting crypto;
+	unsigned long i;
+	ktime_t start;
+
+	start = ktime_get();
+	for (i = 0; i < segments; i++) {
+		if (exynos_ufs_fmp_mapping_cfg(mapping, i,
+				(sector_t)i * NUM_SECTOR_UNIT, 0, &crypto)) {
+			fmp_sw_bench.errors++;
+			continue;
+		}
+		fmp_sw_fill(table, &crypto);
+		if (fmp_sw_check(table, &crypto))
+			fmp_sw_bench.errors++;
+	}
+	memzero_explicit(&crypto, sizeof(crypto));
+
+	return ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+static int fmp_sw_bench_run(unsigned long segments)
+{
+	struct address_space *mapping;
+	struct fmp_table_setting *table;
+	struct fmp_crypto_tmpl *tmpl = NULL;
+	int ret = 0;
+
+	mapping = kzalloc(sizeof(*mapping), GFP_KERNEL);
+	table = kzalloc(sizeof(*table), GFP_KERNEL);
+	if (!mapping || !table) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	mapping->private_algo_mode = EXYNOS_FMP_ALGO_MODE_AES_XTS;
+	mapping->key_length = FMP_XTS_MAX_KEY_SIZE;
+	get_random_bytes(mapping->key, mapping->key_length);
+
+	tmpl = fmp_crypto_tmpl_alloc(mapping->private_algo_mode,
+				mapping->key, mapping->key_length, GFP_KERNEL);
+	if (!tmpl) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	fmp_sw_bench.segments = segments;
+	fmp_sw_bench.errors = 0;
+
+	/* The mapping is private to the bench, so no grace period is needed */
+	fmp_sw_bench.ns_mapping = fmp_sw_bench_loop(mapping, table, segments);
+	RCU_INIT_POINTER(mapping->fmp_tmpl, tmpl);
+	fmp_sw_bench.ns_tmpl = fmp_sw_bench_loop(mapping, table, segments);
+out:
+	kzfree(tmpl);
+	kzfree(table);
+	kzfree(mapping);
+	return ret;
+}
+
+static int fmp_sw_stats_show(struct seq_file *s, void *unused)
+{
+	seq_printf(s, "segments: %lld\n", atomic64_read(&fmp_sw_segments));
+	seq_printf(s, "disk: %lld\n", atomic64_read(&fmp_sw_disk));
+	seq_printf(s, "file: %lld\n", atomic64_read(&fmp_sw_file));
+	seq_printf(s, "errors: %lld\n", atomic64_read(&fmp_sw_errors));
+	return 0;
+}
+
+static int fmp_sw_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fmp_sw_stats_show, NULL);
+}
+
+static const struct file_operations fmp_sw_stats_fops = {
+	.open = fmp_sw_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int fmp_sw_bench_show(struct seq_file *s, void *unused)
+{
+	unsigned long segments;
+
+	mutex_lock(&fmp_sw_bench_lock);
+	segments = fmp_sw_bench.segments;
+	if (segments) {
+		seq_printf(s, "segments: %lu\n", segments);
+		seq_printf(s, "build from mapping: %llu ns/segment\n",
+			div64_u64(fmp_sw_bench.ns_mapping, segments));
+		seq_printf(s, "build from template: %llu ns/segment\n",
+			div64_u64(fmp_sw_bench.ns_tmpl, segments));
+		seq_printf(s, "errors: %lu\n", fmp_sw_bench.errors);
+	}
+	mutex_unlock(&fmp_sw_bench_lock);
+
+	return 0;
+}
+
+static int fmp_sw_bench_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fmp_sw_bench_show, NULL);
+}
+
+static ssize_t fmp_sw_bench_write(struct file *file, const char __user *buf,
+			size_t count, loff_t *ppos)
+{
+	unsigned long segments;
+	int ret;
+
+	ret = kstrtoul_from_user(buf, count, 0, &segments);
+	if (ret)
+		return ret;
+
+	if (!segments || segments > FMP_SW_BENCH_MAX)
+		return -EINVAL;
+
+	mutex_lock(&fmp_sw_bench_lock);
+	ret = fmp_sw_bench_run(segments);
+	mutex_unlock(&fmp_sw_bench_lock);
+
+	return ret ? ret : count;
+}
+
+static const struct file_operations fmp_sw_bench_fops = {
+	.open = fmp_sw_bench_open,
+	.read = seq_read,
+	.write = fmp_sw_bench_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init fmp_sw_init(void)
+{
+	int ret;
+
+	ret = exynos_ufs_fmp_register_sw(&fmp_sw_vops);
+	if (ret) {
+		pr_err("%s: Fail to register software FMP (%d)\n",
+			__func__, ret);
+		return ret;
+	}
+
+	fmp_sw_dir = debugfs_create_dir("ufs-fmp-sw", NULL);
+	if (!IS_ERR_OR_NULL(fmp_sw_dir)) {
+		debugfs_create_file("stats", S_IRUGO, fmp_sw_dir, NULL,
+					&fmp_sw_stats_fops);
+		debugfs_create_file("bench", S_IRUSR | S_IWUSR, fmp_sw_dir,
+					NULL, &fmp_sw_bench_fops);
+	}
+
+	return 0;
+}
+module_init(fmp_sw_init);
+
+static void __exit fmp_sw_exit(void)
+{
+	debugfs_remove_recursive(fmp_sw_dir);
+	exynos_ufs_fmp_unregister_sw(&fmp_sw_vops);
+}
+module_exit(fmp_sw_exit);
+
+MODULE_DESCRIPTION("Software FMP descriptor backend for Exynos UFS");
+MODULE_LICENSE("GPL");
@@ -8,11 +8,17 @@
  */
 
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
+#include <linux/rcupdate.h>
 #include <crypto/fmp.h>
 
 #include "ufs-exynos-fmp.h"
 
+/* Software descriptor backend, used when there is no FMP hardware */
+static struct exynos_fmp_variant_ops __rcu *fmp_sw_vops;
+static DEFINE_MUTEX(fmp_sw_lock);
+
 static int check_data_equal(void *data1, void *data2)
 {
 	return data1 == data2;
@@ -96,6 +102,44 @@ out:
 	return ret;
 }
 
+/*
+ * File crypto setting of a segment of @mapping. The key part is copied from
+ * the template of the mapping if its file key set one up, and only the IV
+ * is patched in. Otherwise it is built from the mapping.
+ */
+int exynos_ufs_fmp_mapping_cfg(struct address_space *mapping,
+					pgoff_t page_index, sector_t sector,
+					int sector_offset,
+					struct fmp_crypto_setting *crypto)
+{
+	struct fmp_crypto_tmpl *tmpl;
+	int ret;
+
+	rcu_read_lock();
+	tmpl = rcu_dereference(mapping->fmp_tmpl);
+	if (tmpl)
+		*crypto = tmpl->crypto;
+	rcu_read_unlock();
+
+	if (!tmpl) {
+		memset(crypto, 0, sizeof(struct fmp_crypto_setting));
+		crypto->enc_mode = EXYNOS_FMP_FILE_ENC;
+		crypto->algo_mode = mapping->private_algo_mode;
+		ret = exynos_ufs_fmp_key_size_cfg(crypto, mapping->key_length);
+		if (ret)
+			return ret;
+
+		ret = exynos_ufs_fmp_key_cfg(crypto, mapping->key,
+						mapping->key_length);
+		if (ret)
+			return ret;
+	}
+
+	return exynos_ufs_fmp_iv_cfg(crypto, sector, page_index,
+					sector_offset);
+}
+EXPORT_SYMBOL(exynos_ufs_fmp_mapping_cfg);
+
 static int exynos_ufs_fmp_disk_cfg(struct scsi_cmnd *cmd,
 					struct fmp_crypto_setting *crypto,
 					int sector_offset)
@@ -220,10 +264,6 @@ static int exynos_ufs_fmp_file_cfg(struct scsi_cmnd *cmd,
 		goto out;
 	}
 
-	memset(crypto, 0, sizeof(struct fmp_crypto_setting));
-
-	crypto->enc_mode = EXYNOS_FMP_FILE_ENC;
-
 	if (!page || PageAnon(page))
 		goto bypass_out;
 
@@ -233,32 +273,17 @@ static int exynos_ufs_fmp_file_cfg(struct scsi_cmnd *cmd,
 	if (!bio)
 		goto bypass_out;
 
-	crypto->algo_mode = page->mapping->private_algo_mode;
-	ret = exynos_ufs_fmp_key_size_cfg(crypto, page->mapping->key_length);
+	page_index = page->index - page->mapping->sensitive_data_index;
+	ret = exynos_ufs_fmp_mapping_cfg(page->mapping, page_index,
+					bio->bi_iter.bi_sector, sector_offset,
+					crypto);
 	if (ret)
 		goto bypass_out;
-
-	page_index = page->index - page->mapping->sensitive_data_index;
-	ret = exynos_ufs_fmp_iv_cfg(crypto, bio->bi_iter.bi_sector, page_index,
-					sector_offset);
-	if (ret) {
-		pr_err("%s: Fail to configure fmp iv. ret(%d)\n",
-				__func__, ret);
-		ret = -EINVAL;
-		goto out;
-	}
-
-	ret = exynos_ufs_fmp_key_cfg(crypto, page->mapping->key,
-					page->mapping->key_length);
-	if (ret) {
-		pr_err("%s: Fail to configure fmp key. ret(%d)\n",
-				__func__, ret);
-		ret = -EINVAL;
-		goto out;
-	}
 out:
 	return ret;
 bypass_out:
+	memset(crypto, 0, sizeof(struct fmp_crypto_setting));
+	crypto->enc_mode = EXYNOS_FMP_FILE_ENC;
 	crypto->algo_mode = EXYNOS_FMP_BYPASS_MODE;
 	ret = 0;
 	return ret;
@@ -313,6 +338,53 @@ static inline void exynos_ufs_fmp_bypass(void *desc)
 	SET_FAS((struct fmp_table_setting *)desc, 0);
 }
 
+int exynos_ufs_fmp_register_sw(struct exynos_fmp_variant_ops *vops)
+{
+	mutex_lock(&fmp_sw_lock);
+	if (rcu_dereference_protected(fmp_sw_vops,
+				lockdep_is_held(&fmp_sw_lock))) {
+		mutex_unlock(&fmp_sw_lock);
+		return -EBUSY;
+	}
+	rcu_assign_pointer(fmp_sw_vops, vops);
+	mutex_unlock(&fmp_sw_lock);
+
+	pr_info("%s: using %s for hosts without FMP\n", __func__, vops->name);
+	return 0;
+}
+EXPORT_SYMBOL(exynos_ufs_fmp_register_sw);
+
+void exynos_ufs_fmp_unregister_sw(struct exynos_fmp_variant_ops *vops)
+{
+	mutex_lock(&fmp_sw_lock);
+	if (rcu_dereference_protected(fmp_sw_vops,
+				lockdep_is_held(&fmp_sw_lock)) == vops)
+		RCU_INIT_POINTER(fmp_sw_vops, NULL);
+	mutex_unlock(&fmp_sw_lock);
+	synchronize_rcu();
+}
+EXPORT_SYMBOL(exynos_ufs_fmp_unregister_sw);
+
+static int exynos_ufs_fmp_config(struct exynos_ufs *ufs,
+				struct fmp_data_setting *data)
+{
+	struct exynos_fmp_variant_ops *vops;
+	int ret = 0;
+
+	if (ufs->fmp.pdev)
+		return ufs->fmp.vops->config(ufs->fmp.pdev, data);
+
+	rcu_read_lock();
+	vops = rcu_dereference(fmp_sw_vops);
+	if (vops)
+		ret = vops->config(NULL, data);
+	else
+		exynos_ufs_fmp_bypass(data->table);
+	rcu_read_unlock();
+
+	return ret;
+}
+
 int exynos_ufs_fmp_cfg(struct ufs_hba *hba,
 				struct ufshcd_lrb *lrbp,
 				struct scatterlist *sg,
@@ -325,16 +397,20 @@ int exynos_ufs_fmp_cfg(struct ufs_hba *hba,
 	struct page *page;
 	struct exynos_ufs *ufs = dev_get_platdata(hba->dev);
 
-	if (!ufs->fmp.pdev || !lrbp->cmd) {
+	if ((!ufs->fmp.pdev && !rcu_access_pointer(fmp_sw_vops)) ||
+			!lrbp->cmd) {
 		exynos_ufs_fmp_bypass(&lrbp->ucd_prdt_ptr[index]);
 		return 0;
 	}
 
 	cmd = lrbp->cmd;
+	page = sg_page(sg);
 
-	ret = is_ufs_fmp_test_enabled(cmd, ufs->fmp.pdev);
-	if (ret == TRUE)
-		goto out;
+	if (ufs->fmp.pdev) {
+		ret = is_ufs_fmp_test_enabled(cmd, ufs->fmp.pdev);
+		if (ret == TRUE)
+			goto out;
+	}
 
 	ret = exynos_ufs_fmp_disk_cfg(cmd, &data.disk, sector_offset);
 	if (ret) {
@@ -357,7 +433,6 @@ int exynos_ufs_fmp_cfg(struct ufs_hba *hba,
 		goto out;
 
 file_cfg:
-	page = sg_page(sg);
 	ret = exynos_ufs_fmp_file_cfg(cmd, page, &data.file, sector_offset);
 	if (ret) {
 		pr_err("%s: Fail to configure FMP File Encryption. ret(%d)\n",
@@ -367,8 +442,8 @@ file_cfg:
 
 out:
 	data.table = (struct fmp_table_setting *)&lrbp->ucd_prdt_ptr[index];
-	data.mapping = page->mapping;
-	return ufs->fmp.vops->config(ufs->fmp.pdev, &data);
+	data.mapping = page ? page->mapping : NULL;
+	return exynos_ufs_fmp_config(ufs, &data);
 }
 EXPORT_SYMBOL(exynos_ufs_fmp_cfg);
 
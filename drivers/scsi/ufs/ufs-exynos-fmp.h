@@ -23,6 +23,12 @@ int exynos_ufs_fmp_cfg(struct ufs_hba *hba,
 				uint32_t index,
 				int sector_offset);
 int exynos_ufs_fmp_clear(struct ufs_hba *hba, struct ufshcd_lrb *lrbp);
+int exynos_ufs_fmp_mapping_cfg(struct address_space *mapping,
+				pgoff_t page_index, sector_t sector,
+				int sector_offset,
+				struct fmp_crypto_setting *crypto);
+int exynos_ufs_fmp_register_sw(struct exynos_fmp_variant_ops *vops);
+void exynos_ufs_fmp_unregister_sw(struct exynos_fmp_variant_ops *vops);
 #else
 inline int exynos_fmp_host_set_device(struct platform_device *host_pdev,
 				struct platform_device *pdev,
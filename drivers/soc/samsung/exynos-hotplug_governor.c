@@ -13,6 +13,8 @@
 #include <linux/slab.h>
 #include <linux/pm_qos.h>
 #include <linux/sched.h>
+#include <linux/cpufreq.h>
+#include <linux/topology.h>
 
 #include <soc/samsung/exynos-cpu_hotplug.h>
 
@@ -22,19 +24,52 @@
 #define DEFAULT_DUAL_CHANGE_MS (15)		/* 15 ms */
 #define DEFAULT_BOOT_ENABLE_MS (0)		/* boot delay is not applied */
 #define RETRY_BOOT_ENABLE_MS (100)		/* 100 ms */
+#define DEFAULT_WINDOW_MS (20)			/* 20 ms */
+#define DEFAULT_MAX_TRANSITIONS (10)		/* per second */
+#define TARGET_LOAD (80)			/* % of a core */
+#define HPGOV_HIST_SIZE (5)
 
 enum hpgov_event {
 	HPGOV_SLACK_TIMER_EXPIRED = 1,	/* slack timer expired */
 	HPGOV_BIG_MODE_UPDATED = 2,	/* dual/quad mode updated */
+	HPGOV_BIG_CORES_PREDICTED = 3,	/* big core count predicted */
 };
 
 struct hpgov_attrib {
 	struct kobj_attribute	enabled;
 	struct kobj_attribute	dual_change_ms;
+	struct kobj_attribute	predict;
+	struct kobj_attribute	window_ms;
+	struct kobj_attribute	max_transitions;
+	struct kobj_attribute	stats;
+	struct kobj_attribute	replay;
 
 	struct attribute_group	attrib_group;
 };
 
+/*
+ * Big core predictor. The cores needed in a window come from the busy time
+ * of the big cluster and the tasks runnable on it. The next window is
+ * predicted as the larger of the last window and the history average, and
+ * a rising trend is carried one window ahead. Changes are limited to
+ * max_transitions per second. Each window is also checked against the
+ * cores that were online in it.
+ */
+struct hpgov_pred {
+	int			hist[HPGOV_HIST_SIZE];
+	int			nr_hist;
+	u64			period_start_ms;
+	int			period_transitions;
+
+	u64			windows;
+	u64			transitions;
+	u64			throttled;
+	u64			under;
+	u64			over;
+	u64			under_ms;
+	u64			over_ms;
+};
+
 struct hpgov_data {
 	enum hpgov_event event;
 	int req_cpu_max;
@@ -62,6 +97,21 @@ struct {
 	wait_queue_head_t		wait_hpq;
 
 	int				boost_cnt;
+
+	int				predict;
+	int				window_ms;
+	int				max_transitions;
+	int				predicted;
+	struct cpumask			big_mask;
+	int				nr_little;
+	int				nr_big;
+	struct timer_list		sample_timer;
+	u64				sample_ms;
+	struct cpumask			sampled;
+	u64				prev_idle[NR_CPUS];
+	u64				prev_wall[NR_CPUS];
+	struct hpgov_pred		pred;
+	struct hpgov_pred		replay;
 } exynos_hpgov;
 
 static struct pm_qos_request hpgov_max_pm_qos;
@@ -81,6 +131,73 @@ enum {
 	BIG_BOOST_MODE,
 };
 
+static int hpgov_pred_need(int busy_pct, int nr_running, int nr_big)
+{
+	int need = DIV_ROUND_UP(busy_pct, TARGET_LOAD);
+
+	need = max(need, nr_running);
+
+	return clamp(need, 1, nr_big);
+}
+
+/* returns the big cores for the next window */
+static int hpgov_pred_window(struct hpgov_pred *p, u64 now_ms, u64 elapsed_ms,
+			int need, int online, int nr_big, int max_transitions)
+{
+	int i, sum = 0, pred, prev;
+
+	p->windows++;
+	if (need > online) {
+		p->under++;
+		p->under_ms += elapsed_ms;
+	} else if (need < online) {
+		p->over++;
+		p->over_ms += elapsed_ms;
+	}
+
+	prev = p->nr_hist ? p->hist[0] : need;
+	memmove(&p->hist[1], &p->hist[0],
+			sizeof(p->hist[0]) * (HPGOV_HIST_SIZE - 1));
+	p->hist[0] = need;
+	if (p->nr_hist < HPGOV_HIST_SIZE)
+		p->nr_hist++;
+
+	for (i = 0; i < p->nr_hist; i++)
+		sum += p->hist[i];
+
+	pred = max(need, DIV_ROUND_UP(sum, p->nr_hist));
+	if (need > prev)
+		pred += need - prev;
+	pred = clamp(pred, 1, nr_big);
+
+	if (pred == online)
+		return online;
+
+	if (now_ms - p->period_start_ms >= MSEC_PER_SEC) {
+		p->period_start_ms = now_ms;
+		p->period_transitions = 0;
+	}
+
+	if (p->period_transitions >= max_transitions) {
+		p->throttled++;
+		return online;
+	}
+
+	p->period_transitions++;
+	p->transitions++;
+
+	return pred;
+}
+
+/* online CPUs of the normal mode, all of them unless predicted */
+static int hpgov_normal_cpu_min(void)
+{
+	if (exynos_hpgov.predict && exynos_hpgov.predicted)
+		return exynos_hpgov.nr_little + exynos_hpgov.predicted;
+
+	return 8;
+}
+
 static void start_slack_timer(void)
 {
 	if (!exynos_hpgov.enabled)
@@ -107,7 +224,7 @@ static enum hrtimer_restart exynos_hpgov_slack_timer(struct hrtimer *timer)
 
 	spin_lock_irqsave(&hpgov_lock, flags);
 	exynos_hpgov.data.event = HPGOV_SLACK_TIMER_EXPIRED;
-	exynos_hpgov.data.req_cpu_min = 8;
+	exynos_hpgov.data.req_cpu_min = hpgov_normal_cpu_min();
 	spin_unlock_irqrestore(&hpgov_lock, flags);
 
 	wake_up(&exynos_hpgov.wait_q);
@@ -125,7 +242,7 @@ static void exynos_hpgov_big_mode_update(int big_mode)
 	spin_lock_irqsave(&hpgov_lock, flags);
 	exynos_hpgov.data.event = HPGOV_BIG_MODE_UPDATED;
 	if (big_mode == BIG_NORMAL_MODE)
-		exynos_hpgov.data.req_cpu_min = 8;
+		exynos_hpgov.data.req_cpu_min = hpgov_normal_cpu_min();
 	else
 		exynos_hpgov.data.req_cpu_min = 5;
 	spin_unlock_irqrestore(&hpgov_lock, flags);
@@ -133,6 +250,67 @@ static void exynos_hpgov_big_mode_update(int big_mode)
 	irq_work_queue(&exynos_hpgov.update_irq_work);
 }
 
+static void exynos_hpgov_sample_timer(unsigned long data)
+{
+	unsigned long flags;
+	int cpu, busy = 0, need, online, cores;
+	bool update = false;
+	u64 now_ms, elapsed_ms, idle, wall;
+
+	if (!exynos_hpgov.enabled)
+		return;
+
+	for_each_cpu(cpu, &exynos_hpgov.big_mask) {
+		if (!cpu_online(cpu)) {
+			cpumask_clear_cpu(cpu, &exynos_hpgov.sampled);
+			continue;
+		}
+
+		idle = get_cpu_idle_time(cpu, &wall, 0);
+		if (cpumask_test_cpu(cpu, &exynos_hpgov.sampled) &&
+				wall > exynos_hpgov.prev_wall[cpu]) {
+			u64 d_wall = wall - exynos_hpgov.prev_wall[cpu];
+			u64 d_idle = min(idle - exynos_hpgov.prev_idle[cpu],
+					d_wall);
+
+			busy += div64_u64((d_wall - d_idle) * 100, d_wall);
+		}
+		exynos_hpgov.prev_idle[cpu] = idle;
+		exynos_hpgov.prev_wall[cpu] = wall;
+		cpumask_set_cpu(cpu, &exynos_hpgov.sampled);
+	}
+
+	now_ms = ktime_to_ms(ktime_get());
+	elapsed_ms = now_ms - exynos_hpgov.sample_ms;
+	exynos_hpgov.sample_ms = now_ms;
+
+	need = hpgov_pred_need(busy, hp_event_big_nr_running(),
+				exynos_hpgov.nr_big);
+
+	spin_lock_irqsave(&hpgov_lock, flags);
+	online = clamp(exynos_hpgov.cur_cpu_min - exynos_hpgov.nr_little,
+			1, exynos_hpgov.nr_big);
+	cores = hpgov_pred_window(&exynos_hpgov.pred, now_ms, elapsed_ms,
+			need, online, exynos_hpgov.nr_big,
+			exynos_hpgov.max_transitions);
+	if (exynos_hpgov.predict && cores != exynos_hpgov.predicted) {
+		exynos_hpgov.predicted = cores;
+		if (!exynos_hpgov.boost_cnt) {
+			exynos_hpgov.data.event = HPGOV_BIG_CORES_PREDICTED;
+			exynos_hpgov.data.req_cpu_min =
+					exynos_hpgov.nr_little + cores;
+			update = true;
+		}
+	}
+	spin_unlock_irqrestore(&hpgov_lock, flags);
+
+	if (update)
+		wake_up(&exynos_hpgov.wait_q);
+
+	mod_timer(&exynos_hpgov.sample_timer,
+		jiffies + msecs_to_jiffies(exynos_hpgov.window_ms));
+}
+
 static void exynos_hpgov_irq_work(struct irq_work *irq_work)
 {
 	wake_up(&exynos_hpgov.wait_q);
@@ -197,6 +375,7 @@ static int exynos_hpgov_update_governor(enum hpgov_event event, int req_cpu_max,
 	switch(event) {
 	case HPGOV_BIG_MODE_UPDATED:
 	case HPGOV_SLACK_TIMER_EXPIRED:
+	case HPGOV_BIG_CORES_PREDICTED:
 		exynos_hpgov.use_fast_hp = FAST_HP;
 
 	default:
@@ -338,7 +517,15 @@ static int exynos_hpgov_set_enabled(int enable)
 		exynos_hpgov.enabled = 1;
 		smp_wmb();
 		start_slack_timer();
+
+		cpumask_clear(&exynos_hpgov.sampled);
+		exynos_hpgov.sample_ms = ktime_to_ms(ktime_get());
+		mod_timer(&exynos_hpgov.sample_timer,
+			jiffies + msecs_to_jiffies(exynos_hpgov.window_ms));
 	} else {
+		del_timer_sync(&exynos_hpgov.sample_timer);
+		exynos_hpgov.predicted = 0;
+
 		kthread_stop(exynos_hpgov.hptask);
 		kthread_stop(exynos_hpgov.task);
 
@@ -368,6 +555,116 @@ static int exynos_hpgov_set_dual_change_ms(int val)
 	return 0;
 }
 
+static int exynos_hpgov_set_predict(int val)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&hpgov_lock, flags);
+	exynos_hpgov.predict = !!val;
+	exynos_hpgov.predicted = 0;
+	spin_unlock_irqrestore(&hpgov_lock, flags);
+
+	/* back to the normal mode of the new policy */
+	if (!exynos_hpgov.boost_cnt)
+		exynos_hpgov_big_mode_update(BIG_NORMAL_MODE);
+
+	return 0;
+}
+
+static int exynos_hpgov_set_window_ms(int val)
+{
+	if (val < 10 || val > 1000)
+		return -EINVAL;
+
+	exynos_hpgov.window_ms = val;
+	return 0;
+}
+
+static int exynos_hpgov_set_max_transitions(int val)
+{
+	if (val < 1)
+		return -EINVAL;
+
+	exynos_hpgov.max_transitions = val;
+	return 0;
+}
+
+static ssize_t hpgov_pred_show(struct hpgov_pred *p, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE,
+		"windows %llu\ntransitions %llu\nthrottled %llu\n"
+		"under %llu %llums\nover %llu %llums\n",
+		p->windows, p->transitions, p->throttled,
+		p->under, p->under_ms, p->over, p->over_ms);
+}
+
+static ssize_t exynos_hpgov_attr_stats_show(struct kobject *kobj,
+			struct kobj_attribute *attr, char *buf)
+{
+	struct hpgov_pred pred;
+	unsigned long flags;
+
+	spin_lock_irqsave(&hpgov_lock, flags);
+	pred = exynos_hpgov.pred;
+	spin_unlock_irqrestore(&hpgov_lock, flags);
+
+	return hpgov_pred_show(&pred, buf);
+}
+
+static ssize_t exynos_hpgov_attr_replay_show(struct kobject *kobj,
+			struct kobj_attribute *attr, char *buf)
+{
+	ssize_t ret;
+
+	mutex_lock(&exynos_hpgov.attrib_lock);
+	ret = hpgov_pred_show(&exynos_hpgov.replay, buf);
+	mutex_unlock(&exynos_hpgov.attrib_lock);
+
+	return ret;
+}
+
+/*
+ * Replays a recorded load trace through the predictor without hotplugging.
+ * The trace is a list of "<busy %>,<nr_running>" of the big cluster, one
+ * per window of window_ms.
+ */
+static ssize_t exynos_hpgov_attr_replay_store(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	struct hpgov_pred *p = &exynos_hpgov.replay;
+	char *trace, *cur, *tok;
+	int busy, nr_running, online;
+	u64 now_ms = 0;
+
+	trace = kstrndup(buf, count, GFP_KERNEL);
+	if (!trace)
+		return -ENOMEM;
+
+	mutex_lock(&exynos_hpgov.attrib_lock);
+
+	memset(p, 0, sizeof(*p));
+	online = exynos_hpgov.nr_big;
+
+	cur = trace;
+	while ((tok = strsep(&cur, " \t\n")) != NULL) {
+		if (sscanf(tok, "%d,%d", &busy, &nr_running) != 2)
+			continue;
+
+		now_ms += exynos_hpgov.window_ms;
+		online = hpgov_pred_window(p, now_ms, exynos_hpgov.window_ms,
+				hpgov_pred_need(busy, nr_running,
+					exynos_hpgov.nr_big),
+				online, exynos_hpgov.nr_big,
+				exynos_hpgov.max_transitions);
+	}
+
+	mutex_unlock(&exynos_hpgov.attrib_lock);
+
+	kfree(trace);
+
+	return count;
+}
+
 #define HPGOV_PARAM(_name, _param) \
 static ssize_t exynos_hpgov_attr_##_name##_show(struct kobject *kobj, \
 			struct kobj_attribute *attr, char *buf) \
@@ -405,8 +702,24 @@ static ssize_t exynos_hpgov_attr_##_name##_store(struct kobject *kobj, \
 	exynos_hpgov.attrib._name.store = exynos_hpgov_attr_##_name##_store; \
 	exynos_hpgov.attrib.attrib_group.attrs[i] = &exynos_hpgov.attrib._name.attr;
 
+#define HPGOV_RO_ATTRIB(i, _name) \
+	exynos_hpgov.attrib._name.attr.name = __stringify(_name); \
+	exynos_hpgov.attrib._name.attr.mode = S_IRUGO; \
+	exynos_hpgov.attrib._name.show = exynos_hpgov_attr_##_name##_show; \
+	exynos_hpgov.attrib.attrib_group.attrs[i] = &exynos_hpgov.attrib._name.attr;
+
+#define HPGOV_RAW_RW_ATTRIB(i, _name) \
+	exynos_hpgov.attrib._name.attr.name = __stringify(_name); \
+	exynos_hpgov.attrib._name.attr.mode = S_IRUGO | S_IWUSR; \
+	exynos_hpgov.attrib._name.show = exynos_hpgov_attr_##_name##_show; \
+	exynos_hpgov.attrib._name.store = exynos_hpgov_attr_##_name##_store; \
+	exynos_hpgov.attrib.attrib_group.attrs[i] = &exynos_hpgov.attrib._name.attr;
+
 HPGOV_PARAM(enabled, exynos_hpgov.enabled);
 HPGOV_PARAM(dual_change_ms, exynos_hpgov.dual_change_ms);
+HPGOV_PARAM(predict, exynos_hpgov.predict);
+HPGOV_PARAM(window_ms, exynos_hpgov.window_ms);
+HPGOV_PARAM(max_transitions, exynos_hpgov.max_transitions);
 
 static void hpgov_boot_enable(struct work_struct *work);
 static DECLARE_DELAYED_WORK(hpgov_boot_work, hpgov_boot_enable);
@@ -419,7 +732,7 @@ static void hpgov_boot_enable(struct work_struct *work)
 static int __init exynos_hpgov_init(void)
 {
 	int ret = 0;
-	const int attr_count = 5;
+	const int attr_count = 8;
 	int i_attr = attr_count;
 
 	hrtimer_init(&exynos_hpgov.slack_timer, CLOCK_MONOTONIC,
@@ -427,6 +740,16 @@ static int __init exynos_hpgov_init(void)
 
 	exynos_hpgov.slack_timer.function = exynos_hpgov_slack_timer;
 
+	__setup_timer(&exynos_hpgov.sample_timer, exynos_hpgov_sample_timer,
+			0, TIMER_DEFERRABLE);
+
+	/* the boot cluster is the little one */
+	cpumask_andnot(&exynos_hpgov.big_mask, cpu_possible_mask,
+			topology_core_cpumask(0));
+	exynos_hpgov.nr_big = max_t(int, 1,
+			cpumask_weight(&exynos_hpgov.big_mask));
+	exynos_hpgov.nr_little = cpumask_weight(topology_core_cpumask(0));
+
 	mutex_init(&exynos_hpgov.attrib_lock);
 	init_waitqueue_head(&exynos_hpgov.wait_q);
 	init_waitqueue_head(&exynos_hpgov.wait_hpq);
@@ -442,6 +765,11 @@ static int __init exynos_hpgov_init(void)
 
 	HPGOV_RW_ATTRIB(attr_count - (i_attr--), enabled);
 	HPGOV_RW_ATTRIB(attr_count - (i_attr--), dual_change_ms);
+	HPGOV_RW_ATTRIB(attr_count - (i_attr--), predict);
+	HPGOV_RW_ATTRIB(attr_count - (i_attr--), window_ms);
+	HPGOV_RW_ATTRIB(attr_count - (i_attr--), max_transitions);
+	HPGOV_RO_ATTRIB(attr_count - (i_attr--), stats);
+	HPGOV_RAW_RW_ATTRIB(attr_count - (i_attr--), replay);
 
 	exynos_hpgov.attrib.attrib_group.name = "governor";
 	ret = sysfs_create_group(exynos_cpu_hotplug_kobj(), &exynos_hpgov.attrib.attrib_group);
@@ -449,6 +777,8 @@ static int __init exynos_hpgov_init(void)
 		pr_err("Unable to create sysfs objects :%d\n", ret);
 
 	exynos_hpgov.dual_change_ms = DEFAULT_DUAL_CHANGE_MS;
+	exynos_hpgov.window_ms = DEFAULT_WINDOW_MS;
+	exynos_hpgov.max_transitions = DEFAULT_MAX_TRANSITIONS;
 	exynos_hpgov.cur_cpu_max = PM_QOS_CPU_ONLINE_MAX_DEFAULT_VALUE;
 	exynos_hpgov.cur_cpu_min = PM_QOS_CPU_ONLINE_MIN_DEFAULT_VALUE;
 
@@ -17,6 +17,7 @@
 #include <net/sock.h>
 #include <linux/hrtimer.h>
 #include <linux/proc_fs.h>
+#include <linux/uaccess.h>
 
 
 #define RET_OK   0
@@ -151,12 +152,27 @@ int mod_sendmsg(int type, int mod, struct priv_data* data)
 	if ((ret = nlmsg_unicast(kfreecess_mod_sock, skb, payload->dst_portid)) < 0) {
 		pr_err("nlmsg_unicast failed! %s errno %d\n", __func__ , ret);
 		return RET_ERR;
-	} else
-		pr_info("nlmsg_unicast snd msg success\n");
+	}
 
 	return RET_OK;
 }
 
+/*
+ * Report to the daemon: through the shared ring if it is mapped, else netlink.
+ * A report dropped on a full ring fails.
+ */
+static int freecess_send(int mod, struct priv_data *data)
+{
+	int flag = (mod == MOD_PKG) ? data->pkg_info.cmd : data->flag;
+	int ret;
+
+	ret = freecess_ring_report(mod, data->caller_pid, data->target_uid, flag);
+	if (ret != -ENODEV)
+		return ret;
+
+	return mod_sendmsg(MSG_TO_USER, mod, data);
+}
+
 int sig_report(struct task_struct *caller, struct task_struct *p)
 {
 	int ret = RET_OK;
@@ -175,13 +191,13 @@ int sig_report(struct task_struct *caller, struct task_struct *p)
 	if (thread_group_is_frozen(p) && (target_pid != last_kill_pid)) {
 		last_kill_pid = target_pid;
 		stat = &freecess_info.mod_reportstat[MOD_SIG];
-		ret = mod_sendmsg(MSG_TO_USER, MOD_SIG, &data);
+		ret = freecess_send(MOD_SIG, &data);
 
 		spin_lock_irqsave(&stat->lock, flags);
 		if (ret < 0) {
 			stat->data.report_fail_count++;
 			stat->data.report_fail_from_windowstart++;
-			pr_err("sig_report error\n");
+			pr_err_ratelimited("sig_report error\n");
 		} else {
 			stat->data.report_suc_count++;
 			stat->data.report_suc_from_windowstart++;
@@ -216,13 +232,13 @@ int binder_report(struct task_struct *caller, struct task_struct *p, int flag)
 
 	walltime = ktime_to_us(ktime_get());
 	if (p && thread_group_is_frozen(p)) {
-		ret = mod_sendmsg(MSG_TO_USER, MOD_BINDER, &data);
+		ret = freecess_send(MOD_BINDER, &data);
 		stat = &freecess_info.mod_reportstat[MOD_BINDER];
 		spin_lock_irqsave(&stat->lock, flags);
 		if (ret < 0) {
 			stat->data.report_fail_count++;
 			stat->data.report_fail_from_windowstart++;
-			pr_err("binder_report error\n");
+			pr_err_ratelimited("binder_report error\n");
 		} else {
 			stat->data.report_suc_count++;
 			stat->data.report_suc_from_windowstart++;
@@ -249,7 +265,7 @@ int pkg_report(int target_uid)
 	data.target_uid = target_uid;
 	data.pkg_info.uid = (uid_t)target_uid;
 	walltime = ktime_to_us(ktime_get());
-	ret = mod_sendmsg(MSG_TO_USER, MOD_PKG, &data);
+	ret = freecess_send(MOD_PKG, &data);
 	stat = &freecess_info.mod_reportstat[MOD_PKG];
 	spin_lock_irqsave(&stat->lock, flags);
 	if (ret < 0) {
@@ -445,6 +461,64 @@ static const struct file_operations pkg_stat_proc_fops = {
 	.release  = single_release,
 };
 
+static int ring_stat_open(struct inode *inode, struct file *file)
+{
+	 return single_open(file, freecess_ring_stat_show, NULL);
+}
+
+static const struct file_operations ring_stat_proc_fops = {
+	.open     = ring_stat_open,
+	.read     = seq_read,
+	.llseek   = seq_lseek,
+	.release  = single_release,
+};
+
+#ifdef CONFIG_SAMSUNG_FREECESS_STRESS
+/*
+ * Stress interface: writing "<count> [<uids>]" queues count synthetic
+ * binder and signal reports, alternating, on the writer's CPU ring, to
+ * target uids UID_MIN_VALUE .. UID_MIN_VALUE + uids - 1. They only go to
+ * the ring, never to the daemon over netlink, so the write fails with
+ * -ENODEV while no reader has the ring open.
+ */
+#define STRESS_MAX_EVENTS	10000000
+
+static ssize_t freecess_stress_write(struct file *filp, const char __user *buf, size_t count, loff_t *f_ops)
+{
+	char kbuf[32];
+	unsigned int events, uids = 1, i;
+	int caller_pid = task_tgid_nr(current);
+	int ret;
+
+	if (count >= sizeof(kbuf))
+		return -EINVAL;
+	if (copy_from_user(kbuf, buf, count))
+		return -EFAULT;
+	kbuf[count] = '\0';
+
+	if (sscanf(kbuf, "%u %u", &events, &uids) < 1)
+		return -EINVAL;
+	if (!events || events > STRESS_MAX_EVENTS || !uids)
+		return -EINVAL;
+
+	for (i = 0; i < events; i++) {
+		ret = freecess_ring_report((i & 1) ? MOD_SIG : MOD_BINDER,
+				caller_pid, UID_MIN_VALUE + i % uids, 0);
+		/* dropped reports are counted in the ring header */
+		if (ret && ret != -ENOSPC)
+			return ret;
+		cond_resched();
+	}
+
+	return count;
+}
+
+static const struct file_operations stress_proc_fops = {
+	.write    = freecess_stress_write,
+	.llseek   = noop_llseek,
+};
+#endif
+
 static int freecess_modstat_show(struct seq_file *m, void *v)
 {
 	int i;
@@ -589,6 +663,15 @@ static int __init kfreecess_init(void)
 		}
 	}
 
+	if (freecess_rootdir) {
+		if (!proc_create("ringstat", 0444, freecess_rootdir, &ring_stat_proc_fops))
+			pr_err("create /proc/freecess/ringstat failed\n");
+#ifdef CONFIG_SAMSUNG_FREECESS_STRESS
+		if (!proc_create("stress", 0200, freecess_rootdir, &stress_proc_fops))
+			pr_err("create /proc/freecess/stress failed\n");
+#endif
+	}
+
 	freecess_runinfo_init(&freecess_info);
 	atomic_set(&kfreecess_init_suc, 1);
 	return RET_OK;
@@ -603,6 +686,10 @@ static void __exit kfreecess_exit(void)
 		remove_proc_entry("windowstat", freecess_rootdir);
 		remove_proc_entry("modstat", freecess_rootdir);
 		remove_proc_entry("pkgstat", freecess_rootdir);
+		remove_proc_entry("ringstat", freecess_rootdir);
+#ifdef CONFIG_SAMSUNG_FREECESS_STRESS
+		remove_proc_entry("stress", freecess_rootdir);
+#endif
 		remove_proc_entry("freecess", NULL);
 	}
 }
@@ -0,0 +1,321 @@
+/*
+ * Shared memory event channel for freecess
+ *
+ * Every CPU has a ring of events that the freecess daemon maps from
+ * /dev/freecess_ring, see uapi/freecess_ring.h. Reports are staged past
+ * the published head and, while staged, coalesced per target uid and
+ * module. They are published in batches, once wakeup_batch events are
+ * staged or flush_ms after the first one, and the daemon is woken through
+ * poll(). While no daemon has the ring open, reports go out over netlink
+ * as before.
+ *
+ * The ring has a single consumer: every live report moves off netlink
+ * while it is open, so a second open is refused with -EBUSY.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/capability.h>
+#include <linux/cred.h>
+#include <linux/freecess.h>
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/percpu.h>
+#include <linux/poll.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/timer.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#include "uapi/freecess_ring.h"
+
+#define FREECESS_SYSTEM_UID	1000
+
+struct freecess_ring {
+	spinlock_t lock;
+	void *base;
+	struct freecess_ring_header *hdr;
+	struct freecess_ring_event *events;
+	u32 size;
+	u32 head;	/* published, the kernel's copy of hdr->head */
+	u32 staged;	/* events written past head, not yet published */
+	bool full;
+};
+
+static DEFINE_PER_CPU(struct freecess_ring, freecess_rings);
+static DECLARE_WAIT_QUEUE_HEAD(freecess_ring_wait);
+static atomic_t freecess_ring_users;
+static bool freecess_ring_ready;
+
+/* Event pages per CPU, rounded up to a power of two */
+static unsigned int ring_pages = 4;
+module_param(ring_pages, uint, 0444);
+
+/* Staged events that trigger a publish and wake the daemon */
+static unsigned int wakeup_batch = 16;
+module_param(wakeup_batch, uint, 0644);
+
+/* Longest an event stays staged */
+static unsigned int flush_ms = 20;
+module_param(flush_ms, uint, 0644);
+
+static void freecess_ring_flush(unsigned long unused);
+static DEFINE_TIMER(freecess_ring_timer, freecess_ring_flush, 0, 0);
+
+/* Called with ring->lock held */
+static bool freecess_ring_publish(struct freecess_ring *ring)
+{
+	if (!ring->staged)
+		return false;
+
+	ring->head += ring->staged;
+	ring->hdr->published += ring->staged;
+	ring->staged = 0;
+	/* The events must be visible before the head that covers them */
+	smp_store_release(&ring->hdr->head, ring->head);
+
+	return true;
+}
+
+static void freecess_ring_flush(unsigned long unused)
+{
+	struct freecess_ring *ring;
+	unsigned long flags;
+	bool wake = false;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		ring = per_cpu_ptr(&freecess_rings, cpu);
+		spin_lock_irqsave(&ring->lock, flags);
+		wake |= freecess_ring_publish(ring);
+		spin_unlock_irqrestore(&ring->lock, flags);
+	}
+
+	if (wake)
+		wake_up_interruptible(&freecess_ring_wait);
+}
+
+/*
+ * Queue a report on this CPU's ring. Returns -ENODEV when no daemon has
+ * the ring open, so that the caller falls back to netlink, and -ENOSPC
+ * when the ring is full and the report is dropped.
+ */
+int freecess_ring_report(int mod, int caller_pid, int target_uid, int flag)
+{
+	struct freecess_ring *ring;
+	struct freecess_ring_event *ev;
+	unsigned long flags;
+	u32 i, tail, batch;
+	bool wake = false;
+	int ret = 0;
+
+	if (!freecess_ring_ready || !atomic_read(&freecess_ring_users))
+		return -ENODEV;
+
+	local_irq_save(flags);
+	ring = this_cpu_ptr(&freecess_rings);
+	spin_lock(&ring->lock);
+
+	/* The first report's caller and flag are kept */
+	for (i = 0; i < ring->staged; i++) {
+		ev = &ring->events[(ring->head + i) & (ring->size - 1)];
+		if (ev->target_uid == target_uid && ev->mod == mod) {
+			ev->count++;
+			ring->hdr->coalesced++;
+			goto out;
+		}
+	}
+
+	/* Pairs with the daemon's release of tail once it read the events */
+	tail = smp_load_acquire(&ring->hdr->tail);
+	if (ring->head + ring->staged - tail >= ring->size) {
+		ring->hdr->dropped++;
+		if (!ring->full) {
+			ring->full = true;
+			ring->hdr->overflows++;
+		}
+		ret = -ENOSPC;
+		goto out;
+	}
+	ring->full = false;
+
+	ev = &ring->events[(ring->head + ring->staged) & (ring->size - 1)];
+	ev->mod = mod;
+	ev->caller_pid = caller_pid;
+	ev->target_uid = target_uid;
+	ev->flag = flag;
+	ev->count = 1;
+	ev->timestamp = ktime_get_ns();
+	ring->staged++;
+
+	batch = clamp_t(u32, READ_ONCE(wakeup_batch), 1, ring->size);
+	if (ring->staged >= batch)
+		wake = freecess_ring_publish(ring);
+	else if (ring->staged == 1 && !timer_pending(&freecess_ring_timer))
+		mod_timer(&freecess_ring_timer,
+			  jiffies + msecs_to_jiffies(flush_ms));
+out:
+	spin_unlock(&ring->lock);
+	local_irq_restore(flags);
+
+	if (wake)
+		wake_up_interruptible(&freecess_ring_wait);
+
+	return ret;
+}
+
+int freecess_ring_stat_show(struct seq_file *m, void *v)
+{
+	struct freecess_ring *ring;
+	unsigned long flags;
+	u64 published, coalesced, dropped, overflows;
+	u32 pending;
+	int cpu;
+
+	if (!freecess_ring_ready) {
+		seq_printf(m, "ring not available\n");
+		return 0;
+	}
+
+	seq_printf(m, "users: %d\n", atomic_read(&freecess_ring_users));
+	seq_printf(m, "cpu\tpending\tpublished\tcoalesced\tdropped\toverflows\n");
+	for_each_possible_cpu(cpu) {
+		ring = per_cpu_ptr(&freecess_rings, cpu);
+		spin_lock_irqsave(&ring->lock, flags);
+		pending = ring->head + ring->staged - READ_ONCE(ring->hdr->tail);
+		published = ring->hdr->published;
+		coalesced = ring->hdr->coalesced;
+		dropped = ring->hdr->dropped;
+		overflows = ring->hdr->overflows;
+		spin_unlock_irqrestore(&ring->lock, flags);
+
+		seq_printf(m, "%d\t%u\t%llu\t%llu\t%llu\t%llu\n", cpu, pending,
+			   published, coalesced, dropped, overflows);
+	}
+
+	return 0;
+}
+
+static int freecess_ring_open(struct inode *inode, struct file *file)
+{
+	/* Same rule as the netlink channel: only the system user */
+	if (!uid_eq(current_uid(), KUIDT_INIT(FREECESS_SYSTEM_UID)) &&
+			!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	if (atomic_cmpxchg(&freecess_ring_users, 0, 1))
+		return -EBUSY;
+
+	return 0;
+}
+
+static int freecess_ring_release(struct inode *inode, struct file *file)
+{
+	atomic_dec(&freecess_ring_users);
+	return 0;
+}
+
+static int freecess_ring_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	unsigned long pages = ring_pages + 1;
+	unsigned long cpu = vma->vm_pgoff / pages;
+
+	if (vma->vm_pgoff % pages || vma_pages(vma) != pages)
+		return -EINVAL;
+
+	if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -ENXIO;
+
+	return remap_vmalloc_range(vma, per_cpu(freecess_rings, cpu).base, 0);
+}
+
+static unsigned int freecess_ring_poll(struct file *file, poll_table *wait)
+{
+	struct freecess_ring *ring;
+	int cpu;
+
+	poll_wait(file, &freecess_ring_wait, wait);
+
+	for_each_possible_cpu(cpu) {
+		ring = per_cpu_ptr(&freecess_rings, cpu);
+		if (READ_ONCE(ring->hdr->head) != READ_ONCE(ring->hdr->tail))
+			return POLLIN | POLLRDNORM;
+	}
+
+	return 0;
+}
+
+static long freecess_ring_ioctl(struct file *file, unsigned int cmd,
+				unsigned long arg)
+{
+	switch (cmd) {
+	case FREECESS_RING_IOC_PAGES:
+		return put_user((u32)(ring_pages + 1), (u32 __user *)arg);
+	case FREECESS_RING_IOC_FLUSH:
+		freecess_ring_flush(0);
+		return 0;
+	default:
+		return -ENOTTY;
+	}
+}
+
+static const struct file_operations freecess_ring_fops = {
+	.owner		= THIS_MODULE,
+	.open		= freecess_ring_open,
+	.release	= freecess_ring_release,
+	.mmap		= freecess_ring_mmap,
+	.poll		= freecess_ring_poll,
+	.unlocked_ioctl	= freecess_ring_ioctl,
+	.compat_ioctl	= freecess_ring_ioctl,
+};
+
+static struct miscdevice freecess_ring_dev = {
+	.minor	= MISC_DYNAMIC_MINOR,
+	.name	= "freecess_ring",
+	.fops	= &freecess_ring_fops,
+};
+
+static int __init freecess_ring_init(void)
+{
+	struct freecess_ring *ring;
+	int cpu, ret;
+
+	ring_pages = roundup_pow_of_two(max(ring_pages, 1U));
+
+	for_each_possible_cpu(cpu) {
+		ring = per_cpu_ptr(&freecess_rings, cpu);
+		spin_lock_init(&ring->lock);
+		ring->base = vmalloc_user((ring_pages + 1) * PAGE_SIZE);
+		if (!ring->base) {
+			ret = -ENOMEM;
+			goto err;
+		}
+
+		ring->hdr = ring->base;
+		ring->events = ring->base + PAGE_SIZE;
+		ring->size = ring_pages * PAGE_SIZE /
+				sizeof(struct freecess_ring_event);
+		ring->hdr->version = FREECESS_RING_VERSION;
+		ring->hdr->size = ring->size;
+	}
+
+	ret = misc_register(&freecess_ring_dev);
+	if (ret) {
+		pr_err("%s: register freecess_ring device failed %d\n",
+			__func__, ret);
+		goto err;
+	}
+
+	freecess_ring_ready = true;
+	return 0;
+err:
+	for_each_possible_cpu(cpu) {
+		ring = per_cpu_ptr(&freecess_rings, cpu);
+		vfree(ring->base);
+		ring->base = NULL;
+	}
+	return ret;
+}
+device_initcall(freecess_ring_init);
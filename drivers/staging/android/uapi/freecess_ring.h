@@ -0,0 +1,53 @@
+/*
+ * drivers/staging/android/uapi/freecess_ring.h
+ *
+ * Shared memory event channel between freecess and its daemon.
+ *
+ * Each CPU has its own ring. The daemon maps it from /dev/freecess_ring
+ * at offset cpu * FREECESS_RING_IOC_PAGES pages: a header page followed by
+ * the events. The kernel advances head, the daemon consumes the events up
+ * to head and then advances tail. Both are free running counters, an
+ * event lives at index (counter & (size - 1)).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _UAPI_LINUX_FREECESS_RING_H
+#define _UAPI_LINUX_FREECESS_RING_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+#define FREECESS_RING_VERSION	1
+
+struct freecess_ring_event {
+	__s32	mod;		/* MOD_BINDER, MOD_SIG, MOD_PKG */
+	__s32	caller_pid;
+	__s32	target_uid;
+	__s32	flag;		/* binder flag, or pkg_cmd_t for MOD_PKG */
+	__u32	count;		/* reports coalesced into this event */
+	__u32	reserved;
+	__u64	timestamp;	/* CLOCK_MONOTONIC ns of the first report */
+};
+
+struct freecess_ring_header {
+	__u32	version;
+	__u32	size;		/* events in the ring, a power of two */
+	__u32	head;		/* written by the kernel */
+	__u32	__pad0[13];
+	__u32	tail;		/* written by the daemon */
+	__u32	__pad1[15];
+	__u64	published;	/* events made visible */
+	__u64	coalesced;	/* reports merged into a pending event */
+	__u64	dropped;	/* reports lost, the ring was full */
+	__u64	overflows;	/* times the ring filled up */
+};
+
+/* Pages to map per CPU, header page included */
+#define FREECESS_RING_IOC_PAGES	_IOR('F', 1, __u32)
+/* Publish the pending events of all CPUs now */
+#define FREECESS_RING_IOC_FLUSH	_IO('F', 2)
+
+#endif /* _UAPI_LINUX_FREECESS_RING_H */
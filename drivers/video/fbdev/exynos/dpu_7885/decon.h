@@ -589,6 +589,7 @@ struct decon_dma_buf_data {
 	struct sg_table			*sg_table;
 	dma_addr_t			dma_addr;
 	struct sync_fence		*fence;
+	bool				iova_cached;
 };
 
 struct decon_win_rect {
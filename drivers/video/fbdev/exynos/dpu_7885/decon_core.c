@@ -30,6 +30,7 @@
 #include <linux/of_address.h>
 #include <linux/debugfs.h>
 #include <linux/pinctrl/consumer.h>
+#include <linux/input.h>
 #include <video/mipi_display.h>
 #include <media/v4l2-subdev.h>
 #include <soc/samsung/exynos-powermode.h>
@@ -322,7 +323,11 @@ static void decon_free_dma_buf(struct decon_device *decon,
 	if (dma->fence)
 		sync_fence_put(dma->fence);
 
-	ion_iovmm_unmap(dma->attachment, dma->dma_addr);
+	if (dma->iova_cached)
+		iovmm_unmap_dmabuf(dma->attachment->dev, dma->dma_buf,
+				dma->dma_addr);
+	else
+		ion_iovmm_unmap(dma->attachment, dma->dma_addr);
 
 	dma_buf_unmap_attachment(dma->attachment, dma->sg_table,
 			DMA_TO_DEVICE);
@@ -1049,11 +1054,13 @@ int decon_set_vsync_int(struct fb_info *info, bool active)
 
 static unsigned int decon_map_ion_handle(struct decon_device *decon,
 		struct device *dev, struct decon_dma_buf_data *dma,
-		struct ion_handle *ion_handle, struct dma_buf *buf, int win_no)
+		struct ion_handle *ion_handle, struct dma_buf *buf, int win_no,
+		bool protection)
 {
 
 	dma->fence = NULL;
 	dma->dma_buf = buf;
+	dma->iova_cached = false;
 
 	dma->attachment = dma_buf_attach(dma->dma_buf, dev);
 	if (IS_ERR_OR_NULL(dma->attachment)) {
@@ -1070,9 +1077,20 @@ static unsigned int decon_map_ion_handle(struct decon_device *decon,
 		goto err_buf_map_attachment;
 	}
 
-	/* This is DVA(Device Virtual Address) for setting base address SFR */
-	dma->dma_addr = ion_iovmm_map(dma->attachment, 0,
-			dma->dma_buf->size, DMA_TO_DEVICE, 0);
+	/*
+	 * This is DVA(Device Virtual Address) for setting base address SFR.
+	 * Gralloc buffers come back every frame, so their DVA is kept in the
+	 * IOVMM dma-buf cache. Protected buffers have their DVA from ION.
+	 */
+	if (protection) {
+		dma->dma_addr = ion_iovmm_map(dma->attachment, 0,
+				dma->dma_buf->size, DMA_TO_DEVICE, 0);
+	} else {
+		dma->dma_addr = iovmm_map_dmabuf(dev, dma->dma_buf,
+				dma->sg_table->sgl, 0, dma->dma_buf->size,
+				DMA_TO_DEVICE, 0);
+		dma->iova_cached = true;
+	}
 	if (!dma->dma_addr || IS_ERR_VALUE(dma->dma_addr)) {
 		decon_err("iovmm_map() failed: %pa\n", &dma->dma_addr);
 		goto err_iovmm_map;
@@ -1130,7 +1148,8 @@ static int decon_import_buffer(struct decon_device *decon, int idx,
 		decon_dbg("get subdevdata\n");
 		dpp = v4l2_get_subdevdata(decon->dpp_sd[config->idma_type]);
 		buf_size = decon_map_ion_handle(decon, dpp->dev,
-				&dma_buf_data[i], handle, buf, idx);
+				&dma_buf_data[i], handle, buf, idx,
+				config->protection);
 		if (!buf_size) {
 			decon_err("failed to map buffer\n");
 			ret = -ENOMEM;
@@ -1712,12 +1731,29 @@ static void decon_update_regs_handler(struct kthread_work *work)
 
 	struct decon_reg_data *data, *next;
 	struct list_head saved_list;
+	unsigned int queued = 0;
 
 	mutex_lock(&decon->up.lock);
 	saved_list = decon->up.list;
 	list_replace_init(&decon->up.list, &saved_list);
 	mutex_unlock(&decon->up.lock);
 
+	/*
+	 * win_config queues one entry per composed frame and this worker
+	 * applies them in order, each waiting for its acquire fences and
+	 * its vsync. The worker normally finds a single entry. Finding more
+	 * means the frames behind the first were composed while the earlier
+	 * update was still pending (a slow fence or a vsync wait), so each
+	 * of them reaches the panel at least one vsync later than it was
+	 * composed for: a missed frame. Frames the composer itself is late
+	 * with never queue up and are not seen here. Only DECON0, the main
+	 * panel, reports to the input booster.
+	 */
+	list_for_each_entry(data, &saved_list, list)
+		queued++;
+	if (decon->id == 0 && queued > 1)
+		input_booster_frame_miss(queued - 1);
+
 	list_for_each_entry_safe(data, next, &saved_list, list) {
 		decon_update_regs(decon, data);
 		decon_hiber_unblock(decon);
@@ -2451,7 +2487,7 @@ static int decon_fb_alloc_memory(struct decon_device *decon, struct decon_win *w
 
 	dpp = v4l2_get_subdevdata(decon->dpp_sd[decon->dt.dft_idma]);
 	ret = decon_map_ion_handle(decon, dpp->dev, &win->dma_buf_data[0],
-			handle, buf, win->idx);
+			handle, buf, win->idx, false);
 	if (!ret)
 		goto err_map;
 	map_dma = win->dma_buf_data[0].dma_addr;
@@ -68,6 +68,14 @@
 #define SCORE_READ_REG(offset)		score_read_reg(offset)
 #define SCORE_WRITE_REG(data, offset)	score_write_reg(data,offset)
 
+/* ring registers, relative to the SFR block of the queue */
+#define SCORE_QUEUE_READ_REG(queue, offset)	\
+	readl((queue)->sfr + (offset))
+#define SCORE_QUEUE_WRITE_REG(queue, data, offset)	\
+	writel((data), (queue)->sfr + (offset))
+#define SCORE_QUEUE_WRITE_REG_RELAXED(queue, data, offset)	\
+	writel_relaxed((data), (queue)->sfr + (offset))
+
 #define SCORE_CACHE_OFFSET(va)		\
 	(virt_to_phys(va) - SCORE_READ_REG(SCORE_DATA_START_ADDR))
 
@@ -131,9 +139,11 @@ struct score_ipc_packet {
 };
 /* @} */
 
+/* a packet waiting for room in the in queue, in the words the ring takes */
 struct score_fw_param_list {
-	struct score_ipc_packet *p;
 	struct list_head p_list;
+	unsigned int size;
+	unsigned int words[0];
 };
 
 struct score_fw_pending_param {
@@ -142,17 +152,37 @@ struct score_fw_pending_param {
 	struct work_struct	param_work;
 };
 
+struct score_fw_queue_stats {
+	unsigned long		packets;
+	unsigned long		doorbells;
+	unsigned long		tail_reads;
+	unsigned long		pended;
+};
+
+/*
+ * The in queue has a single producer and the out queue a single consumer,
+ * so the ring indexes are not protected by a lock. head_cache is the head
+ * last published by the host and tail_cache the last tail read back from
+ * the firmware; the tail register is only read when the cached value says
+ * the ring is too full. While pending_count is not zero every packet goes
+ * through the pending list, whose writer is serialized by its lock.
+ */
 struct score_fw_queue {
 	enum score_fw_queue_type   type;
+	void __iomem		*sfr;
 	unsigned int		head_info;
 	unsigned int		tail_info;
 	unsigned int		start;
 	unsigned int		size;
+	unsigned int		head_cache;
+	unsigned int		tail_cache;
+	atomic_t		pending_count;
 	atomic_t		task_id;
 	struct mutex		lock;
 	spinlock_t		slock;
 	struct list_head	wait_list;
 	struct score_fw_pending_param pending_param;
+	struct score_fw_queue_stats stats;
 };
 
 /* For SCORE firmware */
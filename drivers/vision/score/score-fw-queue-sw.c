@@ -0,0 +1,334 @@
+/*
+ * Software stand-in for the SCORE firmware side of the in queue
+ *
+ * Sets up an in queue over a zeroed memory copy of the SFR block and runs
+ * a kthread that consumes it as the firmware does: it waits for the head
+ * to move, reads each packet word by word, checks the packets arrive in
+ * order, optionally spends a fixed time per packet, and advances the tail.
+ * The producer side is the driver's own score_fw_queue_put_batch(), so
+ * the ring protocol, the doorbell batching and the pending-list fallback
+ * can be measured without the DSP.
+ *
+ * debugfs, in score-fw-queue-sw/:
+ *	bench	write "<packets> [<batch> [<params> [<dsp ns>]]]" to push
+ *		packets of <params> words, <batch> per doorbell, through the
+ *		queue; read back the result
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/delay.h>
+#include <linux/fs.h>
+#include <linux/init.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+
+#include "score-fw-queue.h"
+#include "score-fw-common.h"
+
+#define FW_QUEUE_SW_MAX_PACKETS		(1U << 22)
+#define FW_QUEUE_SW_MAX_BATCH		(64)
+#define FW_QUEUE_SW_MAX_DSP_NS		(100 * NSEC_PER_USEC)
+/* distinct packets, cycled through so that their order can be checked */
+#define FW_QUEUE_SW_TASKS		(128)
+/* the bench holds the producer back rather than queueing without bound */
+#define FW_QUEUE_SW_MAX_PENDING		(1024)
+#define FW_QUEUE_SW_TIMEOUT		(30 * HZ)
+
+struct fw_queue_sw_dsp {
+	struct score_fw_queue	*queue;
+	unsigned int		dsp_ns;
+	unsigned int		expected_task;
+	atomic_t		consumed;
+	unsigned long		errors;
+	ktime_t			last;
+};
+
+static struct dentry *fw_queue_sw_dir;
+
+static DEFINE_MUTEX(fw_queue_sw_bench_lock);
+static struct {
+	unsigned int packets;
+	unsigned int batch;
+	unsigned int params;
+	unsigned int dsp_ns;
+	u64 ns;
+	unsigned long errors;
+	struct score_fw_queue_stats stats;
+} fw_queue_sw_bench;
+
+/* consumes one packet at @tail, returns the tail after it or -EINVAL */
+static int fw_queue_sw_dsp_packet(struct fw_queue_sw_dsp *dsp,
+				unsigned int tail)
+{
+	struct score_fw_queue *queue = dsp->queue;
+	struct score_packet_size size;
+	struct score_packet_header header;
+	unsigned int words[2];
+	unsigned int i, idx;
+
+	for (i = 0; i < 2; i++) {
+		idx = GET_QUEUE_IDX(GET_QUEUE_MIRROR_IDX(tail + i, queue->size),
+				queue->size);
+		words[i] = SCORE_QUEUE_READ_REG(queue,
+				queue->start + SCORE_REG_SIZE * idx);
+	}
+	memcpy(&size, &words[0], sizeof(size));
+	memcpy(&header, &words[1], sizeof(header));
+
+	if (size.packet_size < 2 || size.packet_size > queue->size)
+		return -EINVAL;
+
+	/* the firmware reads the parameters out of the ring as well */
+	for (i = 2; i < size.packet_size; i++) {
+		idx = GET_QUEUE_IDX(GET_QUEUE_MIRROR_IDX(tail + i, queue->size),
+				queue->size);
+		(void)SCORE_QUEUE_READ_REG(queue,
+				queue->start + SCORE_REG_SIZE * idx);
+	}
+
+	if (header.task_id != dsp->expected_task)
+		dsp->errors++;
+	dsp->expected_task = (header.task_id + 1) % FW_QUEUE_SW_TASKS;
+
+	if (dsp->dsp_ns)
+		ndelay(dsp->dsp_ns);
+
+	return GET_QUEUE_MIRROR_IDX(tail + size.packet_size, queue->size);
+}
+
+static int fw_queue_sw_dsp_thread(void *data)
+{
+	struct fw_queue_sw_dsp *dsp = data;
+	struct score_fw_queue *queue = dsp->queue;
+	unsigned int head, tail = 0;
+	int ret;
+
+	while (!kthread_should_stop()) {
+		head = SCORE_QUEUE_READ_REG(queue, queue->head_info);
+		if (head == tail) {
+			cond_resched();
+			continue;
+		}
+
+		while (tail != head) {
+			ret = fw_queue_sw_dsp_packet(dsp, tail);
+			if (ret < 0) {
+				/* the ring is corrupt, stop consuming */
+				dsp->errors++;
+				goto idle;
+			}
+			tail = ret;
+			SCORE_QUEUE_WRITE_REG(queue, tail, queue->tail_info);
+			dsp->last = ktime_get();
+			atomic_inc(&dsp->consumed);
+		}
+
+		/* as reading a result does, retry the packets that did not fit */
+		if (atomic_read(&queue->pending_count))
+			schedule_work(&queue->pending_param.param_work);
+	}
+
+	return 0;
+idle:
+	while (!kthread_should_stop())
+		msleep(1);
+
+	return 0;
+}
+
+static struct score_ipc_packet *fw_queue_sw_alloc_packets(unsigned int params)
+{
+	size_t len = sizeof(struct score_ipc_packet) +
+			sizeof(struct score_packet_group);
+	struct score_ipc_packet *pkts, *cmd;
+	unsigned int i, j;
+
+	pkts = kcalloc(FW_QUEUE_SW_TASKS, len, GFP_KERNEL);
+	if (!pkts)
+		return NULL;
+
+	for (i = 0; i < FW_QUEUE_SW_TASKS; i++) {
+		cmd = (void *)pkts + i * len;
+		cmd->size.group_count = 1;
+		cmd->header.kernel_name = 1;
+		cmd->header.task_id = i;
+		cmd->group[0].header.valid_size = params;
+		for (j = 0; j < params; j++)
+			cmd->group[0].data.params[j] = (i << 8) | j;
+	}
+
+	return pkts;
+}
+
+static int fw_queue_sw_bench_run(unsigned int packets, unsigned int batch,
+				unsigned int params, unsigned int dsp_ns)
+{
+	size_t len = sizeof(struct score_ipc_packet) +
+			sizeof(struct score_packet_group);
+	struct score_ipc_packet *cmd[FW_QUEUE_SW_MAX_BATCH];
+	struct score_ipc_packet *pkts;
+	struct score_fw_queue *queue;
+	struct fw_queue_sw_dsp dsp;
+	struct task_struct *thread;
+	void *sfr;
+	unsigned long timeout;
+	unsigned int i, j, n;
+	ktime_t start;
+	int ret = 0;
+
+	sfr = kzalloc(SFR_SIZE, GFP_KERNEL);
+	queue = kzalloc(sizeof(*queue), GFP_KERNEL);
+	pkts = fw_queue_sw_alloc_packets(params);
+	if (!sfr || !queue || !pkts) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	score_fw_queue_init_in(queue, (void __force __iomem *)sfr);
+
+	memset(&dsp, 0, sizeof(dsp));
+	dsp.queue = queue;
+	dsp.dsp_ns = dsp_ns;
+	atomic_set(&dsp.consumed, 0);
+
+	thread = kthread_run(fw_queue_sw_dsp_thread, &dsp, "score_fw_sw");
+	if (IS_ERR(thread)) {
+		ret = PTR_ERR(thread);
+		goto out_release;
+	}
+
+	start = ktime_get();
+	for (i = 0; i < packets; i += n) {
+		n = min(batch, packets - i);
+		for (j = 0; j < n; j++)
+			cmd[j] = (void *)pkts + ((i + j) % FW_QUEUE_SW_TASKS) * len;
+
+		while (atomic_read(&queue->pending_count) >
+				FW_QUEUE_SW_MAX_PENDING && !READ_ONCE(dsp.errors))
+			cond_resched();
+
+		if (READ_ONCE(dsp.errors)) {
+			ret = -EIO;
+			break;
+		}
+
+		ret = score_fw_queue_put_batch(queue, cmd, n);
+		if (ret)
+			break;
+	}
+
+	timeout = jiffies + FW_QUEUE_SW_TIMEOUT +
+			nsecs_to_jiffies((u64)packets * dsp_ns);
+	while (!ret && atomic_read(&dsp.consumed) < packets) {
+		if (READ_ONCE(dsp.errors))
+			ret = -EIO;
+		else if (time_after(jiffies, timeout))
+			ret = -ETIMEDOUT;
+		else
+			usleep_range(100, 200);
+	}
+
+	kthread_stop(thread);
+
+	fw_queue_sw_bench.packets = packets;
+	fw_queue_sw_bench.batch = batch;
+	fw_queue_sw_bench.params = params;
+	fw_queue_sw_bench.dsp_ns = dsp_ns;
+	fw_queue_sw_bench.ns = ret ? 0 : ktime_to_ns(ktime_sub(dsp.last, start));
+	fw_queue_sw_bench.errors = dsp.errors;
+	fw_queue_sw_bench.stats = queue->stats;
+
+out_release:
+	score_fw_queue_release_in(queue);
+out_free:
+	kfree(pkts);
+	kfree(queue);
+	kfree(sfr);
+	return ret;
+}
+
+static int fw_queue_sw_bench_show(struct seq_file *s, void *unused)
+{
+	mutex_lock(&fw_queue_sw_bench_lock);
+	if (fw_queue_sw_bench.packets) {
+		seq_printf(s, "packets: %u\n", fw_queue_sw_bench.packets);
+		seq_printf(s, "batch: %u\n", fw_queue_sw_bench.batch);
+		seq_printf(s, "params: %u words\n", fw_queue_sw_bench.params);
+		seq_printf(s, "dsp: %u ns/packet\n", fw_queue_sw_bench.dsp_ns);
+		seq_printf(s, "time: %llu ns/packet\n",
+			div_u64(fw_queue_sw_bench.ns, fw_queue_sw_bench.packets));
+		seq_printf(s, "doorbells: %lu\n",
+			fw_queue_sw_bench.stats.doorbells);
+		seq_printf(s, "tail reads: %lu\n",
+			fw_queue_sw_bench.stats.tail_reads);
+		seq_printf(s, "pended: %lu\n", fw_queue_sw_bench.stats.pended);
+		seq_printf(s, "errors: %lu\n", fw_queue_sw_bench.errors);
+	}
+	mutex_unlock(&fw_queue_sw_bench_lock);
+
+	return 0;
+}
+
+static int fw_queue_sw_bench_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fw_queue_sw_bench_show, NULL);
+}
+
+static ssize_t fw_queue_sw_bench_write(struct file *file,
+			const char __user *ubuf, size_t count, loff_t *ppos)
+{
+	unsigned int packets, batch = 1, params = 4, dsp_ns = 0;
+	char buf[64];
+	size_t len = min(count, sizeof(buf) - 1);
+	int ret;
+
+	if (copy_from_user(buf, ubuf, len))
+		return -EFAULT;
+	buf[len] = '\0';
+
+	if (sscanf(buf, "%u %u %u %u", &packets, &batch, &params, &dsp_ns) < 1)
+		return -EINVAL;
+
+	if (!packets || packets > FW_QUEUE_SW_MAX_PACKETS ||
+			!batch || batch > FW_QUEUE_SW_MAX_BATCH ||
+			params > NUM_OF_GRP_PARAM ||
+			dsp_ns > FW_QUEUE_SW_MAX_DSP_NS)
+		return -EINVAL;
+
+	mutex_lock(&fw_queue_sw_bench_lock);
+	ret = fw_queue_sw_bench_run(packets, batch, params, dsp_ns);
+	mutex_unlock(&fw_queue_sw_bench_lock);
+
+	return ret ? ret : count;
+}
+
+static const struct file_operations fw_queue_sw_bench_fops = {
+	.open = fw_queue_sw_bench_open,
+	.read = seq_read,
+	.write = fw_queue_sw_bench_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init fw_queue_sw_init(void)
+{
+	fw_queue_sw_dir = debugfs_create_dir("score-fw-queue-sw", NULL);
+	if (IS_ERR_OR_NULL(fw_queue_sw_dir))
+		return -ENOMEM;
+
+	debugfs_create_file("bench", S_IRUSR | S_IWUSR, fw_queue_sw_dir,
+				NULL, &fw_queue_sw_bench_fops);
+
+	return 0;
+}
+late_initcall(fw_queue_sw_init);
@@ -82,12 +82,12 @@ void score_fw_dump_regs(void __iomem *base_addr, u32 size)
 
 static inline unsigned int score_fw_queue_get_head(struct score_fw_queue *queue)
 {
-	return SCORE_READ_REG(queue->head_info);
+	return SCORE_QUEUE_READ_REG(queue, queue->head_info);
 }
 
 static inline unsigned int score_fw_queue_get_tail(struct score_fw_queue *queue)
 {
-	return SCORE_READ_REG(queue->tail_info);
+	return SCORE_QUEUE_READ_REG(queue, queue->tail_info);
 }
 
 static int score_fw_queue_put_data_direct(struct score_fw_queue *queue, unsigned int pos,
@@ -99,7 +99,7 @@ static int score_fw_queue_put_data_direct(struct score_fw_queue *queue, unsigned
 		return -EINVAL;
 
 	reg_pos = queue->start + (SCORE_REG_SIZE * pos);
-	SCORE_WRITE_REG(data, reg_pos);
+	SCORE_QUEUE_WRITE_REG(queue, data, reg_pos);
 
 	return 0;
 }
@@ -113,7 +113,7 @@ static int score_fw_queue_get_data_direct(struct score_fw_queue *queue, unsigned
 		return -EINVAL;
 
 	reg_pos = queue->start + (SCORE_REG_SIZE * pos);
-	*data = SCORE_READ_REG(reg_pos);
+	*data = SCORE_QUEUE_READ_REG(queue, reg_pos);
 
 	return 0;
 }
@@ -123,45 +123,13 @@ unsigned int score_queue_get_size(struct score_fw_queue *queue)
 	return queue->size;
 }
 
-static unsigned int score_fw_queue_get_used(struct score_fw_queue *queue)
-{
-	unsigned int used;
-	unsigned int head, tail;
-	unsigned int head_idx, tail_idx;
-
-	head = score_fw_queue_get_head(queue);
-	tail = score_fw_queue_get_tail(queue);
-	head_idx = GET_QUEUE_IDX(head, queue->size);
-	tail_idx = GET_QUEUE_IDX(tail, queue->size);
-
-	if (head_idx > tail_idx)
-		used = head_idx - tail_idx;
-	else if (head_idx < tail_idx)
-		used = (queue->size - tail_idx) + head_idx;
-	else if (head != tail)
-		used = queue->size;
-	else
-		used = 0;
-
-	return used;
-}
-
-static void score_fw_queue_inc_head(struct score_fw_queue *queue,
-				unsigned int head, unsigned int size)
-{
-	unsigned int info;
-
-	info = GET_QUEUE_MIRROR_IDX((head + size), queue->size);
-	SCORE_WRITE_REG(info, queue->head_info);
-}
-
 static void score_fw_queue_inc_tail(struct score_fw_queue *queue,
 				unsigned int tail, unsigned int size)
 {
 	unsigned int info;
 
 	info = GET_QUEUE_MIRROR_IDX((tail + size), queue->size);
-	SCORE_WRITE_REG(info, queue->tail_info);
+	SCORE_QUEUE_WRITE_REG(queue, info, queue->tail_info);
 }
 
 int score_fw_queue_is_empty(struct score_fw_queue *queue)
@@ -196,11 +164,6 @@ unsigned int score_fw_queue_get_inc_task_id(struct score_fw_queue *queue)
 	return score_fw_queue_atomic_inc_task_id(queue);
 }
 
-static inline unsigned int score_fw_queue_get_remain(struct score_fw_queue *queue)
-{
-	return (queue->size - score_fw_queue_get_used(queue));
-}
-
 void score_fw_queue_dump_packet_group(struct score_ipc_packet *cmd)
 {
 	struct score_packet_size s = cmd->size;
@@ -252,47 +215,77 @@ static int score_fw_queue_get_total_valid_size(struct score_ipc_packet *cmd)
 	return size;
 }
 
-#if 0
-static int score_fw_queue_put_pending_params(struct score_fw_queue *queue,
-						struct score_ipc_packet *cmd)
+/* in queue words from @tail to @head */
+static unsigned int score_fw_queue_calc_used(unsigned int size,
+				unsigned int head, unsigned int tail)
 {
-	int ret = 0;
-	struct score_fw_pending_param *p_param;
-	struct score_fw_param_list *p_list;
+	unsigned int head_idx = GET_QUEUE_IDX(head, size);
+	unsigned int tail_idx = GET_QUEUE_IDX(tail, size);
 
-	p_param = &queue->pending_param;
-	p_list = kmalloc(sizeof(struct score_fw_param_list), GFP_KERNEL);
-	if (!p_list) {
-		// @@@ change error func
-		/* dev_err(&dev->pdev->dev, "Failed to allocate pending param\n"); */
-		score_debug("Failed to allocate pending param \n");
-		ret = -ENOMEM;
-		goto pending_err;
+	if (head_idx > tail_idx)
+		return head_idx - tail_idx;
+	else if (head_idx < tail_idx)
+		return (size - tail_idx) + head_idx;
+	else if (head != tail)
+		return size;
+
+	return 0;
+}
+
+/*
+ * Reads the head published last. If it is not the one the host wrote, the
+ * firmware has reset the queue and the cached tail is refreshed as well.
+ */
+static unsigned int score_fw_queue_sync_head(struct score_fw_queue *queue)
+{
+	unsigned int head = score_fw_queue_get_head(queue);
+
+	if (unlikely(head != queue->head_cache)) {
+		queue->head_cache = head;
+		queue->tail_cache = score_fw_queue_get_tail(queue);
+		queue->stats.tail_reads++;
 	}
 
-	score_debug("Data is put at pending buffer\n");
-	p_list->p = cmd;
+	return head;
+}
 
-	score_fw_queue_dump_packet_group(cmd);
+/* checks the room with the cached tail first and reads the tail if short */
+static bool score_fw_queue_has_room(struct score_fw_queue *queue,
+				unsigned int head, unsigned int size)
+{
+	if (queue->size - score_fw_queue_calc_used(queue->size,
+				head, queue->tail_cache) >= size)
+		return true;
 
-	INIT_LIST_HEAD(&p_list->p_list);
+	queue->tail_cache = score_fw_queue_get_tail(queue);
+	queue->stats.tail_reads++;
 
-	mutex_lock(&p_param->lock);
-	list_add_tail(&p_list->p_list, &p_param->param_list);
-	mutex_unlock(&p_param->lock);
+	return queue->size - score_fw_queue_calc_used(queue->size,
+				head, queue->tail_cache) >= size;
+}
 
-pending_err:
-	return ret;
+static inline void score_fw_queue_write_word(struct score_fw_queue *queue,
+				unsigned int pos, unsigned int data)
+{
+	unsigned int idx = GET_QUEUE_IDX(GET_QUEUE_MIRROR_IDX(pos, queue->size),
+				queue->size);
+
+	SCORE_QUEUE_WRITE_REG_RELAXED(queue, data,
+			queue->start + (SCORE_REG_SIZE * idx));
 }
-#endif
 
-static int score_fw_queue_put_direct_params(struct score_fw_queue *queue,
-						struct score_ipc_packet *cmd)
+/*
+ * Calls @emit for each word of @cmd as the firmware reads it, with its
+ * offset in the packet, and returns the packet size in words. Always
+ * inlined so that the constant @emit becomes a direct call.
+ */
+static __always_inline unsigned int score_fw_queue_walk_params(
+		struct score_ipc_packet *cmd,
+		void (*emit)(void *arg, unsigned int pos, unsigned int data),
+		void *arg)
 {
-	int ret = 0;
 	int i, j, k, offset = 0;
 	unsigned int size = score_fw_queue_get_total_valid_size(cmd);
-	unsigned int head = score_fw_queue_get_head(queue);
 
 	unsigned int *size_word = (unsigned int *)&cmd->size;
 	unsigned int *header_word = (unsigned int *)&cmd->header;
@@ -301,16 +294,10 @@ static int score_fw_queue_put_direct_params(struct score_fw_queue *queue,
 	struct score_packet_group *group = cmd->group;
 	unsigned int valid_size;
 	unsigned int fd_bitmap;
-	struct sc_packet_buffer *buffer;
-	int memory_type;
-
-	/* score_debug("Data is put directly at cmd queue\n"); */
 
 	cmd->size.packet_size = size;
-	score_fw_queue_put_direct(queue,
-		GET_QUEUE_MIRROR_IDX(head, queue->size), *size_word);
-	score_fw_queue_put_direct(queue,
-		GET_QUEUE_MIRROR_IDX(head + 1, queue->size), *header_word);
+	emit(arg, 0, *size_word);
+	emit(arg, 1, *header_word);
 
 	for (i = 0; i < group_count; ++i) {
 		valid_size = group[i].header.valid_size;
@@ -318,89 +305,178 @@ static int score_fw_queue_put_direct_params(struct score_fw_queue *queue,
 
 		for (j = 0; j < valid_size; ++j, ++offset) {
 			if (fd_bitmap & (0x1 << j)) {
-				buffer = (struct sc_packet_buffer*)(&group[i].data.params[j]);
-				memory_type = buffer->host_buf.memory_type;
-#if 0
-				if (memory_type == VS4L_MEMORY_USERPTR) {
-				/* TODO: this is temporary code. */
-				/* this will be changed in consideration of 32 or 64 bit library and SMMU */
-					buffer->buf.addr = buffer->host_buf.addr32;
-				} else if (memory_type == VS4L_MEMORY_DMABUF) {
-					/* TODO:need memory translating for SCore */
-				} else {
-					ret = -EINVAL;
-					goto exit_enqueue;
-				}
-#endif
 				for (k = 0; k < (sizeof(struct sc_buffer) >> 2); ++k) {
-					score_fw_queue_put_direct(queue,
-						GET_QUEUE_MIRROR_IDX(head + 2 + offset + k, queue->size),
+					emit(arg, 2 + offset + k,
 						group[i].data.params[j + k]);
 				}
 				j += ((sizeof(struct sc_packet_buffer) >> 2) - 1);
 				offset += ((sizeof(struct sc_buffer) >> 2) - 1);
 			} else {
-				score_fw_queue_put_direct(queue,
-					GET_QUEUE_MIRROR_IDX(head + 2 + offset, queue->size),
-					group[i].data.params[j]);
+				emit(arg, 2 + offset, group[i].data.params[j]);
 			}
 		}
 	}
-	score_fw_queue_inc_head(queue, head, size);
 
-	return ret;
+	return size;
 }
 
-int score_fw_queue_put(struct score_fw_queue *queue, struct score_ipc_packet *cmd)
+struct score_fw_queue_ring_pos {
+	struct score_fw_queue *queue;
+	unsigned int head;
+};
+
+static void score_fw_queue_emit_ring(void *arg, unsigned int pos,
+				unsigned int data)
 {
-	int ret;
-	/* int i; */
-#if 0
-	// @@@ temporary size: -1
-	unsigned int remain;
+	struct score_fw_queue_ring_pos *ring = arg;
+
+	score_fw_queue_write_word(ring->queue, ring->head + pos, data);
+}
+
+static void score_fw_queue_emit_words(void *arg, unsigned int pos,
+				unsigned int data)
+{
+	unsigned int *words = arg;
+
+	words[pos] = data;
+}
+
+/*
+ * Copies @cmd into the ring from @head without publishing it and returns
+ * the head after the packet.
+ */
+static unsigned int score_fw_queue_write_params(struct score_fw_queue *queue,
+				unsigned int head, struct score_ipc_packet *cmd)
+{
+	struct score_fw_queue_ring_pos ring = { .queue = queue, .head = head };
 	unsigned int size;
 
-	mutex_lock(&queue->lock);
-	remain = score_fw_queue_get_remain(queue);
-	if (unlikely(remain > queue->size)) {
-		ret = -EFAULT;
-		goto put_unlock;
+	size = score_fw_queue_walk_params(cmd, score_fw_queue_emit_ring, &ring);
+
+	return GET_QUEUE_MIRROR_IDX(head + size, queue->size);
+}
+
+/* copies the @size words of a pended packet into the ring from @head */
+static unsigned int score_fw_queue_write_words(struct score_fw_queue *queue,
+				unsigned int head, const unsigned int *words,
+				unsigned int size)
+{
+	unsigned int i;
+
+	for (i = 0; i < size; ++i)
+		score_fw_queue_write_word(queue, head + i, words[i]);
+
+	return GET_QUEUE_MIRROR_IDX(head + size, queue->size);
+}
+
+/* publishes every packet written up to @head with a single register write */
+static void score_fw_queue_ring_doorbell(struct score_fw_queue *queue,
+				unsigned int head)
+{
+	/* writel() orders the relaxed packet writes before the new head */
+	SCORE_QUEUE_WRITE_REG(queue, head, queue->head_info);
+	queue->head_cache = head;
+	queue->stats.doorbells++;
+}
+
+static int score_fw_queue_put_pending_params(struct score_fw_queue *queue,
+						struct score_ipc_packet *cmd)
+{
+	struct score_fw_pending_param *p_param;
+	struct score_fw_param_list *p_list;
+	unsigned int size = score_fw_queue_get_total_valid_size(cmd);
+
+	p_param = &queue->pending_param;
+	p_list = kmalloc(sizeof(struct score_fw_param_list) +
+			size * sizeof(p_list->words[0]), GFP_KERNEL);
+	if (!p_list) {
+		score_err("Failed to allocate pending param\n");
+		return -ENOMEM;
 	}
 
-	// @@@ temp
-	size = score_fw_queue_get_total_valid_size(cmd);
-	score_debug("[%d] size is needed, [%d] size is remained\n", size, remain);
+	score_debug("Data is put at pending buffer\n");
+	/*
+	 * The caller frees @cmd once its frame is done or cancelled, which
+	 * may be before the packet leaves the pending list, so keep a copy.
+	 */
+	p_list->size = score_fw_queue_walk_params(cmd,
+			score_fw_queue_emit_words, p_list->words);
+	INIT_LIST_HEAD(&p_list->p_list);
 
-	if (remain < size) {
-		mutex_unlock(&queue->lock);
-		ret = score_fw_queue_put_pending_params(queue, cmd);
-		goto put_ret;
-	} else {
-		ret = score_fw_queue_put_direct_params(queue, cmd);
+	mutex_lock(&p_param->lock);
+	list_add_tail(&p_list->p_list, &p_param->param_list);
+	atomic_inc(&queue->pending_count);
+	queue->stats.pended++;
+	mutex_unlock(&p_param->lock);
+
+	schedule_work(&p_param->param_work);
+
+	return 0;
+}
+
+/*
+ * Puts @count packets and rings the doorbell once for all of them.
+ * Packets that do not fit wait in the pending list, in order, until
+ * the firmware consumes the queue. Must not be called concurrently.
+ */
+int score_fw_queue_put_batch(struct score_fw_queue *queue,
+		struct score_ipc_packet **cmd, unsigned int count)
+{
+	unsigned int head, size;
+	unsigned int i = 0;
+	int ret = 0;
+
+	if (atomic_read(&queue->pending_count))
+		goto put_pending;
+	/* pairs with smp_mb__before_atomic() in score_fw_queue_param_work() */
+	smp_rmb();
+
+	head = score_fw_queue_sync_head(queue);
+	for (; i < count; ++i) {
+		size = score_fw_queue_get_total_valid_size(cmd[i]);
+		if (unlikely(size > queue->size)) {
+			score_err("packet size(%d) exceeds queue size(%d)\n",
+					size, queue->size);
+			ret = -EINVAL;
+			break;
+		}
+
+		if (!score_fw_queue_has_room(queue, head, size))
+			break;
+
+		head = score_fw_queue_write_params(queue, head, cmd[i]);
 	}
 
-put_unlock:
-	mutex_unlock(&queue->lock);
-put_ret:
-#else
-	/* score_fw_dump_regs(score_fw_device->sfr + 0x0, 0x100); */
-	/* score_fw_queue_dump_packet_word2(cmd); */
-	/* score_fw_dump_regs(score_fw_device->sfr + 0x7000, 56 * 4); */
-	mutex_lock(&queue->lock);\
-
-	/* HACK : (FW) Access previously buffer issue */
-#if 0
-	for (i = 0; i < 56; i ++) {
-		writel(0x0, score_fw_device->sfr + 0x7000 + (i * 4));
+	if (i) {
+		score_fw_queue_ring_doorbell(queue, head);
+		queue->stats.packets += i;
 	}
-	score_fw_dump_regs(score_fw_device->sfr + 0x7000, 56 * 4);
-#endif
-	ret = score_fw_queue_put_direct_params(queue, cmd);
-	mutex_unlock(&queue->lock);
-#endif
+
+	if (ret)
+		return ret;
+
+put_pending:
+	for (; i < count; ++i) {
+		ret = score_fw_queue_put_pending_params(queue, cmd[i]);
+		if (ret)
+			break;
+	}
+
 	return ret;
 }
 
+int score_fw_queue_put(struct score_fw_queue *queue, struct score_ipc_packet *cmd)
+{
+	return score_fw_queue_put_batch(queue, &cmd, 1);
+}
+
+void score_fw_queue_dump_stats(struct score_fw_queue *queue)
+{
+	score_info("fw queue: %lu packets, %lu doorbells, %lu tail reads, %lu pended\n",
+			queue->stats.packets, queue->stats.doorbells,
+			queue->stats.tail_reads, queue->stats.pended);
+}
+
 int score_fw_queue_put_direct(struct score_fw_queue *queue, unsigned int head, unsigned int data)
 {
 	unsigned int head_idx = GET_QUEUE_IDX(head, queue->size);
@@ -471,6 +547,11 @@ int score_fw_queue_get(struct score_fw_queue *queue, struct score_ipc_packet *cm
 
 	score_fw_queue_inc_tail(queue, tail, size);
 
+	/* the firmware has taken requests, retry the ones that did not fit */
+	if (queue->type == SCORE_OUT_QUEUE &&
+		atomic_read(&score_fw_device->in_queue->pending_count))
+		schedule_work(&score_fw_device->in_queue->pending_param.param_work);
+
 	if (cmd->group[0].data.params[0] == 0x11111111) {
 		score_fw_dump_regs(score_fw_device->sfr + 0x7000, 56 * 4);
 
@@ -501,36 +582,77 @@ static void score_fw_queue_param_work(struct work_struct *work)
 	struct score_fw_queue *queue;
 	struct score_fw_pending_param *p_param;
 	struct score_fw_param_list *p_list;
-	unsigned int remain;
-	unsigned int size;
-	int ret;
+	unsigned int head, size;
+	unsigned int written = 0;
 
-	queue = score_fw_device->in_queue;
-	p_param = &queue->pending_param;
+	p_param = container_of(work, struct score_fw_pending_param, param_work);
+	queue = container_of(p_param, struct score_fw_queue, pending_param);
 
+	mutex_lock(&p_param->lock);
+	head = score_fw_queue_sync_head(queue);
 	while (!list_empty(&p_param->param_list)) {
-		p_list = list_entry(p_param->param_list.next, typeof(*p_list), p_list);
-		remain = score_fw_queue_get_remain(queue);
-		size = score_fw_queue_get_total_valid_size(p_list->p);
-
-		score_debug("[%d] size is needed, [%d] size is remained\n", size, remain);
-
-		if (size <= remain) {
-			ret = score_fw_queue_put_direct_params(queue, p_list->p);
-			if (ret) {
-				continue;
-			}
-
-			mutex_lock(&p_param->lock);
-			list_del(&p_list->p_list);
-			mutex_unlock(&p_param->lock);
+		p_list = list_first_entry(&p_param->param_list,
+				struct score_fw_param_list, p_list);
+		size = p_list->size;
 
-			kfree(p_list);
-		} else {
+		if (!score_fw_queue_has_room(queue, head, size)) {
 			score_debug("Remained queue size is not enough\n");
 			break;
 		}
+
+		head = score_fw_queue_write_words(queue, head, p_list->words,
+				size);
+		list_del(&p_list->p_list);
+		kfree(p_list);
+		written++;
+	}
+
+	if (written) {
+		score_fw_queue_ring_doorbell(queue, head);
+		queue->stats.packets += written;
+		/* the producer may use head_cache once pending_count drops */
+		smp_mb__before_atomic();
+		atomic_sub(written, &queue->pending_count);
+	}
+	mutex_unlock(&p_param->lock);
+}
+
+/*
+ * Sets up @queue as an in queue whose ring registers are in the SFR block
+ * mapped at @sfr: the DSP's, or the memory of a software stand-in.
+ */
+void score_fw_queue_init_in(struct score_fw_queue *queue, void __iomem *sfr)
+{
+	queue->type = SCORE_IN_QUEUE;
+	queue->sfr = sfr;
+	queue->head_info = SCORE_IN_QUEUE_HEAD_INFO;
+	queue->tail_info = SCORE_IN_QUEUE_TAIL_INFO;
+	queue->start = SCORE_IN_QUEUE_START;
+	queue->size = SCORE_IN_QUEUE_REG_SIZE;
+	atomic_set(&queue->task_id, 0);
+	atomic_set(&queue->pending_count, 0);
+	mutex_init(&queue->lock);
+	spin_lock_init(&queue->slock);
+	INIT_LIST_HEAD(&queue->wait_list);
+	mutex_init(&queue->pending_param.lock);
+	INIT_LIST_HEAD(&queue->pending_param.param_list);
+	INIT_WORK(&queue->pending_param.param_work, score_fw_queue_param_work);
+}
+
+/* drops the packets still pending and logs the queue stats */
+void score_fw_queue_release_in(struct score_fw_queue *queue)
+{
+	struct score_fw_param_list *p_list, *tmp;
+
+	cancel_work_sync(&queue->pending_param.param_work);
+	list_for_each_entry_safe(p_list, tmp,
+			&queue->pending_param.param_list, p_list) {
+		list_del(&p_list->p_list);
+		kfree(p_list);
 	}
+	score_fw_queue_dump_stats(queue);
+	mutex_destroy(&queue->pending_param.lock);
+	mutex_destroy(&queue->lock);
 }
 
 int score_fw_queue_init(struct score_fw_dev *dev)
@@ -564,20 +686,10 @@ int score_fw_queue_init(struct score_fw_dev *dev)
 	in_queue = dev->in_queue;
 	out_queue = dev->out_queue;
 
-	in_queue->type = SCORE_IN_QUEUE;
-	in_queue->head_info = SCORE_IN_QUEUE_HEAD_INFO;
-	in_queue->tail_info = SCORE_IN_QUEUE_TAIL_INFO;
-	in_queue->start = SCORE_IN_QUEUE_START;
-	in_queue->size = SCORE_IN_QUEUE_REG_SIZE;
-	atomic_set(&in_queue->task_id, 0);
-	mutex_init(&in_queue->lock);
-	spin_lock_init(&in_queue->slock);
-	INIT_LIST_HEAD(&in_queue->wait_list);
-	mutex_init(&in_queue->pending_param.lock);
-	INIT_LIST_HEAD(&in_queue->pending_param.param_list);
-	INIT_WORK(&in_queue->pending_param.param_work, score_fw_queue_param_work);
+	score_fw_queue_init_in(in_queue, dev->sfr);
 
 	out_queue->type = SCORE_OUT_QUEUE;
+	out_queue->sfr = dev->sfr;
 	out_queue->head_info = SCORE_OUT_QUEUE_HEAD_INFO;
 	out_queue->tail_info = SCORE_OUT_QUEUE_TAIL_INFO;
 	out_queue->start = SCORE_OUT_QUEUE_START;
@@ -616,7 +728,7 @@ void score_fw_queue_exit(struct score_fw_dev *dev)
 	out_queue = dev->out_queue;
 
 	if (in_queue != NULL) {
-		mutex_destroy(&in_queue->lock);
+		score_fw_queue_release_in(in_queue);
 		kfree(in_queue);
 		in_queue = NULL;
 	}
@@ -63,6 +63,8 @@ static inline unsigned int score_fw_queue_get_task_id(struct score_fw_queue *que
 unsigned int score_fw_queue_get_inc_task_id(struct score_fw_queue *queue);
 
 int score_fw_queue_init(struct score_fw_dev *dev);
+void score_fw_queue_init_in(struct score_fw_queue *queue, void __iomem *sfr);
+void score_fw_queue_release_in(struct score_fw_queue *queue);
 void score_fw_queue_exit(struct score_fw_dev *dev);
 void score_wake_up_wait_task(void);
 
@@ -78,6 +80,8 @@ void score_wake_up_wait_task(void);
 	score_fw_queue_get_direct(dev->out_queue, (tail), (data))
 
 int score_fw_queue_put(struct score_fw_queue *queue, struct score_ipc_packet *cmd);
+int score_fw_queue_put_batch(struct score_fw_queue *queue,
+		struct score_ipc_packet **cmd, unsigned int count);
 int score_fw_queue_get(struct score_fw_queue *queue, struct score_ipc_packet *cmd);
 int score_fw_queue_put_direct(struct score_fw_queue *queue,
 					unsigned int head, unsigned int data);
@@ -86,4 +90,5 @@ int score_fw_queue_get_direct(struct score_fw_queue *queue,
 void score_fw_queue_dump_packet_word(struct score_ipc_packet *cmd);
 void score_fw_queue_dump_packet_word2(struct score_ipc_packet *cmd);
 void score_fw_dump_regs(void __iomem *base_addr, u32 size);
+void score_fw_queue_dump_stats(struct score_fw_queue *queue);
 #endif
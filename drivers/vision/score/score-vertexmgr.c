@@ -900,7 +900,7 @@ void change_fd_addr(struct score_frame *frame)
 	return;
 }
 
-void send_request(struct score_frame *frame)
+int send_request(struct score_frame *frame)
 {
 	struct vb_container_list *incl = NULL;
 	struct vb_container_list *otcl = NULL;
@@ -939,13 +939,31 @@ void send_request(struct score_frame *frame)
 	/* score_fw_queue_dump_packet_word2(result_packet); */
 
 	score_event_msg("receive command [task_id:%d]\n", request_packet->header.task_id);
-	score_fw_queue_put(score_fw_device->in_queue, request_packet);
+	return score_fw_queue_put(score_fw_device->in_queue, request_packet);
+}
 
-	return;
+/*
+ * Completes @iframe as NDONE with @ret when its request never reached the
+ * firmware, so that no result is read from the out queue for it.
+ */
+static void score_vertexmgr_fail_request(struct score_interface *interface,
+		struct score_frame *iframe, int ret)
+{
+	unsigned long flags;
+	struct score_framemgr *iframemgr = &interface->framemgr;
+
+	framemgr_e_barrier_irqs(iframemgr, 0, flags);
+	score_frame_trans_pro_to_com(iframemgr, iframe);
+	framemgr_x_barrier_irqr(iframemgr, 0, flags);
+
+	iframe->message = SCORE_FRAME_NDONE;
+	iframe->ret = ret;
+	queue_kthread_work(&interface->worker, &iframe->work);
 }
 
 static void score_vertex_thread(struct kthread_work *work)
 {
+	int ret;
 	unsigned long flags;
 	struct score_vertex_ctx *vctx;
 	struct score_vertexmgr *vertexmgr;
@@ -976,6 +994,7 @@ static void score_vertex_thread(struct kthread_work *work)
 		framemgr_x_barrier_irqr(iframemgr, 0, flags);
 
 		iframe->message = SCORE_FRAME_PROCESS;
+		iframe->ret = 0;
 		iframe->incl = frame->incl;
 		iframe->otcl = frame->otcl;
 		framemgr_e_barrier_irqs(iframemgr, 0, flags);
@@ -988,7 +1007,11 @@ static void score_vertex_thread(struct kthread_work *work)
 		iframe->gindex = gframe->index;
 		__score_gframe_s_process(vertexmgr, gframe);
 
-		send_request(frame);
+		ret = send_request(frame);
+		if (ret) {
+			score_err("send_request is fail(%d)\n", ret);
+			score_vertexmgr_fail_request(interface, iframe, ret);
+		}
 #if 0
 		VERTEX_CHECK_POINT(2);
 		ret = CALL_GOPS(vertex, request, frame);
@@ -1134,7 +1157,12 @@ static void score_interface_thread(struct kthread_work *work)
 	switch (iframe->message) {
 	case SCORE_FRAME_DONE:
 	case SCORE_FRAME_NDONE:
-		ret = score_fw_queue_get(score_fw_device->out_queue, result_packet);
+		/* a request that failed to queue has no result to read */
+		if (iframe->ret)
+			ret = iframe->ret;
+		else
+			ret = score_fw_queue_get(score_fw_device->out_queue,
+					result_packet);
 
 		/* HACK */
 		gframe_index = iframe->gindex;
@@ -11,6 +11,7 @@
 #include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/ctype.h>
+#include <linux/math64.h>
 #include <media/videobuf2-ion.h>
 
 #include "vpu-config.h"
@@ -378,7 +379,7 @@ static ssize_t vpu_debug_img_write(struct file *file, const char __user *user_bu
 
 static int vpu_debug_grp_show(struct seq_file *s, void *unused)
 {
-	u32 i;
+	u32 i, done;
 	struct vpu_debug *debug = s->private;
 	struct vpu_graphmgr *graphmgr = debug->graphmgr_data;
 	struct vpu_graph *graph;
@@ -386,8 +387,9 @@ static int vpu_debug_grp_show(struct seq_file *s, void *unused)
 	seq_printf(s, "------------------------------------------"
 			"----------------------------------------"
 			"--------------------------------------\n");
-	seq_printf(s, "%7.s %7.s %7.s %7.s %7.s %7.s %7.s\n",
-			"graph", "prio", "period", "input", "done", "cancel", "recent");
+	seq_printf(s, "%7.s %7.s %7.s %7.s %7.s %7.s %7.s %7.s %7.s %7.s %7.s\n",
+			"graph", "prio", "period", "input", "done", "cancel", "recent",
+			"wait", "ready", "run", "depth");
 	seq_printf(s, "------------------------------------------"
 			"----------------------------------------"
 			"--------------------------------------\n");
@@ -399,9 +401,16 @@ static int vpu_debug_grp_show(struct seq_file *s, void *unused)
 		if (!graph)
 			continue;
 
-		seq_printf(s, "%2d(%3d) %7d %7d %7d %7d %7d %7d\n",
+		done = graph->done_cnt ? graph->done_cnt : 1;
+
+		/* average us spent per stage, and the deepest the graph was pipelined */
+		seq_printf(s, "%2d(%3d) %7d %7d %7d %7d %7d %7d %7llu %7llu %7llu %7d\n",
 			graph->id, graph->uid, graph->priority, graph->period_ticks,
-			graph->input_cnt, graph->done_cnt, graph->cancel_cnt, graph->recent);
+			graph->input_cnt, graph->done_cnt, graph->cancel_cnt, graph->recent,
+			div_u64(graph->stage_us[VPU_GRAPH_STAGE_WAIT], done),
+			div_u64(graph->stage_us[VPU_GRAPH_STAGE_READY], done),
+			div_u64(graph->stage_us[VPU_GRAPH_STAGE_RUN], done),
+			graph->depth_max);
 	}
 	mutex_unlock(&graphmgr->mlock);
 
@@ -1854,6 +1854,55 @@ p_err:
 	return ret;
 }
 
+static void __vpu_graph_latch_iovec(struct vpu_graph *graph, struct vpu_frame *frame)
+{
+	struct vpu_invoke_external_mem_vector_ds *mvectors;
+	struct vpuo_pu *pu, *temp;
+	u32 i;
+
+	mvectors = &graph->iovec[frame->index];
+	mvectors->num_of_buffers = 0;
+
+	if (test_bit(VS4L_GRAPH_FLAG_PRIMITIVE, &graph->flags)) {
+		for (i = 0; i < graph->iobuffer_cnt; ++i) {
+			mvectors->addresses_vector[i] = graph->iobuffer_dat[i];
+			mvectors->num_of_buffers++;
+		}
+
+		return;
+	}
+
+	list_for_each_entry_safe(pu, temp, &graph->inleaf_list, gleaf_entry) {
+		for (i = 0; i < pu->buffer_cnt; ++i) {
+			if (!pu->buffer_ptr[i] || pu->buffer_shm[i])
+				continue;
+
+			if (mvectors->num_of_buffers >= VPUL_MAX_MAPS_DESC) {
+				vpu_ierr("mvectors is over1(%d)\n", graph, mvectors->num_of_buffers);
+				break;
+			}
+
+			mvectors->addresses_vector[mvectors->num_of_buffers] = *pu->buffer_ptr[i];
+			mvectors->num_of_buffers++;
+		}
+	}
+
+	list_for_each_entry_safe(pu, temp, &graph->otleaf_list, gleaf_entry) {
+		for (i = 0; i < pu->buffer_cnt; ++i) {
+			if (!pu->buffer_ptr[i] || pu->buffer_shm[i])
+				continue;
+
+			if (mvectors->num_of_buffers >= VPUL_MAX_MAPS_DESC) {
+				vpu_ierr("mvectors is over2(%d)\n", graph, mvectors->num_of_buffers);
+				break;
+			}
+
+			mvectors->addresses_vector[mvectors->num_of_buffers] = *pu->buffer_ptr[i];
+			mvectors->num_of_buffers++;
+		}
+	}
+}
+
 static int vpu_graph_queue(struct vpu_queue *queue, struct vb_container_list *incl, struct vb_container_list *otcl)
 {
 	int ret = 0;
@@ -2010,6 +2059,8 @@ static int vpu_graph_queue(struct vpu_queue *queue, struct vb_container_list *in
 	}
 
 p_skip_primitive:
+	__vpu_graph_latch_iovec(graph, frame);
+
 	graph->inhash[incl->index] = frame->index;
 	graph->othash[otcl->index] = frame->index;
 	graph->input_cnt++;
@@ -2025,10 +2076,10 @@ p_skip_primitive:
 	clear_bit(VS4L_CL_FLAG_TIMESTAMP, &frame->flags);
 
 	if ((incl->flags & (1 << VS4L_CL_FLAG_TIMESTAMP)) ||
-		(otcl->flags & (1 << VS4L_CL_FLAG_TIMESTAMP))) {
+		(otcl->flags & (1 << VS4L_CL_FLAG_TIMESTAMP)))
 		set_bit(VS4L_CL_FLAG_TIMESTAMP, &frame->flags);
-		vpu_get_timestamp(&frame->time[VPU_TMP_QUEUE]);
-	}
+
+	vpu_get_timestamp(&frame->time[VPU_TMP_QUEUE]);
 
 	vpu_graphmgr_queue(graph->cookie, frame);
 
@@ -2163,8 +2214,7 @@ static int vpu_graph_request(struct vpu_graph *graph, struct vpu_frame *frame)
 	vpu_frame_trans_req_to_pre(framemgr, frame);
 	framemgr_x_barrier_irqr(framemgr, 0, flags);
 
-	if (test_bit(VS4L_CL_FLAG_TIMESTAMP, &frame->flags))
-		vpu_get_timestamp(&frame->time[VPU_TMP_REQUEST]);
+	vpu_get_timestamp(&frame->time[VPU_TMP_REQUEST]);
 
 	return ret;
 }
@@ -2187,14 +2237,15 @@ static int vpu_graph_process(struct vpu_graph *graph, struct vpu_frame *frame)
 
 	framemgr_e_barrier_irqs(framemgr, FMGR_IDX_0, flags);
 	vpu_frame_trans_pre_to_pro(framemgr, frame);
+	if (framemgr->pro_cnt > graph->depth_max)
+		graph->depth_max = framemgr->pro_cnt;
 	framemgr_x_barrier_irqr(framemgr, FMGR_IDX_0, flags);
 
 #ifdef DBG_STREAMING
 	vpu_iinfo("PROCESS(%d, %d)\n", graph, frame->index, frame->id);
 #endif
 
-	if (test_bit(VS4L_CL_FLAG_TIMESTAMP, &frame->flags))
-		vpu_get_timestamp(&frame->time[VPU_TMP_PROCESS]);
+	vpu_get_timestamp(&frame->time[VPU_TMP_PROCESS]);
 
 	return ret;
 }
@@ -2297,9 +2348,18 @@ static int vpu_graph_done(struct vpu_graph *graph, struct vpu_frame *frame)
 		BUG();
 	}
 
-	if (test_bit(VS4L_CL_FLAG_TIMESTAMP, &frame->flags)) {
-		vpu_get_timestamp(&frame->time[VPU_TMP_DONE]);
+	vpu_get_timestamp(&frame->time[VPU_TMP_DONE]);
+	graph->stage_us[VPU_GRAPH_STAGE_WAIT] +=
+		VPU_TIME_IN_US(frame->time[VPU_TMP_REQUEST]) -
+		VPU_TIME_IN_US(frame->time[VPU_TMP_QUEUE]);
+	graph->stage_us[VPU_GRAPH_STAGE_READY] +=
+		VPU_TIME_IN_US(frame->time[VPU_TMP_PROCESS]) -
+		VPU_TIME_IN_US(frame->time[VPU_TMP_REQUEST]);
+	graph->stage_us[VPU_GRAPH_STAGE_RUN] +=
+		VPU_TIME_IN_US(frame->time[VPU_TMP_DONE]) -
+		VPU_TIME_IN_US(frame->time[VPU_TMP_PROCESS]);
 
+	if (test_bit(VS4L_CL_FLAG_TIMESTAMP, &frame->flags)) {
 		if (incl->flags & (1 << VS4L_CL_FLAG_TIMESTAMP))
 			memcpy(incl->timestamp, frame->time, sizeof(frame->time));
 
@@ -28,6 +28,13 @@
 
 struct vpu_graph;
 
+enum vpu_graph_stage {
+	VPU_GRAPH_STAGE_WAIT,	/* queue -> request */
+	VPU_GRAPH_STAGE_READY,	/* request -> process */
+	VPU_GRAPH_STAGE_RUN,	/* process -> done */
+	VPU_GRAPH_STAGE_COUNT
+};
+
 enum vpu_graph_state {
 	VPU_GRAPH_STATE_CONFIG,
 	VPU_GRAPH_STATE_HENROLL,
@@ -74,6 +81,8 @@ struct vpu_graph {
 	u32				done_cnt;
 	u32				recent;
 	u8				pu_map[VPU_PU_NUMBER];
+	u64				stage_us[VPU_GRAPH_STAGE_COUNT];
+	u32				depth_max;
 
 	const struct vpu_graph_ops	*gops;
 
@@ -116,6 +125,12 @@ struct vpu_graph {
 	u32				iobuffer_cnt;
 	u32				iobuffer_idx[VPUL_MAX_TASK_EXTERNAL_RAMS];
 	u32				iobuffer_dat[VPUL_MAX_TASK_EXTERNAL_RAMS];
+
+	/*
+	 * external memory vector latched per frame at queue time so that the
+	 * next frame can be queued while the previous one is still running
+	 */
+	struct vpu_invoke_external_mem_vector_ds iovec[VPU_MAX_FRAME];
 };
 
 void vpu_graph_print(struct vpu_graph *graph);
@@ -553,17 +553,13 @@ static int __vpu_itf_process(struct vpu_interface *interface,
 	unsigned long flags;
 	struct vpu_framemgr *iframemgr;
 	struct vpu_frame *iframe;
-	struct vpuo_pu *pu, *temp;
-	struct vpu_invoke_external_mem_vector_ds mvectors;
 	union vpul_pu_parameters *update_array;
-	u32 i;
 
 	BUG_ON(!interface);
 	BUG_ON(!graph);
 	BUG_ON(!frame);
 
 	iframemgr = &interface->framemgr;
-	mvectors.num_of_buffers = 0;
 	update_array = NULL;
 
 	framemgr_e_barrier_irqs(iframemgr, 0, flags);
@@ -576,50 +572,6 @@ static int __vpu_itf_process(struct vpu_interface *interface,
 		goto p_err;
 	}
 
-	if (test_bit(VS4L_GRAPH_FLAG_PRIMITIVE, &graph->flags)) {
-		for (i = 0; i < graph->iobuffer_cnt; ++i) {
-			mvectors.addresses_vector[i] = graph->iobuffer_dat[i];
-			mvectors.num_of_buffers++;
-		}
-
-		goto p_skip_primitive;
-	}
-
-	list_for_each_entry_safe(pu, temp, &graph->inleaf_list, gleaf_entry) {
-		for (i = 0; i < pu->buffer_cnt; ++i) {
-			if (!pu->buffer_ptr[i])
-				continue;
-
-			if (mvectors.num_of_buffers >= VPUL_MAX_MAPS_DESC) {
-				vpu_err("mvectors.num_of_buffers is over1(%d)\n", mvectors.num_of_buffers);
-				break;
-			}
-
-			if (!pu->buffer_shm[i]) {
-				mvectors.addresses_vector[mvectors.num_of_buffers] = *pu->buffer_ptr[i];
-				mvectors.num_of_buffers++;
-			}
-		}
-	}
-
-	list_for_each_entry_safe(pu, temp, &graph->otleaf_list, gleaf_entry) {
-		for (i = 0; i < pu->buffer_cnt; ++i) {
-			if (!pu->buffer_ptr[i])
-				continue;
-
-			if (mvectors.num_of_buffers >= VPUL_MAX_MAPS_DESC) {
-				vpu_err("mvectors.num_of_buffers is over2(%d)\n", mvectors.num_of_buffers);
-				break;
-			}
-
-			if (!pu->buffer_shm[i]){
-				mvectors.addresses_vector[mvectors.num_of_buffers] = *pu->buffer_ptr[i];
-				mvectors.num_of_buffers++;
-			}
-		}
-	}
-
-p_skip_primitive:
 	if (test_bit(VPU_GRAPH_FLAG_UPDATE_PARAM, &graph->flags)) {
 		ret = CALL_GOPS(graph, update_param, frame);
 		if (ret) {
@@ -638,7 +590,7 @@ p_skip_primitive:
 	iframe->message = VPU_FRAME_PROCESS;
 	iframe->param0 = (ulong)graph->desc_mtask;
 	iframe->param1 = graph->id;
-	iframe->param2 = (ulong)&mvectors; /* return : DONE or NDONE */
+	iframe->param2 = (ulong)&graph->iovec[frame->index]; /* return : DONE or NDONE */
 	iframe->param3 = (ulong)update_array; /* return : error code if param2 is NDONE */
 	iframe->flags = frame->flags;
 	iframe->incl = frame->incl;
@@ -206,6 +206,8 @@ void ext4_free_encryption_info(struct inode *inode,
 #ifdef CONFIG_EXT4CRYPT_SDP
 	fscrypt_sdp_cache_remove_inode_num(inode);
 #endif
+	if (ci->private_enc_mode)
+		fmp_crypto_tmpl_set(inode->i_mapping, NULL);
 	ext4_free_crypt_info(ci);
 }
 
@@ -398,6 +400,11 @@ private_crypt:
 		memcpy(crypt_info->raw_key, raw_key, ext4_encryption_key_size(mode));
 		memcpy(inode->i_mapping->key, crypt_info->raw_key, ext4_encryption_key_size(mode));
 		inode->i_mapping->key_length = ext4_encryption_key_size(mode);
+		fmp_crypto_tmpl_set(inode->i_mapping,
+			fmp_crypto_tmpl_alloc(inode->i_mapping->private_algo_mode,
+					      inode->i_mapping->key,
+					      inode->i_mapping->key_length,
+					      GFP_NOFS));
 	} else {
 		crypt_info->private_enc_mode = 0;
 		inode->i_mapping->private_algo_mode = EXYNOS_FMP_BYPASS_MODE;
@@ -19,6 +19,9 @@
 #include <linux/ratelimit.h>
 #include <linux/list_lru.h>
 #include <trace/events/writeback.h>
+#ifdef CONFIG_EXT4_PRIVATE_ENCRYPTION
+#include <crypto/fmp.h>
+#endif
 #include "internal.h"
 
 /*
@@ -171,6 +174,7 @@ int inode_init_always(struct super_block *sb, struct inode *inode)
 	mapping_set_gfp_mask(mapping, GFP_HIGHUSER_MOVABLE);
 	mapping->private_data = NULL;
 	mapping->writeback_index = 0;
+	RCU_INIT_POINTER(mapping->fmp_tmpl, NULL);
 #ifdef CONFIG_EXT4_PRIVATE_ENCRYPTION
 	mapping->iv = NULL;
 	memset(mapping->key, 0, MAX_KEY_SIZE);
@@ -250,11 +254,46 @@ void __destroy_inode(struct inode *inode)
 		posix_acl_release(inode->i_acl);
 	if (inode->i_default_acl && inode->i_default_acl != ACL_NOT_CACHED)
 		posix_acl_release(inode->i_default_acl);
+#endif
+#ifdef CONFIG_EXT4_PRIVATE_ENCRYPTION
+	fmp_crypto_tmpl_set(&inode->i_data, NULL);
 #endif
 	this_cpu_dec(nr_inodes);
 }
 EXPORT_SYMBOL(__destroy_inode);
 
+#ifdef CONFIG_EXT4_PRIVATE_ENCRYPTION
+static void fmp_crypto_tmpl_free_rcu(struct rcu_head *head)
+{
+	kzfree(container_of(head, struct fmp_crypto_tmpl, rcu));
+}
+
+/**
+ * fmp_crypto_tmpl_set - replace the FMP crypto template of a mapping
+ * @mapping: mapping of the inode whose file key is (un)set
+ * @tmpl: template from fmp_crypto_tmpl_alloc(), or NULL to invalidate
+ *
+ * The mapping owns @tmpl from now on. The previous template is zeroed and
+ * freed once the I/O paths that may still be copying it are done.
+ */
+void fmp_crypto_tmpl_set(struct address_space *mapping,
+			 struct fmp_crypto_tmpl *tmpl)
+{
+	struct inode *inode = mapping->host;
+	struct fmp_crypto_tmpl *old;
+
+	spin_lock(&inode->i_lock);
+	old = rcu_dereference_protected(mapping->fmp_tmpl,
+					lockdep_is_held(&inode->i_lock));
+	rcu_assign_pointer(mapping->fmp_tmpl, tmpl);
+	spin_unlock(&inode->i_lock);
+
+	if (old)
+		call_rcu(&old->rcu, fmp_crypto_tmpl_free_rcu);
+}
+EXPORT_SYMBOL(fmp_crypto_tmpl_set);
+#endif
+
 static void i_callback(struct rcu_head *head)
 {
 	struct inode *inode = container_of(head, struct inode, i_rcu);
@@ -27,6 +27,7 @@
 /*                                                                      */
 /************************************************************************/
 
+#include <linux/bitmap.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 
@@ -44,88 +45,41 @@ static inline void amap_list_del(struct list_head *entry)
 	entry->next = NULL;
 }
 
-static inline int amap_insert_to_list(AU_INFO_T *au, struct slist_head *shead)
+static inline int amap_insert_to_list(AU_INFO_T *au, struct list_head *lh,
+		uint8_t state)
 {
-	struct slist_head *entry = &au->shead;
+	ASSERT(!au->head.prev && au->state == AU_STATE_COLD);
 
-	ASSERT(!entry->head);
-
-	entry->next = shead->next;
-	entry->head = shead;
-
-	shead->next = entry;
+	list_add(&au->head, lh);
+	au->state = state;
 
 	return 0;
 }
 
-static inline int amap_remove_from_list(AU_INFO_T *au, struct slist_head *shead)
+static inline int amap_remove_from_list(AU_INFO_T *au, uint8_t state)
 {
-	struct slist_head *entry = &au->shead;
-	struct slist_head *iter;
-
-	BUG_ON(entry->head != shead);
-
-	iter = shead;
-
-	while (iter->next) {
-		if (iter->next == entry) {
-			// iter->next = iter->next->next
-			iter->next = entry->next;
-
-			entry->next = NULL;
-			entry->head = NULL;
-			return 0;
-		}
-		iter = iter->next;
-	}
-
-	BUG_ON("Not reachable");
-}
-
-/* Full-linear serach => Find AU with max. number of fclu */
-static inline AU_INFO_T *amap_find_hot_au_largest(struct slist_head *shead)
-{
-	struct slist_head *iter;
-	uint16_t max_fclu = 0;
-	AU_INFO_T *entry, *ret = NULL;
-
-	ASSERT(shead->head == shead);	/* Singly-list condition */
-	ASSERT(shead->next != shead);
+	BUG_ON(au->state != state);
 
-	iter = shead->next;
+	amap_list_del(&au->head);
+	au->state = AU_STATE_COLD;
 
-	while (iter) {
-		entry = list_entry(iter, AU_INFO_T, shead);
-
-		if (entry->free_clusters > max_fclu) {
-			max_fclu = entry->free_clusters;
-			ret = entry;
-		}
-
-		iter = iter->next;
-	}
-
-	return ret;
+	return 0;
 }
 
 /* Find partially used AU with max. number of fclu.
  * If there is no partial AU available, pick a clean one
+ *
+ * There are at most SMART_ALLOC_N_HOT_AU + 1 hot AUs, and their free
+ * clusters change on every hot allocation, so they are just scanned.
  */
 static inline AU_INFO_T *amap_find_hot_au_partial(AMAP_T *amap)
 {
-	struct slist_head *iter;
 	uint16_t max_fclu = 0;
 	AU_INFO_T *entry, *ret = NULL;
 
-	iter = &amap->slist_hot;
-	ASSERT(iter->head == iter);	/* Singly-list condition */
-	ASSERT(iter->next != iter);
-
-	iter = iter->next;
-
-	while (iter) {
-		entry = list_entry(iter, AU_INFO_T, shead);
+	ASSERT(!list_empty(&amap->list_hot));
 
+	list_for_each_entry(entry, &amap->list_hot, head) {
 		if (entry->free_clusters > max_fclu) {
 			if (entry->free_clusters < amap->clusters_per_au) {
 				max_fclu = entry->free_clusters;
@@ -135,14 +89,27 @@ static inline AU_INFO_T *amap_find_hot_au_partial(AMAP_T *amap)
 					ret = entry;
 			}
 		}
-
-		iter = iter->next;
 	}
 
 	return ret;
 }
 
 
+/* Index of the last non-empty cold AU node at or below 'i', -1 if none */
+static inline int amap_find_prev_node(AMAP_T *amap, int i)
+{
+	int word = BIT_WORD(i);
+	unsigned long bits;
+
+	bits = amap->fclu_bitmap[word] & BITMAP_LAST_WORD_MASK(i + 1);
+	while (!bits) {
+		if (--word < 0)
+			return -1;
+		bits = amap->fclu_bitmap[word];
+	}
+
+	return word * BITS_PER_LONG + __fls(bits);
+}
 
 
 /*
@@ -169,10 +136,7 @@ int amap_add_cold_au(AMAP_T *amap, AU_INFO_T *au)
 
 	/* Insert to the list */
 	list_add_tail(&(au->head), &(fclu_node->head));
-
-	/* Update fclu_hint (Increase) */
-	if (au->free_clusters > amap->fclu_hint)
-		amap->fclu_hint = au->free_clusters;
+	__set_bit(au->free_clusters - 1, amap->fclu_bitmap);
 
 	return 0;
 }
@@ -192,6 +156,8 @@ int amap_remove_cold_au(AMAP_T *amap, AU_INFO_T *au)
 
 	/* remove from list */
 	amap_list_del(&(au->head));
+	if (list_empty(&NODE(au->free_clusters, amap)->head))
+		__clear_bit(au->free_clusters - 1, amap->fclu_bitmap);
 
 	return 0;
 }
@@ -205,8 +171,8 @@ int amap_remove_cold_au(AMAP_T *amap, AU_INFO_T *au)
  */
 AU_INFO_T *amap_find_cold_au_bestfit(AMAP_T *amap, uint16_t free_clusters)
 {
-	AU_INFO_T *au = NULL;
-	FCLU_NODE_T *fclu_iter;
+	AU_INFO_T *au;
+	int i;
 
 	if (free_clusters <= 0 || free_clusters > amap->clusters_per_au) {
 		EMSG("AMAP: amap_find_cold_au_bestfit / unexpected arg. (%d)\n",
@@ -214,29 +180,18 @@ AU_INFO_T *amap_find_cold_au_bestfit(AMAP_T *amap, uint16_t free_clusters)
 		return NULL;
 	}
 
-	fclu_iter = NODE(free_clusters, amap);
-
-	if (amap->fclu_hint < free_clusters) {
+	/* The first non-empty node with enough free_clusters */
+	i = find_next_bit(amap->fclu_bitmap, amap->clusters_per_au,
+			free_clusters - 1);
+	if (i >= amap->clusters_per_au) {
 		/* There is no AUs with enough free_clusters */
 		return NULL;
 	}
 
-	/* Naive Hash management (++) */
-	do {
-		if (!list_empty(&fclu_iter->head)) {
-			struct list_head *first = fclu_iter->head.next;
-
-			au = list_entry(first, AU_INFO_T, head);
-
-			break;
-		}
-
-		fclu_iter++;
-	} while (fclu_iter < (amap->fclu_nodes + amap->clusters_per_au));
-
+	au = list_first_entry(&amap->fclu_nodes[i].head, AU_INFO_T, head);
 
 	// BUG_ON(au->free_clusters < 0);
-	BUG_ON(au && (au->free_clusters > amap->clusters_per_au));
+	BUG_ON(au->free_clusters > amap->clusters_per_au);
 
 	return au;
 }
@@ -269,40 +224,23 @@ AU_INFO_T *amap_pop_cold_au_bestfit(AMAP_T *amap, uint16_t free_clusters)
  */
 AU_INFO_T *amap_pop_cold_au_largest(AMAP_T *amap, uint16_t start_fclu)
 {
-	AU_INFO_T *au = NULL;
-	FCLU_NODE_T *fclu_iter;
+	AU_INFO_T *au;
+	int i;
 
 	if (!start_fclu)
 		start_fclu = amap->clusters_per_au;
 	if (start_fclu > amap->clusters_per_au)
 		start_fclu = amap->clusters_per_au;
 
-	/* Use hint (search start point) */
-	if (amap->fclu_hint < start_fclu)
-		fclu_iter = NODE(amap->fclu_hint, amap);
-	else
-		fclu_iter = NODE(start_fclu, amap);
-
-	/* Naive Hash management */
-	do {
-		if (!list_empty(&fclu_iter->head)) {
-			struct list_head *first = fclu_iter->head.next;
-
-			au = list_entry(first, AU_INFO_T, head);
-			// BUG_ON((au < amap->entries) || ((amap->entries + amap->n_au) <= au));
-
-			amap_list_del(first);
-
-			// (Hint) Possible maximum value of free clusters (among cold)
-			/* if it wasn't the whole search, don't update fclu_hint */
-			if (start_fclu == amap->clusters_per_au)
-				amap->fclu_hint = au->free_clusters;
+	/* The last non-empty node at or below start_fclu */
+	i = amap_find_prev_node(amap, start_fclu - 1);
+	if (i < 0)
+		return NULL;
 
-			break;
-		}
+	au = list_first_entry(&amap->fclu_nodes[i].head, AU_INFO_T, head);
+	// BUG_ON((au < amap->entries) || ((amap->entries + amap->n_au) <= au));
 
-		fclu_iter--;
-	} while (amap->fclu_nodes <= fclu_iter);
+	amap_remove_cold_au(amap, au);
 
 	return au;
 }
@@ -445,15 +383,20 @@ int amap_create(struct super_block *sb, u32 pack_ratio, u32 sect_per_au, u32 hid
 	else
 		amap->fclu_nodes = vzalloc(PAGE_SIZE << amap->fclu_order);
 
-	amap->fclu_hint = amap->clusters_per_au;
+	/* Non-empty nodes, for best-fit and largest AU lookup */
+	amap->fclu_bitmap = kcalloc(BITS_TO_LONGS(amap->clusters_per_au),
+			sizeof(unsigned long), GFP_NOIO);
+	if (!amap->fclu_nodes || !amap->fclu_bitmap) {
+		sdfat_msg(sb, KERN_ERR,
+			"failed to alloc amap->fclu_nodes\n");
+		goto free_and_eio;
+	}
 
 	/* Hot AU list, ignored AU list */
-	amap->slist_hot.next = NULL;
-	amap->slist_hot.head = &amap->slist_hot;
+	INIT_LIST_HEAD(&amap->list_hot);
 	amap->total_fclu_hot = 0;
 
-	amap->slist_ignored.next = NULL;
-	amap->slist_ignored.head = &amap->slist_ignored;
+	INIT_LIST_HEAD(&amap->list_ignored);
 
 	/* Strategy related vars. */
 	amap->cur_cold.au = NULL;
@@ -473,6 +416,7 @@ int amap_create(struct super_block *sb, u32 pack_ratio, u32 sect_per_au, u32 hid
 	/*
 	 * Thanks to kzalloc()
 	 * amap->entries[i_au].free_clusters = 0;
+	 * amap->entries[i_au].state = AU_STATE_COLD;
 	 * amap->entries[i_au].head.prev = NULL;
 	 * amap->entries[i_au].head.next = NULL;
 	 */
@@ -554,6 +498,7 @@ free_and_eio:
 			else
 				vfree(amap->fclu_nodes);
 		}
+		kfree(amap->fclu_bitmap);
 		kfree(amap);
 	}
 	return -EIO;
@@ -585,6 +530,7 @@ void amap_destroy(struct super_block *sb)
 		free_page((unsigned long)amap->fclu_nodes);
 	else
 		vfree(amap->fclu_nodes);
+	kfree(amap->fclu_bitmap);
 	kfree(amap);
 	SDFAT_SB(sb)->fsi.amap = NULL;
 }
@@ -748,7 +694,7 @@ retry:
 		 * This could happen because of the ignored AUs but not likely
 		 * (because the defrag daemon will not work if there is no enough space)
 		 */
-		BUG_ON(amap->slist_ignored.next == NULL);
+		BUG_ON(list_empty(&amap->list_ignored));
 		return NULL;
 	}
 
@@ -916,7 +862,7 @@ void amap_put_target_au(AMAP_T *amap, TARGET_AU_T *cur, unsigned int num_allocat
 
 		if (cur->idx >= amap->clusters_per_au || cur->au->free_clusters == 0) {
 			/* It should be inserted back to AU MAP */
-			cur->au->shead.head = NULL;		// SET_AU_NOT_WORKING
+			SET_AU_NOT_WORKING(cur->au);
 			amap_add_cold_au(amap, cur->au);
 
 			// cur->au = NULL;	// This value will be used for the next AU selection
@@ -1215,7 +1161,7 @@ s32 amap_mark_ignore(struct super_block *sb, u32 clu)
 		return 0;
 
 	amap_remove_cold_au(amap, au);
-	amap_insert_to_list(au, &amap->slist_ignored);
+	amap_insert_to_list(au, &amap->list_ignored, AU_STATE_IGNORED);
 
 	BUG_ON(!IS_AU_IGNORED(au, amap));
 
@@ -1241,7 +1187,7 @@ s32 amap_unmark_ignore(struct super_block *sb, u32 clu)
 	BUG_ON(!IS_AU_IGNORED(au, amap));
 	// BUG_ON(GET_IGN_CNT(au) == 0);
 
-	amap_remove_from_list(au, &amap->slist_ignored);
+	amap_remove_from_list(au, AU_STATE_IGNORED);
 	amap_add_cold_au(amap, au);
 
 	BUG_ON(IS_AU_IGNORED(au, amap));
@@ -1260,29 +1206,23 @@ s32 amap_unmark_ignore(struct super_block *sb, u32 clu)
 s32 amap_unmark_ignore_all(struct super_block *sb)
 {
 	AMAP_T *amap = SDFAT_SB(sb)->fsi.amap;
-	struct slist_head *entry;
-	AU_INFO_T *au;
+	AU_INFO_T *au, *tmp;
 	int n = 0;
 
 	BUG_ON(!amap);
-	entry = amap->slist_ignored.next;
-	while (entry) {
-		au = list_entry(entry, AU_INFO_T, shead);
-
+	list_for_each_entry_safe(au, tmp, &amap->list_ignored, head) {
 		BUG_ON(au != GET_AU(amap, au->idx));
 		BUG_ON(!IS_AU_IGNORED(au, amap));
 
 		//CLEAR_IGN_CNT(au);
-		amap_remove_from_list(au, &amap->slist_ignored);
+		amap_remove_from_list(au, AU_STATE_IGNORED);
 		amap_add_cold_au(amap, au);
 
 		MMSG("AMAP: Unmark ignored AU (%d)\n", au->idx);
 		n++;
-
-		entry = amap->slist_ignored.next;
 	}
 
-	BUG_ON(amap->slist_ignored.next != NULL);
+	BUG_ON(!list_empty(&amap->list_ignored));
 	MMSG("AMAP: unmark_ignore_all, total %d AUs\n", n);
 
 	return n;
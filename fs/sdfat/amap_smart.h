@@ -37,22 +37,15 @@
 /* Minimum sectors for support AMAP create */
 #define AMAP_MIN_SUPPORT_SECTORS	(1048576)
 
-#define amap_add_hot_au(amap, au) amap_insert_to_list(au, &amap->slist_hot)
-
-/* singly linked list */
-struct slist_head {
-	struct slist_head *next;
-	struct slist_head *head;
-};
+#define amap_add_hot_au(amap, au) \
+	amap_insert_to_list(au, &amap->list_hot, AU_STATE_HOT)
 
 /* AU entry type */
 typedef struct __AU_INFO_T {
 	uint16_t idx;			/* the index of the AU (0, 1, 2, ... ) */
 	uint16_t free_clusters;		/* # of available cluster */
-	union {
-		struct list_head head;
-		struct slist_head shead;/* singly linked list head for hot list */
-	};
+	uint8_t state;			/* AU_STATE_XXX */
+	struct list_head head;		/* cold bucket, hot or ignored list */
 } AU_INFO_T;
 
 
@@ -91,14 +84,14 @@ typedef struct __AMAP_T {
 	/* Size-based AU management pool (cold) */
 	FCLU_NODE_T *fclu_nodes;	/* An array of listheads */
 	int fclu_order;			/* Page order that fclu_nodes needs */
-	int fclu_hint;			/* maximum # of free clusters in an AU */
+	unsigned long *fclu_bitmap;	/* Bit (fclu - 1) set: node not empty */
 
 	/* Hot AU list */
 	unsigned int total_fclu_hot;	/* Free clusters in hot list */
-	struct slist_head slist_hot;	/* Hot AU list */
+	struct list_head list_hot;	/* Hot AU list */
 
 	/* Ignored AU list */
-	struct slist_head slist_ignored;
+	struct list_head list_ignored;
 
 	/* Allocator variables (keep 2 AUs at maximum) */
 	TARGET_AU_T cur_cold;
@@ -119,11 +112,16 @@ typedef struct __AMAP_T {
 #define FREE_CLUSTERS(node, amap) ((int)(node - amap->fclu_nodes) + 1)
 
 /* AU status */
-#define MAGIC_WORKING	((struct slist_head *)0xFFFF5091)
-#define IS_AU_HOT(au, amap)	(au->shead.head == &amap->slist_hot)
-#define IS_AU_IGNORED(au, amap)	(au->shead.head == &amap->slist_ignored)
-#define IS_AU_WORKING(au, amap)	(au->shead.head == MAGIC_WORKING)
-#define SET_AU_WORKING(au)	(au->shead.head = MAGIC_WORKING)
+#define AU_STATE_COLD		(0)	/* In a cold AU node (or full) */
+#define AU_STATE_HOT		(1)
+#define AU_STATE_IGNORED	(2)
+#define AU_STATE_WORKING	(3)
+
+#define IS_AU_HOT(au, amap)	(au->state == AU_STATE_HOT)
+#define IS_AU_IGNORED(au, amap)	(au->state == AU_STATE_IGNORED)
+#define IS_AU_WORKING(au, amap)	(au->state == AU_STATE_WORKING)
+#define SET_AU_WORKING(au)	(au->state = AU_STATE_WORKING)
+#define SET_AU_NOT_WORKING(au)	(au->state = AU_STATE_COLD)
 
 /* AU <-> cluster */
 #define i_AU_of_CLU(amap, clu)	((amap->clu_align_bias + clu) / amap->clusters_per_au)
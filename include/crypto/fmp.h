@@ -12,6 +12,9 @@
 
 #include <linux/platform_device.h>
 #include <linux/miscdevice.h>
+#include <linux/fs.h>
+#include <linux/rcupdate.h>
+#include <linux/slab.h>
 
 #define FMP_KEY_SIZE_16		16
 #define FMP_KEY_SIZE_32		32
@@ -83,6 +86,53 @@ struct fmp_crypto_setting {
 	uint8_t iv[FMP_IV_SIZE_16];
 };
 
+/*
+ * Key part of the file crypto setting of an inode, built once when its key
+ * is set up and hung off its mapping. The I/O path copies it and patches in
+ * the IV of each segment instead of rebuilding the setting from the mapping.
+ */
+struct fmp_crypto_tmpl {
+	struct rcu_head rcu;
+	struct fmp_crypto_setting crypto;
+};
+
+static inline struct fmp_crypto_tmpl *fmp_crypto_tmpl_alloc(int algo_mode,
+				const unsigned char *key,
+				unsigned long key_length, gfp_t gfp)
+{
+	struct fmp_crypto_tmpl *tmpl;
+	unsigned long size = key_length;
+
+	if (algo_mode == EXYNOS_FMP_ALGO_MODE_AES_XTS)
+		size >>= 1;
+	if (size != FMP_KEY_SIZE_16 && size != FMP_KEY_SIZE_32)
+		return NULL;
+	if (key_length > FMP_MAX_KEY_SIZE)
+		return NULL;
+
+	tmpl = kzalloc(sizeof(*tmpl), gfp);
+	if (!tmpl)
+		return NULL;
+
+	tmpl->crypto.enc_mode = EXYNOS_FMP_FILE_ENC;
+	tmpl->crypto.algo_mode = algo_mode;
+	tmpl->crypto.key_size = size;
+	memcpy(tmpl->crypto.key, key, key_length);
+
+	return tmpl;
+}
+
+#ifdef CONFIG_EXT4_PRIVATE_ENCRYPTION
+void fmp_crypto_tmpl_set(struct address_space *mapping,
+			 struct fmp_crypto_tmpl *tmpl);
+#else
+static inline void fmp_crypto_tmpl_set(struct address_space *mapping,
+				       struct fmp_crypto_tmpl *tmpl)
+{
+	kzfree(tmpl);
+}
+#endif
+
 struct fmp_table_setting {
 	__le32 des0;
 #define GET_CMDQ_LENGTH(d) \
@@ -21,6 +21,7 @@
 
 struct scatterlist;
 struct device;
+struct dma_buf;
 
 typedef u32 exynos_iova_t;
 
@@ -137,6 +138,30 @@ dma_addr_t iovmm_map(struct device *dev, struct scatterlist *sg, off_t offset,
  */
 void iovmm_unmap(struct device *dev, dma_addr_t iova);
 
+/* iovmm_map_dmabuf() - iovmm_map() with the mapping cached per dma-buf
+ * @dev: the owner of the IO address space where the mapping is created
+ * @dmabuf: the buffer that @sg describes
+ * @sg: list of physical memory chunks of @dmabuf
+ * @offset, @size, @direction, @prot: same as iovmm_map()
+ *
+ * Mapping the same part of @dmabuf again in the same IO address space returns
+ * the IO address of the previous mapping without building the page table.
+ * The mapping holds a reference to @dmabuf and stays alive after
+ * iovmm_unmap_dmabuf() until it has been idle for dmabuf_idle_ms, or until it
+ * is evicted by the cache size limit or by memory pressure.
+ */
+dma_addr_t iovmm_map_dmabuf(struct device *dev, struct dma_buf *dmabuf,
+		struct scatterlist *sg, off_t offset, size_t size,
+		enum dma_data_direction direction, int prot);
+
+/* iovmm_unmap_dmabuf() - releases an IO address from iovmm_map_dmabuf()
+ * @dev: the owner of the IO address space where @iova belongs
+ * @dmabuf: the buffer given to iovmm_map_dmabuf()
+ * @iova: IO address returned by iovmm_map_dmabuf()
+ */
+void iovmm_unmap_dmabuf(struct device *dev, struct dma_buf *dmabuf,
+			dma_addr_t iova);
+
 /*
  * flags to option_iplanes and option_oplanes.
  * inplanes and onplanes is 'input planes' and 'output planes', respectively.
@@ -163,6 +188,9 @@ void iovmm_unmap(struct device *dev, dma_addr_t iova);
 #define iovmm_deactivate(dev)		do { } while (0)
 #define iovmm_map(dev, sg, offset, size, direction, prot) (-ENOSYS)
 #define iovmm_unmap(dev, iova)		do { } while (0)
+#define iovmm_map_dmabuf(dev, dmabuf, sg, offset, size, direction, prot) \
+					(-ENOSYS)
+#define iovmm_unmap_dmabuf(dev, dmabuf, iova)	do { } while (0)
 #define get_domain_from_dev(dev)	NULL
 static inline dma_addr_t exynos_iovmm_map_userptr(struct device *dev,
 			unsigned long vaddr, size_t size, int prot)
@@ -51,4 +51,6 @@ int cfb_report(int target_uid, const char *reason);
 int register_kfreecess_hook(int mod, freecess_hook hook);
 int unregister_kfreecess_hook(int mod);
 int pkg_stat_show(struct seq_file *m, void *v);
+int freecess_ring_report(int mod, int caller_pid, int target_uid, int flag);
+int freecess_ring_stat_show(struct seq_file *m, void *v);
 #endif
\ No newline at end of file
@@ -55,6 +55,7 @@ struct workqueue_struct;
 struct iov_iter;
 struct fscrypt_info;
 struct fscrypt_operations;
+struct fmp_crypto_tmpl;
 
 extern void __init inode_init(void);
 extern void __init inode_init_early(void);
@@ -477,6 +478,7 @@ struct address_space {
 	int			private_enc_mode;	/* Encryption mode */
 	int 			private_algo_mode;	/* Encryption algorithm */
 	pgoff_t			sensitive_data_index;	/* data starts here */
+	struct fmp_crypto_tmpl __rcu *fmp_tmpl;	/* key part of FMP setting */
 	struct crypto_hash	*hash_tfm;	/* hash transform */
 #ifdef CONFIG_CRYPTO_FIPS
 	bool			cc_enable;	/* cc flag */
@@ -535,4 +535,11 @@ int input_ff_erase(struct input_dev *dev, int effect_id, struct file *file);
 int input_ff_create_memless(struct input_dev *dev, void *data,
 		int (*play_effect)(struct input_dev *, void *, struct ff_effect *));
 
+/* Built-in callers such as the display driver cannot reach input=m */
+#if IS_REACHABLE(CONFIG_INPUT) && !defined(CONFIG_INPUT_BOOSTER)
+void input_booster_frame_miss(unsigned int frames);
+#else
+static inline void input_booster_frame_miss(unsigned int frames) { }
+#endif
+
 #endif
@@ -53,6 +53,7 @@ struct sched_param {
 #include <linux/hrtimer.h>
 #include <linux/kcov.h>
 #include <linux/task_io_accounting.h>
+#include <linux/uid_sys_stats.h>
 #include <linux/latencytop.h>
 #include <linux/cred.h>
 #include <linux/llist.h>
@@ -135,6 +136,7 @@ struct perf_event_context;
 struct blk_plug;
 struct filename;
 struct nameidata;
+struct uid_time_owed;
 
 #define VMACACHE_BITS 2
 #define VMACACHE_SIZE (1U << VMACACHE_BITS)
@@ -874,6 +876,10 @@ struct user_struct {
 #if defined(CONFIG_PERF_EVENTS) || defined(CONFIG_BPF_SYSCALL)
 	atomic_long_t locked_vm;
 #endif
+#ifdef CONFIG_UID_SYS_STATS
+	struct uid_sys_stats __percpu *sys_stats; /* cpu/io usage totals */
+	atomic_t sys_stats_registered;	/* pinned by a uid_sys_stats entry */
+#endif
 };
 
 extern int uids_sysfs_init(void);
@@ -1753,6 +1759,7 @@ struct task_struct {
 #ifdef CONFIG_CPU_FREQ_TIMES
 	u64 *time_in_state;
 	unsigned int max_state;
+	struct uid_time_owed *uid_time_owed;
 #endif
 	struct prev_cputime prev_cputime;
 #ifdef CONFIG_VIRT_CPU_ACCOUNTING_GEN
@@ -2324,6 +2331,9 @@ static inline cputime_t task_gtime(struct task_struct *t)
 #endif
 extern void task_cputime_adjusted(struct task_struct *p, cputime_t *ut, cputime_t *st);
 extern void thread_group_cputime_adjusted(struct task_struct *p, cputime_t *ut, cputime_t *st);
+extern void cputime_totals_adjusted(struct task_cputime *curr,
+				    struct prev_cputime *prev,
+				    cputime_t *ut, cputime_t *st);
 
 /*
  * Per process flags
@@ -3448,11 +3458,13 @@ extern int task_can_switch_user(struct user_struct *up,
 static inline void add_rchar(struct task_struct *tsk, ssize_t amt)
 {
 	tsk->ioac.rchar += amt;
+	uid_sys_stats_account(tsk, UID_SYS_STATS_RCHAR, amt);
 }
 
 static inline void add_wchar(struct task_struct *tsk, ssize_t amt)
 {
 	tsk->ioac.wchar += amt;
+	uid_sys_stats_account(tsk, UID_SYS_STATS_WCHAR, amt);
 }
 
 static inline void inc_syscr(struct task_struct *tsk)
@@ -3468,6 +3480,7 @@ static inline void inc_syscw(struct task_struct *tsk)
 static inline void inc_syscfs(struct task_struct *tsk)
 {
 	tsk->ioac.syscfs++;
+	uid_sys_stats_account(tsk, UID_SYS_STATS_FSYNC, 1);
 }
 #else
 static inline void add_rchar(struct task_struct *tsk, ssize_t amt)
@@ -3538,7 +3551,9 @@ void cpufreq_remove_update_util_hook(int cpu);
 
 #ifdef CONFIG_SCHED_HP_EVENT
 void hp_event_update(struct sched_entity *se);
+unsigned int hp_event_big_nr_running(void);
 #else
 static inline void hp_event_update(struct sched_entity *se) { }
+static inline unsigned int hp_event_big_nr_running(void) { return 0; }
 #endif
 #endif
@@ -444,6 +444,8 @@ struct tcp_sock {
 	struct hlist_nulls_node tk_table;
 	u32		mptcp_loc_token;
 	u64		mptcp_loc_key;
+	/* MPTCP_ENERGY_PREF plus one, 0 if the scheduler's default applies */
+	u8		mptcp_energy_pref;
 #endif
 	
 };
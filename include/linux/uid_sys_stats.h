@@ -0,0 +1,67 @@
+/* include/linux/uid_sys_stats.h
+ *
+ * Copyright (C) 2014 - 2015 Google, Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _LINUX_UID_SYS_STATS_H
+#define _LINUX_UID_SYS_STATS_H
+
+#include <linux/jump_label.h>
+#include <linux/types.h>
+
+struct task_struct;
+struct user_struct;
+
+enum uid_sys_stats_item {
+	UID_SYS_STATS_UTIME,
+	UID_SYS_STATS_STIME,
+	UID_SYS_STATS_RTIME,
+	UID_SYS_STATS_RCHAR,
+	UID_SYS_STATS_WCHAR,
+	UID_SYS_STATS_READ_BYTES,
+	UID_SYS_STATS_WRITE_BYTES,
+	UID_SYS_STATS_CANCELLED_WRITE_BYTES,
+	UID_SYS_STATS_FSYNC,
+	UID_SYS_STATS_NR,
+};
+
+/*
+ * Per-cpu running totals charged to a user_struct, updated as the usage
+ * happens so that readers never have to walk the task list.
+ */
+struct uid_sys_stats {
+	u64 stat[UID_SYS_STATS_NR];
+};
+
+#ifdef CONFIG_UID_SYS_STATS
+DECLARE_STATIC_KEY_FALSE(uid_sys_stats_enabled);
+
+void __uid_sys_stats_account(struct task_struct *tsk,
+			     enum uid_sys_stats_item item, u64 amt);
+void uid_sys_stats_register_user(struct user_struct *up);
+
+/* A patched-out branch until the /proc/uid_* nodes are registered */
+static inline void uid_sys_stats_account(struct task_struct *tsk,
+					 enum uid_sys_stats_item item,
+					 u64 amt)
+{
+	if (static_branch_unlikely(&uid_sys_stats_enabled))
+		__uid_sys_stats_account(tsk, item, amt);
+}
+#else
+static inline void uid_sys_stats_account(struct task_struct *tsk,
+					 enum uid_sys_stats_item item,
+					 u64 amt) {}
+static inline void uid_sys_stats_register_user(struct user_struct *up) {}
+#endif /* CONFIG_UID_SYS_STATS */
+#endif /* _LINUX_UID_SYS_STATS_H */
@@ -730,6 +730,7 @@ enum
 	MPTCP_MIB_ADDADDRTX,		/* Sent an ADD_ADDR */
 	MPTCP_MIB_REMADDRRX,		/* Received a REMOVE_ADDR */
 	MPTCP_MIB_REMADDRTX,		/* Sent a REMOVE_ADDR */
+	MPTCP_MIB_OFOBATCHMERGE,	/* Segments merged before the meta-ofo-queue */
 	__MPTCP_MIB_MAX
 };
 
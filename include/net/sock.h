@@ -249,6 +249,7 @@ struct sock_common {
 };
 
 struct cg_proto;
+struct sock_tag;
 /**
   *	struct sock - network layer representation of sockets
   *	@__sk_common: shared layout with inet_timewait_sock
@@ -314,6 +315,7 @@ struct cg_proto;
   *	@sk_send_head: front of stuff to transmit
   *	@sk_security: used by security modules
   *	@sk_mark: generic packet mark
+ *	@sk_qtag: xt_qtaguid tag of this socket, %NULL if untagged
   *	@sk_classid: this socket's cgroup classid
   *	@sk_cgrp: this socket's cgroup-specific proto data
   *	@sk_write_pending: a write to stream socket waits to start
@@ -456,6 +458,9 @@ struct sock {
 #endif
 	__u32			sk_mark;
 	kuid_t			sk_uid;
+#ifdef CONFIG_NETFILTER_XT_MATCH_QTAGUID
+	struct sock_tag __rcu	*sk_qtag;
+#endif
 #ifdef CONFIG_CGROUP_NET_CLASSID
 	u32			sk_classid;
 #endif
@@ -118,6 +118,7 @@ enum {
 
 #ifdef CONFIG_MPTCP
 	#define MPTCP_ENABLED		42
+	#define MPTCP_ENERGY_PREF	43	/* latency (0) vs energy (100), -1 for default */
 #endif
 
 struct tcp_repair_opt {
@@ -554,6 +554,37 @@ static ssize_t wake_unlock_store(struct kobject *kobj,
 
 power_attr(wake_unlock);
 
+static ssize_t wake_lock_stats_show(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    char *buf)
+{
+	return pm_show_wakelock_stats(buf);
+}
+
+static struct kobj_attribute wake_lock_stats_attr = __ATTR_RO(wake_lock_stats);
+
+static ssize_t wake_lock_coalesce_ms_show(struct kobject *kobj,
+					  struct kobj_attribute *attr,
+					  char *buf)
+{
+	return sprintf(buf, "%u\n", pm_get_wakelocks_coalesce_ms());
+}
+
+static ssize_t wake_lock_coalesce_ms_store(struct kobject *kobj,
+					   struct kobj_attribute *attr,
+					   const char *buf, size_t n)
+{
+	unsigned int val;
+
+	if (kstrtouint(buf, 10, &val))
+		return -EINVAL;
+
+	pm_set_wakelocks_coalesce_ms(val);
+	return n;
+}
+
+power_attr(wake_lock_coalesce_ms);
+
 #endif /* CONFIG_PM_WAKELOCKS */
 #endif /* CONFIG_PM_SLEEP */
 
@@ -642,6 +673,8 @@ static struct attribute * g[] = {
 #ifdef CONFIG_PM_WAKELOCKS
 	&wake_lock_attr.attr,
 	&wake_unlock_attr.attr,
+	&wake_lock_stats_attr.attr,
+	&wake_lock_coalesce_ms_attr.attr,
 #endif
 #ifdef CONFIG_PM_DEBUG
 	&pm_test_attr.attr,
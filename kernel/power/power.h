@@ -286,5 +286,8 @@ static inline suspend_state_t pm_autosleep_state(void) { return PM_SUSPEND_ON; }
 extern ssize_t pm_show_wakelocks(char *buf, bool show_active);
 extern int pm_wake_lock(const char *buf);
 extern int pm_wake_unlock(const char *buf);
+extern ssize_t pm_show_wakelock_stats(char *buf);
+extern unsigned int pm_get_wakelocks_coalesce_ms(void);
+extern void pm_set_wakelocks_coalesce_ms(unsigned int msec);
 
 #endif /* !CONFIG_PM_WAKELOCKS */
@@ -11,40 +11,70 @@
 
 #include <linux/capability.h>
 #include <linux/ctype.h>
+#include <linux/dcache.h>
 #include <linux/device.h>
 #include <linux/err.h>
+#include <linux/hashtable.h>
 #include <linux/hrtimer.h>
 #include <linux/list.h>
-#include <linux/rbtree.h>
+#include <linux/rculist.h>
+#include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/workqueue.h>
 
 #include "power.h"
 
+/*
+ * Wakelocks are looked up under RCU, so that writes to wake_lock and
+ * wake_unlock for existing names only take the wakeup source's own lock.
+ * wakelocks_lock serializes adding and garbage collecting them.
+ */
 static DEFINE_MUTEX(wakelocks_lock);
 
+#define WAKELOCKS_HASH_BITS	7
+
+enum {
+	WL_COALESCING,		/* unlocked, relax deferred by coalescing */
+};
+
 struct wakelock {
 	char			*name;
-	struct rb_node		node;
+	unsigned int		hash;
+	struct hlist_node	node;
 	struct wakeup_source	ws;
 #ifdef CONFIG_PM_WAKELOCKS_GC
-	struct list_head	lru;
+	struct list_head	gc;
 #endif
+	/* Statistics, updated without locking */
+	atomic_long_t		acquires;
+	atomic_long_t		coalesced;
+	pid_t			tgid;		/* last holder */
+	unsigned long		rate_start;	/* jiffies */
+	unsigned int		rate_count;
+	unsigned int		rate;		/* acquires in the last second */
+	unsigned long		flags;
+	unsigned long		coalesce_until;	/* jiffies */
 };
 
-static struct rb_root wakelocks_tree = RB_ROOT;
+static DEFINE_HASHTABLE(wakelocks_hash, WAKELOCKS_HASH_BITS);
+
+/*
+ * If set, wake_unlock keeps the wakelock active for this long, so that a
+ * wake_lock right after it does not deactivate and reactivate the wakeup
+ * source.
+ */
+static unsigned int wakelocks_coalesce_ms;
 
 ssize_t pm_show_wakelocks(char *buf, bool show_active)
 {
-	struct rb_node *node;
 	struct wakelock *wl;
 	char *str = buf;
 	char *end = buf + PAGE_SIZE;
+	int bkt;
 
-	mutex_lock(&wakelocks_lock);
+	rcu_read_lock();
 
-	for (node = rb_first(&wakelocks_tree); node; node = rb_next(node)) {
-		wl = rb_entry(node, struct wakelock, node);
+	hash_for_each_rcu(wakelocks_hash, bkt, wl, node) {
 		if (wl->ws.active == show_active)
 			str += scnprintf(str, end - str, "%s ", wl->name);
 	}
@@ -53,10 +83,64 @@ ssize_t pm_show_wakelocks(char *buf, bool show_active)
 
 	str += scnprintf(str, end - str, "\n");
 
-	mutex_unlock(&wakelocks_lock);
+	rcu_read_unlock();
 	return (str - buf);
 }
 
+ssize_t pm_show_wakelock_stats(char *buf)
+{
+	struct wakelock *wl;
+	char *str = buf;
+	char *end = buf + PAGE_SIZE;
+	ktime_t total, max;
+	bool active;
+	int bkt;
+
+	str += scnprintf(str, end - str, "%-24s %10s %6s %12s %10s %7s %10s\n",
+			 "name", "acquires", "rate", "hold_ms", "max_ms",
+			 "tgid", "coalesced");
+
+	rcu_read_lock();
+
+	hash_for_each_rcu(wakelocks_hash, bkt, wl, node) {
+		spin_lock_irq(&wl->ws.lock);
+		total = wl->ws.total_time;
+		max = wl->ws.max_time;
+		active = wl->ws.active;
+		if (active) {
+			ktime_t held = ktime_sub(ktime_get(), wl->ws.last_time);
+
+			total = ktime_add(total, held);
+			if (ktime_to_ns(held) > ktime_to_ns(max))
+				max = held;
+		}
+		spin_unlock_irq(&wl->ws.lock);
+
+		str += scnprintf(str, end - str,
+				 "%-24s %10lu %6u %12lld %10lld %7d %10lu%s\n",
+				 wl->name, atomic_long_read(&wl->acquires),
+				 time_before(jiffies, wl->rate_start + 2 * HZ) ?
+					READ_ONCE(wl->rate) : 0,
+				 ktime_to_ms(total), ktime_to_ms(max),
+				 READ_ONCE(wl->tgid),
+				 atomic_long_read(&wl->coalesced),
+				 active ? " active" : "");
+	}
+
+	rcu_read_unlock();
+	return (str - buf);
+}
+
+unsigned int pm_get_wakelocks_coalesce_ms(void)
+{
+	return READ_ONCE(wakelocks_coalesce_ms);
+}
+
+void pm_set_wakelocks_coalesce_ms(unsigned int msec)
+{
+	WRITE_ONCE(wakelocks_coalesce_ms, msec);
+}
+
 #if CONFIG_PM_WAKELOCKS_LIMIT > 0
 static unsigned int number_of_wakelocks;
 
@@ -85,29 +169,21 @@ static inline void decrement_wakelocks_number(void) {}
 #define WL_GC_TIME_SEC	300
 
 static void __wakelocks_gc(struct work_struct *work);
-static LIST_HEAD(wakelocks_lru_list);
 static DECLARE_WORK(wakelock_work, __wakelocks_gc);
-static unsigned int wakelocks_gc_count;
-
-static inline void wakelocks_lru_add(struct wakelock *wl)
-{
-	list_add(&wl->lru, &wakelocks_lru_list);
-}
-
-static inline void wakelocks_lru_most_recent(struct wakelock *wl)
-{
-	list_move(&wl->lru, &wakelocks_lru_list);
-}
+static atomic_t wakelocks_gc_count = ATOMIC_INIT(0);
 
 static void __wakelocks_gc(struct work_struct *work)
 {
 	struct wakelock *wl, *aux;
+	struct hlist_node *tmp;
+	LIST_HEAD(unused);
 	ktime_t now;
+	int bkt;
 
 	mutex_lock(&wakelocks_lock);
 
 	now = ktime_get();
-	list_for_each_entry_safe_reverse(wl, aux, &wakelocks_lru_list, lru) {
+	hash_for_each_safe(wakelocks_hash, bkt, tmp, wl, node) {
 		u64 idle_time_ns;
 		bool active;
 
@@ -116,62 +192,79 @@ static void __wakelocks_gc(struct work_struct *work)
 		active = wl->ws.active;
 		spin_unlock_irq(&wl->ws.lock);
 
-		if (idle_time_ns < ((u64)WL_GC_TIME_SEC * NSEC_PER_SEC))
-			break;
+		if (active || idle_time_ns < ((u64)WL_GC_TIME_SEC * NSEC_PER_SEC))
+			continue;
+
+		hash_del_rcu(&wl->node);
+		list_add(&wl->gc, &unused);
+	}
+
+	if (!list_empty(&unused))
+		synchronize_rcu();
+
+	/*
+	 * No lookup can find them anymore, but one which did so before may
+	 * have locked them again.
+	 */
+	list_for_each_entry_safe(wl, aux, &unused, gc) {
+		bool active;
+
+		list_del(&wl->gc);
+
+		spin_lock_irq(&wl->ws.lock);
+		active = wl->ws.active;
+		spin_unlock_irq(&wl->ws.lock);
 
-		if (!active) {
-			wakeup_source_remove(&wl->ws);
-			rb_erase(&wl->node, &wakelocks_tree);
-			list_del(&wl->lru);
-			kfree(wl->name);
-			kfree(wl);
-			decrement_wakelocks_number();
+		if (active) {
+			hash_add_rcu(wakelocks_hash, &wl->node, wl->hash);
+			continue;
 		}
+
+		wakeup_source_remove(&wl->ws);
+		kfree(wl->name);
+		kfree(wl);
+		decrement_wakelocks_number();
 	}
-	wakelocks_gc_count = 0;
+	atomic_set(&wakelocks_gc_count, 0);
 
 	mutex_unlock(&wakelocks_lock);
 }
 
 static void wakelocks_gc(void)
 {
-	if (++wakelocks_gc_count <= WL_GC_COUNT_MAX)
+	if (atomic_inc_return(&wakelocks_gc_count) <= WL_GC_COUNT_MAX)
 		return;
 
 	schedule_work(&wakelock_work);
 }
 #else /* !CONFIG_PM_WAKELOCKS_GC */
-static inline void wakelocks_lru_add(struct wakelock *wl) {}
-static inline void wakelocks_lru_most_recent(struct wakelock *wl) {}
 static inline void wakelocks_gc(void) {}
 #endif /* !CONFIG_PM_WAKELOCKS_GC */
 
-static struct wakelock *wakelock_lookup_add(const char *name, size_t len,
-					    bool add_if_not_found)
+/* Must be called under rcu_read_lock() or with wakelocks_lock held. */
+static struct wakelock *wakelock_lookup(const char *name, size_t len,
+					unsigned int hash)
 {
-	struct rb_node **node = &wakelocks_tree.rb_node;
-	struct rb_node *parent = *node;
 	struct wakelock *wl;
 
-	while (*node) {
-		int diff;
-
-		parent = *node;
-		wl = rb_entry(*node, struct wakelock, node);
-		diff = strncmp(name, wl->name, len);
-		if (diff == 0) {
-			if (wl->name[len])
-				diff = -1;
-			else
-				return wl;
-		}
-		if (diff < 0)
-			node = &(*node)->rb_left;
-		else
-			node = &(*node)->rb_right;
+	hash_for_each_possible_rcu(wakelocks_hash, wl, node, hash) {
+		if (wl->hash == hash && !strncmp(name, wl->name, len) &&
+		    !wl->name[len])
+			return wl;
 	}
-	if (!add_if_not_found)
-		return ERR_PTR(-EINVAL);
+
+	return NULL;
+}
+
+/* Must be called with wakelocks_lock held. */
+static struct wakelock *wakelock_add(const char *name, size_t len,
+				     unsigned int hash)
+{
+	struct wakelock *wl;
+
+	wl = wakelock_lookup(name, len, hash);
+	if (wl)
+		return wl;
 
 	if (wakelocks_limit_exceeded())
 		return ERR_PTR(-ENOSPC);
@@ -186,20 +279,67 @@ static struct wakelock *wakelock_lookup_add(const char *name, size_t len,
 		kfree(wl);
 		return ERR_PTR(-ENOMEM);
 	}
+	wl->hash = hash;
 	wl->ws.name = wl->name;
 	wakeup_source_add(&wl->ws);
-	rb_link_node(&wl->node, parent, node);
-	rb_insert_color(&wl->node, &wakelocks_tree);
-	wakelocks_lru_add(wl);
+	hash_add_rcu(wakelocks_hash, &wl->node, hash);
 	increment_wakelocks_number();
 	return wl;
 }
 
+/*
+ * Called under rcu_read_lock() or with wakelocks_lock held, which keeps
+ * the garbage collector from freeing @wl. The statistics are updated
+ * racily: concurrent writers of one name may lose a count.
+ */
+static void wakelock_acquire(struct wakelock *wl, u64 timeout_ns)
+{
+	unsigned long now = jiffies;
+
+	atomic_long_inc(&wl->acquires);
+	WRITE_ONCE(wl->tgid, task_tgid_nr(current));
+	if (time_after_eq(now, wl->rate_start + HZ)) {
+		WRITE_ONCE(wl->rate, time_before(now, wl->rate_start + 2 * HZ) ?
+			   wl->rate_count : 0);
+		wl->rate_start = now;
+		wl->rate_count = 0;
+	}
+	wl->rate_count++;
+
+	if (test_and_clear_bit(WL_COALESCING, &wl->flags) &&
+	    time_before(now, wl->coalesce_until))
+		atomic_long_inc(&wl->coalesced);
+
+	if (timeout_ns) {
+		u64 timeout_ms = timeout_ns + NSEC_PER_MSEC - 1;
+
+		do_div(timeout_ms, NSEC_PER_MSEC);
+		__pm_wakeup_event(&wl->ws, timeout_ms);
+	} else {
+		__pm_stay_awake(&wl->ws);
+	}
+}
+
+static void wakelock_release(struct wakelock *wl)
+{
+	unsigned int coalesce_ms = READ_ONCE(wakelocks_coalesce_ms);
+
+	/* Only a held wakelock is kept; an inactive one must stay inactive */
+	if (coalesce_ms && wl->ws.active) {
+		wl->coalesce_until = jiffies + msecs_to_jiffies(coalesce_ms);
+		set_bit(WL_COALESCING, &wl->flags);
+		__pm_wakeup_event(&wl->ws, coalesce_ms);
+	} else {
+		__pm_relax(&wl->ws);
+	}
+}
+
 int pm_wake_lock(const char *buf)
 {
 	const char *str = buf;
 	struct wakelock *wl;
 	u64 timeout_ns = 0;
+	unsigned int hash;
 	size_t len;
 	int ret = 0;
 
@@ -217,23 +357,25 @@ int pm_wake_lock(const char *buf)
 			return -EINVAL;
 	}
 
+	hash = full_name_hash((const unsigned char *)buf, len);
+
+	rcu_read_lock();
+	wl = wakelock_lookup(buf, len, hash);
+	if (wl)
+		wakelock_acquire(wl, timeout_ns);
+	rcu_read_unlock();
+
+	if (wl)
+		return 0;
+
 	mutex_lock(&wakelocks_lock);
 
-	wl = wakelock_lookup_add(buf, len, true);
+	wl = wakelock_add(buf, len, hash);
 	if (IS_ERR(wl)) {
 		ret = PTR_ERR(wl);
 		goto out;
 	}
-	if (timeout_ns) {
-		u64 timeout_ms = timeout_ns + NSEC_PER_MSEC - 1;
-
-		do_div(timeout_ms, NSEC_PER_MSEC);
-		__pm_wakeup_event(&wl->ws, timeout_ms);
-	} else {
-		__pm_stay_awake(&wl->ws);
-	}
-
-	wakelocks_lru_most_recent(wl);
+	wakelock_acquire(wl, timeout_ns);
 
  out:
 	mutex_unlock(&wakelocks_lock);
@@ -256,19 +398,18 @@ int pm_wake_unlock(const char *buf)
 	if (!len)
 		return -EINVAL;
 
-	mutex_lock(&wakelocks_lock);
+	rcu_read_lock();
 
-	wl = wakelock_lookup_add(buf, len, false);
-	if (IS_ERR(wl)) {
-		ret = PTR_ERR(wl);
-		goto out;
-	}
-	__pm_relax(&wl->ws);
+	wl = wakelock_lookup(buf, len, full_name_hash((const unsigned char *)buf, len));
+	if (wl)
+		wakelock_release(wl);
+	else
+		ret = -EINVAL;
 
-	wakelocks_lru_most_recent(wl);
-	wakelocks_gc();
+	rcu_read_unlock();
+
+	if (wl)
+		wakelocks_gc();
 
- out:
-	mutex_unlock(&wakelocks_lock);
 	return ret;
 }
@@ -6,6 +6,7 @@
 #include <linux/static_key.h>
 #include <linux/context_tracking.h>
 #include <linux/cpufreq_times.h>
+#include <linux/uid_sys_stats.h>
 #include "sched.h"
 #include "walt.h"
 
@@ -173,6 +174,8 @@ void account_user_time(struct task_struct *p, cputime_t cputime,
 
 	/* Account power usage for system time */
 	cpufreq_acct_update_power(p, cputime);
+
+	uid_sys_stats_account(p, UID_SYS_STATS_UTIME, (__force u64) cputime);
 }
 
 /*
@@ -191,6 +194,7 @@ static void account_guest_time(struct task_struct *p, cputime_t cputime,
 	p->utimescaled += cputime_scaled;
 	account_group_user_time(p, cputime);
 	p->gtime += cputime;
+	uid_sys_stats_account(p, UID_SYS_STATS_UTIME, (__force u64) cputime);
 
 	/* Add guest time to cpustat. */
 	if (task_nice(p) > 0) {
@@ -229,6 +233,8 @@ void __account_system_time(struct task_struct *p, cputime_t cputime,
 
 	/* Account power usage for system time */
 	cpufreq_acct_update_power(p, cputime);
+
+	uid_sys_stats_account(p, UID_SYS_STATS_STIME, (__force u64) cputime);
 }
 
 /*
@@ -485,6 +491,14 @@ void thread_group_cputime_adjusted(struct task_struct *p, cputime_t *ut, cputime
 	*ut = cputime.utime;
 	*st = cputime.stime;
 }
+
+void cputime_totals_adjusted(struct task_cputime *curr,
+			     struct prev_cputime *prev,
+			     cputime_t *ut, cputime_t *st)
+{
+	*ut = curr->utime;
+	*st = curr->stime;
+}
 #else /* !CONFIG_VIRT_CPU_ACCOUNTING_NATIVE */
 /*
  * Account a single tick of cpu time.
@@ -697,6 +711,17 @@ void thread_group_cputime_adjusted(struct task_struct *p, cputime_t *ut, cputime
 	thread_group_cputime(p, &cputime);
 	cputime_adjust(&cputime, &p->signal->prev_cputime, ut, st);
 }
+
+/*
+ * Adjusts utime/stime totals kept outside of a task or thread group, such
+ * as the per-uid ones, to their sum_exec_runtime the way the task's are.
+ */
+void cputime_totals_adjusted(struct task_cputime *curr,
+			     struct prev_cputime *prev,
+			     cputime_t *ut, cputime_t *st)
+{
+	cputime_adjust(curr, prev, ut, st);
+}
 #endif /* !CONFIG_VIRT_CPU_ACCOUNTING_NATIVE */
 
 #ifdef CONFIG_VIRT_CPU_ACCOUNTING_GEN
@@ -11567,6 +11567,12 @@ void hp_event_update(struct sched_entity *se)
 
 	raw_spin_unlock_irqrestore(&hp_event_lock, flags);
 }
+
+/* runnable tasks on the big cluster, sampled by the hotplug governor */
+unsigned int hp_event_big_nr_running(void)
+{
+	return hmp_domain_sum_nr_running(hmp_faster_domain(0));
+}
 #endif
 
 #ifdef CONFIG_SCHED_HMP_TASK_BASED_SOFTLANDING
@@ -255,6 +255,8 @@ static inline void account_group_exec_runtime(struct task_struct *tsk,
 {
 	struct thread_group_cputimer *cputimer = &tsk->signal->cputimer;
 
+	uid_sys_stats_account(tsk, UID_SYS_STATS_RTIME, ns);
+
 	if (!cputimer_running(tsk))
 		return;
 
@@ -18,6 +18,7 @@
 #include <linux/user_namespace.h>
 #include <linux/proc_fs.h>
 #include <linux/proc_ns.h>
+#include <linux/uid_sys_stats.h>
 
 /*
  * userns count is 1 for root user, 1 for init_uts_ns,
@@ -135,6 +136,9 @@ static void free_user(struct user_struct *up, unsigned long flags)
 	spin_unlock_irqrestore(&uidhash_lock, flags);
 	key_put(up->uid_keyring);
 	key_put(up->session_keyring);
+#ifdef CONFIG_UID_SYS_STATS
+	free_percpu(up->sys_stats);
+#endif
 	kmem_cache_free(uid_cachep, up);
 }
 
@@ -185,6 +189,13 @@ struct user_struct *alloc_uid(kuid_t uid)
 
 		new->uid = uid;
 		atomic_set(&new->__count, 1);
+#ifdef CONFIG_UID_SYS_STATS
+		new->sys_stats = alloc_percpu(struct uid_sys_stats);
+		if (!new->sys_stats) {
+			kmem_cache_free(uid_cachep, new);
+			goto out_unlock;
+		}
+#endif
 
 		/*
 		 * Before adding this, check whether we raced
@@ -195,6 +206,9 @@ struct user_struct *alloc_uid(kuid_t uid)
 		if (up) {
 			key_put(new->uid_keyring);
 			key_put(new->session_keyring);
+#ifdef CONFIG_UID_SYS_STATS
+			free_percpu(new->sys_stats);
+#endif
 			kmem_cache_free(uid_cachep, new);
 		} else {
 			uid_hash_insert(new, hashent);
@@ -203,6 +217,7 @@ struct user_struct *alloc_uid(kuid_t uid)
 		spin_unlock_irq(&uidhash_lock);
 	}
 	proc_register_uid(uid);
+	uid_sys_stats_register_user(up);
 
 	return up;
 
@@ -220,6 +235,10 @@ static int __init uid_cache_init(void)
 	for(n = 0; n < UIDHASH_SZ; ++n)
 		INIT_HLIST_HEAD(uidhash_table + n);
 
+#ifdef CONFIG_UID_SYS_STATS
+	root_user.sys_stats = alloc_percpu(struct uid_sys_stats);
+#endif
+
 	/* Insert the root user immediately (init already runs as root) */
 	spin_lock_irq(&uidhash_lock);
 	uid_hash_insert(&root_user, uidhashentry(GLOBAL_ROOT_UID));
@@ -50,6 +50,9 @@
 #include <linux/mount.h>
 #include <linux/compaction.h>
 #include <linux/pagemap.h>
+#include <linux/swap.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
 
 #define ZSPAGE_MAGIC	0x58
 
@@ -160,6 +163,15 @@ struct zs_size_stat {
 	unsigned long objs[NR_ZS_STAT_TYPE];
 };
 
+struct zs_compact_stat {
+	unsigned long runs;
+	unsigned long pages_freed;
+	u64 total_ns;
+	u64 max_ns;
+	/* objects of smaller classes placed in this one, see zs_malloc() */
+	unsigned long merged_allocs;
+};
+
 #ifdef CONFIG_ZSMALLOC_STAT
 static struct dentry *zs_stat_root;
 #endif
@@ -196,6 +208,28 @@ static int zs_size_classes;
 static const int fullness_threshold_frac = 4;
 static size_t huge_class_size;
 
+/*
+ * A class is compacted in the background once more than frag_target
+ * percent of its allocated objects are unused and at least one zspage
+ * can be freed. New pools take this value; debugfs can change it per
+ * pool. 0 leaves compaction to zs_compact() and the shrinker only.
+ */
+static unsigned int zs_frag_target = 30;
+module_param_named(frag_target, zs_frag_target, uint, 0644);
+
+static unsigned int zs_compact_delay_ms = 200;
+module_param_named(compact_delay_ms, zs_compact_delay_ms, uint, 0644);
+
+/*
+ * A class in use by less than ZS_MERGE_UNDERUSED zspages worth of objects
+ * borrows a free slot from one of its ZS_MERGE_NEIGHBOURS next larger
+ * classes rather than allocating a zspage that would stay mostly empty,
+ * provided that wastes at most 1/2^ZS_MERGE_WASTE_SHIFT of the object.
+ */
+#define ZS_MERGE_UNDERUSED	2
+#define ZS_MERGE_NEIGHBOURS	2
+#define ZS_MERGE_WASTE_SHIFT	3
+
 struct size_class {
 	spinlock_t lock;
 	struct list_head fullness_list[NR_ZS_FULLNESS];
@@ -210,6 +244,7 @@ struct size_class {
 
 	unsigned int index;
 	struct zs_size_stat stats;
+	struct zs_compact_stat cstat;
 };
 
 /* huge object: pages_per_zspage == 1 && maxobj_per_zspage == 1 */
@@ -273,6 +308,9 @@ struct zs_pool {
 	struct inode *inode;
 	struct work_struct free_work;
 #endif
+	/* Background compaction, see zs_kick_compaction() */
+	struct delayed_work compact_work;
+	u32 frag_target;
 };
 
 /*
@@ -592,6 +630,39 @@ static inline unsigned long zs_stat_get(struct size_class *class,
 	return class->stats.objs[type];
 }
 
+static unsigned long zs_can_compact(struct size_class *class);
+
+/* Percentage of the allocated objects of @class which are unused */
+static unsigned int zs_class_frag(struct size_class *class)
+{
+	unsigned long obj_allocated = zs_stat_get(class, OBJ_ALLOCATED);
+	unsigned long obj_used = zs_stat_get(class, OBJ_USED);
+
+	if (obj_allocated <= obj_used)
+		return 0;
+
+	return (obj_allocated - obj_used) * 100 / obj_allocated;
+}
+
+/* Must be called with class->lock held */
+static bool zs_class_needs_compaction(struct zs_pool *pool,
+				struct size_class *class)
+{
+	u32 target = READ_ONCE(pool->frag_target);
+
+	return target && zs_class_frag(class) > target &&
+		zs_can_compact(class);
+}
+
+static void zs_kick_compaction(struct zs_pool *pool, unsigned long delay)
+{
+	if (!delay)
+		mod_delayed_work(system_unbound_wq, &pool->compact_work, 0);
+	else if (!delayed_work_pending(&pool->compact_work))
+		queue_delayed_work(system_unbound_wq, &pool->compact_work,
+				delay);
+}
+
 #ifdef CONFIG_ZSMALLOC_STAT
 
 static int __init zs_stat_init(void)
@@ -611,8 +682,6 @@ static void __exit zs_stat_exit(void)
 	debugfs_remove_recursive(zs_stat_root);
 }
 
-static unsigned long zs_can_compact(struct size_class *class);
-
 static int zs_stats_size_show(struct seq_file *s, void *v)
 {
 	int i;
@@ -684,6 +753,55 @@ static const struct file_operations zs_stat_size_ops = {
 	.release        = single_release,
 };
 
+static int zs_stats_compaction_show(struct seq_file *s, void *v)
+{
+	int i;
+	struct zs_pool *pool = s->private;
+	struct size_class *class;
+	struct zs_compact_stat cstat;
+	unsigned int frag;
+	unsigned long freeable;
+
+	seq_printf(s, " %5s %5s %5s %8s %8s %11s %8s %8s %13s\n",
+			"class", "size", "frag%", "freeable", "runs",
+			"pages_freed", "avg_us", "max_us", "merged_allocs");
+
+	for (i = 0; i < zs_size_classes; i++) {
+		class = pool->size_class[i];
+
+		if (class->index != i)
+			continue;
+
+		spin_lock(&class->lock);
+		frag = zs_class_frag(class);
+		freeable = zs_can_compact(class);
+		cstat = class->cstat;
+		spin_unlock(&class->lock);
+
+		seq_printf(s, " %5u %5u %5u %8lu %8lu %11lu %8llu %8llu %13lu\n",
+			i, class->size, frag, freeable, cstat.runs,
+			cstat.pages_freed,
+			cstat.runs ? div64_u64(cstat.total_ns,
+					cstat.runs * NSEC_PER_USEC) : 0,
+			div64_u64(cstat.max_ns, NSEC_PER_USEC),
+			cstat.merged_allocs);
+	}
+
+	return 0;
+}
+
+static int zs_stats_compaction_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, zs_stats_compaction_show, inode->i_private);
+}
+
+static const struct file_operations zs_stat_compaction_ops = {
+	.open           = zs_stats_compaction_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+
 static int zs_pool_stat_create(struct zs_pool *pool, const char *name)
 {
 	struct dentry *entry;
@@ -706,6 +824,22 @@ static int zs_pool_stat_create(struct zs_pool *pool, const char *name)
 		return -ENOMEM;
 	}
 
+	entry = debugfs_create_file("compaction", S_IFREG | S_IRUGO,
+			pool->stat_dentry, pool, &zs_stat_compaction_ops);
+	if (!entry) {
+		pr_warn("%s: debugfs file entry <%s> creation failed\n",
+				name, "compaction");
+		return -ENOMEM;
+	}
+
+	entry = debugfs_create_u32("frag_target", S_IRUGO | S_IWUSR,
+			pool->stat_dentry, &pool->frag_target);
+	if (!entry) {
+		pr_warn("%s: debugfs file entry <%s> creation failed\n",
+				name, "frag_target");
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
@@ -1570,6 +1704,48 @@ static unsigned long obj_malloc(struct size_class *class,
 }
 
 
+/*
+ * Places an object of @size, which would need a new zspage in the
+ * under-used @class, into a free slot of a close enough larger class.
+ * zs_free() and compaction find the class through the zspage, so the
+ * object simply lives in that class from now on.
+ */
+static unsigned long zs_malloc_neighbour(struct zs_pool *pool,
+				struct size_class *class, int size,
+				unsigned long handle)
+{
+	int i, tried = 0;
+	unsigned long obj;
+	struct size_class *next;
+	struct zspage *zspage;
+
+	for (i = class->index + 1; i < zs_size_classes &&
+			tried < ZS_MERGE_NEIGHBOURS; i++) {
+		next = pool->size_class[i];
+		if (next->index != i)
+			continue;
+
+		if (next->objs_per_zspage == 1 ||
+			next->size - size > size >> ZS_MERGE_WASTE_SHIFT)
+			break;
+
+		tried++;
+		spin_lock(&next->lock);
+		zspage = find_get_zspage(next);
+		if (zspage) {
+			obj = obj_malloc(next, zspage, handle);
+			fix_fullness_group(next, zspage);
+			record_obj(handle, obj);
+			next->cstat.merged_allocs++;
+			spin_unlock(&next->lock);
+			return obj;
+		}
+		spin_unlock(&next->lock);
+	}
+
+	return 0;
+}
+
 /**
  * zs_malloc - Allocate block of given size from pool.
  * @pool: pool to allocate from
@@ -1585,6 +1761,7 @@ unsigned long zs_malloc(struct zs_pool *pool, size_t size, gfp_t gfp)
 	struct size_class *class;
 	enum fullness_group newfg;
 	struct zspage *zspage;
+	bool underused;
 
 	if (unlikely(!size || size > ZS_MAX_ALLOC_SIZE))
 		return 0;
@@ -1610,8 +1787,13 @@ unsigned long zs_malloc(struct zs_pool *pool, size_t size, gfp_t gfp)
 		return handle;
 	}
 
+	underused = zs_stat_get(class, OBJ_USED) <
+			ZS_MERGE_UNDERUSED * class->objs_per_zspage;
 	spin_unlock(&class->lock);
 
+	if (underused && zs_malloc_neighbour(pool, class, size, handle))
+		return handle;
+
 	zspage = alloc_zspage(pool, class, gfp);
 	if (!zspage) {
 		cache_free_handle(pool, handle);
@@ -1671,7 +1853,7 @@ void zs_free(struct zs_pool *pool, unsigned long handle)
 	int class_idx;
 	struct size_class *class;
 	enum fullness_group fullness;
-	bool isolated;
+	bool isolated, kick;
 
 	if (unlikely(!handle))
 		return;
@@ -1700,10 +1882,14 @@ void zs_free(struct zs_pool *pool, unsigned long handle)
 	if (likely(!isolated))
 		free_zspage(pool, class, zspage);
 out:
-
+	kick = zs_class_needs_compaction(pool, class);
 	spin_unlock(&class->lock);
 	unpin_tag(handle);
 	cache_free_handle(pool, handle);
+
+	if (kick)
+		zs_kick_compaction(pool,
+			msecs_to_jiffies(READ_ONCE(zs_compact_delay_ms)));
 }
 EXPORT_SYMBOL_GPL(zs_free);
 
@@ -2304,11 +2490,13 @@ static unsigned long zs_can_compact(struct size_class *class)
 	return obj_wasted * class->pages_per_zspage;
 }
 
-static void __zs_compact(struct zs_pool *pool, struct size_class *class)
+static unsigned long __zs_compact(struct zs_pool *pool,
+				struct size_class *class)
 {
 	struct zs_compact_control cc;
 	struct zspage *src_zspage;
 	struct zspage *dst_zspage = NULL;
+	unsigned long pages_freed = 0;
 
 	spin_lock(&class->lock);
 	while ((src_zspage = isolate_zspage(class, true))) {
@@ -2339,6 +2527,7 @@ static void __zs_compact(struct zs_pool *pool, struct size_class *class)
 		if (putback_zspage(class, src_zspage) == ZS_EMPTY) {
 			free_zspage(pool, class, src_zspage);
 			pool->stats.pages_compacted += class->pages_per_zspage;
+			pages_freed += class->pages_per_zspage;
 		}
 		spin_unlock(&class->lock);
 		cond_resched();
@@ -2349,6 +2538,24 @@ static void __zs_compact(struct zs_pool *pool, struct size_class *class)
 		putback_zspage(class, src_zspage);
 
 	spin_unlock(&class->lock);
+
+	return pages_freed;
+}
+
+/* __zs_compact() accounted in the class's compaction statistics */
+static void zs_compact_class(struct zs_pool *pool, struct size_class *class)
+{
+	ktime_t start = ktime_get();
+	unsigned long pages_freed = __zs_compact(pool, class);
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	spin_lock(&class->lock);
+	class->cstat.runs++;
+	class->cstat.pages_freed += pages_freed;
+	class->cstat.total_ns += ns;
+	if (ns > class->cstat.max_ns)
+		class->cstat.max_ns = ns;
+	spin_unlock(&class->lock);
 }
 
 unsigned long zs_compact(struct zs_pool *pool)
@@ -2362,13 +2569,41 @@ unsigned long zs_compact(struct zs_pool *pool)
 			continue;
 		if (class->index != i)
 			continue;
-		__zs_compact(pool, class);
+		zs_compact_class(pool, class);
 	}
 
 	return pool->stats.pages_compacted;
 }
 EXPORT_SYMBOL_GPL(zs_compact);
 
+/*
+ * Compacts the classes over the pool's fragmentation target, off the
+ * allocation and reclaim paths.
+ */
+static void zs_compact_work(struct work_struct *work)
+{
+	int i;
+	bool needed;
+	struct size_class *class;
+	struct zs_pool *pool = container_of(to_delayed_work(work),
+			struct zs_pool, compact_work);
+
+	for (i = zs_size_classes - 1; i >= 0; i--) {
+		class = pool->size_class[i];
+		if (!class)
+			continue;
+		if (class->index != i)
+			continue;
+
+		spin_lock(&class->lock);
+		needed = zs_class_needs_compaction(pool, class);
+		spin_unlock(&class->lock);
+
+		if (needed)
+			zs_compact_class(pool, class);
+	}
+}
+
 void zs_pool_stats(struct zs_pool *pool, struct zs_pool_stats *stats)
 {
 	memcpy(stats, &pool->stats, sizeof(struct zs_pool_stats));
@@ -2382,6 +2617,15 @@ static unsigned long zs_shrinker_scan(struct shrinker *shrinker,
 	struct zs_pool *pool = container_of(shrinker, struct zs_pool,
 			shrinker);
 
+	/*
+	 * Do not stall direct reclaim on compaction when the background
+	 * worker can do it: let it run now and report nothing freed here.
+	 */
+	if (READ_ONCE(pool->frag_target) && !current_is_kswapd()) {
+		zs_kick_compaction(pool, 0);
+		return SHRINK_STOP;
+	}
+
 	pages_freed = pool->stats.pages_compacted;
 	/*
 	 * Compact classes and calculate compaction delta.
@@ -2454,6 +2698,8 @@ struct zs_pool *zs_create_pool(const char *name)
 		return NULL;
 
 	init_deferred_free(pool);
+	INIT_DELAYED_WORK(&pool->compact_work, zs_compact_work);
+	pool->frag_target = READ_ONCE(zs_frag_target);
 	pool->size_class = kcalloc(zs_size_classes, sizeof(struct size_class *),
 			GFP_KERNEL);
 	if (!pool->size_class) {
@@ -2565,6 +2811,7 @@ void zs_destroy_pool(struct zs_pool *pool)
 	int i;
 
 	zs_unregister_shrinker(pool);
+	cancel_delayed_work_sync(&pool->compact_work);
 	zs_unregister_migration(pool);
 	zs_pool_stat_destroy(pool);
 
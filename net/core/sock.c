@@ -1752,6 +1752,10 @@ struct sock *sk_clone_lock(const struct sock *sk, const gfp_t priority)
 		newsk->sk_forward_alloc = 0;
 		newsk->sk_send_head	= NULL;
 		newsk->sk_userlocks	= sk->sk_userlocks & ~SOCK_BINDPORT_LOCK;
+#ifdef CONFIG_NETFILTER_XT_MATCH_QTAGUID
+		/* Tags belong to the tagged socket, not its children */
+		RCU_INIT_POINTER(newsk->sk_qtag, NULL);
+#endif
 
 		sock_reset_flag(newsk, SOCK_DONE);
 #ifdef CONFIG_MPTCP
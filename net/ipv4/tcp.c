@@ -2842,6 +2842,14 @@ static int do_tcp_setsockopt(struct sock *sk, int level,
 		else
 			mptcp_disable_sock(sk);
 		break;
+	case MPTCP_ENERGY_PREF:
+		if (val < -1 || val > 100) {
+			err = -EINVAL;
+			break;
+		}
+
+		tp->mptcp_energy_pref = val + 1;
+		break;
 #endif
 	default:
 		err = -ENOPROTOOPT;
@@ -3149,6 +3157,9 @@ static int do_tcp_getsockopt(struct sock *sk, int level,
 	case MPTCP_ENABLED:
 		val = sock_flag(sk, SOCK_MPTCP) ? 1 : 0;
 		break;
+	case MPTCP_ENERGY_PREF:
+		val = (int)tp->mptcp_energy_pref - 1;
+		break;
 #endif
 	default:
 		return -ENOPROTOOPT;
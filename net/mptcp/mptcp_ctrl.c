@@ -2471,6 +2471,7 @@ static const struct snmp_mib mptcp_snmp_list[] = {
 	SNMP_MIB_ITEM("AddAddrTx", MPTCP_MIB_ADDADDRTX),
 	SNMP_MIB_ITEM("RemAddrRx", MPTCP_MIB_REMADDRRX),
 	SNMP_MIB_ITEM("RemAddrTx", MPTCP_MIB_REMADDRTX),
+	SNMP_MIB_ITEM("OfoBatchMerge", MPTCP_MIB_OFOBATCHMERGE),
 	SNMP_MIB_SENTINEL
 };
 
@@ -0,0 +1,514 @@
+/*
+ *	MPTCP Scheduler trading latency against radio energy.
+ *
+ *	The default scheduler always picks the subflow with the lowest SRTT.
+ *	On a phone with Wi-Fi and cellular subflows, this keeps the cellular
+ *	radio out of its idle state for trickle traffic, paying the promotion
+ *	and the multi-second tail of the radio for a few bytes.
+ *
+ *	This scheduler gives every candidate subflow a cost made of:
+ *	 - the expected delay of the segment, i.e. half the SRTT plus the time
+ *	   to drain what is already queued and in flight at cwnd/SRTT rate, and
+ *	 - the marginal energy of sending it on the subflow's interface, which
+ *	   depends on whether the radio is idle, in its tail or still active.
+ *	The two are weighted by a per-connection preference, from 0 (latency
+ *	only) to 100 (energy only), set with the MPTCP_ENERGY_PREF socket
+ *	option. A subflow whose cwnd is full can still win: the scheduler then
+ *	waits for its ACKs instead of waking up a more expensive radio.
+ *
+ *	This program is free software; you can redistribute it and/or
+ *      modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation; either version
+ *      2 of the License, or (at your option) any later version.
+ */
+
+#include <linux/module.h>
+#include <linux/netdevice.h>
+#include <net/mptcp.h>
+
+static unsigned char default_pref __read_mostly = 50;
+module_param(default_pref, byte, 0644);
+MODULE_PARM_DESC(default_pref, "latency (0) vs energy (100) preference of sockets not setting MPTCP_ENERGY_PREF");
+
+static char *cell_ifnames __read_mostly = "rmnet,ccmni,wwan";
+module_param(cell_ifnames, charp, 0644);
+MODULE_PARM_DESC(cell_ifnames, "comma separated name prefixes of cellular interfaces");
+
+static unsigned int cell_tail_ms __read_mostly = 11500;
+module_param(cell_tail_ms, uint, 0644);
+MODULE_PARM_DESC(cell_tail_ms, "time the cellular radio stays in high power after the last packet");
+
+static unsigned int wifi_tail_ms __read_mostly = 240;
+module_param(wifi_tail_ms, uint, 0644);
+MODULE_PARM_DESC(wifi_tail_ms, "time the Wi-Fi radio stays in high power after the last packet");
+
+enum energy_radio {
+	ENERGY_RADIO_WIFI,
+	ENERGY_RADIO_CELL,
+	ENERGY_RADIO_NUM,
+};
+
+/* Power model of a radio, in mW and ms */
+struct energy_radio_model {
+	unsigned int promo_ms;
+	unsigned int active_mw;
+	unsigned int tail_mw;
+	unsigned int *tail_ms;
+};
+
+static const struct energy_radio_model energy_models[ENERGY_RADIO_NUM] = {
+	[ENERGY_RADIO_WIFI] = {
+		.promo_ms = 0,
+		.active_mw = 720,
+		.tail_mw = 120,
+		.tail_ms = &wifi_tail_ms,
+	},
+	[ENERGY_RADIO_CELL] = {
+		.promo_ms = 260,
+		.active_mw = 1210,
+		.tail_mw = 1060,
+		.tail_ms = &cell_tail_ms,
+	},
+};
+
+/* The radio tail is shared by all connections on an interface. Slots are
+ * keyed by netns and ifindex, and freed when the interface goes away.
+ */
+#define ENERGY_MAX_IFACES	8
+
+struct energy_iface {
+	const struct net *net;		/* compared only, never dereferenced */
+	int ifindex;
+	u16 gen;			/* bumped each time the slot is freed */
+	unsigned long last_tx;
+};
+
+static struct energy_iface energy_ifaces[ENERGY_MAX_IFACES];
+static DEFINE_SPINLOCK(energy_ifaces_lock);
+
+struct energysched_priv {
+	int ifindex;
+	u8 radio;
+	s8 slot;			/* -1 if the table was full */
+	u16 gen;			/* gen of the slot when it was taken */
+};
+
+static struct energysched_priv *energysched_get_priv(const struct tcp_sock *tp)
+{
+	return (struct energysched_priv *)&tp->mptcp->mptcp_sched[0];
+}
+
+/* The slot of the subflow's interface, unless it was freed meanwhile */
+static struct energy_iface *energy_iface(const struct energysched_priv *esp)
+{
+	if (esp->slot < 0 || READ_ONCE(energy_ifaces[esp->slot].gen) != esp->gen)
+		return NULL;
+
+	return &energy_ifaces[esp->slot];
+}
+
+static void energy_iface_get(struct energysched_priv *esp,
+			     const struct net *net)
+{
+	struct energy_iface *iface, *free = NULL;
+	int i;
+
+	spin_lock_bh(&energy_ifaces_lock);
+	for (i = 0; i < ENERGY_MAX_IFACES; i++) {
+		iface = &energy_ifaces[i];
+
+		if (iface->ifindex == esp->ifindex && iface->net == net)
+			goto found;
+
+		if (!iface->ifindex && !free)
+			free = iface;
+	}
+
+	iface = free;
+	if (!iface) {
+		esp->slot = -1;
+		goto out;
+	}
+
+	iface->net = net;
+	iface->ifindex = esp->ifindex;
+	/* Never seen sending: its radio is idle */
+	WRITE_ONCE(iface->last_tx,
+		   jiffies - msecs_to_jiffies(cell_tail_ms) - 1);
+found:
+	esp->slot = iface - energy_ifaces;
+	esp->gen = iface->gen;
+out:
+	spin_unlock_bh(&energy_ifaces_lock);
+}
+
+static void energy_iface_put(const struct net *net, int ifindex)
+{
+	int i;
+
+	spin_lock_bh(&energy_ifaces_lock);
+	for (i = 0; i < ENERGY_MAX_IFACES; i++) {
+		struct energy_iface *iface = &energy_ifaces[i];
+
+		if (iface->ifindex != ifindex || iface->net != net)
+			continue;
+
+		iface->net = NULL;
+		iface->ifindex = 0;
+		WRITE_ONCE(iface->gen, iface->gen + 1);
+	}
+	spin_unlock_bh(&energy_ifaces_lock);
+}
+
+static enum energy_radio energy_classify(const struct net_device *dev)
+{
+	const char *p = cell_ifnames;
+
+	while (p && *p) {
+		size_t len = strcspn(p, ",");
+
+		if (len && !strncmp(dev->name, p, len))
+			return ENERGY_RADIO_CELL;
+
+		p += len;
+		if (*p == ',')
+			p++;
+	}
+
+	return ENERGY_RADIO_WIFI;
+}
+
+/* Caches the interface of the subflow, which may change with its route */
+static void energy_update_iface(struct sock *sk)
+{
+	struct energysched_priv *esp = energysched_get_priv(tcp_sk(sk));
+	struct dst_entry *dst = __sk_dst_get(sk);
+
+	if (!dst || !dst->dev)
+		return;
+
+	if (dst->dev->ifindex == esp->ifindex &&
+	    (esp->slot < 0 || energy_iface(esp)))
+		return;
+
+	esp->ifindex = dst->dev->ifindex;
+	esp->radio = energy_classify(dst->dev);
+	energy_iface_get(esp, dev_net(dst->dev));
+}
+
+static unsigned int energy_pref(const struct sock *meta_sk)
+{
+	u8 pref = tcp_sk(meta_sk)->mptcp_energy_pref;
+
+	/* 0 means not set, otherwise the preference is stored plus one */
+	return pref ? pref - 1 : min_t(unsigned int, default_pref, 100);
+}
+
+/* Expected time in us until the last byte of @len reaches the peer */
+static u64 energy_delay_us(const struct tcp_sock *tp, unsigned int len,
+			   u64 *tx_us)
+{
+	u64 srtt = tp->srtt_us >> 3;
+	u64 window = (u64)max(tp->snd_cwnd, 1U) * tp->mss_cache;
+	u64 queued = (u64)tcp_packets_in_flight(tp) * tp->mss_cache +
+		     (tp->write_seq - tp->snd_nxt) + len;
+
+	/* No RTT sample yet, assume a slow path */
+	if (!srtt)
+		srtt = 100 * USEC_PER_MSEC;
+
+	*tx_us = div64_u64(len * srtt, window);
+
+	return (srtt >> 1) + div64_u64(queued * srtt, window);
+}
+
+/* Marginal energy in uJ of keeping the radio busy for @tx_us more */
+static u64 energy_cost_uj(const struct energysched_priv *esp, u64 tx_us)
+{
+	const struct energy_radio_model *m = &energy_models[esp->radio];
+	struct energy_iface *iface = energy_iface(esp);
+	u64 tail_us = (u64)*m->tail_ms * USEC_PER_MSEC;
+	u64 gap_us, uj;
+
+	uj = div_u64(tx_us * m->active_mw, USEC_PER_MSEC);
+
+	/* Without a slot the state of the radio is unknown: assume it idle */
+	gap_us = iface ? jiffies_to_usecs(jiffies - READ_ONCE(iface->last_tx)) :
+			 tail_us;
+
+	/* Idle: pay the promotion and a whole new tail */
+	if (gap_us >= tail_us)
+		return uj + (u64)m->promo_ms * m->active_mw +
+		       div_u64(tail_us * m->tail_mw, USEC_PER_MSEC);
+
+	/* In its tail: the tail restarts, extending it by the gap */
+	return uj + div_u64(gap_us * m->tail_mw, USEC_PER_MSEC);
+}
+
+static u64 energy_score(struct sock *sk, const struct sk_buff *skb,
+			unsigned int pref)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	unsigned int len = skb ? skb->len : tp->mss_cache;
+	u64 delay_us, tx_us;
+
+	energy_update_iface(sk);
+
+	delay_us = energy_delay_us(tp, len, &tx_us);
+
+	return (100 - pref) * delay_us +
+	       pref * energy_cost_uj(energysched_get_priv(tp), tx_us);
+}
+
+/* Are we not allowed to reinject this skb on tp? */
+static int mptcp_energy_dont_reinject_skb(const struct tcp_sock *tp,
+					  const struct sk_buff *skb)
+{
+	/* If the skb has already been enqueued in this sk, try to find
+	 * another one.
+	 */
+	return skb &&
+		/* Has the skb already been enqueued into this subsocket? */
+		mptcp_pi_to_flag(tp->mptcp->path_index) & TCP_SKB_CB(skb)->path_mask;
+}
+
+/* Only a full cwnd clears by itself soon enough to be worth waiting for */
+static bool energy_can_wait(const struct sock *sk)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+
+	return inet_csk(sk)->icsk_ca_state == TCP_CA_Open &&
+	       tcp_packets_in_flight(tp) >= tp->snd_cwnd;
+}
+
+/* Returns the cheapest subflow among those chosen by @selector. If that
+ * subflow cannot send right now but will after its next ACKs, NULL is
+ * returned and *@wait is set.
+ */
+static struct sock *energy_pick(struct sock *meta_sk, struct sk_buff *skb,
+				bool (*selector)(const struct tcp_sock *),
+				bool zero_wnd_test, bool reinject_ok,
+				bool *wait, bool *skipped)
+{
+	struct mptcp_cb *mpcb = tcp_sk(meta_sk)->mpcb;
+	unsigned int pref = energy_pref(meta_sk);
+	struct sock *sk, *bestsk = NULL;
+	u64 best = U64_MAX;
+	bool best_waits = false;
+
+	mptcp_for_each_sk(mpcb, sk) {
+		struct tcp_sock *tp = tcp_sk(sk);
+		bool waits = false;
+		u64 score;
+
+		if (!(*selector)(tp) || mptcp_is_def_unavailable(sk))
+			continue;
+
+		if (!reinject_ok && mptcp_energy_dont_reinject_skb(tp, skb)) {
+			*skipped = true;
+			continue;
+		}
+
+		if (!mptcp_is_available(sk, skb, zero_wnd_test)) {
+			if (!energy_can_wait(sk))
+				continue;
+			waits = true;
+		}
+
+		score = energy_score(sk, skb, pref);
+		if (score < best) {
+			best = score;
+			bestsk = sk;
+			best_waits = waits;
+		}
+	}
+
+	*wait = bestsk && best_waits;
+
+	return *wait ? NULL : bestsk;
+}
+
+static struct sock *energy_get_available_subflow(struct sock *meta_sk,
+						 struct sk_buff *skb,
+						 bool zero_wnd_test)
+{
+	struct mptcp_cb *mpcb = tcp_sk(meta_sk)->mpcb;
+	bool wait = false, skipped = false;
+	struct sock *sk;
+
+	/* if there is only one subflow, bypass the scheduling function */
+	if (mpcb->cnt_subflows == 1) {
+		sk = (struct sock *)mpcb->connection_list;
+		if (!mptcp_is_available(sk, skb, zero_wnd_test))
+			sk = NULL;
+		return sk;
+	}
+
+	/* Answer data_fin on same subflow!!! */
+	if (meta_sk->sk_shutdown & RCV_SHUTDOWN &&
+	    skb && mptcp_is_data_fin(skb)) {
+		mptcp_for_each_sk(mpcb, sk) {
+			if (tcp_sk(sk)->mptcp->path_index == mpcb->dfin_path_index &&
+			    mptcp_is_available(sk, skb, zero_wnd_test))
+				return sk;
+		}
+	}
+
+	sk = energy_pick(meta_sk, skb, &subflow_is_active, zero_wnd_test,
+			 false, &wait, &skipped);
+	if (sk || wait)
+		return sk;
+
+	sk = energy_pick(meta_sk, skb, &subflow_is_backup, zero_wnd_test,
+			 false, &wait, &skipped);
+	if (sk || wait || !skipped)
+		return sk;
+
+	/* It has been sent on all subflows once - let's give it a chance
+	 * again by restarting its pathmask.
+	 */
+	if (skb)
+		TCP_SKB_CB(skb)->path_mask = 0;
+
+	sk = energy_pick(meta_sk, skb, &subflow_is_active, zero_wnd_test,
+			 true, &wait, &skipped);
+	if (sk || wait)
+		return sk;
+
+	return energy_pick(meta_sk, skb, &subflow_is_backup, zero_wnd_test,
+			   true, &wait, &skipped);
+}
+
+/* Returns the next segment to be sent from the mptcp meta-queue.
+ * (chooses the reinject queue if any segment is waiting in it, otherwise,
+ * chooses the normal write queue).
+ * Sets *@reinject to 1 if the returned segment comes from the
+ * reinject queue. Sets it to 0 if it is the regular send-head of the meta-sk.
+ */
+static struct sk_buff *__mptcp_energy_next_segment(const struct sock *meta_sk,
+						   int *reinject)
+{
+	const struct mptcp_cb *mpcb = tcp_sk(meta_sk)->mpcb;
+	struct sk_buff *skb = NULL;
+
+	*reinject = 0;
+
+	/* If we are in fallback-mode, just take from the meta-send-queue */
+	if (mpcb->infinite_mapping_snd || mpcb->send_infinite_mapping)
+		return tcp_send_head(meta_sk);
+
+	skb = skb_peek(&mpcb->reinject_queue);
+
+	if (skb)
+		*reinject = 1;
+	else
+		skb = tcp_send_head(meta_sk);
+	return skb;
+}
+
+static struct sk_buff *mptcp_energy_next_segment(struct sock *meta_sk,
+						 int *reinject,
+						 struct sock **subsk,
+						 unsigned int *limit)
+{
+	struct sk_buff *skb = __mptcp_energy_next_segment(meta_sk, reinject);
+	struct energy_iface *iface;
+	unsigned int mss_now, in_flight, max_segs;
+	struct tcp_sock *subtp;
+	u32 window;
+
+	/* As we set it, we have to reset it as well. */
+	*limit = 0;
+
+	if (!skb)
+		return NULL;
+
+	*subsk = energy_get_available_subflow(meta_sk, skb, false);
+	if (!*subsk)
+		return NULL;
+
+	subtp = tcp_sk(*subsk);
+	iface = energy_iface(energysched_get_priv(subtp));
+	if (iface)
+		WRITE_ONCE(iface->last_tx, jiffies);
+
+	mss_now = tcp_current_mss(*subsk);
+
+	/* No splitting required, as we will only send one single segment */
+	if (skb->len <= mss_now)
+		return skb;
+
+	/* Limit to what the cwnd, the NIC's GSO and the subflow's window
+	 * take, like the default scheduler does.
+	 */
+	in_flight = tcp_packets_in_flight(subtp);
+	max_segs = subtp->snd_cwnd > in_flight ? subtp->snd_cwnd - in_flight : 1;
+	max_segs = min_t(unsigned int, max_segs,
+			 max_t(u16, (*subsk)->sk_gso_max_segs, 1));
+	window = tcp_wnd_end(subtp) - subtp->write_seq;
+
+	*limit = min_t(u32, max_segs * mss_now, window);
+	if (*limit >= skb->len)
+		*limit = 0;
+
+	return skb;
+}
+
+static void energysched_init(struct sock *sk)
+{
+	struct energysched_priv *esp = energysched_get_priv(tcp_sk(sk));
+
+	esp->ifindex = 0;
+	esp->slot = -1;
+}
+
+static int energy_netdev_event(struct notifier_block *this,
+			       unsigned long event, void *ptr)
+{
+	struct net_device *dev = netdev_notifier_info_to_dev(ptr);
+
+	if (event == NETDEV_UNREGISTER)
+		energy_iface_put(dev_net(dev), dev->ifindex);
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block energy_netdev_notifier = {
+	.notifier_call = energy_netdev_event,
+};
+
+static struct mptcp_sched_ops mptcp_sched_energy = {
+	.get_subflow = energy_get_available_subflow,
+	.next_segment = mptcp_energy_next_segment,
+	.init = energysched_init,
+	.name = "energy",
+	.owner = THIS_MODULE,
+};
+
+static int __init energy_register(void)
+{
+	BUILD_BUG_ON(sizeof(struct energysched_priv) > MPTCP_SCHED_SIZE);
+
+	if (register_netdevice_notifier(&energy_netdev_notifier))
+		return -1;
+
+	if (mptcp_register_scheduler(&mptcp_sched_energy)) {
+		unregister_netdevice_notifier(&energy_netdev_notifier);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void energy_unregister(void)
+{
+	mptcp_unregister_scheduler(&mptcp_sched_energy);
+	unregister_netdevice_notifier(&energy_netdev_notifier);
+}
+
+module_init(energy_register);
+module_exit(energy_unregister);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Latency and energy aware MPTCP scheduler");
+MODULE_VERSION("0.1");
@@ -418,6 +418,38 @@ static inline void mptcp_prepare_skb(struct sk_buff *skb,
 	tcb->end_seq = tcb->seq + skb->len + inc;
 }
 
+/* Merges @from into @to if it directly follows it in data-sequence space,
+ * like GRO does for a subflow. Both skbs are orphaned, so no memory is
+ * charged here - the meta-socket accounts for the merged skb when it is
+ * queued. Returns true if @from must be freed with kfree_skb_partial().
+ */
+static bool mptcp_ofo_batch_coalesce(struct sk_buff *to, struct sk_buff *from,
+				     bool *fragstolen)
+{
+	int delta;
+	u32 gso_segs;
+
+	*fragstolen = false;
+
+	if (TCP_SKB_CB(to)->end_seq != TCP_SKB_CB(from)->seq ||
+	    TCP_SKB_CB(to)->tcp_flags & TCPHDR_FIN)
+		return false;
+
+	if (!skb_try_coalesce(to, from, fragstolen, &delta))
+		return false;
+
+	TCP_SKB_CB(to)->end_seq = TCP_SKB_CB(from)->end_seq;
+	TCP_SKB_CB(to)->ack_seq = TCP_SKB_CB(from)->ack_seq;
+	TCP_SKB_CB(to)->tcp_flags |= TCP_SKB_CB(from)->tcp_flags;
+
+	/* In case tcp_drop() is called later, update to->gso_segs */
+	gso_segs = max_t(u16, 1, skb_shinfo(to)->gso_segs) +
+		   max_t(u16, 1, skb_shinfo(from)->gso_segs);
+	skb_shinfo(to)->gso_segs = min_t(u32, gso_segs, 0xFFFF);
+
+	return true;
+}
+
 /**
  * @return: 1 if the segment has been eaten and can be suppressed,
  *          otherwise 0.
@@ -887,7 +919,7 @@ static int mptcp_queue_skb(struct sock *sk)
 	struct tcp_sock *tp = tcp_sk(sk), *meta_tp = mptcp_meta_tp(tp);
 	struct sock *meta_sk = mptcp_meta_sk(sk);
 	struct mptcp_cb *mpcb = tp->mpcb;
-	struct sk_buff *tmp, *tmp1;
+	struct sk_buff *tmp, *tmp1, *batch = NULL;
 	u64 rcv_nxt64 = mptcp_get_rcv_nxt_64(meta_tp);
 	u32 old_copied_seq = tp->copied_seq;
 	bool data_queued = false;
@@ -937,8 +969,16 @@ static int mptcp_queue_skb(struct sock *sk)
 	}
 
 	if (before64(rcv_nxt64, tp->mptcp->map_data_seq)) {
-		/* Seg's have to go to the meta-ofo-queue */
+		/* Seg's have to go to the meta-ofo-queue.
+		 *
+		 * The segments of a mapping are contiguous in data-sequence
+		 * space, but with asymmetric paths they usually land in the
+		 * middle of a long meta-ofo-queue. So, merge them first and
+		 * pay the rb-tree insertion once per batch, not per segment.
+		 */
 		skb_queue_walk_safe(&sk->sk_receive_queue, tmp1, tmp) {
+			bool fragstolen;
+
 			tp->copied_seq = TCP_SKB_CB(tmp1)->end_seq;
 			mptcp_prepare_skb(tmp1, sk);
 			__skb_unlink(tmp1, &sk->sk_receive_queue);
@@ -947,16 +987,26 @@ static int mptcp_queue_skb(struct sock *sk)
 			 */
 			skb_orphan(tmp1);
 
-			if (!mpcb->in_time_wait) /* In time-wait, do not receive data */
-				tcp_data_queue_ofo(meta_sk, tmp1);
-			else
+			if (mpcb->in_time_wait) { /* In time-wait, do not receive data */
 				__kfree_skb(tmp1);
+			} else if (batch &&
+				   mptcp_ofo_batch_coalesce(batch, tmp1, &fragstolen)) {
+				kfree_skb_partial(tmp1, fragstolen);
+				MPTCP_INC_STATS(sock_net(meta_sk),
+						MPTCP_MIB_OFOBATCHMERGE);
+			} else {
+				if (batch)
+					tcp_data_queue_ofo(meta_sk, batch);
+				batch = tmp1;
+			}
 
 			if (!skb_queue_empty(&sk->sk_receive_queue) &&
 			    !before(TCP_SKB_CB(tmp)->seq,
 				    tp->mptcp->map_subseq + tp->mptcp->map_data_len))
 				break;
 		}
+		if (batch)
+			tcp_data_queue_ofo(meta_sk, batch);
 		tcp_enter_quickack_mode(sk, TCP_MAX_QUICKACKS);
 	} else {
 		/* Ready for the meta-rcv-queue */
@@ -11,7 +11,10 @@
 #define __XT_QTAGUID_INTERNAL_H__
 
 #include <linux/types.h>
+#include <linux/hashtable.h>
+#include <linux/percpu.h>
 #include <linux/rbtree.h>
+#include <linux/rcupdate.h>
 #include <linux/spinlock_types.h>
 #include <linux/workqueue.h>
 
@@ -197,6 +200,35 @@ static inline uint64_t dc_sum_packets(struct data_counters *counters,
 		+ counters->bpc[set][direction][IFS_PROTO_OTHER].packets;
 }
 
+/*
+ * Counters are updated per cpu from the packet path.
+ * Readers fold them into a plain data_counters snapshot.
+ */
+static inline void dc_fold(struct data_counters *dst,
+			   struct data_counters __percpu *src)
+{
+	struct data_counters *dc;
+	int cpu, set, direction, proto;
+
+	memset(dst, 0, sizeof(*dst));
+	if (!src)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		dc = per_cpu_ptr(src, cpu);
+		for (set = 0; set < IFS_MAX_COUNTER_SETS; set++)
+			for (direction = 0; direction < IFS_MAX_DIRECTIONS;
+			     direction++)
+				for (proto = 0; proto < IFS_MAX_PROTOS;
+				     proto++) {
+					dst->bpc[set][direction][proto].bytes +=
+					  dc->bpc[set][direction][proto].bytes;
+					dst->bpc[set][direction][proto].packets +=
+					  dc->bpc[set][direction][proto].packets;
+				}
+	}
+}
+
 
 /* Generic X based nodes used as a base for rb_tree ops */
 struct tag_node {
@@ -206,23 +238,28 @@ struct tag_node {
 
 struct tag_stat {
 	struct tag_node tn;
-	struct data_counters counters;
+	/* In iface_stat.tag_stat_hash, for lockless lookups */
+	struct hlist_node hnode;
+	struct rcu_head rcu;
+	struct data_counters __percpu *counters;
 	/*
 	 * If this tag is acct_tag based, we need to count against the
 	 * matching parent uid_tag.
 	 */
-	struct data_counters *parent_counters;
+	struct data_counters __percpu *parent_counters;
 };
 
+#define TAG_STAT_HASH_BITS 6
+
 struct iface_stat {
-	struct list_head list;  /* in iface_stat_list */
+	struct list_head list;  /* in iface_stat_list, RCU-traversable */
 	char *ifname;
 	bool active;
 	/* net_dev is only valid for active iface_stat */
 	struct net_device *net_dev;
 
 	struct byte_packet_counters totals_via_dev[IFS_MAX_DIRECTIONS];
-	struct data_counters totals_via_skb;
+	struct data_counters __percpu *totals_via_skb;
 	/*
 	 * We keep the last_known, because some devices reset their counters
 	 * just before NETDEV_UP, while some will reset just before
@@ -238,6 +275,8 @@ struct iface_stat {
 	struct proc_dir_entry *proc_ptr;
 
 	struct rb_root tag_stat_tree;
+	/* Same entries as tag_stat_tree, looked up under rcu_read_lock() */
+	DECLARE_HASHTABLE(tag_stat_hash, TAG_STAT_HASH_BITS);
 	spinlock_t tag_stat_list_lock;
 };
 
@@ -255,7 +294,12 @@ struct iface_stat_work {
  */
 struct sock_tag {
 	struct rb_node sock_node;
-	struct sock *sk;  /* Only used as a number, never dereferenced */
+	struct rcu_head rcu;
+	/*
+	 * Only dereferenced by the control path, which holds a ref on it
+	 * while tagged, to publish/clear sk->sk_qtag.
+	 */
+	struct sock *sk;
 	/* Used to associate with a given pid */
 	struct list_head list;   /* in proc_qtu_data.sock_tag_list */
 	pid_t pid;
@@ -293,14 +337,21 @@ struct qtaguid_event_counts {
 	 * This might happen for traffic while the socket is being closed.
 	 */
 	atomic64_t match_no_sk_gid;
+	/* tag_stat entries the packet path failed to allocate */
+	atomic64_t tag_stat_alloc_failed;
 };
 
 /* Track the set active_set for the given tag. */
 struct tag_counter_set {
 	struct tag_node tn;
+	/* In tag_counter_set_hash, for lockless lookups */
+	struct hlist_node hnode;
+	struct rcu_head rcu;
 	int active_set;
 };
 
+#define TAG_COUNTER_SET_HASH_BITS 8
+
 /*----------------------------------------------*/
 /*
  * The qtu uid data is used to track resources that are created directly or
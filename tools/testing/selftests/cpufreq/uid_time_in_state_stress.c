@@ -0,0 +1,314 @@
+/*
+ * Concurrent readers of /proc/uid_time_in_state while tasks churn.
+ *
+ * Worker processes keep forking short-lived children that switch to one of
+ * UID_COUNT uids and spin, so the accounting tick keeps charging new tasks
+ * and uids. The workers first run alone, then with reader threads that read
+ * the whole file in a loop. Each read is checked: every uid line has as
+ * many values as the header has frequencies, no uid appears twice, and the
+ * total time of a churned uid never goes backwards. Reports the read
+ * latency and the work the spinning children got done in both phases, the
+ * drop being the cost readers add to the tick path.
+ *
+ * Must run as root.
+ *
+ * Usage: uid_time_in_state_stress [<seconds per phase> [<readers> [<workers>]]]
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PROC_FILE	"/proc/uid_time_in_state"
+#define UID_BASE	20000
+#define UID_COUNT	64
+#define SPIN_MS		20
+#define MAX_SAMPLES	100000
+
+static volatile int stop;
+static unsigned long *work_done;
+
+struct reader {
+	pthread_t thread;
+	double *lat;
+	unsigned long reads;
+	unsigned long errors;
+	unsigned long long last[UID_COUNT];
+};
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void spin_child(unsigned int n)
+{
+	unsigned long iters = 0;
+	double end;
+
+	if (setuid(UID_BASE + n % UID_COUNT))
+		_exit(1);
+
+	end = now_us() + SPIN_MS * 1000;
+	while (now_us() < end)
+		iters++;
+
+	__sync_fetch_and_add(work_done, iters);
+	_exit(0);
+}
+
+static void worker(unsigned int id)
+{
+	unsigned int n = id;
+	pid_t pid;
+
+	/* killed by the parent at the end of the phase */
+	for (;;) {
+		pid = fork();
+		if (pid == 0)
+			spin_child(n);
+		if (pid > 0)
+			waitpid(pid, NULL, 0);
+		n += 7;
+	}
+}
+
+/* reads the whole file into *buf, growing it as needed */
+static ssize_t read_all(char **buf, size_t *size)
+{
+	ssize_t len = 0, ret;
+	int fd;
+
+	fd = open(PROC_FILE, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	for (;;) {
+		if (len + 1 >= *size) {
+			*size *= 2;
+			*buf = realloc(*buf, *size);
+			if (!*buf) {
+				close(fd);
+				return -1;
+			}
+		}
+		ret = read(fd, *buf + len, *size - len - 1);
+		if (ret <= 0)
+			break;
+		len += ret;
+	}
+	close(fd);
+	if (ret < 0)
+		return -1;
+
+	(*buf)[len] = '\0';
+	return len;
+}
+
+static int count_fields(const char *s)
+{
+	int n = 0;
+
+	while (*s) {
+		while (*s == ' ')
+			s++;
+		if (!*s)
+			break;
+		n++;
+		while (*s && *s != ' ')
+			s++;
+	}
+	return n;
+}
+
+/* returns the number of inconsistencies in one read */
+static unsigned long check(struct reader *r, char *buf)
+{
+	unsigned char seen[UID_COUNT] = { 0 };
+	unsigned long errors = 0;
+	unsigned long long total;
+	char *line, *next, *p;
+	int nfreq = -1;
+	unsigned int uid;
+
+	for (line = buf; line && *line; line = next) {
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+
+		p = strchr(line, ':');
+		if (!p) {
+			errors++;
+			continue;
+		}
+		if (nfreq < 0) {
+			if (strncmp(line, "uid:", 4))
+				errors++;
+			nfreq = count_fields(p + 1);
+			continue;
+		}
+		if (count_fields(p + 1) != nfreq)
+			errors++;
+
+		uid = strtoul(line, NULL, 10);
+		if (uid < UID_BASE || uid >= UID_BASE + UID_COUNT)
+			continue;
+		uid -= UID_BASE;
+
+		if (seen[uid]++)
+			errors++;
+
+		for (total = 0, p++; *p; )
+			total += strtoull(p, &p, 10);
+		if (total < r->last[uid])
+			errors++;
+		r->last[uid] = total;
+	}
+
+	return errors;
+}
+
+static void *reader_fn(void *arg)
+{
+	struct reader *r = arg;
+	size_t size = 4096;
+	char *buf = malloc(size);
+	double t;
+
+	while (buf && !stop) {
+		t = now_us();
+		if (read_all(&buf, &size) < 0) {
+			perror(PROC_FILE);
+			r->errors++;
+			break;
+		}
+		if (r->reads < MAX_SAMPLES)
+			r->lat[r->reads] = now_us() - t;
+		r->reads++;
+		r->errors += check(r, buf);
+	}
+
+	free(buf);
+	return NULL;
+}
+
+/* runs the workers, and readers if any, for @seconds; returns work per second */
+static double phase(unsigned int seconds, struct reader *readers, int nreaders,
+		    int nworkers)
+{
+	pid_t *pids = calloc(nworkers, sizeof(*pids));
+	unsigned long work;
+	int i;
+
+	if (!pids)
+		return -1;
+
+	stop = 0;
+	*work_done = 0;
+	for (i = 0; i < nworkers; i++) {
+		pids[i] = fork();
+		if (pids[i] == 0)
+			worker(i);
+	}
+	for (i = 0; i < nreaders; i++)
+		pthread_create(&readers[i].thread, NULL, reader_fn, &readers[i]);
+
+	sleep(seconds);
+	stop = 1;
+	work = __sync_fetch_and_add(work_done, 0);
+
+	for (i = 0; i < nreaders; i++)
+		pthread_join(readers[i].thread, NULL);
+	for (i = 0; i < nworkers; i++) {
+		if (pids[i] > 0) {
+			kill(pids[i], SIGTERM);
+			waitpid(pids[i], NULL, 0);
+		}
+	}
+	free(pids);
+
+	return (double)work / seconds;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int seconds = argc > 1 ? strtoul(argv[1], NULL, 0) : 10;
+	int nreaders = argc > 2 ? atoi(argv[2]) : 4;
+	int nworkers = argc > 3 ? atoi(argv[3]) : sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned long reads = 0, errors = 0, n = 0;
+	struct reader *readers;
+	double alone, shared, sum = 0, *lat;
+	int i;
+
+	if (geteuid()) {
+		fprintf(stderr, "must be run as root\n");
+		return 1;
+	}
+	if (access(PROC_FILE, R_OK)) {
+		perror(PROC_FILE);
+		return 1;
+	}
+	if (!seconds || nreaders < 1 || nworkers < 1) {
+		fprintf(stderr,
+			"usage: %s [<seconds per phase> [<readers> [<workers>]]]\n",
+			argv[0]);
+		return 1;
+	}
+
+	work_done = mmap(NULL, sizeof(*work_done), PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	readers = calloc(nreaders, sizeof(*readers));
+	lat = calloc((size_t)nreaders * MAX_SAMPLES, sizeof(*lat));
+	if (work_done == MAP_FAILED || !readers || !lat)
+		return 1;
+	for (i = 0; i < nreaders; i++)
+		readers[i].lat = lat + (size_t)i * MAX_SAMPLES;
+
+	printf("%d workers, %d readers, %u s per phase\n", nworkers, nreaders,
+	       seconds);
+
+	alone = phase(seconds, NULL, 0, nworkers);
+	shared = phase(seconds, readers, nreaders, nworkers);
+
+	for (i = 0; i < nreaders; i++) {
+		unsigned long samples = readers[i].reads < MAX_SAMPLES ?
+					readers[i].reads : MAX_SAMPLES;
+
+		reads += readers[i].reads;
+		errors += readers[i].errors;
+		/* pack the samples to the front of lat */
+		memmove(lat + n, readers[i].lat, samples * sizeof(*lat));
+		n += samples;
+	}
+	for (i = 0; i < n; i++)
+		sum += lat[i];
+	qsort(lat, n, sizeof(*lat), cmp);
+
+	printf("reads:           %lu\n", reads);
+	if (n)
+		printf("read latency:    avg %.1f us  p50 %.1f us  p99 %.1f us\n",
+		       sum / n, lat[n / 2], lat[n * 99 / 100]);
+	printf("work alone:      %.0f iterations/s\n", alone);
+	printf("work w/ readers: %.0f iterations/s (%.1f%%)\n", shared,
+	       alone > 0 ? (shared - alone) * 100 / alone : 0);
+	printf("inconsistencies: %lu\n", errors);
+
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,220 @@
+/*
+ * Stress test for the freecess shared memory event channel.
+ *
+ * One thread per CPU, pinned to it, has the kernel generate synthetic
+ * binder and signal reports through /proc/freecess/stress, while the main
+ * thread consumes every CPU's ring from /dev/freecess_ring. At the end,
+ * every report must be accounted for, either as a ring event (with its
+ * coalesced count) or as a drop. Needs CONFIG_SAMSUNG_FREECESS_STRESS,
+ * and no freecess daemon holding the ring, which has a single consumer.
+ *
+ * Usage: freecess_ring_test [-n reports per CPU] [-u target uids]
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include "freecess_ring.h"
+
+#define RING_DEV	"/dev/freecess_ring"
+#define STRESS		"/proc/freecess/stress"
+#define MOD_BINDER	1
+#define MOD_SIG		2
+
+struct ring {
+	struct freecess_ring_header *hdr;
+	struct freecess_ring_event *events;
+	unsigned long long dropped0;
+};
+
+static unsigned int reports = 100000, uids = 8;
+static volatile int writers_left;
+static volatile int writers_failed;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *writer(void *arg)
+{
+	long cpu = (long)arg;
+	cpu_set_t set;
+	char buf[32];
+	int fd, len;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	sched_setaffinity(0, sizeof(set), &set);
+
+	fd = open(STRESS, O_WRONLY);
+	if (fd < 0) {
+		perror(STRESS);
+		__sync_fetch_and_add(&writers_failed, 1);
+	} else {
+		len = snprintf(buf, sizeof(buf), "%u %u", reports, uids);
+		if (write(fd, buf, len) != len) {
+			perror("stress write");
+			__sync_fetch_and_add(&writers_failed, 1);
+		}
+		close(fd);
+	}
+
+	__sync_fetch_and_sub(&writers_left, 1);
+	return NULL;
+}
+
+/* Consume all published events of @r, returns the reports they carry */
+static unsigned long long drain(struct ring *r, unsigned long long *events,
+				unsigned long long *bad)
+{
+	unsigned int head, tail, mask = r->hdr->size - 1;
+	unsigned long long n = 0;
+	struct freecess_ring_event *ev;
+
+	head = __atomic_load_n(&r->hdr->head, __ATOMIC_ACQUIRE);
+	for (tail = r->hdr->tail; tail != head; tail++) {
+		ev = &r->events[tail & mask];
+		if ((ev->mod != MOD_BINDER && ev->mod != MOD_SIG) ||
+		    ev->target_uid < 10000 || !ev->count)
+			(*bad)++;
+		n += ev->count;
+		(*events)++;
+	}
+	__atomic_store_n(&r->hdr->tail, tail, __ATOMIC_RELEASE);
+
+	return n;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long got = 0, events = 0, bad = 0, dropped = 0;
+	unsigned long long coalesced = 0, expected;
+	long cpu, ncpus = sysconf(_SC_NPROCESSORS_CONF);
+	struct ring *rings;
+	pthread_t *threads;
+	unsigned int pages;
+	struct pollfd pfd;
+	double start, elapsed;
+	int fd, opt, nrings = 0;
+
+	while ((opt = getopt(argc, argv, "n:u:")) != -1) {
+		switch (opt) {
+		case 'n':
+			reports = strtoul(optarg, NULL, 0);
+			break;
+		case 'u':
+			uids = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n reports] [-u uids]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (access(STRESS, W_OK)) {
+		printf("[SKIP] %s: %s\n", STRESS, strerror(errno));
+		return 0;
+	}
+
+	fd = open(RING_DEV, O_RDWR);
+	if (fd < 0) {
+		printf("[SKIP] %s: %s\n", RING_DEV, strerror(errno));
+		return 0;
+	}
+
+	if (ioctl(fd, FREECESS_RING_IOC_PAGES, &pages)) {
+		perror("FREECESS_RING_IOC_PAGES");
+		return 1;
+	}
+
+	rings = calloc(ncpus, sizeof(*rings));
+	threads = calloc(ncpus, sizeof(*threads));
+	if (!rings || !threads)
+		return 1;
+
+	for (cpu = 0; cpu < ncpus; cpu++) {
+		void *p = mmap(NULL, pages * 4096UL, PROT_READ | PROT_WRITE,
+			       MAP_SHARED, fd, cpu * pages * 4096UL);
+
+		if (p == MAP_FAILED)
+			continue;
+		rings[cpu].hdr = p;
+		rings[cpu].events = (void *)((char *)p + 4096);
+		rings[cpu].dropped0 = rings[cpu].hdr->dropped;
+		coalesced -= rings[cpu].hdr->coalesced;
+		/* Start from an empty ring */
+		rings[cpu].hdr->tail = rings[cpu].hdr->head;
+		nrings++;
+	}
+
+	if (!nrings) {
+		perror("mmap");
+		return 1;
+	}
+
+	writers_left = ncpus;
+	start = now();
+	for (cpu = 0; cpu < ncpus; cpu++)
+		pthread_create(&threads[cpu], NULL, writer, (void *)cpu);
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	for (;;) {
+		int done = !writers_left;
+
+		if (done)
+			ioctl(fd, FREECESS_RING_IOC_FLUSH);
+		poll(&pfd, 1, 10);
+		for (cpu = 0; cpu < ncpus; cpu++)
+			if (rings[cpu].hdr)
+				got += drain(&rings[cpu], &events, &bad);
+		if (done)
+			break;
+	}
+	elapsed = now() - start;
+
+	for (cpu = 0; cpu < ncpus; cpu++) {
+		pthread_join(threads[cpu], NULL);
+		if (!rings[cpu].hdr)
+			continue;
+		dropped += rings[cpu].hdr->dropped - rings[cpu].dropped0;
+		coalesced += rings[cpu].hdr->coalesced;
+	}
+
+	expected = (unsigned long long)reports * nrings;
+	printf("reports:   %llu in %.2f s (%.0f/s)\n", expected, elapsed,
+	       expected / elapsed);
+	printf("events:    %llu, carrying %llu reports\n", events, got);
+	printf("coalesced: %llu\n", coalesced);
+	printf("dropped:   %llu\n", dropped);
+
+	if (writers_failed) {
+		printf("[FAIL] %d stress writers failed\n", writers_failed);
+		return 1;
+	}
+
+	if (bad || got + dropped != expected) {
+		printf("[FAIL] %llu malformed events, %llu reports unaccounted\n",
+		       bad, expected - got - dropped);
+		return 1;
+	}
+
+	printf("[PASS]\n");
+	return 0;
+}
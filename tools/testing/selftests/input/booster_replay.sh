@@ -0,0 +1,79 @@
+#!/bin/sh
+#
+# Replays short input traces through the adaptive booster policy via
+# /proc/bus/input/booster and checks the scaled hold times. Replays do not
+# boost and do not touch the live policy, so this is safe on a running
+# system.
+#
+# Usage: booster_replay.sh
+
+PROC=/proc/bus/input/booster
+fail=0
+
+skip()
+{
+	echo "[SKIP] $1"
+	exit 0
+}
+
+[ "$(id -u)" -eq 0 ] || skip "must be run as root"
+[ -w $PROC ] || skip "kernel without input booster replay"
+
+# replay <name> <holds> <base_ms> <hold_ms> <trace line>...
+replay()
+{
+	name=$1
+	want="$2 $3 $4"
+	shift 4
+
+	{
+		echo reset
+		for line in "$@"; do
+			echo "$line"
+		done
+	} > $PROC
+
+	got=$(awk '$1 == "replay" { print $2, $3, $4 }' $PROC)
+	if [ "$got" = "$want" ]; then
+		echo "[PASS] $name"
+	else
+		echo "[FAIL] $name: holds/base/hold ms $got, expected $want"
+		fail=1
+	fi
+}
+
+# stationary contact: half of the device tree time
+replay "tap" 1 100 50 \
+	"b 0 100 1"
+
+# boosters without motion keep the device tree time
+replay "key" 1 100 100 \
+	"b 0 100 0"
+
+# 10000 px/s sample, averaged to 2500 px/s: 50% + 125%
+replay "swipe" 1 100 175 \
+	"m 0 0 0" "m 10 100 0" "b 10 100 1"
+
+# the average keeps growing and the hold time is capped at 300%
+replay "fling" 1 100 300 \
+	"m 0 0 0" "m 10 100 0" "m 20 200 0" "m 30 300 0" "b 30 100 1"
+
+# a gap of IB_MOTION_GAP_MS ends the motion
+replay "pause" 1 100 50 \
+	"m 0 0 0" "m 10 100 0" "b 110 100 1"
+
+# 25% per missed frame, halved every 250ms: 150 + 125 + 100
+replay "miss decay" 3 300 375 \
+	"v 0 2" "b 0 100 0" "b 250 100 0" "b 500 100 0"
+
+# missed frames are capped at 300% as well
+replay "miss cap" 1 100 300 \
+	"v 0 20" "b 0 100 0"
+
+# the same trace gives the same result
+replay "repeat" 3 300 375 \
+	"v 0 2" "b 0 100 0" "b 250 100 0" "b 500 100 0"
+
+echo reset > $PROC
+
+exit $fail
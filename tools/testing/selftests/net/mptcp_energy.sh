@@ -0,0 +1,157 @@
+#!/bin/sh
+#
+# Runs a trickle and a bulk transfer over a Wi-Fi like and a cellular like
+# veth pair between two network namespaces, with the MPTCP energy scheduler
+# at several latency/energy preferences, and prints the completion time and
+# the bytes sent on each interface.
+#
+# The cellular side is named after the scheduler's default cell_ifnames
+# prefix, so that it is modeled as a cellular radio.
+#
+# The MPTCP sysctls exist in init_net only, so they are set there for the
+# duration of the test and restored afterwards. Each transfer checks that
+# it ran on the energy scheduler and that fullmesh opened a second subflow.
+
+CLI=mptcp_energy_cli
+SRV=mptcp_energy_srv
+WIFI=wlan_t0
+CELL=rmnet_t0
+PORT=5201
+PREFS="0 50 100"
+SYSCTL=/proc/sys/net/mptcp
+PARAMS=/sys/module/mptcp_energy/parameters
+ret=0
+
+skip()
+{
+	echo "[SKIP] $1"
+	exit 0
+}
+
+fail()
+{
+	echo "[FAIL] $1"
+	ret=1
+}
+
+[ "$(id -u)" -eq 0 ] || skip "must be run as root"
+[ -e $SYSCTL/mptcp_enabled ] || skip "kernel without MPTCP"
+command -v nc >/dev/null 2>&1 || skip "nc not found"
+modprobe -q mptcp_energy 2>/dev/null
+[ -d /sys/module/mptcp_energy ] || skip "mptcp_energy scheduler not available"
+modprobe -q mptcp_fullmesh 2>/dev/null
+
+old_enabled=$(cat $SYSCTL/mptcp_enabled)
+old_pm=$(cat $SYSCTL/mptcp_path_manager)
+old_sched=$(cat $SYSCTL/mptcp_scheduler)
+old_pref=$(cat $PARAMS/default_pref)
+
+cleanup()
+{
+	ip netns del $CLI 2>/dev/null
+	ip netns del $SRV 2>/dev/null
+	echo $old_enabled > $SYSCTL/mptcp_enabled
+	echo $old_pm > $SYSCTL/mptcp_path_manager
+	echo $old_sched > $SYSCTL/mptcp_scheduler
+	echo $old_pref > $PARAMS/default_pref
+}
+trap cleanup EXIT
+
+setup()
+{
+	echo 1 > $SYSCTL/mptcp_enabled
+	echo fullmesh > $SYSCTL/mptcp_path_manager 2>/dev/null
+	echo energy > $SYSCTL/mptcp_scheduler 2>/dev/null
+	[ "$(cat $SYSCTL/mptcp_path_manager)" = fullmesh ] || \
+		skip "fullmesh path manager not available"
+	[ "$(cat $SYSCTL/mptcp_scheduler)" = energy ] || \
+		skip "energy scheduler cannot be selected"
+
+	ip netns add $CLI
+	ip netns add $SRV
+
+	ip link add $WIFI netns $CLI type veth peer name wifi_peer netns $SRV
+	ip link add $CELL netns $CLI type veth peer name cell_peer netns $SRV
+
+	ip -n $CLI addr add 10.0.1.1/24 dev $WIFI
+	ip -n $CLI addr add 10.0.2.1/24 dev $CELL
+	ip -n $SRV addr add 10.0.1.2/24 dev wifi_peer
+	ip -n $SRV addr add 10.0.2.2/24 dev cell_peer
+
+	for ns in $CLI $SRV; do
+		ip -n $ns link set lo up
+		for dev in $(ip -n $ns -o link show type veth | \
+			     awk -F'[:@ ]+' '{ print $2 }'); do
+			ip -n $ns link set $dev up
+		done
+	done
+
+	# Wi-Fi: 20 Mbit/s, 20ms; cellular: 50 Mbit/s, 45ms
+	ip netns exec $CLI tc qdisc add dev $WIFI root netem delay 20ms rate 20mbit
+	ip netns exec $CLI tc qdisc add dev $CELL root netem delay 45ms rate 50mbit
+
+	# One routing table per source address for the fullmesh subflows
+	ip -n $CLI rule add from 10.0.1.1 table 1
+	ip -n $CLI route add 10.0.1.0/24 dev $WIFI scope link table 1
+	ip -n $CLI route add default via 10.0.1.2 dev $WIFI table 1
+	ip -n $CLI rule add from 10.0.2.1 table 2
+	ip -n $CLI route add 10.0.2.0/24 dev $CELL scope link table 2
+	ip -n $CLI route add default via 10.0.2.2 dev $CELL table 2
+}
+
+tx_bytes()
+{
+	ip netns exec $CLI cat /sys/class/net/$1/statistics/tx_bytes
+}
+
+mib()
+{
+	ip netns exec $SRV awk -v m=$1 '$1 == m { print $2 }' \
+		/proc/net/mptcp_net/snmp
+}
+
+# $1: name, $2: command generating the data to send
+run()
+{
+	wifi0=$(tx_bytes $WIFI)
+	cell0=$(tx_bytes $CELL)
+	join0=$(mib MPJoinSynRx)
+
+	ip netns exec $SRV nc -l -p $PORT > /dev/null &
+	srv=$!
+	sleep 1
+
+	start=$(date +%s%N)
+	sh -c "$2" | ip netns exec $CLI nc -q 1 10.0.1.2 $PORT &
+	cli=$!
+
+	# Each connection on the energy scheduler holds a module reference
+	sleep 0.5
+	users=$(cat /sys/module/mptcp_energy/refcnt)
+
+	wait $cli
+	end=$(date +%s%N)
+	wait $srv
+
+	printf "%-8s %4s %10d %12d %12d\n" "$1" "$pref" \
+		$(((end - start) / 1000000)) \
+		$(($(tx_bytes $WIFI) - wifi0)) $(($(tx_bytes $CELL) - cell0))
+
+	[ "${users:-0}" -gt 0 ] || fail "$1/$pref did not use the energy scheduler"
+	join1=$(mib MPJoinSynRx)
+	[ "${join1:-0}" -gt "${join0:-0}" ] || \
+		fail "$1/$pref opened no second subflow"
+}
+
+setup
+
+printf "%-8s %4s %10s %12s %12s\n" "test" "pref" "time(ms)" "$WIFI" "$CELL"
+for pref in $PREFS; do
+	echo $pref > $PARAMS/default_pref
+
+	run trickle "for i in \$(seq 20); do head -c 1024 /dev/zero; sleep 0.2; done"
+	run bulk "head -c 8388608 /dev/zero"
+done
+
+[ $ret -eq 0 ] && echo "[PASS]"
+exit $ret
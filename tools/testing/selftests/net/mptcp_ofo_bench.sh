@@ -0,0 +1,138 @@
+#!/bin/sh
+#
+# Receive-side reordering benchmark for MPTCP. Sends a bulk transfer over
+# two veth paths between network namespaces, one fast and one slow, so that
+# the receiver keeps a long meta-level out-of-order queue, and reports the
+# CPU time spent per received byte.
+#
+# The MPTCP sysctls exist in init_net only, so they are set there for the
+# duration of the benchmark and restored afterwards. A short probe transfer
+# must establish the second subflow before the real one is measured.
+#
+# Usage: mptcp_ofo_bench.sh [<MiB>] [<slow path delay ms>]
+
+CLI=mptcp_ofo_cli
+SRV=mptcp_ofo_srv
+PORT=5202
+SIZE_MB=${1:-64}
+SLOW_MS=${2:-60}
+SYSCTL=/proc/sys/net/mptcp
+
+skip()
+{
+	echo "[SKIP] $1"
+	exit 0
+}
+
+[ "$(id -u)" -eq 0 ] || skip "must be run as root"
+[ -e $SYSCTL/mptcp_enabled ] || skip "kernel without MPTCP"
+command -v nc >/dev/null 2>&1 || skip "nc not found"
+modprobe -q mptcp_fullmesh 2>/dev/null
+
+old_enabled=$(cat $SYSCTL/mptcp_enabled)
+old_pm=$(cat $SYSCTL/mptcp_path_manager)
+old_sched=$(cat $SYSCTL/mptcp_scheduler)
+
+cleanup()
+{
+	ip netns del $CLI 2>/dev/null
+	ip netns del $SRV 2>/dev/null
+	echo $old_enabled > $SYSCTL/mptcp_enabled
+	echo $old_pm > $SYSCTL/mptcp_path_manager
+	echo $old_sched > $SYSCTL/mptcp_scheduler
+}
+trap cleanup EXIT
+
+setup()
+{
+	echo 1 > $SYSCTL/mptcp_enabled
+	echo fullmesh > $SYSCTL/mptcp_path_manager 2>/dev/null
+	echo default > $SYSCTL/mptcp_scheduler
+	[ "$(cat $SYSCTL/mptcp_path_manager)" = fullmesh ] || \
+		skip "fullmesh path manager not available"
+
+	ip netns add $CLI
+	ip netns add $SRV
+
+	ip link add fast0 netns $CLI type veth peer name fast1 netns $SRV
+	ip link add slow0 netns $CLI type veth peer name slow1 netns $SRV
+
+	ip -n $CLI addr add 10.0.1.1/24 dev fast0
+	ip -n $CLI addr add 10.0.2.1/24 dev slow0
+	ip -n $SRV addr add 10.0.1.2/24 dev fast1
+	ip -n $SRV addr add 10.0.2.2/24 dev slow1
+
+	for dev in lo fast0 slow0; do
+		ip -n $CLI link set $dev up
+	done
+	for dev in lo fast1 slow1; do
+		ip -n $SRV link set $dev up
+	done
+
+	ip netns exec $CLI tc qdisc add dev fast0 root netem delay 5ms rate 200mbit
+	ip netns exec $CLI tc qdisc add dev slow0 root netem delay ${SLOW_MS}ms rate 100mbit
+
+	ip -n $CLI rule add from 10.0.1.1 table 1
+	ip -n $CLI route add 10.0.1.0/24 dev fast0 scope link table 1
+	ip -n $CLI route add default via 10.0.1.2 dev fast0 table 1
+	ip -n $CLI rule add from 10.0.2.1 table 2
+	ip -n $CLI route add 10.0.2.0/24 dev slow0 scope link table 2
+	ip -n $CLI route add default via 10.0.2.2 dev slow0 table 2
+}
+
+# Busy time of all CPUs, in USER_HZ ticks
+cpu_busy()
+{
+	awk '$1 == "cpu" { print $2 + $3 + $4 + $7 + $8 }' /proc/stat
+}
+
+mib()
+{
+	ip netns exec $SRV awk -v m=$1 '$1 == m { print $2 }' \
+		/proc/net/mptcp_net/snmp
+}
+
+# $1: bytes to send from the client to the server
+transfer()
+{
+	ip netns exec $SRV nc -l -p $PORT > /dev/null &
+	srv=$!
+	sleep 1
+
+	head -c $1 /dev/zero | ip netns exec $CLI nc -q 1 10.0.1.2 $PORT
+	wait $srv
+}
+
+setup
+
+bytes=$((SIZE_MB * 1048576))
+hz=$(getconf CLK_TCK)
+
+# A single-subflow transfer has no meta-level reordering to measure
+join0=$(mib MPJoinAckRx)
+transfer 1048576
+join1=$(mib MPJoinAckRx)
+if [ "${join1:-0}" -le "${join0:-0}" ]; then
+	echo "[FAIL] the second subflow was not established"
+	exit 1
+fi
+
+merge0=$(mib OfoBatchMerge)
+busy0=$(cpu_busy)
+start=$(date +%s%N)
+
+transfer $bytes
+
+end=$(date +%s%N)
+busy1=$(cpu_busy)
+merge1=$(mib OfoBatchMerge)
+
+ms=$(((end - start) / 1000000))
+busy_ns=$(((busy1 - busy0) * (1000000000 / hz)))
+
+echo "transfer:        ${SIZE_MB} MiB, slow path +${SLOW_MS} ms"
+echo "time:            ${ms} ms"
+echo "throughput:      $((bytes * 8 / 1000 / (ms ? ms : 1))) Mbit/s"
+echo "cpu busy:        $((busy_ns / 1000000)) ms"
+echo "cpu per byte:    $(awk -v n=$busy_ns -v b=$bytes 'BEGIN { printf "%.3f", n / b }') ns"
+echo "ofo batch merge: $((${merge1:-0} - ${merge0:-0})) segments"
@@ -0,0 +1,134 @@
+#!/bin/sh
+#
+# Per-packet cost of xt_qtaguid accounting. Sends a bulk TCP transfer over
+# a small-MTU veth pair between network namespaces, once without and once
+# with an "owner" match (xt_qtaguid) on both ends, and reports the packet
+# rate and the CPU time spent per packet for each run.
+#
+# Usage: qtaguid_bench.sh [<MiB>] [<mtu>] [<parallel streams>]
+
+CLI=qtaguid_cli
+SRV=qtaguid_srv
+PORT=5203
+SIZE_MB=${1:-64}
+MTU=${2:-576}
+STREAMS=${3:-4}
+
+skip()
+{
+	echo "[SKIP] $1"
+	exit 0
+}
+
+[ "$(id -u)" -eq 0 ] || skip "must be run as root"
+[ -e /proc/net/xt_qtaguid/ctrl ] || skip "kernel without xt_qtaguid"
+command -v iptables >/dev/null 2>&1 || skip "iptables not found"
+command -v nc >/dev/null 2>&1 || skip "nc not found"
+
+cleanup()
+{
+	ip netns del $CLI 2>/dev/null
+	ip netns del $SRV 2>/dev/null
+}
+trap cleanup EXIT
+
+setup()
+{
+	ip netns add $CLI
+	ip netns add $SRV
+
+	ip link add q0 netns $CLI type veth peer name q1 netns $SRV
+	ip -n $CLI link set q0 mtu $MTU
+	ip -n $SRV link set q1 mtu $MTU
+
+	ip -n $CLI addr add 10.0.3.1/24 dev q0
+	ip -n $SRV addr add 10.0.3.2/24 dev q1
+
+	for dev in lo q0; do
+		ip -n $CLI link set $dev up
+	done
+	for dev in lo q1; do
+		ip -n $SRV link set $dev up
+	done
+}
+
+rules()
+{
+	ip netns exec $CLI iptables $1 OUTPUT -o q0 -m owner --socket-exists
+	ip netns exec $SRV iptables $1 INPUT -i q1 -m owner --socket-exists
+}
+
+# Busy time of all CPUs, in USER_HZ ticks
+cpu_busy()
+{
+	awk '$1 == "cpu" { print $2 + $3 + $4 + $7 + $8 }' /proc/stat
+}
+
+# Packets both ends of the pair have sent and received
+packets()
+{
+	ip netns exec $CLI cat /sys/class/net/q0/statistics/tx_packets \
+		/sys/class/net/q0/statistics/rx_packets |
+		awk '{ n += $1 } END { print n }'
+}
+
+ctrl_event()
+{
+	tr ' ' '\n' < /proc/net/xt_qtaguid/ctrl |
+		awk -F= -v e=$1 '$1 == e { print $2 }'
+}
+
+run()
+{
+	i=0
+	while [ $i -lt $STREAMS ]; do
+		ip netns exec $SRV nc -l -p $((PORT + i)) > /dev/null &
+		i=$((i + 1))
+	done
+	sleep 1
+
+	calls0=$(ctrl_event match_calls)
+	failed0=$(ctrl_event tag_stat_alloc_failed)
+	pkts0=$(packets)
+	busy0=$(cpu_busy)
+	start=$(date +%s%N)
+
+	i=0
+	while [ $i -lt $STREAMS ]; do
+		head -c $((bytes / STREAMS)) /dev/zero |
+			ip netns exec $CLI nc -q 1 10.0.3.2 $((PORT + i)) &
+		i=$((i + 1))
+	done
+	wait
+
+	end=$(date +%s%N)
+	busy1=$(cpu_busy)
+	pkts1=$(packets)
+	failed1=$(ctrl_event tag_stat_alloc_failed)
+	calls1=$(ctrl_event match_calls)
+
+	ms=$(((end - start) / 1000000))
+	pkts=$((pkts1 - pkts0))
+	busy_ns=$(((busy1 - busy0) * (1000000000 / hz)))
+
+	echo "$1:"
+	echo "  time:            ${ms} ms"
+	echo "  packets:         ${pkts}"
+	echo "  packet rate:     $((pkts * 1000 / (ms ? ms : 1))) pps"
+	echo "  cpu per packet:  $((busy_ns / (pkts ? pkts : 1))) ns"
+	echo "  match calls:     $((${calls1:-0} - ${calls0:-0}))"
+	echo "  alloc failures:  $((${failed1:-0} - ${failed0:-0}))"
+}
+
+setup
+
+bytes=$((SIZE_MB * 1048576))
+hz=$(getconf CLK_TCK)
+
+echo "transfer:          ${SIZE_MB} MiB, mtu ${MTU}, ${STREAMS} streams"
+
+run "no match"
+
+rules -A || skip "iptables owner match not available"
+run "owner match"
+rules -D
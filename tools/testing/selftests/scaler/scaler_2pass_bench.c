@@ -0,0 +1,216 @@
+/*
+ * Frame latency of the Exynos scaler with and without prescale trimming.
+ *
+ * Scales a <src> RGB32 frame down to <dst> <frames> times through the V4L2
+ * mem2mem node, once with /sys/module/scaler/parameters/prescale_trim set
+ * to 0 and once set to 1, and reports the latency of each frame. A source
+ * size that is not aligned to the pre-scaler ratio takes two H/W passes
+ * with trimming off and a single pass with it on. The parameter is
+ * restored at the end.
+ *
+ * Usage: scaler_2pass_bench <video node> [<src WxH> <dst WxH> [<frames>]]
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+
+#define TRIM_PARAM	"/sys/module/scaler/parameters/prescale_trim"
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int set_trim(const char *val)
+{
+	int fd = open(TRIM_PARAM, O_WRONLY);
+	ssize_t ret;
+
+	if (fd < 0) {
+		perror(TRIM_PARAM);
+		return -1;
+	}
+	ret = write(fd, val, strlen(val));
+	close(fd);
+
+	return ret < 0 ? -1 : 0;
+}
+
+static int set_fmt(int fd, enum v4l2_buf_type type,
+		   unsigned int width, unsigned int height)
+{
+	struct v4l2_format fmt;
+
+	memset(&fmt, 0, sizeof(fmt));
+	fmt.type = type;
+	fmt.fmt.pix_mp.width = width;
+	fmt.fmt.pix_mp.height = height;
+	fmt.fmt.pix_mp.pixelformat = V4L2_PIX_FMT_RGB32;
+	fmt.fmt.pix_mp.num_planes = 1;
+	fmt.fmt.pix_mp.plane_fmt[0].sizeimage = width * height * 4;
+	fmt.fmt.pix_mp.plane_fmt[0].bytesperline = width * 4;
+
+	return ioctl(fd, VIDIOC_S_FMT, &fmt);
+}
+
+static int setup_queue(int fd, enum v4l2_buf_type type)
+{
+	struct v4l2_requestbuffers req;
+
+	memset(&req, 0, sizeof(req));
+	req.type = type;
+	req.memory = V4L2_MEMORY_MMAP;
+	req.count = 1;
+	if (ioctl(fd, VIDIOC_REQBUFS, &req) || req.count < 1)
+		return -1;
+
+	return ioctl(fd, VIDIOC_STREAMON, &type);
+}
+
+static int xfer_buf(int fd, unsigned long req, enum v4l2_buf_type type,
+		    unsigned int bytesused)
+{
+	struct v4l2_plane plane;
+	struct v4l2_buffer buf;
+
+	memset(&plane, 0, sizeof(plane));
+	memset(&buf, 0, sizeof(buf));
+	plane.bytesused = bytesused;
+	buf.type = type;
+	buf.memory = V4L2_MEMORY_MMAP;
+	buf.index = 0;
+	buf.m.planes = &plane;
+	buf.length = 1;
+
+	return ioctl(fd, req, &buf);
+}
+
+/* fills @lat with the latency of each frame, returns 0 on success */
+static int run(const char *node, unsigned int sw, unsigned int sh,
+	       unsigned int dw, unsigned int dh, double *lat,
+	       unsigned long frames)
+{
+	enum v4l2_buf_type out = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+	enum v4l2_buf_type cap = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	unsigned long i;
+	double t;
+	int fd, ret = -1;
+
+	fd = open(node, O_RDWR);
+	if (fd < 0) {
+		perror(node);
+		return -1;
+	}
+
+	if (set_fmt(fd, out, sw, sh) || set_fmt(fd, cap, dw, dh)) {
+		perror("VIDIOC_S_FMT");
+		goto out;
+	}
+
+	/* the scaling ratio, and so the number of passes, is fixed here */
+	if (setup_queue(fd, out) || setup_queue(fd, cap)) {
+		perror("VIDIOC_REQBUFS/STREAMON");
+		goto out;
+	}
+
+	for (i = 0; i < frames; i++) {
+		t = now_us();
+		if (xfer_buf(fd, VIDIOC_QBUF, out, sw * sh * 4) ||
+		    xfer_buf(fd, VIDIOC_QBUF, cap, 0) ||
+		    xfer_buf(fd, VIDIOC_DQBUF, cap, 0) ||
+		    xfer_buf(fd, VIDIOC_DQBUF, out, 0)) {
+			perror("frame");
+			goto out;
+		}
+		lat[i] = now_us() - t;
+	}
+	ret = 0;
+out:
+	close(fd);
+	return ret;
+}
+
+static void report(const char *name, double *lat, unsigned long frames)
+{
+	double sum = 0;
+	unsigned long i;
+
+	for (i = 0; i < frames; i++)
+		sum += lat[i];
+	qsort(lat, frames, sizeof(*lat), cmp);
+
+	printf("%-12s avg %8.1f us  p50 %8.1f us  p99 %8.1f us\n", name,
+	       sum / frames, lat[frames / 2], lat[frames * 99 / 100]);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int sw = 1918, sh = 1078, dw = 160, dh = 90;
+	unsigned long frames = 300;
+	char saved[16] = "0";
+	double *lat;
+	int fd, ret = 1;
+	ssize_t len;
+
+	if (argc < 2 || argc == 3) {
+		fprintf(stderr,
+			"usage: %s <video node> [<src WxH> <dst WxH> [<frames>]]\n",
+			argv[0]);
+		return 1;
+	}
+
+	if (argc > 3 && (sscanf(argv[2], "%ux%u", &sw, &sh) != 2 ||
+			 sscanf(argv[3], "%ux%u", &dw, &dh) != 2)) {
+		fprintf(stderr, "sizes are given as WxH\n");
+		return 1;
+	}
+	if (argc > 4)
+		frames = strtoul(argv[4], NULL, 0);
+
+	lat = calloc(frames, sizeof(*lat));
+	if (!frames || !lat)
+		return 1;
+
+	fd = open(TRIM_PARAM, O_RDONLY);
+	if (fd < 0) {
+		perror(TRIM_PARAM);
+		return 1;
+	}
+	len = read(fd, saved, sizeof(saved) - 1);
+	close(fd);
+	if (len > 0)
+		saved[len] = '\0';
+
+	printf("%ux%u -> %ux%u, %lu frames\n", sw, sh, dw, dh, frames);
+
+	if (set_trim("0") || run(argv[1], sw, sh, dw, dh, lat, frames))
+		goto out;
+	report("two-pass", lat, frames);
+
+	if (set_trim("1") || run(argv[1], sw, sh, dw, dh, lat, frames))
+		goto out;
+	report("trimmed", lat, frames);
+
+	ret = 0;
+out:
+	set_trim(saved);
+	free(lat);
+	return ret;
+}
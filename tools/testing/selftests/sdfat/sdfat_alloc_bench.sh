@@ -0,0 +1,70 @@
+#!/bin/sh
+#
+# Cluster allocation latency of the sdFAT smart allocator at several fill
+# levels. Formats a sparse FAT32 image, mounts it with the smart allocator,
+# fragments it to each fill level with files of random sizes, then times
+# single cluster allocations with sdfat_alloc_lat.
+#
+# Usage: sdfat_alloc_bench.sh [<image MiB>] [<allocations per level>]
+
+SIZE_MB=${1:-4096}
+COUNT=${2:-2000}
+CLU=4096
+AU_SECT=8192			# 4 MiB AUs
+LEVELS="0 25 50 75 90 95"
+
+IMG=$(mktemp /tmp/sdfat.XXXXXX)
+MNT=$(mktemp -d /tmp/sdfat_mnt.XXXXXX)
+LAT=$(dirname "$0")/sdfat_alloc_lat
+
+skip()
+{
+	echo "[SKIP] $1"
+	exit 0
+}
+
+cleanup()
+{
+	umount "$MNT" 2>/dev/null
+	[ -n "$LOOP" ] && losetup -d "$LOOP"
+	rm -rf "$IMG" "$MNT"
+}
+trap cleanup EXIT
+
+[ "$(id -u)" -eq 0 ] || skip "must be run as root"
+command -v mkfs.vfat >/dev/null 2>&1 || skip "mkfs.vfat not found"
+[ -x "$LAT" ] || skip "sdfat_alloc_lat not built"
+modprobe sdfat 2>/dev/null
+grep -qw sdfat /proc/filesystems || skip "kernel without sdfat"
+
+truncate -s ${SIZE_MB}M "$IMG"
+mkfs.vfat -F 32 -S 512 -s $((CLU / 512)) "$IMG" >/dev/null || exit 1
+LOOP=$(losetup -f --show "$IMG") || exit 1
+mount -t sdfat -o smart,ausize=$AU_SECT "$LOOP" "$MNT" || exit 1
+grep -q "$MNT.*smart" /proc/mounts || skip "smart allocation not enabled"
+
+used_pct()
+{
+	df -P "$MNT" | awk 'NR == 2 { sub("%", "", $5); print $5 }'
+}
+
+# Fill up to $1 percent, then punch holes: every other file is removed
+# and the filling continues, leaving partially used AUs behind.
+fill()
+{
+	while [ "$(used_pct)" -lt "$1" ]; do
+		i=$((i + 1))
+		dd if=/dev/zero of="$MNT/fill.$i" bs=$CLU \
+		   count=$(( $(od -An -N2 -tu2 /dev/urandom) % 2048 + 1 )) \
+		   2>/dev/null || break
+		[ $((i % 2)) -eq 0 ] && rm -f "$MNT/fill.$((i - 1))"
+	done
+	sync
+}
+
+i=0
+for level in $LEVELS; do
+	fill $level
+	printf "fill %3s%%: " "$(used_pct)"
+	"$LAT" "$MNT" $COUNT $CLU || exit 1
+done
@@ -0,0 +1,89 @@
+/*
+ * Cluster allocation latency probe for sdFAT.
+ *
+ * Creates <count> files of <clusters> clusters each in <dir> and reports
+ * the latency of the write() that allocates them. The files are removed
+ * at the end, so that repeated runs start from the same fill level.
+ *
+ * Usage: sdfat_alloc_lat <dir> <count> <cluster size> [<clusters>]
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long count, clu_size, clusters = 1, i;
+	char path[4096], *buf;
+	double *lat, t, sum = 0;
+	size_t len;
+
+	if (argc < 4) {
+		fprintf(stderr, "usage: %s <dir> <count> <cluster size> [<clusters>]\n",
+			argv[0]);
+		return 1;
+	}
+
+	count = strtoul(argv[2], NULL, 0);
+	clu_size = strtoul(argv[3], NULL, 0);
+	if (argc > 4)
+		clusters = strtoul(argv[4], NULL, 0);
+
+	len = clu_size * clusters;
+	buf = malloc(len);
+	lat = calloc(count, sizeof(*lat));
+	if (!count || !len || !buf || !lat)
+		return 1;
+	memset(buf, 0x5a, len);
+
+	for (i = 0; i < count; i++) {
+		int fd;
+
+		snprintf(path, sizeof(path), "%s/lat.%lu", argv[1], i);
+		fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+		if (fd < 0) {
+			perror(path);
+			return 1;
+		}
+
+		t = now_us();
+		if (write(fd, buf, len) != (ssize_t)len) {
+			perror("write");
+			return 1;
+		}
+		lat[i] = now_us() - t;
+		sum += lat[i];
+		close(fd);
+	}
+
+	for (i = 0; i < count; i++) {
+		snprintf(path, sizeof(path), "%s/lat.%lu", argv[1], i);
+		unlink(path);
+	}
+
+	qsort(lat, count, sizeof(*lat), cmp);
+	printf("avg %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+	       sum / count, lat[count / 2], lat[count * 99 / 100],
+	       lat[count - 1]);
+
+	return 0;
+}
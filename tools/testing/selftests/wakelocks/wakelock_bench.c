@@ -0,0 +1,178 @@
+/*
+ * Measures the throughput of /sys/power/wake_lock and wake_unlock writes.
+ *
+ * Each thread toggles its own set of wakelock names, or all threads share
+ * one name with -S, and the total number of lock+unlock pairs per second
+ * is reported, followed by the kernel's statistics for the names used.
+ *
+ * Usage: wakelock_bench [-t threads] [-n pairs per thread]
+ *			 [-k names per thread] [-S] [-c coalesce_ms]
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define WAKE_LOCK	"/sys/power/wake_lock"
+#define WAKE_UNLOCK	"/sys/power/wake_unlock"
+#define STATS		"/sys/power/wake_lock_stats"
+#define COALESCE	"/sys/power/wake_lock_coalesce_ms"
+
+static unsigned long pairs = 100000;
+static int names = 4;
+static int shared;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *worker(void *arg)
+{
+	long id = (long)arg;
+	int lock_fd = open(WAKE_LOCK, O_WRONLY);
+	int unlock_fd = open(WAKE_UNLOCK, O_WRONLY);
+	char name[64];
+	unsigned long i;
+	long failed = 0;
+
+	if (lock_fd < 0 || unlock_fd < 0) {
+		perror("open");
+		return (void *)1L;
+	}
+
+	for (i = 0; i < pairs; i++) {
+		int len;
+
+		if (shared)
+			len = snprintf(name, sizeof(name), "wlbench_shared");
+		else
+			len = snprintf(name, sizeof(name), "wlbench_%ld_%lu",
+				       id, i % names);
+
+		if (write(lock_fd, name, len) != len ||
+		    write(unlock_fd, name, len) != len)
+			failed++;
+	}
+
+	close(lock_fd);
+	close(unlock_fd);
+
+	return (void *)failed;
+}
+
+static int write_str(const char *path, const char *str)
+{
+	int fd = open(path, O_WRONLY);
+	int ret;
+
+	if (fd < 0)
+		return -errno;
+	ret = write(fd, str, strlen(str)) < 0 ? -errno : 0;
+	close(fd);
+
+	return ret;
+}
+
+static void show_stats(void)
+{
+	char line[256];
+	FILE *f = fopen(STATS, "r");
+
+	if (!f) {
+		perror(STATS);
+		return;
+	}
+
+	if (fgets(line, sizeof(line), f))
+		fputs(line, stdout);
+	while (fgets(line, sizeof(line), f))
+		if (!strncmp(line, "wlbench_", 8))
+			fputs(line, stdout);
+	fclose(f);
+}
+
+int main(int argc, char **argv)
+{
+	int threads = 4, coalesce = -1, opt, i;
+	char old_coalesce[32] = "", buf[32];
+	pthread_t *tids;
+	long failed = 0;
+	double start, elapsed;
+	FILE *f;
+
+	while ((opt = getopt(argc, argv, "t:n:k:Sc:")) != -1) {
+		switch (opt) {
+		case 't':
+			threads = atoi(optarg);
+			break;
+		case 'n':
+			pairs = strtoul(optarg, NULL, 0);
+			break;
+		case 'k':
+			names = atoi(optarg);
+			break;
+		case 'S':
+			shared = 1;
+			break;
+		case 'c':
+			coalesce = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-t threads] [-n pairs] [-k names] [-S] [-c coalesce_ms]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (threads < 1 || names < 1)
+		return 1;
+
+	if (coalesce >= 0) {
+		f = fopen(COALESCE, "r");
+		if (!f || !fgets(old_coalesce, sizeof(old_coalesce), f)) {
+			perror(COALESCE);
+			return 1;
+		}
+		fclose(f);
+
+		snprintf(buf, sizeof(buf), "%d", coalesce);
+		if (write_str(COALESCE, buf)) {
+			perror(COALESCE);
+			return 1;
+		}
+	}
+
+	tids = calloc(threads, sizeof(*tids));
+	if (!tids)
+		return 1;
+
+	start = now();
+	for (i = 0; i < threads; i++)
+		pthread_create(&tids[i], NULL, worker, (void *)(long)i);
+	for (i = 0; i < threads; i++) {
+		void *ret;
+
+		pthread_join(tids[i], &ret);
+		failed += (long)ret;
+	}
+	elapsed = now() - start;
+
+	if (old_coalesce[0])
+		write_str(COALESCE, old_coalesce);
+
+	printf("%d threads, %s names, %lu pairs each: %.2f s, %.0f pairs/s, %ld failed\n",
+	       threads, shared ? "shared" : "private", pairs, elapsed,
+	       threads * pairs / elapsed, failed);
+	show_stats();
+
+	return failed != 0;
+}
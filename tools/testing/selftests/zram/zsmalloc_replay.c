@@ -0,0 +1,239 @@
+/*
+ * Replays a zsmalloc alloc/free trace through a zram device and reports
+ * the pool's memory use and per-class fragmentation and compaction
+ * statistics.
+ *
+ * An allocation of <size> bytes writes a page whose first <size> bytes are
+ * random, so that it compresses to about that size; a free discards it.
+ *
+ * Trace lines:
+ *	a <slot> <size>
+ *	f <slot>
+ * Without a trace, a synthetic churn of mixed object sizes is replayed.
+ *
+ * Usage: zsmalloc_replay [-d /dev/zram0] [-t trace] [-n ops] [-s seed]
+ *			  [-i report_interval]
+ *
+ * Needs the zram device to be set up (disksize), and debugfs mounted for
+ * the per-class statistics.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+
+#define PAGE_SZ		4096
+
+static int fd;
+static unsigned char *page;
+static unsigned char *live;
+static unsigned long nr_slots, nr_live;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void cat(const char *path)
+{
+	char buf[4096];
+	FILE *f = fopen(path, "r");
+	size_t n;
+
+	if (!f) {
+		printf("%s: %s\n", path, strerror(errno));
+		return;
+	}
+
+	printf("%s:\n", path);
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		fwrite(buf, 1, n, stdout);
+	fclose(f);
+}
+
+static int do_alloc(unsigned long slot, unsigned int size)
+{
+	unsigned int i;
+
+	if (slot >= nr_slots)
+		return -1;
+
+	if (size > PAGE_SZ)
+		size = PAGE_SZ;
+	for (i = 0; i < size; i++)
+		page[i] = rand();
+	memset(page + size, 0, PAGE_SZ - size);
+
+	if (pwrite(fd, page, PAGE_SZ, (off_t)slot * PAGE_SZ) != PAGE_SZ) {
+		perror("pwrite");
+		return -1;
+	}
+
+	if (!live[slot]) {
+		live[slot] = 1;
+		nr_live++;
+	}
+	return 0;
+}
+
+static int do_free(unsigned long slot)
+{
+	unsigned long long range[2] = { (unsigned long long)slot * PAGE_SZ,
+					PAGE_SZ };
+
+	if (slot >= nr_slots)
+		return -1;
+
+	if (ioctl(fd, BLKDISCARD, range)) {
+		perror("BLKDISCARD");
+		return -1;
+	}
+
+	if (live[slot]) {
+		live[slot] = 0;
+		nr_live--;
+	}
+	return 0;
+}
+
+/* Mostly mid-sized objects, with small and near-incompressible tails */
+static unsigned int synthetic_size(void)
+{
+	int r = rand() % 100;
+
+	if (r < 30)
+		return 64 + rand() % 600;
+	if (r < 80)
+		return 1000 + rand() % 1600;
+	return 3000 + rand() % 1000;
+}
+
+static int synthetic_op(void)
+{
+	unsigned long slot = rand() % nr_slots;
+
+	/* Free more often as the device fills up, to keep the pool churning */
+	if (live[slot] && rand() % nr_slots < nr_live * 2)
+		return do_free(slot);
+
+	return do_alloc(slot, synthetic_size());
+}
+
+static int trace_op(FILE *trace)
+{
+	char line[128];
+	unsigned long slot;
+	unsigned int size;
+
+	while (fgets(line, sizeof(line), trace)) {
+		if (sscanf(line, "a %lu %u", &slot, &size) == 2)
+			return do_alloc(slot, size);
+		if (sscanf(line, "f %lu", &slot) == 1)
+			return do_free(slot);
+	}
+
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	const char *dev = "/dev/zram0", *trace_path = NULL;
+	unsigned long ops = 200000, interval = 0, done = 0;
+	unsigned long long size;
+	FILE *trace = NULL;
+	char path[256], name[64], *base;
+	double start;
+	int opt, ret = 0;
+	unsigned int seed = 1;
+
+	while ((opt = getopt(argc, argv, "d:t:n:s:i:")) != -1) {
+		switch (opt) {
+		case 'd':
+			dev = optarg;
+			break;
+		case 't':
+			trace_path = optarg;
+			break;
+		case 'n':
+			ops = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			interval = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-d dev] [-t trace] [-n ops] [-s seed] [-i interval]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	srand(seed);
+	base = strdup(dev);
+	snprintf(name, sizeof(name), "%s", basename(base));
+	free(base);
+
+	fd = open(dev, O_RDWR | O_DIRECT);
+	if (fd < 0 || ioctl(fd, BLKGETSIZE64, &size)) {
+		perror(dev);
+		return 1;
+	}
+
+	nr_slots = size / PAGE_SZ;
+	live = calloc(nr_slots, 1);
+	if (!nr_slots || !live || posix_memalign((void **)&page, PAGE_SZ, PAGE_SZ)) {
+		fprintf(stderr, "%s: no memory or empty device\n", dev);
+		return 1;
+	}
+
+	if (trace_path) {
+		trace = fopen(trace_path, "r");
+		if (!trace) {
+			perror(trace_path);
+			return 1;
+		}
+	}
+
+	snprintf(path, sizeof(path), "/sys/block/%s/mm_stat", name);
+
+	start = now();
+	while (trace || done < ops) {
+		ret = trace ? trace_op(trace) : synthetic_op();
+		if (ret)
+			break;
+		done++;
+
+		if (interval && !(done % interval)) {
+			printf("%lu ops, %lu live, %.2f s\n", done, nr_live,
+			       now() - start);
+			cat(path);
+		}
+	}
+
+	printf("%lu ops in %.2f s, %lu live objects\n", done, now() - start,
+	       nr_live);
+	cat(path);
+
+	snprintf(path, sizeof(path), "/sys/kernel/debug/zsmalloc/%s/compaction",
+		 name);
+	cat(path);
+
+	if (trace)
+		fclose(trace);
+	close(fd);
+
+	return ret < 0;
+}